@@ -68,7 +68,12 @@ rm -rf *
 
 # Запускаем CMake
 echo "Запуск CMake..."
-cmake ..
+CMAKE_ARGS=""
+if [ "${BUILD_SQLCIPHER_PLUGIN}" = "1" ]; then
+  # Приложение и плагин qsqlite должны использовать одну библиотеку SQLite
+  CMAKE_ARGS="-DUSE_SQLCIPHER=ON"
+fi
+cmake .. $CMAKE_ARGS
 
 # Проверяем успешность CMake
 if [ $? -ne 0 ]; then
@@ -117,7 +117,7 @@ run_interactive() {
     docker run -it --rm \
         -e DISPLAY=$DISPLAY \
         -e QT_QPA_PLATFORM=xcb \
-        -e QT_PLUGIN_PATH=/app/sqldrivers \
+        -e QT_PLUGIN_PATH=/app \
         -v /tmp/.X11-unix:/tmp/.X11-unix:rw \
         -v "$(pwd)/data:/app/data" \
         -v "$(pwd)/templates:/app/templates" \
@@ -1,20 +1,63 @@
 #pragma once
 #include <QDialog>
+#include <functional>
 
-QT_BEGIN_NAMESPACE
-namespace Ui { class AdminAuthDialog; }
-QT_END_NAMESPACE
+class QCheckBox;
+class QDialogButtonBox;
+class QLabel;
+class QLineEdit;
+class QProgressBar;
+class QThread;
 
+// Окно ввода пароля (админ-пароль, мастер-пароль). Если задан verifier,
+// проверка — растяжение ключа на сотни миллисекунд — идёт в отдельном
+// потоке: окно не замирает, показывает индикатор занятости, а при неверном
+// пароле предлагает повторить ввод, пока не исчерпаны попытки. Accepted —
+// пароль подтверждён. Без verifier окно просто возвращает введённый пароль.
+// Пока идёт проверка, окно нельзя закрыть: её итог не должен остаться без хозяина.
 class AdminAuthDialog : public QDialog {
     Q_OBJECT
 public:
+    // Итог проверки. verifier не меняет общего состояния — он только считает;
+    // apply (ключи, перезапись записей) выполняется в потоке окна перед accept()
+    struct Verdict {
+        bool ok = false;
+        std::function<void()> apply;
+    };
+    using Verifier = std::function<Verdict(const QString&)>;
+
     explicit AdminAuthDialog(QWidget* parent = nullptr);
     ~AdminAuthDialog();
+
+    void setPrompt(const QString& title, const QString& text);
+    // verifier вызывается в рабочем потоке
+    void setVerifier(Verifier verifier, int maxAttempts = 1);
+
     QString password() const;
+    int failedAttempts() const { return m_failed; }
+
+public slots:
+    void reject() override;
 
 private slots:
-    void onShowToggled(bool on); // слот, на который ссылается moc
+    void onShowToggled(bool on);
+    void onAccepted();
 
 private:
-    Ui::AdminAuthDialog* ui;
-};
\ No newline at end of file
+    void setBusy(bool busy);
+    void onVerified(quint64 ticket, const Verdict& verdict);
+
+    QLabel*           m_prompt = nullptr;
+    QLineEdit*        m_edit = nullptr;
+    QCheckBox*        m_show = nullptr;
+    QProgressBar*     m_busy = nullptr;
+    QLabel*           m_status = nullptr;
+    QDialogButtonBox* m_buttons = nullptr;
+
+    Verifier m_verifier;
+    int m_maxAttempts = 1;
+    int m_failed = 0;
+    quint64 m_ticket = 0;   // номер текущей проверки: ответы отменённых не учитываются
+    QThread* m_worker = nullptr;
+    QString m_verified;     // пароль, прошедший проверку
+};
@@ -15,7 +15,8 @@ public:
     QString storedRecord() const;
     bool setStoredRecord(const QString& record);
 
-    static QString hashPassword(const QString& pwd, int iterations = 500000);
+    // Запись PBKDF2; iterations <= 0 — подбор под время проверки (Pbkdf2::calibrate)
+    static QString hashPassword(const QString& pwd, int iterations = 0);
     static bool verifyAgainstRecord(const QString& pwd, const QString& record);
 
 private:
@@ -0,0 +1,45 @@
+#pragma once
+#include <QByteArray>
+#include <QIODevice>
+#include <functional>
+
+// ChaCha20-Poly1305 (RFC 8439): шифрование с проверкой целостности.
+// Ключевой поток ChaCha20 считается по четыре блока за раз в векторных
+// регистрах (SSE2 на x86-64), без SSE2 — поблочно.
+//
+// Короткие значения (поля БД) — seal()/open(): случайный nonce пишется
+// перед шифртекстом, тег — после. aad — контекст (например, имя колонки),
+// который не шифруется, но проверяется: шифртекст одной колонки не
+// расшифруется, если его переставить в другую.
+//
+// Потоки (резервные копии, выгрузки) — encryptStream()/decryptStream():
+// заголовок и куски по kChunkSize. Nonce куска — случайный префикс из
+// заголовка, номер куска и признак последнего, поэтому переставить,
+// выбросить или отрезать куски незаметно нельзя. Память — два буфера
+// куска, независимо от размера потока.
+class Aead {
+public:
+    static constexpr int kKeySize = 32;
+    static constexpr int kNonceSize = 12;
+    static constexpr int kTagSize = 16;
+    static constexpr int kChunkSize = 1 << 20;
+
+    // nonce || шифртекст || тег
+    static QByteArray seal(const QByteArray& key, const QByteArray& plaintext,
+                           const QByteArray& aad = QByteArray());
+    static bool open(const QByteArray& key, const QByteArray& sealed, QByteArray* plaintext,
+                     const QByteArray& aad = QByteArray());
+
+    // progress получает число обработанных байт исходного потока;
+    // вернул false — операция прерывается
+    using Progress = std::function<bool(qint64)>;
+    static bool encryptStream(const QByteArray& key, QIODevice& in, QIODevice& out,
+                              const Progress& progress = Progress());
+    static bool decryptStream(const QByteArray& key, QIODevice& in, QIODevice& out,
+                              const Progress& progress = Progress());
+
+    // Начинается ли устройство с заголовка зашифрованного потока (позиция не меняется)
+    static bool isEncryptedStream(QIODevice& in);
+
+    static QByteArray randomBytes(int size);
+};
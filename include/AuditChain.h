@@ -0,0 +1,54 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+
+// Итог проверки цепочки журнала
+struct AuditVerifyResult {
+    bool ok = false;
+    bool incremental = false;   // начата с последней проверенной контрольной точки
+    qint64 rowsChecked = 0;
+    int partitions = 0;         // сколько месяцев проверялось (параллельно)
+    int checkpoints = 0;        // сколько подписей проверено
+    qint64 firstBadId = 0;      // первая строка, на которой цепочка разошлась
+    qint64 elapsedMs = 0;
+    QString message;
+};
+
+// Цепочка хешей журнала аудита. hash строки — SHA-256 от hash предыдущей
+// строки (по id) и канонической записи её полей, поэтому правка или
+// удаление строки ломают все последующие звенья. Контрольные точки
+// подписываются HMAC-SHA256 ключом, выведенным из ключа данных (его
+// открывает только мастер-пароль): пересчитать цепочку после правки без
+// пароля не получится — подпись не сойдётся.
+class AuditChain {
+public:
+    static constexpr int kHashSize = 32;
+
+    // Звено до первой строки журнала
+    static QByteArray genesis();
+
+    static QByteArray rowHash(const QByteArray& prev, qint64 id, qint64 tsMs, const QString& ts,
+                              const QString& actor, const QString& event, const QString& details,
+                              int severity);
+
+    static QByteArray checkpointSignature(const QByteArray& key, qint64 lastId, const QByteArray& hash,
+                                          qint64 createdMs, int kind);
+
+    // Ключ подписи из ключа данных (Security::dataKey); пустой — без ключа данных
+    static QByteArray deriveKey(const QByteArray& dataKey);
+    // Ключ прежних версий (файл audit.key рядом с журналом) — только для
+    // переподписи старых точек; нет файла — пустой
+    static QByteArray readLegacyKey(const QString& path);
+
+    // Проверка звеньев одного месяца на собственном соединении — вызывается
+    // из рабочего потока. Строки с id > afterId, prev — звено перед первой из них
+    struct RangeResult {
+        qint64 rows = 0;
+        qint64 firstBadId = 0;
+        qint64 lastId = 0;        // последняя сверенная строка и её hash
+        QByteArray lastHash;
+        QString error;
+    };
+    static RangeResult verifyRange(const QString& dbPath, const QString& partition,
+                                   qint64 afterId, const QByteArray& prev);
+};
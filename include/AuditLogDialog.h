@@ -18,20 +18,36 @@
 #include <QHeaderView>   
 #include <QLabel> 
 
+class QThread;
+
 class AuditLogDialog : public QDialog {
     Q_OBJECT
 public:
     explicit AuditLogDialog(QWidget* parent = nullptr);
+    ~AuditLogDialog() override;
 private slots:
     void reload();
+    void loadMore();
     void exportCsv();
     void clearOld();
+    void verifyChain();
 private:
+    AuditQuery currentQuery() const;
+    void reloadFilterValues();
+    void showVerifyResult(const AuditVerifyResult& result);
+
     QTableWidget* m_table = nullptr;
     QLineEdit*    m_filterEdit = nullptr;
     QDateEdit*    m_fromEdit = nullptr;
     QDateEdit*    m_toEdit = nullptr;
     QComboBox*    m_sevCombo = nullptr;
+    QComboBox*    m_eventCombo = nullptr;
+    QComboBox*    m_actorCombo = nullptr;
     QPushButton*  m_btnExport = nullptr;
     QPushButton*  m_btnClear = nullptr;
+    QPushButton*  m_btnVerify = nullptr;
+    QPushButton*  m_btnMore = nullptr;
+    QLabel*       m_countLabel = nullptr;
+    AuditCursor   m_cursor;     // последняя показанная строка — начало следующей страницы
+    QThread*      m_verifyThread = nullptr; // проверка цепочки идёт в фоне
 };
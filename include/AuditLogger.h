@@ -3,7 +3,15 @@
 #include <QDateTime>
 #include <QSqlDatabase>
 #include <QVariantMap>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "AuditRing.h"
+#include "AuditStore.h"
 
 enum class AuditSeverity : int {
     Info     = 0,
@@ -12,13 +20,25 @@ enum class AuditSeverity : int {
     Security = 3
 };
 
+// Журнал аудита. Хранится отдельно от рабочей БД (см. AuditStore), поэтому
+// не спорит с ней за блокировки и не попадает в её бэкапы. log() только
+// кладёт событие в кольцевой буфер; отдельный поток-писатель на своём
+// соединении забирает события пачками и пишет их одной транзакцией.
+// При переполнении буфера события Info/Warning отбрасываются (их число
+// попадает в журнал отдельной записью), а Error и Security ждут, пока
+// писатель освободит место, — они не теряются никогда. Соединение окна
+// (m_store) трогается только из потока логгера: без писателя события из
+// других потоков передаются туда через очередь событий.
 class AuditLogger : public QObject {
     Q_OBJECT
 public:
     static AuditLogger& instance();
+    ~AuditLogger();
 
-    // Использовать конкретное имя соединения БД (по умолчанию — default)
-    void init(const QString& connectionName = QString());
+    // connectionName — соединение рабочей БД (по умолчанию — default): из неё
+    // однократно переносится старая таблица audit_log. auditDbPath — файл
+    // журнала; пусто — audit.db рядом с рабочей БД
+    void init(const QString& connectionName = QString(), const QString& auditDbPath = QString());
 
     // Позволяет прокинуть «кто» выполняет действие (админ/пользователь)
     void setActorProvider(std::function<QString()> provider);
@@ -28,23 +48,60 @@ public:
              const QString& details = QString(),
              AuditSeverity severity = AuditSeverity::Info);
 
-    // Чтение лога с фильтрами (limit <= 0 значит без лимита)
-    QList<QVariantMap> fetch(int limit = 1000,
-                             const QDateTime& from = QDateTime(),
-                             const QDateTime& to = QDateTime(),
-                             const QString& textFilter = QString(),
-                             int severityFilter = -1);
+    // Дождаться, пока все поставленные события окажутся в БД
+    void flush();
 
-    // Удалить старше даты
+    // Дозаписать очередь и остановить писателя; дальше log() пишет синхронно
+    void shutdown();
+
+    // Сколько событий отброшено из-за переполнения с момента запуска
+    quint64 droppedCount() const { return m_droppedTotal.load(std::memory_order_relaxed); }
+
+    // Страница журнала от новых к старым. cursor — позиция после предыдущей
+    // страницы (пустой — с начала); после вызова указывает на последнюю строку
+    QList<QVariantMap> fetchPage(const AuditQuery& query, int limit, AuditCursor* cursor);
+
+    // Значения для фильтров диалога
+    QStringList knownEvents();
+    QStringList knownActors();
+
+    // Проверка цепочки хешей журнала (см. AuditStore::verify). Файл журнала
+    // проверяется на собственном соединении — можно звать из рабочего потока
+    AuditVerifyResult verifyIntegrity(bool full = false);
+
+    // Удалить старше даты: целые месяцы удаляются вместе с таблицей
     bool clearOlderThan(const QDateTime& before);
 
-    // Экспорт в CSV
-    static bool exportCsv(const QString& path, const QList<QVariantMap>& rows);
+    // Экспорт в CSV: строки идут с курсора БД прямо в файл, без списка в памяти
+    bool exportCsv(const QString& path, const AuditQuery& query, int* rowsWritten = nullptr);
 
 private:
     explicit AuditLogger(QObject* parent = nullptr);
-    void ensureTable();
+    QSqlDatabase operationalDatabase() const;
+
+    void startWriter();
+    void stopWriter();
+    void writerLoop();
+    void writeSync(const AuditRecord& record);
+    void writeOnOwner(const AuditRecord& record);
 
-    QString m_connectionName; // имя соединения QSqlDatabase
+    QString m_connectionName; // соединение рабочей БД
+    QString m_databasePath;   // файл журнала для соединения писателя
+    QByteArray m_signingKey;  // ключ подписи контрольных точек (из ключа данных)
+    std::unique_ptr<AuditStore> m_store; // соединение потока окна: чтение, очистка, синхронная запись
     std::function<QString()> m_actorProvider;
+
+    AuditRing<AuditRecord> m_ring;
+    std::thread m_writer;
+    std::atomic_bool m_writerRunning{false};
+    std::atomic<quint64> m_dropped{0};      // ещё не записанные в журнал
+    std::atomic<quint64> m_droppedTotal{0};
+
+    std::mutex m_mutex;                     // только для ожидания, не для очереди
+    std::condition_variable m_wake;
+    std::condition_variable m_flushed;
+    std::condition_variable m_space;        // писатель забрал пачку из буфера
+    bool m_stop = false;
+    quint64 m_flushRequested = 0;
+    quint64 m_flushDone = 0;
 };
@@ -0,0 +1,122 @@
+#pragma once
+#include <QDateTime>
+#include <QList>
+#include <QSet>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <functional>
+#include "AuditChain.h"
+#include "SqlCipher.h"
+
+// Событие журнала: время берётся в момент log(), строка ts форматируется при записи
+struct AuditRecord {
+    qint64 msecs = 0;
+    QString actor;
+    QString event;
+    QString details;
+    int severity = 0;
+};
+
+// Фильтр журнала. text ищется по словам (с префиксом) в actor/event/details
+// через FTS5; event, actor и severity — точное совпадение по индексам
+struct AuditQuery {
+    QDateTime from;
+    QDateTime to;
+    QString text;
+    QString event;
+    QString actor;
+    int severity = -1;
+};
+
+// Позиция для постраничного чтения: последняя выданная строка (ts_ms, id).
+// Следующая страница начинается строго после неё — без OFFSET
+struct AuditCursor {
+    qint64 tsMs = 0;
+    qint64 id = 0;
+    bool isNull() const { return id == 0; }
+};
+
+// Отдельный файл журнала аудита (audit.db) со своим соединением и pragma.
+// Записи разложены по помесячным таблицам audit_YYYYMM (месяц — по местному
+// времени, как и ts), id сквозные между таблицами. Порядок и диапазоны — по
+// целочисленному ts_ms; у каждого месяца индексы по времени, событию,
+// пользователю и уровню и FTS5-таблица audit_YYYYMM_fts по тексту. Строки
+// сцеплены хешами (AuditChain) в порядке id, поверх цепочки раз в
+// kCheckpointEvery строк пишутся подписанные контрольные точки. Хранение
+// старых данных ограничивается удалением целых месяцев, а не DELETE по
+// всему журналу.
+// Экземпляр привязан к потоку, в котором открыт: писатель и окно держат
+// каждый свой.
+class AuditStore {
+public:
+    explicit AuditStore(const QString& connectionName);
+    ~AuditStore();
+
+    bool open(const QString& path);
+    // Ключ подписи контрольных точек; без него точки не пишутся
+    void setSigningKey(const QByteArray& key) { m_key = key; }
+    void close();
+    bool isOpen() const;
+    QString lastError() const;
+
+    // Пачка событий одной транзакцией; нужные месяцы создаются по ходу
+    bool insert(const QList<AuditRecord>& records);
+
+    // Месяцы, пересекающиеся с [from, to] (невалидная граница — без ограничения)
+    QStringList partitions(const QDateTime& from = QDateTime(), const QDateTime& to = QDateTime());
+
+    // Строки от новых к старым, начиная после cursor (пустой — с самой новой).
+    // Месяцы читаются по очереди, каждый своим индексным запросом, и строки
+    // отдаются в row прямо с курсора; row вернул false — чтение прекращается.
+    // limit <= 0 — без ограничения. Колонки: id, ts_ms, ts, actor, event, details, severity
+    using RowHandler = std::function<bool(const QSqlQuery&)>;
+    bool forEach(const AuditQuery& query, const AuditCursor& cursor, int limit, const RowHandler& row);
+
+    // Различные значения event или actor — для списков фильтров
+    QStringList distinctValues(const QString& column);
+
+    // Месяцы целиком старше before удаляются DROP TABLE, в месяце before
+    // удаляются только ранние строки
+    bool dropOlderThan(const QDateTime& before);
+
+    // Перенос старой таблицы audit_log из операционной БД (однократно).
+    // key/format — как открыть её файл, если он зашифрован SQLCipher
+    bool importLegacy(const QString& operationalPath, const QByteArray& key = QByteArray(),
+                      const SqlCipher::Options& format = SqlCipher::Options());
+
+    // Подписать текущую голову цепочки (при остановке писателя)
+    bool checkpoint();
+
+    // Точки, подписанные oldKey, переподписать текущим ключом (смена ключа).
+    // Точки с неверной подписью не трогаются — проверка покажет их как раньше
+    bool resignCheckpoints(const QByteArray& oldKey);
+
+    // Проверка цепочки. По умолчанию — от последней проверенной контрольной
+    // точки: старые строки уже сверены и закреплены подписью. Месяцы
+    // проверяются параллельно, каждый на своём соединении
+    AuditVerifyResult verify(bool full = false);
+
+    static QString partitionName(const QDateTime& ts);
+
+private:
+    QSqlDatabase database() const;
+    bool ensurePartition(const QString& name);
+    bool createPartitionObjects(QSqlQuery& q, const QString& name);
+    bool upgradeSchema();
+    bool readHead(QSqlQuery& q, qint64* id, QByteArray* hash);
+    bool writeHead(QSqlQuery& q, qint64 id, const QByteArray& hash);
+    bool sealPending(QSqlQuery& q);
+    bool addCheckpoint(QSqlQuery& q, qint64 lastId, const QByteArray& hash, int kind);
+    QByteArray hashBefore(const QStringList& names, int index, qint64 id);
+    QString whereClause(const QString& partition, const AuditQuery& query,
+                        const AuditCursor& cursor, QVariantList& binds) const;
+
+    QString m_connectionName;
+    QString m_path;
+    QByteArray m_key;
+    bool m_fts = false;    // SQLite собран с FTS5
+    QSet<QString> m_known; // месяцы, созданные или проверенные этим соединением
+};
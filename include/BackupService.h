@@ -0,0 +1,70 @@
+#pragma once
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class QSqlDatabase;
+class QThread;
+
+// Резервное копирование без остановки работы: страницы БД копируются
+// SQLite Online Backup API небольшими шагами в отдельном потоке, на
+// собственных соединениях. Между шагами блокировки отпускаются и поток
+// уступает время, поэтому запись в базу с рабочих мест продолжается.
+//
+// В режиме WAL источник держит одну транзакцию чтения — снимок на момент
+// начала, писатели ей не мешают. В режиме журнала отката запись из другого
+// соединения заставляет SQLite начать копию заново; шаг после каждого
+// перезапуска удваивается, чтобы копия успела завершиться между записями.
+//
+// Открытая копия пишется во временный файл рядом и получает итоговое имя
+// только целиком. Зашифрованная (.dbx) снимается в закрытый временный
+// каталог рядом с БД и оттуда потоком шифруется ключом данных (Aead) в
+// файл назначения — открытые данные к месту назначения не попадают.
+class BackupService : public QObject {
+    Q_OBJECT
+public:
+    static constexpr int kPagesPerStep = 256;  // 1 МиБ при странице 4 КиБ
+    static constexpr int kStepPauseMs = 10;
+    static constexpr int kBusyPauseMs = 100;   // источник занят писателем
+
+    explicit BackupService(QObject* parent = nullptr);
+    ~BackupService();
+
+    // false — копия уже идёт. Отменённую, но ещё не закрывшую файлы копию
+    // сначала дожидается
+    bool start(const QString& path, bool encrypt);
+    void cancel();
+    // Копия идёт и её результат ждут
+    bool isActive() const { return m_activeJob != 0; }
+    // Поток копии ещё держит файлы БД открытыми (в том числе после cancel())
+    bool isRunning() const { return m_thread != nullptr; }
+    // Дождаться завершения потока; после cancel() это доли секунды
+    void waitForFinished();
+
+    // Процент готовности; вернул false — копирование прерывается
+    using Progress = std::function<bool(int percent)>;
+    // Синхронная копия текущей БД (вызывается из любого потока). Непустой
+    // dataKey — копия шифруется им целиком
+    static bool backup(const QString& path, const QByteArray& dataKey,
+                       const Progress& progress = Progress(), QString* error = nullptr);
+    // Постраничная копия source в target; оба соединения уже открыты и с ключом
+    static bool copyPages(QSqlDatabase& source, QSqlDatabase& target, const Progress& progress,
+                          int* restarts, QString* error);
+
+signals:
+    void started(const QString& path);
+    void progress(int percent);
+    void finished(const QString& path, bool ok, const QString& error);
+    void cancelled();
+
+private:
+    void onJobDone(quint64 jobId, const QString& path, bool ok, const QString& error);
+
+    QThread* m_thread = nullptr;
+    std::shared_ptr<std::atomic_bool> m_cancel;
+    quint64 m_nextJobId = 0;
+    quint64 m_activeJob = 0;
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+// Слепые индексы для поиска по зашифрованным полям клиента. Токен —
+// HMAC-SHA256 нормализованного значения на ключе, выведенном из ключа
+// данных (первые 16 байт, hex). Одинаковые значения дают одинаковые
+// токены, поэтому точный поиск — обычный поиск по индексу колонки, а
+// значение по токену без ключа не восстановить. Для поиска по последним
+// цифрам телефона у каждого номера хранятся токены его окончаний длиной
+// kMinSuffix..kMaxSuffix (таблица customer_phone_suffix).
+class BlindIndex {
+public:
+    static constexpr int kMinSuffix = 4;
+    static constexpr int kMaxSuffix = 10;
+
+    // Только цифры: "1234 567890" и "1234567890" дают один токен
+    static QString normalizePassport(const QString& value);
+    // Цифры; 8XXXXXXXXXX и XXXXXXXXXX приводятся к 7XXXXXXXXXX
+    static QString normalizePhone(const QString& value);
+
+    // Пусто — нечего индексировать или ключ данных не загружен
+    static QString passportToken(const QString& passport);
+    static QString phoneToken(const QString& phone);
+    static QStringList phoneSuffixTokens(const QString& phone);
+    // Токен для поиска по введённым последним цифрам номера
+    static QString suffixToken(const QString& digits);
+
+private:
+    static QByteArray key();
+    static QString token(const QByteArray& key, const char* domain, const QString& normalized);
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <QDateTime>
+#include <QList>
+#include <QMap>
+#include <QString>
+
+class Rental;
+class ReportSink;
+
+// Данные договора и квитанции, уже отформатированные для печати. Обычная
+// структура без ссылок на БД и модели — её можно отдавать в рабочие потоки.
+struct ContractData {
+    int rentalId = 0;
+    QString customerName;
+    QString customerPhone;
+    QString customerEmail;
+    QString customerPassport;
+    QString customerAddress;
+    QString equipmentName;
+    QString equipmentCategory;
+    QString equipmentPrice;
+    QString quantity;
+    QString start;
+    QString end;
+    QString totalPrice;
+    QString deposit;
+    QString notes;
+    // Для квитанции о возврате
+    bool completed = false;
+    QString finalPrice;
+    QString damageCost;
+    QString cleaningCost;
+    QString finalDeposit;
+
+    static ContractData fromRental(const Rental& rental);
+    // Одним запросом; порядок — как в ids, ненайденные пропускаются
+    static QList<ContractData> loadMany(const QList<int>& ids);
+
+    QMap<QString, QString> placeholders() const; // {{DATE}}, {{CUSTOMER_NAME}}, ...
+};
+
+void writeContract(ReportSink& sink, const ContractData& data);
+void writeReceipt(ReportSink& sink, const ContractData& data);
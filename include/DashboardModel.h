@@ -0,0 +1,62 @@
+#pragma once
+#include <QObject>
+#include <QDate>
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <QTimer>
+#include "rentalmanager.h"
+
+struct DashboardTotals {
+    int activeRentals = 0;
+    int overdueRentals = 0;
+    double todayRevenue = 0.0;  // завершённые сегодня, по итоговой стоимости
+    double depositsHeld = 0.0;  // залоги по активным арендам
+};
+
+// Показатели вкладки «Сводка». Считаются одним запросом при reload(), дальше
+// ведутся по событиям RentalManager: у каждой активной аренды хранится её
+// вклад, поэтому любое событие меняет итоги за O(1) без обращения к БД.
+class DashboardModel : public QObject {
+    Q_OBJECT
+public:
+    explicit DashboardModel(RentalManager* manager, QObject* parent = nullptr);
+
+    bool reload();
+    DashboardTotals totals() const { return m_totals; }
+    QMap<QString, int> unitsOutByCategory() const;
+
+signals:
+    void reset();                                              // после reload()
+    void totalsChanged();
+    void categoryUnitsChanged(const QString& category, int units);
+
+private slots:
+    void onRentalCreated(Rental* rental);
+    void onRentalCompleted(Rental* rental);
+    void onRentalCancelled(Rental* rental);
+    void onRentalsCompleted(const QList<RentalReturnLine>& lines);
+    void onRentalOverdue(Rental* rental);
+    void onNewDay();
+
+private:
+    struct ActiveRental {
+        QString category;
+        int quantity = 0;
+        double totalPrice = 0.0;
+        double deposit = 0.0;
+        bool overdue = false;
+    };
+
+    void addActive(int rentalId, const ActiveRental& entry);
+    // Снимает вклад аренды; revenue < 0 — аренда не принесла выручки (отмена)
+    void removeActive(int rentalId, double revenue);
+    void addUnits(const QString& category, int delta);
+    void scheduleMidnight();
+
+    QHash<int, ActiveRental> m_active;
+    QHash<QString, int> m_unitsOut;
+    DashboardTotals m_totals;
+    QDate m_today;
+    QTimer m_midnightTimer;
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+
+struct DocumentBatchRequest {
+    QList<int> rentalIds;
+    QString outputDir;
+    QString templatePath;     // DOCX-шаблон договора; пусто — DOCX не создаются
+    bool docx = true;
+    bool pdf = false;         // договор в PDF на каждую аренду
+    bool receipts = false;    // квитанция в PDF на каждую аренду
+    bool mergedPdf = false;   // все договоры (и квитанции) одним PDF
+};
+
+// Пакетная подготовка договоров и квитанций. Данные всех аренд читаются
+// одним запросом в потоке окна, шаблон компилируется один раз, а сами
+// документы собираются параллельно в пуле потоков — без диалогов на
+// каждый документ. Общий PDF пишется отдельной задачей последовательно.
+class DocumentBatchJob : public QObject {
+    Q_OBJECT
+public:
+    explicit DocumentBatchJob(QObject* parent = nullptr);
+    ~DocumentBatchJob();
+
+    bool start(const DocumentBatchRequest& request, QString* error = nullptr);
+    void cancel();
+    bool isRunning() const { return m_pending > 0; }
+
+signals:
+    void progress(int done, int total);
+    void itemFailed(int rentalId, const QString& error);
+    void finished(const QStringList& files, int failed, bool cancelled);
+
+private:
+    void onTaskDone(int rentalId, const QStringList& files, const QString& error);
+
+    QThreadPool m_pool;
+    std::shared_ptr<std::atomic_bool> m_cancel;
+    int m_total = 0;
+    int m_pending = 0;
+    int m_failed = 0;
+    QStringList m_files;
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <QByteArray>
+#include <QDateTime>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include "ZipArchive.h"
+
+// DOCX-шаблон, скомпилированный один раз: word/document.xml разобран в
+// список литеральных кусков и слотов заполнителей, остальные части архива
+// хранятся в сжатом виде. Заполнение — один линейный проход по сегментам
+// с экранированными значениями и сжатие результата; шаблон не меняется и
+// может одновременно использоваться из нескольких потоков.
+//
+// Заполнители вида {{NAME}} ищутся в тексте абзаца, а не в XML, поэтому
+// находятся и тогда, когда Word разбил их на несколько <w:r>/<w:t>.
+class DocxTemplate {
+public:
+    // Из кэша по пути; перекомпилируется, если файл изменился (mtime, размер)
+    static std::shared_ptr<const DocxTemplate> load(const QString& path, QString* error = nullptr);
+    static void clearCache();
+
+    static bool fill(const QString& templatePath, const QMap<QString, QString>& values,
+                     const QString& outputPath, QString* error = nullptr);
+
+    bool write(const QMap<QString, QString>& values, const QString& outputPath,
+               QString* error = nullptr) const;
+    QByteArray renderDocument(const QMap<QString, QString>& values) const;
+    QStringList placeholders() const;
+
+private:
+    // Литерал, за которым (если key не пуст) следует слот заполнителя
+    struct Segment {
+        QByteArray literal;
+        QString key;
+    };
+    struct Part {
+        ZipEntry entry;
+        QByteArray raw;
+    };
+
+    bool compile(const QString& path, QString* error);
+
+    QList<Part> m_parts;
+    int m_documentPart = -1;
+    QList<Segment> m_segments;
+    qsizetype m_literalSize = 0;
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <QObject>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QTimer>
+
+enum class NotificationKind : int {
+    Overdue        = 0,
+    ReturnReminder = 1
+};
+
+struct Notification {
+    NotificationKind kind = NotificationKind::Overdue;
+    int rentalId = 0;
+    QString message;
+    QDateTime createdAt;
+};
+
+// Центр уведомлений: копит алерты по арендам, убирает повторы и отдаёт их
+// одним немодальным дайджестом не чаще заданного интервала. Дайджест можно
+// дублировать в spool-каталог для внешнего рассыльщика.
+class NotificationCenter : public QObject {
+    Q_OBJECT
+public:
+    explicit NotificationCenter(QObject* parent = nullptr);
+
+    void post(NotificationKind kind, int rentalId, const QString& message);
+
+    void setCoalesceInterval(int ms);          // сколько ждать, собирая пачку
+    void setMinDigestInterval(int ms);         // не чаще одного дайджеста за интервал
+    void setRepeatSuppression(int secs);       // тот же алерт по аренде не чаще чем раз в
+    void setSpoolDirectory(const QString& dir); // пусто — не писать в файл
+
+    int pendingCount() const { return m_pending.size(); }
+    void flush(); // отдать накопленное немедленно, минуя лимит
+
+signals:
+    void digestReady(const QList<Notification>& items);
+
+private:
+    void scheduleDelivery();
+    void deliver();
+    bool writeSpool(const QList<Notification>& items) const;
+    static quint64 key(NotificationKind kind, int rentalId);
+
+    QList<Notification> m_pending;
+    QHash<quint64, int> m_pendingIndex;     // ключ -> позиция в m_pending
+    QHash<quint64, qint64> m_lastDelivered; // ключ -> время последней доставки
+    QTimer m_timer;
+    qint64 m_lastDigestMs = 0;
+    int m_coalesceMs = 2000;
+    int m_minDigestIntervalMs = 60000;
+    int m_repeatSuppressSecs = 6 * 3600;
+    QString m_spoolDir;
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <QObject>
+#include <QDateTime>
+#include <QHash>
+#include <QTimer>
+#include <functional>
+#include <queue>
+#include <vector>
+
+// Планировщик дедлайнов аренд (просрочки, напоминания о возврате): аренды
+// лежат в min-куче по сроку, а единственный таймер взведён на ближайший. Вместо полного
+// перечитывания аренд раз в 5 минут — O(log n) на событие и срабатывание
+// ровно в момент наступления просрочки.
+class OverdueScheduler : public QObject {
+    Q_OBJECT
+public:
+    explicit OverdueScheduler(QObject* parent = nullptr);
+
+    // Добавить аренду или перенести её дедлайн
+    void schedule(int rentalId, const QDateTime& deadline);
+    // Аренда завершена/отменена — больше не отслеживаем
+    void unschedule(int rentalId);
+    void clear();
+
+    bool contains(int rentalId) const { return m_deadlines.contains(rentalId); }
+    int size() const { return m_deadlines.size(); }
+
+signals:
+    void deadlineReached(int rentalId);
+
+private slots:
+    void onTimeout();
+
+private:
+    struct Entry {
+        qint64 deadlineMs;
+        int rentalId;
+        bool operator>(const Entry& other) const {
+            return deadlineMs != other.deadlineMs ? deadlineMs > other.deadlineMs
+                                                  : rentalId > other.rentalId;
+        }
+    };
+
+    void rearm();
+    void dropStaleTop();
+    void compactIfNeeded();
+    bool isLive(const Entry& e) const;
+
+    // Ленивое удаление: запись кучи действительна, только если совпадает с m_deadlines
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> m_heap;
+    QHash<int, qint64> m_deadlines;
+    QTimer m_timer;
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+
+// PBKDF2-HMAC-SHA256 (RFC 8018). Состояния SHA-256 после блоков ipad и opad
+// считаются один раз на пароль, итерация — ровно два сжатия SHA-256 над
+// буфером на стеке, без выделений памяти и повторного ключевания HMAC.
+// Результат совпадает с прежним QMessageAuthenticationCode-вариантом бит в бит.
+//
+// Запись пароля: "pbkdf2-sha256$<итерации>$<соль base64>$<хеш base64>".
+// Число итераций подбирается calibrate() под заданное время разблокировки
+// на текущей машине и хранится в самой записи, поэтому проверка не зависит
+// от того, где и с какой стоимостью запись была создана.
+class Pbkdf2 {
+public:
+    static constexpr int kKeySize = 32;
+    static constexpr int kSaltSize = 16;
+    static constexpr int kMinIterations = 100000;
+    static constexpr int kMaxIterations = 20000000;
+    static constexpr int kDefaultTargetMs = 300;
+
+    static QByteArray derive(const QByteArray& password, const QByteArray& salt,
+                             int iterations, int keyLength = kKeySize);
+
+    // Сколько итераций derive() укладывается в targetMs на этой машине
+    // (не меньше kMinIterations)
+    static int calibrate(int targetMs = kDefaultTargetMs);
+
+    static QByteArray randomSalt(int size = kSaltSize);
+
+    // Новая запись; iterations <= 0 — подобрать calibrate()
+    static QString makeRecord(const QString& password, int iterations = 0);
+    static bool isRecord(const QString& record);
+    static bool parseRecord(const QString& record, int* iterations, QByteArray* salt, QByteArray* hash);
+    static bool verifyRecord(const QString& password, const QString& record);
+    // Итерации из записи (0 — запись не распознана)
+    static int recordIterations(const QString& record);
+
+    // Сравнение за время, не зависящее от позиции первого расхождения
+    static bool constantTimeEquals(const QByteArray& a, const QByteArray& b);
+};
@@ -0,0 +1,29 @@
+#pragma once
+#include <QList>
+#include <QString>
+#include <atomic>
+#include <functional>
+#include "ContractDocument.h"
+#include "ReportSink.h"
+
+// Безоконный вывод в PDF через QPdfWriter: без QPrinter, QPrintDialog и
+// промежуточного QTextDocument. Оформление страниц задаётся PageTemplate
+// один раз на рендерер; сам рендерер не хранит состояния между вызовами,
+// поэтому один экземпляр можно использовать из нескольких потоков.
+class PdfRenderer {
+public:
+    using Body = std::function<void(ReportSink&)>;
+
+    explicit PdfRenderer(const PageTemplate& page = PageTemplate::contract());
+
+    bool render(const QString& path, const Body& body, QString* error = nullptr) const;
+
+    bool renderContract(const ContractData& data, const QString& path, QString* error = nullptr) const;
+    bool renderReceipt(const ContractData& data, const QString& path, QString* error = nullptr) const;
+    // Несколько договоров одним файлом, каждый с новой страницы
+    bool renderContracts(const QList<ContractData>& items, const QString& path, bool withReceipts,
+                         const std::atomic_bool* cancel = nullptr, QString* error = nullptr) const;
+
+private:
+    PageTemplate m_page;
+};
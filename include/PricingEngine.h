@@ -0,0 +1,117 @@
+#pragma once
+#include <QObject>
+#include <QDate>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <memory>
+#include <vector>
+
+class Equipment;
+
+// Правило тарифа из таблицы pricing_rules
+struct PricingRule {
+    enum Type { Season, Weekend, LongTerm, Group };
+
+    int id = 0;
+    Type type = Season;
+    int equipmentId = 0;   // 0 — для любого оборудования
+    QString category;      // пусто — для любой категории
+    QDate startDate;       // Season: первый день (включительно)
+    QDate endDate;         // Season: последний день (включительно)
+    int minDays = 0;       // LongTerm: от скольких дней аренды
+    int minQuantity = 0;   // Group: от скольких единиц
+    double percent = 0.0;  // > 0 — наценка, < 0 — скидка, % к цене
+    bool active = true;
+
+    static QString typeToString(Type type);
+    static Type typeFromString(const QString& s);
+};
+
+struct QuoteLine {
+    int equipmentId = 0;
+    int quantity = 1;
+    QDateTime start;
+    QDateTime end;
+};
+
+struct PriceQuote {
+    int equipmentId = 0;
+    int quantity = 0;
+    int days = 0;
+    double unitPrice = 0.0;      // цена одной единицы за весь период с учётом сезонов/выходных
+    double discountPercent = 0.0; // суммарная скидка за длительность и количество
+    double total = 0.0;
+    bool ok = false;
+};
+
+// Движок тарифов: правила компилируются в таблицы по каждому оборудованию
+// (префиксные суммы дневных коэффициентов + ступени скидок), поэтому расчёт
+// цены — O(1) независимо от длины аренды. Изменение правила сбрасывает только
+// затронутые таблицы.
+class PricingEngine : public QObject {
+    Q_OBJECT
+public:
+    static PricingEngine& instance();
+
+    PriceQuote quote(const QuoteLine& line);
+    QList<PriceQuote> quote(const QList<QuoteLine>& lines);
+    // Расчёт по уже загруженному оборудованию (диалог аренды) без похода в БД
+    PriceQuote quote(const Equipment* equipment, int quantity,
+                     const QDateTime& start, const QDateTime& end);
+
+    // Правила
+    QList<PricingRule> rules();
+    bool addRule(PricingRule& rule);
+    bool updateRule(const PricingRule& rule);
+    bool removeRule(int ruleId);
+    void reloadRules();
+
+    // Сброс таблиц: оборудование изменилось или удалено
+    void invalidateEquipment(int equipmentId);
+    void invalidateAll();
+
+private:
+    explicit PricingEngine(QObject* parent = nullptr);
+
+    // Общий для оборудования с одинаковым набором дневных правил массив префиксных сумм
+    struct DayFactors {
+        QDate origin;
+        std::vector<double> prefix; // prefix[i] = сумма коэффициентов дней [origin, origin + i)
+        std::vector<double> factor; // коэффициент дня origin + i
+    };
+
+    struct Tier {
+        int threshold = 0;
+        double percent = 0.0;
+    };
+
+    struct TariffTable {
+        int equipmentId = 0;
+        QString category;
+        double firstDayPrice = 0.0;
+        double additionalDayPrice = 0.0;
+        QList<int> dayRuleIds;                    // сезон/выходные, влияющие на таблицу
+        std::shared_ptr<const DayFactors> days;   // nullptr — дневных правил нет
+        std::vector<Tier> longTermTiers;          // по убыванию порога
+        std::vector<Tier> groupTiers;             // по убыванию порога
+    };
+
+    void ensureRules();
+    void preload(const QList<int>& equipmentIds);
+    TariffTable buildTable(int equipmentId, const QString& category,
+                           double price, double additionalPrice);
+    std::shared_ptr<const DayFactors> dayFactors(const QList<int>& ruleIds);
+    double dayFactor(const QList<int>& ruleIds, const QDate& day) const;
+    static int specificity(const PricingRule& rule);
+    bool ruleApplies(const PricingRule& rule, int equipmentId, const QString& category) const;
+    void invalidateForRule(const PricingRule& rule);
+    PriceQuote evaluate(const TariffTable& t, int quantity, const QDateTime& start, const QDateTime& end) const;
+    static double tierPercent(const std::vector<Tier>& tiers, int value);
+
+    bool m_rulesLoaded = false;
+    QHash<int, PricingRule> m_rules;
+    QHash<int, TariffTable> m_tables;
+    QHash<QString, std::shared_ptr<const DayFactors>> m_dayFactorCache; // ключ — набор id правил
+};
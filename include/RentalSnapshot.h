@@ -0,0 +1,102 @@
+#pragma once
+#include <QObject>
+#include <QDate>
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <cstdint>
+#include <vector>
+
+class RentalManager;
+class Rental;
+
+// Сегмент клиента по числу его аренд в снимке (отменённые не считаются):
+// New — одна, Returning — от kReturningFrom, Regular — от kRegularFrom
+enum class CustomerSegment : quint8 { Any, New, Returning, Regular };
+
+// Отбор строк снимка; пустые поля — без ограничения
+struct SnapshotFilter {
+    QDate from;               // по дате начала аренды, включительно
+    QDate to;
+    QString category;
+    CustomerSegment segment = CustomerSegment::Any;
+    quint8 statusMask = 0xFF; // биты RentalSnapshot::Status
+};
+
+struct SnapshotTotals {
+    int count = 0;
+    qint64 units = 0;
+    double revenue = 0.0;   // total_price; у завершённых — плюс ущерб и чистка
+    double deposits = 0.0;
+    double damage = 0.0;
+    double cleaning = 0.0;
+};
+
+// Колоночный снимок таблицы rentals для интерактивной аналитики: каждое поле
+// хранится отдельным плотным массивом, категории — кодами словаря. Фильтр
+// строит маску одним проходом без ветвлений, суммы считаются по маске —
+// оба цикла компилятор векторизует. Снимок обновляется построчно по сигналам
+// RentalManager, полная перезагрузка — только при первом открытии сводки и
+// после восстановления БД из копии. Срезы показывает вкладка «Сводка».
+class RentalSnapshot : public QObject {
+    Q_OBJECT
+public:
+    enum Status : quint8 { Active = 0, Completed = 1, Cancelled = 2, Other = 3 };
+
+    static constexpr int kReturningFrom = 2;
+    static constexpr int kRegularFrom = 5;
+    static QString segmentName(CustomerSegment segment);
+
+    explicit RentalSnapshot(QObject* parent = nullptr);
+
+    bool load();
+    void attach(RentalManager* manager);
+    bool refreshRental(int rentalId);
+    bool refreshRentals(const QList<int>& rentalIds);
+    void removeRental(int rentalId);
+    // Категория оборудования изменилась: перекодировать его аренды
+    void recategorize(int equipmentId, const QString& category);
+
+    int size() const { return static_cast<int>(m_id.size()); }
+    // Словарь категорий; коды, оставшиеся без строк после смены категории
+    // оборудования, из него выбрасываются
+    QStringList categories() const { return m_categories; }
+
+    SnapshotTotals totals(const SnapshotFilter& filter) const;
+    QMap<QString, SnapshotTotals> byCategory(const SnapshotFilter& filter) const;
+    QMap<QDate, SnapshotTotals> byWeek(const SnapshotFilter& filter) const; // ключ — понедельник недели
+
+signals:
+    void changed();
+
+private:
+    static constexpr quint16 kNoCategory = 0xFFFF;
+
+    bool loadRows(const QList<int>& rentalIds);
+    quint16 categoryCode(const QString& category);
+    void compactCategories();
+    // Сегмент каждого клиента, индекс — id клиента
+    void customerSegments(std::vector<quint8>& segments) const;
+    void buildMask(const SnapshotFilter& filter, std::vector<std::uint8_t>& mask) const;
+    SnapshotTotals sumMasked(const std::vector<std::uint8_t>& mask) const;
+    void clear();
+
+    // Колонки
+    std::vector<qint32> m_id;
+    std::vector<qint32> m_customerId;
+    std::vector<qint32> m_equipmentId;
+    std::vector<qint32> m_quantity;
+    std::vector<qint32> m_startDay; // юлианский день
+    std::vector<qint32> m_endDay;
+    std::vector<quint16> m_category;
+    std::vector<quint8> m_status;
+    std::vector<double> m_revenue;
+    std::vector<double> m_deposit;
+    std::vector<double> m_damage;
+    std::vector<double> m_cleaning;
+
+    QHash<int, int> m_rowById;
+    QStringList m_categories;
+    QHash<QString, quint16> m_categoryIndex;
+};
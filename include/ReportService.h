@@ -0,0 +1,69 @@
+#pragma once
+#include <QObject>
+#include <QCache>
+#include <QDate>
+#include <QList>
+#include <QString>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class QPrinter;
+class QThread;
+class ReportSink;
+
+enum class ReportFormat { Html, Csv, Pdf };
+
+struct ReportRequest {
+    QString type;   // "Отчет по арендам", "Отчет по оборудованию", ...
+    QDate start;
+    QDate end;
+};
+
+// Фоновая генерация отчётов: работа идёт в отдельном потоке на собственном
+// соединении с БД, окно остаётся отзывчивым. Строки потоком уходят в
+// ReportSink: на экран — ограниченный предпросмотр, в файл/на печать — всё.
+// Предпросмотры кэшируются по (тип, период, версия данных), поэтому повторный
+// запрос без изменений в БД возвращается мгновенно.
+class ReportService : public QObject {
+    Q_OBJECT
+public:
+    explicit ReportService(QObject* parent = nullptr);
+    ~ReportService();
+
+    void generate(const ReportRequest& request);                  // предпросмотр
+    void exportTo(const ReportRequest& request, const QString& path, ReportFormat format);
+    void print(const ReportRequest& request, QPrinter* printer);  // принтер переходит во владение
+    void cancel();
+    bool isRunning() const { return m_activeJob != 0; }
+    void clearCache();
+
+signals:
+    void started();
+    void progress(int percent);
+    void finished(const ReportRequest& request, const QString& html, bool fromCache);
+    void exported(const ReportRequest& request, const QString& path);
+    void printed(const ReportRequest& request);
+    void cancelled();
+    void failed(const QString& error);
+
+private:
+    enum class Output { Preview, File, Print };
+    // Создаётся в рабочем потоке; для предпросмотра пишет в переданную строку
+    using SinkFactory = std::function<std::unique_ptr<ReportSink>(QString* preview)>;
+
+    static QString pageTitle(const ReportRequest& request);
+    static QString cacheKey(const ReportRequest& request, const QString& dataVersion);
+    void startJob(const ReportRequest& request, const QString& key, Output output,
+                  const QString& path, SinkFactory makeSink);
+    void onJobDone(quint64 jobId, const QString& key, Output output, const QString& path,
+                   const ReportRequest& request, const QString& html,
+                   const QString& error, bool wasCancelled);
+
+    QCache<QString, QString> m_cache;     // стоимость — размер HTML в КБ
+    QList<QThread*> m_threads;            // включая отменённые, ещё не успевшие завершиться
+    std::shared_ptr<std::atomic_bool> m_cancel;
+    quint64 m_nextJobId = 0;
+    quint64 m_activeJob = 0;
+    QString m_activeKey;
+};
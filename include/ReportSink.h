@@ -0,0 +1,175 @@
+#pragma once
+#include <QFile>
+#include <QFont>
+#include <QFontMetrics>
+#include <QMarginsF>
+#include <QPageSize>
+#include <QPdfWriter>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <memory>
+
+class QPainter;
+class QPagedPaintDevice;
+
+// Приёмник отчёта: построитель отдаёт заголовки, строки и таблицы по мере
+// чтения из БД, а приёмник сразу пишет их в свой формат. Весь документ
+// целиком нигде не собирается.
+class ReportSink {
+public:
+    virtual ~ReportSink() = default;
+
+    virtual bool begin() { return true; }
+    virtual void title(const QString& text) = 0;
+    virtual void heading(const QString& text) = 0;
+    virtual void field(const QString& label, const QString& value) = 0; // «метка: значение»
+    virtual void text(const QString& text) = 0;
+    virtual void separator() {}
+    virtual void pageBreak() {}
+
+    // Пустой header — таблица без строки заголовка (пары «поле — значение»)
+    virtual void beginTable(const QStringList& header) = 0;
+    virtual void row(const QStringList& cells) = 0;
+    virtual void endTable() = 0;
+
+    virtual bool finish() = 0;
+    virtual QString errorString() const { return QString(); }
+};
+
+// HTML в строку (предпросмотр) или в файл. Для предпросмотра задаётся лимит
+// строк таблиц: дальше строки только считаются, итоги остаются точными.
+class HtmlReportSink : public ReportSink {
+public:
+    explicit HtmlReportSink(QString* target, int maxRows = -1);
+    explicit HtmlReportSink(const QString& path);
+
+    bool begin() override;
+    void title(const QString& text) override;
+    void heading(const QString& text) override;
+    void field(const QString& label, const QString& value) override;
+    void text(const QString& text) override;
+    void separator() override;
+    void beginTable(const QStringList& header) override;
+    void row(const QStringList& cells) override;
+    void endTable() override;
+    bool finish() override;
+    QString errorString() const override { return m_error; }
+
+private:
+    QFile m_file;
+    QTextStream m_out;
+    bool m_toFile = false;
+    bool m_document = false; // файл — полноценный документ с <html>
+    int m_maxRows;
+    int m_rowsWritten = 0;
+    int m_rowsSkipped = 0;
+    QString m_error;
+};
+
+// CSV: только табличные данные, таблицы разделены пустой строкой
+class CsvReportSink : public ReportSink {
+public:
+    explicit CsvReportSink(const QString& path);
+
+    bool begin() override;
+    void title(const QString&) override {}
+    void heading(const QString& text) override;
+    void field(const QString& label, const QString& value) override;
+    void text(const QString&) override {}
+    void beginTable(const QStringList& header) override;
+    void row(const QStringList& cells) override;
+    void endTable() override;
+    bool finish() override;
+    QString errorString() const override { return m_error; }
+
+private:
+    void writeRecord(const QStringList& cells);
+
+    QFile m_file;
+    QTextStream m_out;
+    bool m_needsGap = false;
+    QString m_error;
+};
+
+// Оформление страницы для постраничной отрисовки: формат, поля и
+// колонтитулы. В footer «%1» заменяется номером страницы.
+struct PageTemplate {
+    QPageSize pageSize = QPageSize(QPageSize::A4);
+    QMarginsF marginsMm = QMarginsF(15, 15, 15, 15);
+    int resolution = 300;   // только для PDF; у принтера своё разрешение
+    QString header;
+    QString footer;
+
+    static PageTemplate report(const QString& title);
+    static PageTemplate contract();
+};
+
+// Постраничная отрисовка на любом QPagedPaintDevice (QPdfWriter, QPrinter):
+// готовые страницы сразу уходят в устройство, в памяти только текущая.
+// Метрики шрифтов считаются один раз в begin(), а не на каждую строку.
+class PaintedReportSink : public ReportSink {
+public:
+    explicit PaintedReportSink(QPagedPaintDevice* device = nullptr,
+                               const PageTemplate& page = PageTemplate());
+    ~PaintedReportSink() override;
+
+    bool begin() override;
+    void title(const QString& text) override;
+    void heading(const QString& text) override;
+    void field(const QString& label, const QString& value) override;
+    void text(const QString& text) override;
+    void separator() override;
+    void pageBreak() override;
+    void beginTable(const QStringList& header) override;
+    void row(const QStringList& cells) override;
+    void endTable() override;
+    bool finish() override;
+    QString errorString() const override { return m_error; }
+
+protected:
+    void setDevice(QPagedPaintDevice* device) { m_device = device; }
+    // Закрыть отрисовку без finish(); наследник, владеющий устройством,
+    // вызывает это в своём деструкторе — до разрушения устройства
+    void endPainting();
+
+private:
+    void drawLine(const QString& text, const QFont& font, const QFontMetrics& fm, int spacingBefore);
+    void drawRow(const QStringList& cells, bool header);
+    void drawPageDecorations();
+    void startPage();
+    bool ensureSpace(int height);
+    void newPage();
+
+    QPagedPaintDevice* m_device;
+    PageTemplate m_page;
+    std::unique_ptr<QPainter> m_painter;
+    QFont m_titleFont;
+    QFont m_headingFont;
+    QFont m_bodyFont;
+    QFont m_boldFont;
+    QFont m_smallFont;
+    std::unique_ptr<QFontMetrics> m_titleMetrics;
+    std::unique_ptr<QFontMetrics> m_headingMetrics;
+    std::unique_ptr<QFontMetrics> m_bodyMetrics;
+    std::unique_ptr<QFontMetrics> m_boldMetrics;
+    std::unique_ptr<QFontMetrics> m_smallMetrics;
+    int m_pageWidth = 0;
+    int m_pageHeight = 0;
+    int m_contentTop = 0;
+    int m_contentBottom = 0;
+    int m_pageNumber = 0;
+    int m_y = 0;
+    QStringList m_tableHeader;
+    bool m_inTable = false;
+    QString m_error;
+};
+
+class PdfReportSink : public PaintedReportSink {
+public:
+    explicit PdfReportSink(const QString& path, const PageTemplate& page = PageTemplate());
+    ~PdfReportSink() override;
+
+private:
+    QPdfWriter m_writer;
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include <QByteArray>
+#include <QList>
+#include <QSqlDatabase>
+#include <QString>
+#include <atomic>
+
+// Шифрование файла БД целиком (SQLCipher). Работает, когда драйвер QSQLITE
+// собран против libsqlcipher (build.sh, BUILD_SQLCIPHER_PLUGIN=1). Обычный
+// драйвер молча игнорирует PRAGMA key и пишет открытый файл, поэтому
+// наличие кодека проверяется явно — PRAGMA cipher_version.
+//
+// Ключ файла выводится из ключа данных (Security::dataKey), а тот открывается
+// мастер-паролем: смена пароля не требует перешифровки базы. kdfIter == 0 —
+// ключ передаётся сырым (x'…') без второго растяжения: пароль уже растянут
+// откалиброванным PBKDF2 при открытии ключа данных. kdfIter > 0 — SQLCipher
+// растягивает ключ сам при каждом открытии соединения.
+class SqlCipher {
+public:
+    struct Options {
+        bool enabled = false;
+        int kdfIter = 0;
+        int pageSize = 4096;    // страница шифрования, задаётся при создании файла
+        int cacheKiB = 16384;   // кэш расшифрованных страниц на соединение
+
+        // Совпадает ли то, что зашито в файл (кэш — свойство соединения)
+        bool sameFormat(const Options& other) const;
+    };
+
+    static constexpr int kMinPageSize = 1024;
+    static constexpr int kMaxPageSize = 65536;
+
+    // Желаемые параметры (QSettings "database/sqlcipher_*")
+    static Options load();
+    static void save(const Options& options);
+    // С какими параметрами зашифрован текущий файл БД
+    static Options fileFormat();
+    static void setFileFormat(const Options& options);
+
+    // Собран ли драйвер QSQLITE с SQLCipher (проверяется один раз)
+    static bool isAvailable();
+    // Файл есть и не начинается с заголовка открытой SQLite
+    static bool isEncryptedFile(const QString& path);
+
+    static QByteArray deriveKey(const QByteArray& dataKey);
+    // Первое действие после open(): ключ и параметры файла (если
+    // options.enabled), размер кэша и проверка, что схема читается — с чужим
+    // ключом SQLCipher отвечает «file is not a database» только на первом чтении
+    static bool prepareConnection(QSqlDatabase& db, const QByteArray& key, const Options& options);
+    // ATTACH файла под alias со своим ключом и параметрами (options.enabled ==
+    // false — открытый файл). Без KEY SQLCipher подставил бы ключ основной базы
+    static bool attach(QSqlDatabase& db, const QString& path, const QString& alias,
+                       const QByteArray& key, const Options& options);
+    // Полная копия открытой базы в новый файл с другими параметрами
+    // (options.enabled == false — в открытом виде). cancel проверяется и
+    // во время экспорта; прерванная копия удаляется
+    static bool exportDatabase(QSqlDatabase& db, const QString& targetPath,
+                               const QByteArray& key, const Options& options,
+                               const std::atomic_bool* cancel = nullptr);
+
+    // Замер: копии текущей базы в открытом и зашифрованном виде, на каждой —
+    // те же запросы, что выполняет окно. Каждый раунд — новое соединение,
+    // чтобы в замер попадала расшифровка страниц, а не только чтение из кэша
+    struct BenchmarkRow {
+        QString name;
+        double plainMs = 0;
+        double encryptedMs = 0;
+    };
+    struct BenchmarkReport {
+        bool ok = false;
+        QString error;
+        qint64 databaseBytes = 0;
+        int rounds = 0;
+        double plainOpenMs = 0;      // open + ключ + первое чтение схемы
+        double encryptedOpenMs = 0;
+        QList<BenchmarkRow> rows;
+
+        QString toText() const;
+    };
+    // sourceKey/sourceFormat — как открыть текущий файл (для открытого — пустой ключ).
+    // workDir — закрытый каталог (Database::privateTempDir): открытая копия
+    // базы не должна попадать в общий системный temp. Копии удаляются сразу
+    // после замера
+    static BenchmarkReport benchmark(const QString& workDir, const QString& sourcePath, const QByteArray& sourceKey,
+                                     const Options& sourceFormat, const QByteArray& key,
+                                     const Options& candidate, const std::atomic_bool* cancel = nullptr);
+
+private:
+    static QString keyLiteral(const QByteArray& key, int kdfIter);
+};
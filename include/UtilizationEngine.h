@@ -0,0 +1,91 @@
+#pragma once
+#include <QDate>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <vector>
+
+struct EquipmentUtilization {
+    int equipmentId = 0;
+    QString name;
+    QString category;
+    int units = 0;              // единиц в парке
+    double capacityDays = 0.0;  // единице-дни за период
+    double usedDays = 0.0;      // единице-дни в аренде
+    double percent = 0.0;
+    int peakConcurrent = 0;     // максимум единиц в аренде одновременно
+    int idleUnits = 0;          // не понадобились даже в пик
+};
+
+struct CategoryUtilization {
+    QString category;
+    int items = 0;
+    int units = 0;
+    double capacityDays = 0.0;
+    double usedDays = 0.0;
+    double percent = 0.0;
+    int peakConcurrent = 0;
+    int idleUnits = 0;
+};
+
+struct UtilizationReport {
+    QDate start;
+    QDate end;
+    int days = 0;
+    int totalUnits = 0;
+    double capacityDays = 0.0;
+    double usedDays = 0.0;
+    double percent = 0.0;
+    QList<CategoryUtilization> categories;
+    QList<EquipmentUtilization> items;
+};
+
+// Загрузка оборудования за период. Интервалы аренд обрезаются по границам
+// периода и превращаются в события «выдано/возвращено»; события сортируются
+// один раз по (категория, время) и проходятся заметающей прямой, которая
+// одновременно ведёт счётчики по позициям и по категории. Итого O(n log n)
+// по числу аренд в периоде.
+class UtilizationEngine {
+public:
+    UtilizationEngine(const QDate& start, const QDate& end);
+
+    // Время — секунды «настенного» времени, как их считает strftime('%s')
+    void addEquipment(int id, const QString& name, const QString& category, int units);
+    void addRental(int equipmentId, qint64 startSecs, qint64 endSecs, int quantity);
+
+    // Оборудование и аренды периода из БД; соединение — любое (и фоновое)
+    bool load(const QSqlDatabase& db, QString* error = nullptr);
+
+    // false — расчёт отменён
+    bool compute(UtilizationReport& report, const std::atomic_bool* cancel = nullptr) const;
+
+    static qint64 wallSeconds(const QDateTime& dateTime);
+
+private:
+    struct Item {
+        int id;
+        QString name;
+        int category;
+        int units;
+    };
+    struct Event {
+        qint64 time;
+        int category;
+        int item;
+        int delta;
+    };
+
+    QDate m_start;
+    QDate m_end;
+    qint64 m_periodStart;
+    qint64 m_periodEnd;
+    std::vector<Item> m_items;
+    QHash<int, int> m_itemById;
+    QStringList m_categories;
+    QHash<QString, int> m_categoryIndex;
+    std::vector<Event> m_events;
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+class QIODevice;
+
+// Запись центрального каталога ZIP
+struct ZipEntry {
+    QByteArray name;          // как в архиве (UTF-8 при флаге 0x0800)
+    quint16 flags = 0;
+    quint16 method = 0;       // 0 — без сжатия, 8 — deflate
+    quint16 modTime = 0;      // формат DOS
+    quint16 modDate = 0;
+    quint32 crc32 = 0;
+    quint32 compressedSize = 0;
+    quint32 uncompressedSize = 0;
+    quint32 localHeaderOffset = 0;
+};
+
+// Чтение ZIP целиком из памяти (DOCX — единицы мегабайт). Поддерживается
+// обычный ZIP без шифрования и без ZIP64, методы stored и deflate.
+class ZipReader {
+public:
+    bool open(const QString& path);
+    bool setData(const QByteArray& data);
+    QString errorString() const { return m_error; }
+
+    const QList<ZipEntry>& entries() const { return m_entries; }
+    const ZipEntry* find(const QByteArray& name) const;
+
+    // Распакованное содержимое с проверкой CRC
+    bool read(const ZipEntry& entry, QByteArray& out);
+    // Данные как они лежат в архиве — для переноса без пересжатия
+    bool rawData(const ZipEntry& entry, QByteArray& out);
+
+private:
+    bool parseCentralDirectory();
+
+    QByteArray m_data;
+    QList<ZipEntry> m_entries;
+    QHash<QByteArray, int> m_index;
+    QString m_error;
+};
+
+// Последовательная запись ZIP в устройство: локальные заголовки по ходу,
+// центральный каталог — в finish().
+class ZipWriter {
+public:
+    explicit ZipWriter(QIODevice* device);
+
+    // Перенос записи из другого архива как есть, без распаковки
+    bool addRaw(const ZipEntry& entry, const QByteArray& rawData);
+    // Новое содержимое под именем и временем записи like; сжимается deflate
+    bool addFile(const ZipEntry& like, const QByteArray& data);
+    bool finish();
+    QString errorString() const { return m_error; }
+
+private:
+    bool writeLocal(ZipEntry& entry, const QByteArray& payload);
+
+    QIODevice* m_device;
+    quint32 m_offset = 0;
+    QList<ZipEntry> m_written;
+    QString m_error;
+};
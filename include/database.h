@@ -2,6 +2,7 @@
 #define DATABASE_H
 
 #include "security.h"
+#include "SqlCipher.h"
 
 #include <QObject>
 #include <QSqlDatabase>
@@ -20,6 +21,9 @@
 #include <QMetaType>
 #include <QVariant>
 #include <QFileInfo>
+#include <QThread>
+#include <QTemporaryDir>
+#include <memory>
 
 class Database : public QObject
 {
@@ -29,7 +33,12 @@ public:
     static Database& getInstance();
     static void initialize(const QString& dbPath);
     
+    // Пустой password — сначала запросить мастер-пароль
     bool openDatabase(const QString& password);
+    // Открыть файл и схему без аутентификации — чтобы начать до ввода пароля
+    bool openStorage();
+    // Прогреть файловый кэш чтением основных таблиц в фоновом потоке
+    void prefetch();
     void closeDatabase();
     bool isOpen() const;
     
@@ -42,6 +51,8 @@ public:
     QSqlQuery getCustomers();
     QSqlQuery getCustomerById(int id);
     QSqlQuery searchCustomers(const QString& searchTerm);
+    // Расшифровать телефон/паспорт/адрес из строки выборки (column — имя колонки)
+    static QString customerField(const QString& column, const QVariant& stored);
     
     // Equipment operations
     bool addEquipment(const QString& name, const QString& category, double price, 
@@ -53,6 +64,19 @@ public:
     QSqlQuery getEquipmentById(int id);
     QSqlQuery searchEquipment(const QString& searchTerm);
     bool updateEquipmentQuantity(int id, int newQuantity);
+    bool releaseEquipmentQuantity(int id, int quantity);
+    QSqlQuery getEquipmentPricing(const QList<int>& ids);
+    
+    // Pricing rules
+    int addPricingRule(const QString& ruleType, int equipmentId, const QString& category,
+                       const QDate& startDate, const QDate& endDate, int minDays,
+                       int minQuantity, double percent, bool active);
+    bool updatePricingRule(int id, const QString& ruleType, int equipmentId, const QString& category,
+                           const QDate& startDate, const QDate& endDate, int minDays,
+                           int minQuantity, double percent, bool active);
+    bool deletePricingRule(int id);
+    QSqlQuery getPricingRules();
+    QSqlQuery getPricingRuleById(int id);
     
     // Rental operations
     bool addRental(int customerId, int equipmentId, int quantity, 
@@ -66,20 +90,54 @@ public:
     QSqlQuery getRentals();
     QSqlQuery getRentalById(int id);
     QSqlQuery getActiveRentals();
+    QSqlQuery getActiveRentalDeadlines();
     QSqlQuery getRentalsByCustomer(int customerId);
     QSqlQuery getRentalsByDateRange(const QDateTime& start, const QDateTime& end);
+    QSqlQuery getRentalsByIds(const QList<int>& ids);
+    QSqlQuery getRentalAnalyticsRows(const QDateTime& start, const QDateTime& end);
+    QSqlQuery getRentalSnapshotRows(const QList<int>& ids = QList<int>()); // пустой список — все аренды
+    QSqlQuery getDashboardActiveRentals();
+    QSqlQuery getContractRows(const QList<int>& ids);
+    double getRevenueCompletedOn(const QDate& day);
+    
+    // Transactions
+    bool beginTransaction();
+    bool commitTransaction();
+    bool rollbackTransaction();
     
     // Reports
     QSqlQuery getRentalReport(const QDateTime& start, const QDateTime& end);
     QSqlQuery getEquipmentReport();
     QSqlQuery getCustomerReport();
     QSqlQuery getFinancialReport(const QDateTime& start, const QDateTime& end);
+    
+    // Daily statistics (rental_daily_stats, поддерживается триггерами)
+    QSqlQuery getDailyStats(const QDate& start, const QDate& end);
+    bool rebuildDailyStats();
+    int checkDailyStats(); // число расходящихся строк, -1 при ошибке
 
     // Utility methods
     QString getDatabasePath() const { return m_dbPath; }
     QSqlDatabase& getDatabase() { return m_db; }
-    bool backupDatabase(const QString& backupPath);
+    // Файл зашифрован SQLCipher; другие соединения с ним открываются через keyConnection
+    bool isEncrypted() const { return m_cipher.enabled; }
+    SqlCipher::Options cipherFormat() const { return m_cipher; }
+    QByteArray cipherKey() const { return m_cipherKey; }
+    bool keyConnection(QSqlDatabase& db) const;
+    QString dataVersion(); // меняется при любой записи в БД (для кэшей отчётов)
+    // encrypt — копия шифруется ключом данных (восстановление определяет это само)
+    // Синхронно; в фоне — BackupService
+    bool backupDatabase(const QString& backupPath, bool encrypt = false);
     bool restoreDatabase(const QString& backupPath);
+    // Временный каталог рядом с БД с доступом только для владельца — для
+    // открытых промежуточных копий (шифрование/расшифровка резервных копий).
+    // nullptr, если создать не удалось
+    std::unique_ptr<QTemporaryDir> privateTempDir() const;
+
+signals:
+    // Файл БД подменён восстановлением: всё, что загружено из неё в память
+    // (кэши, снимки, расписания), нужно перечитать
+    void databaseReplaced();
 
 private:
     explicit Database(QObject *parent = nullptr);
@@ -90,13 +148,36 @@ private:
     bool createEquipmentTable();
     bool createRentalsTable();
     bool createSettingsTable();
+    bool createPricingRulesTable();
+    bool createDailyStatsTable();
+    bool createDataVersionTable();
+    // Зашифрованные поля клиента и их слепые индексы — для записи в строку
+    struct SealedCustomer {
+        QString phone;
+        QString passport;
+        QString address;
+        QVariant phoneIndex;      // NULL, если телефона нет
+        QVariant passportIndex;
+        QStringList phoneSuffixes;
+    };
+    bool sealCustomerFields(const QString& phone, const QString& passport, const QString& address,
+                            SealedCustomer* out);
+    bool writePhoneSuffixes(int customerId, const QStringList& tokens);
+    bool releaseSavepoint(bool commit);
+    bool secureCustomerRows();
+    bool restoreFromFile(const QString& backupPath);
+    bool openConnection();
+    bool applyCipherSettings();
     
     QSqlDatabase m_db;
     QString m_dbPath;
     bool m_isOpen;
+    quint64 m_openGeneration = 0; // счётчики SQLite обнуляются при переоткрытии
+    QThread* m_prefetch = nullptr;
     
     // Security
-    QString m_encryptionKey;
+    SqlCipher::Options m_cipher;  // как зашифрован файл (enabled == false — открытый)
+    QByteArray m_cipherKey;
     bool setupEncryption();
     
     // Singleton instance
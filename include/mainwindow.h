@@ -14,6 +14,14 @@
 #include "AdminPasswordManager.h"
 #include "AuditLogger.h"
 #include "AuditLogDialog.h"
+#include "ReportService.h"
+#include "BackupService.h"
+#include "ReportSink.h"
+#include "DashboardModel.h"
+#include "DocxTemplate.h"
+#include "ContractDocument.h"
+#include "DocumentBatchJob.h"
+#include "PdfRenderer.h"
 #include <QMainWindow>
 #include <QFileDialog>
 #include <QPrinter>
@@ -61,6 +69,10 @@
 #include <QFileInfo>
 #include <QtPrintSupport/QPrinter>
 #include <QtPrintSupport/QPrintDialog>
+#include <QPointer>
+#include <QProgressBar>
+#include <QProgressDialog>
+#include <QEventLoop>
 
 // Forward declarations
 class CustomerForm;
@@ -89,14 +101,17 @@ private slots:
     void onDeleteCustomer();
     void onDeleteEquipment();
     void onCompleteRental();
+    void onBatchCompleteRentals(); // групповой возврат выбранных аренд
     void onViewRental();
     void onPrintRental();
+    void onBatchDocuments();      // договоры и квитанции по выбранным арендам
     void onSearchCustomer();
     void onSearchEquipment();
     void onCustomerSearch();
     void onEquipmentSearch();
     void onViewRentals();
     void onReports();
+    void onReportFinished(const ReportRequest& request, const QString& html, bool fromCache);
     void onSettings();
     void onAbout();
     void onExit();
@@ -116,6 +131,8 @@ private slots:
 
 private:
     void setupUI();
+    void startBackup(QWidget* parent, const QString& fileName);
+    bool ensureNoBackup(QWidget* parent); // восстановление нельзя начинать во время копии
     void setupMenuBar();
     void setupToolBar();
     void setupStatusBar();
@@ -124,6 +141,7 @@ private:
     void createEquipmentTab();
     void createRentalTab();
     void createReportsTab();
+    void createDashboardTab();
     void setupConnections();
     void updateStatus();
     void loadSettings();
@@ -141,6 +159,15 @@ private:
     
     // Style methods
     void loadStyleSheet(const QString& theme);
+    ReportRequest currentReportRequest() const;
+    void showNotificationDigest(const QList<Notification>& items);
+    void refreshDashboard();
+    void updateDashboardTotals();
+    void updateDashboardCategory(const QString& category, int units);
+    void ensureRentalSnapshot();
+    void reloadSliceCategories();
+    void refreshSlices();
+    QString contractTemplatePath() const;
     bool generateDocxFromTemplate(const QString& templatePath, const QMap<QString, QString>& values, QString& outputDocxPath);
 
     // Admin security
@@ -158,6 +185,7 @@ private:
     QWidget *m_equipmentTab;
     QWidget *m_rentalTab;
     QWidget *m_reportsTab;
+    QWidget *m_dashboardTab;
     
     // Customer Tab Components
     QTableWidget *m_customerTable;
@@ -178,8 +206,12 @@ private:
     QTableWidget *m_rentalTable;
     QPushButton *m_newRentalBtn;
     QPushButton *m_completeRentalBtn;
+    QPushButton *m_batchReturnBtn;
     QPushButton *m_viewRentalBtn;
     QPushButton *m_printRentalBtn;
+    QPushButton *m_batchPrintBtn;
+    DocumentBatchJob *m_documentJob = nullptr;
+    QPointer<QProgressDialog> m_batchProgress;
     
     // Reports Tab Components
     QTextEdit *m_reportsText;
@@ -187,6 +219,33 @@ private:
     QComboBox *m_reportTypeCombo;
     QDateEdit *m_reportStartDate;
     QDateEdit *m_reportEndDate;
+    QPushButton *m_cancelReportBtn;
+    QProgressBar *m_reportProgress;
+    ReportService *m_reportService;
+    
+    // Фоновое резервное копирование
+    BackupService *m_backupService = nullptr;
+    QProgressBar *m_backupProgress = nullptr;
+    QPushButton *m_cancelBackupBtn = nullptr;
+    
+    // Dashboard Tab Components
+    QLabel *m_dashActiveLabel = nullptr;
+    QLabel *m_dashOverdueLabel = nullptr;
+    QLabel *m_dashRevenueLabel = nullptr;
+    QLabel *m_dashDepositsLabel = nullptr;
+    QTableWidget *m_dashCategoryTable = nullptr;
+    QHash<QString, QTableWidgetItem*> m_dashCategoryItems; // категория -> ячейка «единиц»
+    DashboardModel *m_dashboardModel = nullptr;
+    // Срезы по колоночному снимку аренд; снимок грузится при первом открытии вкладки
+    RentalSnapshot *m_rentalSnapshot = nullptr;
+    QDateEdit *m_sliceFromEdit = nullptr;
+    QDateEdit *m_sliceToEdit = nullptr;
+    QComboBox *m_sliceCategoryCombo = nullptr;
+    QComboBox *m_sliceSegmentCombo = nullptr;
+    QComboBox *m_sliceGroupCombo = nullptr;
+    QTableWidget *m_sliceTable = nullptr;
+    QLabel *m_sliceTotalsLabel = nullptr;
+    QTimer *m_sliceTimer = nullptr;   // пачка событий снимка — один пересчёт
     
     // Menu Actions
     QAction *m_newCustomerAction;
@@ -219,6 +278,9 @@ private:
     RentalManager *m_rentalManager;
     Database *m_database;
     
+    // Немодальный дайджест уведомлений (один на все алерты)
+    QPointer<QMessageBox> m_digestBox;
+    
     // Status
     QLabel *m_statusLabel;
     QLabel *m_userLabel;
@@ -84,6 +84,7 @@ public:
     bool save();
     bool update();
     bool remove();
+    // Только статус и суммы; оборудование на склад возвращает RentalManager
     bool complete(double damageCost, double cleaningCost, double finalDeposit, const QString& notes);
     static Rental* loadById(int id);
     static QList<Rental*> getByCustomer(int customerId);
@@ -5,10 +5,48 @@
 #include <QString>
 #include <QDateTime>
 #include <QList>
+#include <QMap>
+#include <QFlags>
 #include <QDebug>
 #include "customer.h"
 #include "equipment.h"
 #include "rental.h"
+#include "OverdueScheduler.h"
+#include "NotificationCenter.h"
+#include "RentalSnapshot.h"
+
+// Строка группового возврата: одна аренда со своими расходами
+struct RentalReturnLine
+{
+    int rentalId = 0;
+    double damageCost = 0.0;
+    double cleaningCost = 0.0;
+    double finalDeposit = 0.0;
+    QString notes;
+};
+
+// Метрики аналитики: любой набор считается за один проход по одной выборке
+enum AnalyticsMetric {
+    MetricRevenue           = 0x01,
+    MetricDeposits          = 0x02,
+    MetricUsageByCategory   = 0x04,
+    MetricRevenueByCustomer = 0x08,
+    MetricOverdue           = 0x10,
+    MetricAll               = 0x1F
+};
+Q_DECLARE_FLAGS(AnalyticsMetrics, AnalyticsMetric)
+Q_DECLARE_OPERATORS_FOR_FLAGS(AnalyticsMetrics)
+
+struct RentalAnalytics
+{
+    AnalyticsMetrics computed;
+    int rentalCount = 0;
+    double totalRevenue = 0.0;   // total_price; у завершённых — плюс ущерб и чистка
+    double totalDeposits = 0.0;
+    int overdueCount = 0;        // активные с истёкшим сроком
+    QMap<QString, int> usageByCategory;      // категория -> выдано единиц
+    QMap<QString, double> revenueByCustomer; // клиент -> выручка
+};
 
 class RentalManager : public QObject
 {
@@ -26,6 +64,12 @@ public:
                        double cleaningCost = 0.0, double finalDeposit = 0.0,
                        const QString& notes = "");
     bool cancelRental(Rental* rental, const QString& reason = "");
+    // Сохранить аренду, собранную в диалоге, с уведомлением подписчиков
+    bool saveRental(Rental* rental);
+    // Групповой возврат: все строки в одной транзакции (всё или ничего)
+    bool completeRentals(const QList<RentalReturnLine>& lines);
+    // Сохранить правку оборудования: от его категории зависят срезы и сводка
+    bool updateEquipment(Equipment* equipment);
     
     // Price calculations
     double calculateRentalPrice(Equipment* equipment, int days) const;
@@ -49,6 +93,10 @@ public:
     double calculateTotalDeposits(const QDateTime& start, const QDateTime& end) const;
     QMap<QString, int> getEquipmentUsageStats(const QDateTime& start, const QDateTime& end) const;
     QMap<QString, double> getCustomerRevenueStats(const QDateTime& start, const QDateTime& end) const;
+    RentalAnalytics computeAnalytics(const QDateTime& start, const QDateTime& end,
+                                     AnalyticsMetrics metrics = MetricAll) const;
+    // Колоночный снимок для интерактивных срезов; загружается при первом обращении
+    RentalSnapshot* snapshot();
     
     // Validation
     bool validateRentalRequest(Customer* customer, Equipment* equipment, int quantity,
@@ -56,19 +104,25 @@ public:
     QStringList getRentalValidationErrors(Customer* customer, Equipment* equipment, int quantity,
                                          const QDateTime& startDate, const QDateTime& endDate) const;
     
-    // Notifications
-    void checkOverdueRentals();
-    void sendOverdueNotifications();
-    void sendReturnReminders();
+    // Notifications: просрочки и напоминания о возврате (за kReminderLeadHours
+    // до срока) приходят по дедлайнам, пачкой через центр уведомлений
+    static constexpr int kReminderLeadHours = 24;
+    void startOverdueMonitoring();
+    OverdueScheduler* overdueScheduler() const { return m_overdueScheduler; }
+    NotificationCenter* notificationCenter() const { return m_notifications; }
 
 signals:
     void rentalCreated(Rental* rental);
     void rentalCompleted(Rental* rental);
     void rentalCancelled(Rental* rental);
+    void rentalsCompleted(const QList<RentalReturnLine>& lines); // групповой возврат
     void equipmentReserved(Equipment* equipment, int quantity);
     void equipmentReleased(Equipment* equipment, int quantity);
+    void equipmentUpdated(Equipment* equipment);
     void overdueRentalDetected(Rental* rental);
     void returnReminderNeeded(Rental* rental);
+    // БД восстановлена из копии; состояние менеджера уже перечитано
+    void databaseReplaced();
 
 private:
     bool reserveEquipment(Equipment* equipment, int quantity);
@@ -79,6 +133,16 @@ private:
     bool isDateRangeValid(const QDateTime& startDate, const QDateTime& endDate) const;
     bool isCustomerValid(Customer* customer) const;
     bool isEquipmentValid(Equipment* equipment) const;
+    void scheduleDeadlines(int rentalId, const QDateTime& endDate);
+    void unscheduleDeadlines(int rentalId);
+    void onRentalDeadline(int rentalId);
+    void onReminderDeadline(int rentalId);
+    void onDatabaseReplaced();
+    
+    OverdueScheduler* m_overdueScheduler;
+    OverdueScheduler* m_reminderScheduler; // срок минус kReminderLeadHours
+    NotificationCenter* m_notifications;
+    RentalSnapshot* m_snapshot = nullptr;
 };
 
 #endif // RENTALMANAGER_H 
\ No newline at end of file
@@ -15,6 +15,7 @@
 #include <QDateTime>
 #include <QTimer>
 #include <QRandomGenerator>
+#include "AdminAuthDialog.h"
 
 class Security : public QObject
 {
@@ -34,6 +35,17 @@ public:
     static QString encryptString(const QString& text);
     static QString decryptString(const QString& encryptedText);
     
+    // Поля БД: "enc1:" + base64(nonce || шифртекст || тег). context (имя
+    // колонки) проверяется при расшифровке. Пустое значение не шифруется,
+    // значение без префикса считается открытым текстом прежних версий
+    static bool encryptField(const QString& value, const QString& context, QString* out);
+    static QString decryptField(const QString& stored, const QString& context);
+    static bool isEncryptedField(const QString& stored);
+    
+    // Ключ данных: загружается при проверке мастер-пароля
+    static bool hasDataKey();
+    static QByteArray dataKey();
+    
     // Password management
     static bool setMasterPassword(const QString& password);
     static bool verifyMasterPassword(const QString& password);
@@ -60,16 +72,48 @@ private:
     
     static QString getMasterPasswordHash();
     static void setMasterPasswordHash(const QString& hash);
-    static QString generateSalt();
-    static QString hashPassword(const QString& password, const QString& salt);
+    static QString hashPassword(const QString& password, const QString& salt); // старый формат
     static QString generateSessionToken();
+
+    // Проверка мастер-пароля делится на расчёт и применение: растяжение идёт
+    // в рабочем потоке окна пароля и не трогает ни m_instance, ни QSettings.
+    // Сохранённые записи читаются до запуска потока, итог применяется в
+    // потоке окна (applyMasterPasswordCheck)
+    struct MasterPasswordState {
+        QString record;      // security/master_password_hash
+        QString legacySalt;  // security/salt (SHA-256 старого формата)
+        QString wrappedKey;  // security/data_key
+    };
+    struct MasterPasswordCheck {
+        bool ok = false;
+        QByteArray dataKey;  // открытый ключ данных; пусто — не открылся
+        QString record;      // новая запись пароля, если старую нужно перевести
+        QString wrappedKey;  // новая обёртка ключа данных, если нужна
+    };
+    // Мастер-пароль растягивается PBKDF2 один раз; из результата HMAC-ом
+    // выводятся проверочное значение (хранится в записи) и ключ обёртки
+    // ключа данных (нигде не хранится)
+    struct MasterKeys {
+        QString record;
+        QByteArray kek;
+    };
+    static MasterPasswordState masterPasswordState();
+    static MasterPasswordCheck checkMasterPassword(const QString& password, const MasterPasswordState& state);
+    static void applyMasterPasswordCheck(const MasterPasswordCheck& check);
+    static AdminAuthDialog::Verdict masterPasswordVerdict(const QString& password, const MasterPasswordState& state);
+    static MasterKeys makeMasterKeys(const QString& password, int iterations = 0);
+    static bool openMasterRecord(const QString& password, const QString& record, QByteArray* kek);
+    static int masterRecordIterations(const QString& record);
+    static QString wrapDataKey(const QByteArray& kek, const QByteArray& dataKey);
+    static QByteArray unwrapDataKey(const QByteArray& kek, const QString& stored);
+    static QByteArray unwrapLegacyDataKey(const QString& password, const QString& stored);
     
     QString m_sessionToken;
     QDateTime m_sessionStart;
     QStringList m_permissions;
     bool m_isAuthenticated;
     
-    // Encryption key derived from master password
+    // Ключ данных (AEAD), открывается мастер-паролем
     QByteArray m_encryptionKey;
     bool m_isInitialized;
 };
@@ -1,25 +1,135 @@
 #include "AdminAuthDialog.h"
-#include "ui_AdminAuthDialog.h"
 #include <QCheckBox>
+#include <QDialogButtonBox>
+#include <QLabel>
 #include <QLineEdit>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QThread>
+#include <QVBoxLayout>
+#include <memory>
 
 AdminAuthDialog::AdminAuthDialog(QWidget* parent)
-    : QDialog(parent), ui(new Ui::AdminAuthDialog)
+    : QDialog(parent)
 {
-    ui->setupUi(this);
     setWindowTitle(tr("Подтверждение прав"));
-    connect(ui->checkBoxShow, &QCheckBox::toggled,
-            this, &AdminAuthDialog::onShowToggled);
+    setModal(true);
+    setMinimumWidth(360);
+
+    auto* v = new QVBoxLayout(this);
+    m_prompt = new QLabel(tr("Введите админ-пароль:"), this);
+    m_edit = new QLineEdit(this);
+    m_edit->setEchoMode(QLineEdit::Password);
+    m_show = new QCheckBox(tr("Показать пароль"), this);
+
+    // Индикатор без шкалы: время проверки заранее не известно
+    m_busy = new QProgressBar(this);
+    m_busy->setRange(0, 0);
+    m_busy->setTextVisible(false);
+    m_busy->setMaximumHeight(8);
+    m_busy->hide();
+    m_status = new QLabel(this);
+    m_status->hide();
+
+    m_buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+
+    v->addWidget(m_prompt);
+    v->addWidget(m_edit);
+    v->addWidget(m_show);
+    v->addWidget(m_busy);
+    v->addWidget(m_status);
+    v->addWidget(m_buttons);
+
+    connect(m_show, &QCheckBox::toggled, this, &AdminAuthDialog::onShowToggled);
+    connect(m_buttons, &QDialogButtonBox::accepted, this, &AdminAuthDialog::onAccepted);
+    connect(m_buttons, &QDialogButtonBox::rejected, this, &AdminAuthDialog::reject);
+    m_edit->setFocus();
 }
 
 AdminAuthDialog::~AdminAuthDialog() {
-    delete ui;
+    if (m_worker) m_worker->wait();
+}
+
+void AdminAuthDialog::setPrompt(const QString& title, const QString& text) {
+    setWindowTitle(title);
+    m_prompt->setText(text);
+}
+
+void AdminAuthDialog::setVerifier(Verifier verifier, int maxAttempts) {
+    m_verifier = std::move(verifier);
+    m_maxAttempts = qMax(1, maxAttempts);
 }
 
 QString AdminAuthDialog::password() const {
-    return ui->lineEditPwd->text();
+    return m_verifier ? m_verified : m_edit->text();
 }
 
 void AdminAuthDialog::onShowToggled(bool on) {
-    ui->lineEditPwd->setEchoMode(on ? QLineEdit::Normal : QLineEdit::Password);
-}
\ No newline at end of file
+    m_edit->setEchoMode(on ? QLineEdit::Normal : QLineEdit::Password);
+}
+
+void AdminAuthDialog::onAccepted() {
+    if (!m_verifier) {
+        accept();
+        return;
+    }
+    if (m_edit->text().isEmpty()) return;
+
+    setBusy(true);
+    const quint64 ticket = ++m_ticket;
+    auto verdict = std::make_shared<Verdict>();
+    // Отдельный поток на одну проверку: пул не нужен, проверки редки и
+    // не должны вставать в очередь за фоновыми задачами
+    QThread* worker = QThread::create([verifier = m_verifier, password = m_edit->text(), verdict]() {
+        *verdict = verifier(password);
+    });
+    m_worker = worker;
+    connect(worker, &QThread::finished, this, [this, worker, ticket, verdict]() {
+        if (m_worker == worker) m_worker = nullptr;
+        worker->deleteLater();
+        onVerified(ticket, *verdict);
+    });
+    worker->start();
+}
+
+void AdminAuthDialog::reject() {
+    if (m_worker) return; // проверка идёт: итог применится или будет отброшен здесь же
+    QDialog::reject();
+}
+
+void AdminAuthDialog::onVerified(quint64 ticket, const Verdict& verdict) {
+    if (ticket != m_ticket || !isVisible()) return; // окно уже закрыто — ответ не нужен
+    setBusy(false);
+    if (verdict.ok) {
+        if (verdict.apply) verdict.apply();
+        m_verified = m_edit->text();
+        accept();
+        return;
+    }
+
+    ++m_failed;
+    if (m_failed >= m_maxAttempts) {
+        reject();
+        return;
+    }
+    m_edit->clear();
+    m_edit->setFocus();
+    m_status->setStyleSheet("color: #c0392b;");
+    m_status->setText(tr("Неверный пароль. Осталось попыток: %1").arg(m_maxAttempts - m_failed));
+    m_status->show();
+}
+
+void AdminAuthDialog::setBusy(bool busy) {
+    m_edit->setEnabled(!busy);
+    m_show->setEnabled(!busy);
+    m_buttons->button(QDialogButtonBox::Ok)->setEnabled(!busy);
+    m_buttons->button(QDialogButtonBox::Cancel)->setEnabled(!busy);
+    m_busy->setVisible(busy);
+    if (busy) {
+        m_status->setStyleSheet(QString());
+        m_status->setText(tr("Проверка пароля…"));
+        m_status->show();
+    } else {
+        m_status->hide();
+    }
+}
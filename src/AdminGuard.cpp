@@ -1,4 +1,5 @@
 #include "AdminGuard.h"
+#include "Pbkdf2.h"
 
 bool AdminGuard::ensureAdmin(QWidget* parent, AdminSession* session, AdminPasswordManager* mgr, int minutes)
 {
@@ -13,12 +14,25 @@ bool AdminGuard::ensureAdmin(QWidget* parent, AdminSession* session, AdminPasswo
         return false;
     }
 
+    // Растяжение пароля идёт в потоке окна проверки, интерфейс не замирает.
+    // Запись читается здесь, поток только считает хеш; перевод записи старого
+    // формата на PBKDF2 считается там же, а сохраняется в потоке окна
     AdminAuthDialog dlg(parent);
-    if (dlg.exec() != QDialog::Accepted) return false;
-
-    if (!mgr->verifyPassword(dlg.password())) {
-        QMessageBox::critical(parent, QObject::tr("Отказано"), QObject::tr("Неверный админ-пароль."));
-        AuditLogger::instance().log("Admin auth failed", "", AuditSeverity::Security);
+    const QString record = mgr->storedRecord();
+    dlg.setVerifier([mgr, record](const QString& pwd) {
+        AdminAuthDialog::Verdict verdict;
+        verdict.ok = AdminPasswordManager::verifyAgainstRecord(pwd, record);
+        if (verdict.ok && !Pbkdf2::isRecord(record)) {
+            const QString upgraded = AdminPasswordManager::hashPassword(pwd);
+            verdict.apply = [mgr, upgraded]() { mgr->setStoredRecord(upgraded); };
+        }
+        return verdict;
+    });
+    if (dlg.exec() != QDialog::Accepted) {
+        if (dlg.failedAttempts() > 0) {
+            QMessageBox::critical(parent, QObject::tr("Отказано"), QObject::tr("Неверный админ-пароль."));
+            AuditLogger::instance().log("Admin auth failed", "", AuditSeverity::Security);
+        }
         return false;
     }
 
@@ -1,26 +1,30 @@
 #include "AdminPasswordManager.h"
 #include <QCryptographicHash>
-#include <QRandomGenerator>
 #include <QByteArray>
 #include <QSettings>
+#include <cstring>
+#include "Pbkdf2.h"
 
-static QByteArray stretch(const QByteArray& input, const QByteArray& salt, int iterations) {
-    // Простое «растяжение»: H = SHA256(salt || pwd), затем итерации H = SHA256(H || salt)
-    QByteArray h = QCryptographicHash::hash(salt + input, QCryptographicHash::Sha256);
+// Старый формат "sha256$<итерации>$<соль>$<хеш>": H = SHA256(salt || pwd),
+// затем итерации H = SHA256(H || salt). Новые записи — PBKDF2 (см. Pbkdf2),
+// старые только проверяются и после успешного входа переписываются.
+// Вход итерации собирается в одном буфере, хешер переиспользуется
+static QByteArray legacyStretch(const QByteArray& input, const QByteArray& salt, int iterations) {
+    QCryptographicHash hasher(QCryptographicHash::Sha256);
+    hasher.addData(salt);
+    hasher.addData(input);
+    QByteArray buf = hasher.result();
+    buf.append(salt);
     for (int i = 0; i < iterations; ++i) {
-        h = QCryptographicHash::hash(h + salt, QCryptographicHash::Sha256);
+        hasher.reset();
+        hasher.addData(buf);
+        std::memcpy(buf.data(), hasher.result().constData(), 32);
     }
-    return h;
+    buf.truncate(32);
+    return buf;
 }
 
-static QString makeRecord(const QByteArray& salt, const QByteArray& hash, int iterations) {
-    return QStringLiteral("sha256$%1$%2$%3")
-        .arg(iterations)
-        .arg(QString::fromLatin1(salt.toBase64()))
-        .arg(QString::fromLatin1(hash.toBase64()));
-}
-
-static bool parseRecord(const QString& record, int& iterOut, QByteArray& saltOut, QByteArray& hashOut) {
+static bool parseLegacyRecord(const QString& record, int& iterOut, QByteArray& saltOut, QByteArray& hashOut) {
     const auto parts = record.split('$');
     if (parts.size() != 4 || parts[0] != QLatin1String("sha256")) return false;
     bool ok = false;
@@ -33,6 +37,11 @@ static bool parseRecord(const QString& record, int& iterOut, QByteArray& saltOut
     return true;
 }
 
+static bool isValidRecord(const QString& record) {
+    int it = 0; QByteArray salt, hash;
+    return Pbkdf2::parseRecord(record, nullptr, nullptr, nullptr) || parseLegacyRecord(record, it, salt, hash);
+}
+
 AdminPasswordManager::AdminPasswordManager(QObject* p) : QObject(p) {}
 
 QString AdminPasswordManager::loadRecord() const {
@@ -54,15 +63,8 @@ bool AdminPasswordManager::hasPassword() const {
 }
 
 QString AdminPasswordManager::hashPassword(const QString& pwd, int iterations) {
-    QByteArray salt(24, Qt::Uninitialized);
-    auto *rng = QRandomGenerator::system();
-    for (int i = 0; i < salt.size(); i += 4) {
-        quint32 r = rng->generate();
-        const int chunk = qMin(4, salt.size() - i);
-        std::memcpy(salt.data() + i, &r, chunk);
-    }
-    QByteArray hash = stretch(pwd.toUtf8(), salt, iterations);
-    return makeRecord(salt, hash, iterations);
+    // iterations <= 0 — подобрать под время проверки на этой машине
+    return Pbkdf2::makeRecord(pwd, iterations);
 }
 
 bool AdminPasswordManager::setNewPassword(const QString& pwd) {
@@ -72,22 +74,24 @@ bool AdminPasswordManager::setNewPassword(const QString& pwd) {
 }
 
 bool AdminPasswordManager::verifyAgainstRecord(const QString& pwd, const QString& record) {
+    if (Pbkdf2::isRecord(record)) return Pbkdf2::verifyRecord(pwd, record);
     int it = 0; QByteArray salt, stored;
-    if (!parseRecord(record, it, salt, stored)) return false;
-    QByteArray calc = stretch(pwd.toUtf8(), salt, it);
-    return calc == stored;
+    if (!parseLegacyRecord(record, it, salt, stored)) return false;
+    return Pbkdf2::constantTimeEquals(legacyStretch(pwd.toUtf8(), salt, it), stored);
 }
 
 bool AdminPasswordManager::verifyPassword(const QString& pwd) const {
     const QString rec = loadRecord();
     if (rec.isEmpty()) return false;
-    return verifyAgainstRecord(pwd, rec);
+    if (!verifyAgainstRecord(pwd, rec)) return false;
+    // Запись старого формата переводим на PBKDF2 с подобранной стоимостью
+    if (!Pbkdf2::isRecord(rec)) saveRecord(hashPassword(pwd));
+    return true;
 }
 
 QString AdminPasswordManager::storedRecord() const { return loadRecord(); }
 bool AdminPasswordManager::setStoredRecord(const QString& r) {
-    int it=0; QByteArray salt, hash;
-    if (!parseRecord(r, it, salt, hash)) return false;
+    if (!isValidRecord(r)) return false;
     saveRecord(r);
     return true;
 }
\ No newline at end of file
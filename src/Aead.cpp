@@ -0,0 +1,461 @@
+#include "Aead.h"
+#include <QRandomGenerator>
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AEAD_SSE2 1
+#endif
+
+namespace {
+
+constexpr quint32 kSigma[4] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+constexpr char kStreamMagic[8] = {'R', 'N', 'T', 'A', 'E', 'A', 'D', '1'};
+constexpr int kPrefixSize = 7;
+constexpr int kHeaderSize = 8 + 4 + kPrefixSize + 1;
+
+inline quint32 load32le(const uchar* p)
+{
+    return quint32(p[0]) | (quint32(p[1]) << 8) | (quint32(p[2]) << 16) | (quint32(p[3]) << 24);
+}
+
+inline void store32le(uchar* p, quint32 v)
+{
+    p[0] = uchar(v);
+    p[1] = uchar(v >> 8);
+    p[2] = uchar(v >> 16);
+    p[3] = uchar(v >> 24);
+}
+
+inline quint32 rotl(quint32 x, int n) { return (x << n) | (x >> (32 - n)); }
+
+#define CHACHA_QR(a, b, c, d)                   \
+    a += b; d ^= a; d = rotl(d, 16);            \
+    c += d; b ^= c; b = rotl(b, 12);            \
+    a += b; d ^= a; d = rotl(d, 8);             \
+    c += d; b ^= c; b = rotl(b, 7)
+
+// Состояние ChaCha20: константы, ключ, счётчик блоков, nonce
+struct ChaCha20 {
+    quint32 input[16];
+
+    ChaCha20(const uchar key[32], const uchar nonce[12], quint32 counter)
+    {
+        std::memcpy(input, kSigma, sizeof(kSigma));
+        for (int i = 0; i < 8; ++i) input[4 + i] = load32le(key + 4 * i);
+        input[12] = counter;
+        for (int i = 0; i < 3; ++i) input[13 + i] = load32le(nonce + 4 * i);
+    }
+
+    void block(uchar out[64])
+    {
+        quint32 x[16];
+        std::memcpy(x, input, sizeof(x));
+        for (int i = 0; i < 10; ++i) {
+            CHACHA_QR(x[0], x[4], x[8], x[12]);
+            CHACHA_QR(x[1], x[5], x[9], x[13]);
+            CHACHA_QR(x[2], x[6], x[10], x[14]);
+            CHACHA_QR(x[3], x[7], x[11], x[15]);
+            CHACHA_QR(x[0], x[5], x[10], x[15]);
+            CHACHA_QR(x[1], x[6], x[11], x[12]);
+            CHACHA_QR(x[2], x[7], x[8], x[13]);
+            CHACHA_QR(x[3], x[4], x[9], x[14]);
+        }
+        for (int i = 0; i < 16; ++i) store32le(out + 4 * i, x[i] + input[i]);
+        ++input[12];
+    }
+
+#ifdef AEAD_SSE2
+    // Четыре блока подряд: в каждой дорожке регистра — свой счётчик
+    void block4(uchar out[256])
+    {
+        __m128i x[16], orig[16];
+        for (int i = 0; i < 16; ++i) x[i] = _mm_set1_epi32(int(input[i]));
+        x[12] = _mm_add_epi32(x[12], _mm_set_epi32(3, 2, 1, 0));
+        for (int i = 0; i < 16; ++i) orig[i] = x[i];
+
+#define ROTL4(v, n) _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - n))
+#define ROTL4_16(v) _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1)
+#define QR4(a, b, c, d)                                                         \
+    a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = ROTL4_16(d);          \
+    c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = ROTL4(b, 12);         \
+    a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = ROTL4(d, 8);          \
+    c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = ROTL4(b, 7)
+        for (int i = 0; i < 10; ++i) {
+            QR4(x[0], x[4], x[8], x[12]);
+            QR4(x[1], x[5], x[9], x[13]);
+            QR4(x[2], x[6], x[10], x[14]);
+            QR4(x[3], x[7], x[11], x[15]);
+            QR4(x[0], x[5], x[10], x[15]);
+            QR4(x[1], x[6], x[11], x[12]);
+            QR4(x[2], x[7], x[8], x[13]);
+            QR4(x[3], x[4], x[9], x[14]);
+        }
+#undef QR4
+#undef ROTL4_16
+#undef ROTL4
+
+        // Транспонирование 4x4: из «слово i всех блоков» в «блок j подряд»
+        for (int g = 0; g < 16; g += 4) {
+            const __m128i a = _mm_add_epi32(x[g], orig[g]);
+            const __m128i b = _mm_add_epi32(x[g + 1], orig[g + 1]);
+            const __m128i c = _mm_add_epi32(x[g + 2], orig[g + 2]);
+            const __m128i d = _mm_add_epi32(x[g + 3], orig[g + 3]);
+            const __m128i t0 = _mm_unpacklo_epi32(a, b);
+            const __m128i t1 = _mm_unpacklo_epi32(c, d);
+            const __m128i t2 = _mm_unpackhi_epi32(a, b);
+            const __m128i t3 = _mm_unpackhi_epi32(c, d);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * g), _mm_unpacklo_epi64(t0, t1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 64 + 4 * g), _mm_unpackhi_epi64(t0, t1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 128 + 4 * g), _mm_unpacklo_epi64(t2, t3));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 192 + 4 * g), _mm_unpackhi_epi64(t2, t3));
+        }
+        input[12] += 4;
+    }
+#endif
+
+    // data ^= ключевой поток, с текущего счётчика
+    void apply(uchar* data, size_t size)
+    {
+        uchar stream[256];
+#ifdef AEAD_SSE2
+        while (size >= sizeof(stream)) {
+            block4(stream);
+            for (size_t i = 0; i < sizeof(stream); i += 16) {
+                __m128i* p = reinterpret_cast<__m128i*>(data + i);
+                const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(stream + i));
+                _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), s));
+            }
+            data += sizeof(stream);
+            size -= sizeof(stream);
+        }
+#endif
+        while (size > 0) {
+            block(stream);
+            const size_t take = size < 64 ? size : 64;
+            for (size_t i = 0; i < take; ++i) data[i] ^= stream[i];
+            data += take;
+            size -= take;
+        }
+    }
+};
+
+#undef CHACHA_QR
+
+// Poly1305 на 26-битных лимбах: умножения 32x32->64, переносимо без __int128
+struct Poly1305 {
+    quint32 r[5], s[4], h[5] = {0, 0, 0, 0, 0}, pad[4];
+    uchar buffer[16];
+    size_t used = 0;
+
+    explicit Poly1305(const uchar key[32])
+    {
+        r[0] = load32le(key + 0) & 0x3ffffff;
+        r[1] = (load32le(key + 3) >> 2) & 0x3ffff03;
+        r[2] = (load32le(key + 6) >> 4) & 0x3ffc0ff;
+        r[3] = (load32le(key + 9) >> 6) & 0x3f03fff;
+        r[4] = (load32le(key + 12) >> 8) & 0x00fffff;
+        for (int i = 0; i < 4; ++i) s[i] = r[i + 1] * 5;
+        for (int i = 0; i < 4; ++i) pad[i] = load32le(key + 16 + 4 * i);
+    }
+
+    void blocks(const uchar* m, size_t size, quint32 hibit)
+    {
+        const quint32 r0 = r[0], r1 = r[1], r2 = r[2], r3 = r[3], r4 = r[4];
+        const quint32 s1 = s[0], s2 = s[1], s3 = s[2], s4 = s[3];
+        quint32 h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4];
+        while (size >= 16) {
+            h0 += load32le(m + 0) & 0x3ffffff;
+            h1 += (load32le(m + 3) >> 2) & 0x3ffffff;
+            h2 += (load32le(m + 6) >> 4) & 0x3ffffff;
+            h3 += (load32le(m + 9) >> 6) & 0x3ffffff;
+            h4 += (load32le(m + 12) >> 8) | hibit;
+
+            const quint64 d0 = quint64(h0) * r0 + quint64(h1) * s4 + quint64(h2) * s3 + quint64(h3) * s2 + quint64(h4) * s1;
+            quint64 d1 = quint64(h0) * r1 + quint64(h1) * r0 + quint64(h2) * s4 + quint64(h3) * s3 + quint64(h4) * s2;
+            quint64 d2 = quint64(h0) * r2 + quint64(h1) * r1 + quint64(h2) * r0 + quint64(h3) * s4 + quint64(h4) * s3;
+            quint64 d3 = quint64(h0) * r3 + quint64(h1) * r2 + quint64(h2) * r1 + quint64(h3) * r0 + quint64(h4) * s4;
+            quint64 d4 = quint64(h0) * r4 + quint64(h1) * r3 + quint64(h2) * r2 + quint64(h3) * r1 + quint64(h4) * r0;
+
+            quint32 c = quint32(d0 >> 26); h0 = quint32(d0) & 0x3ffffff;
+            d1 += c; c = quint32(d1 >> 26); h1 = quint32(d1) & 0x3ffffff;
+            d2 += c; c = quint32(d2 >> 26); h2 = quint32(d2) & 0x3ffffff;
+            d3 += c; c = quint32(d3 >> 26); h3 = quint32(d3) & 0x3ffffff;
+            d4 += c; c = quint32(d4 >> 26); h4 = quint32(d4) & 0x3ffffff;
+            h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+            h1 += c;
+
+            m += 16;
+            size -= 16;
+        }
+        h[0] = h0; h[1] = h1; h[2] = h2; h[3] = h3; h[4] = h4;
+    }
+
+    void update(const uchar* m, size_t size)
+    {
+        if (used > 0) {
+            const size_t take = qMin(size, sizeof(buffer) - used);
+            std::memcpy(buffer + used, m, take);
+            used += take;
+            m += take;
+            size -= take;
+            if (used < sizeof(buffer)) return;
+            blocks(buffer, sizeof(buffer), 1u << 24);
+            used = 0;
+        }
+        const size_t whole = size & ~size_t(15);
+        blocks(m, whole, 1u << 24);
+        m += whole;
+        size -= whole;
+        std::memcpy(buffer, m, size);
+        used = size;
+    }
+
+    // Выравнивание нулями до 16 байт (AEAD дополняет aad и шифртекст)
+    void padTo16()
+    {
+        if (used == 0) return;
+        std::memset(buffer + used, 0, sizeof(buffer) - used);
+        blocks(buffer, sizeof(buffer), 1u << 24);
+        used = 0;
+    }
+
+    void final(uchar tag[16])
+    {
+        if (used > 0) {
+            buffer[used] = 1;
+            std::memset(buffer + used + 1, 0, sizeof(buffer) - used - 1);
+            blocks(buffer, sizeof(buffer), 0);
+            used = 0;
+        }
+
+        quint32 h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4];
+        quint32 c = h1 >> 26; h1 &= 0x3ffffff;
+        h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+        h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+        h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+        h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+        h1 += c;
+
+        // h - p: если не ушло в минус, берём его (без ветвлений)
+        quint32 g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+        quint32 g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+        quint32 g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+        quint32 g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+        const quint32 g4 = h4 + c - (1u << 26);
+        quint32 mask = (g4 >> 31) - 1;
+        g0 &= mask; g1 &= mask; g2 &= mask; g3 &= mask;
+        const quint32 g4m = g4 & mask;
+        mask = ~mask;
+        h0 = (h0 & mask) | g0;
+        h1 = (h1 & mask) | g1;
+        h2 = (h2 & mask) | g2;
+        h3 = (h3 & mask) | g3;
+        h4 = (h4 & mask) | g4m;
+
+        h0 = h0 | (h1 << 26);
+        h1 = (h1 >> 6) | (h2 << 20);
+        h2 = (h2 >> 12) | (h3 << 14);
+        h3 = (h3 >> 18) | (h4 << 8);
+
+        quint64 f = quint64(h0) + pad[0];            store32le(tag + 0, quint32(f));
+        f = quint64(h1) + pad[1] + (f >> 32);         store32le(tag + 4, quint32(f));
+        f = quint64(h2) + pad[2] + (f >> 32);         store32le(tag + 8, quint32(f));
+        f = quint64(h3) + pad[3] + (f >> 32);         store32le(tag + 12, quint32(f));
+    }
+};
+
+// Тег RFC 8439: Poly1305 по aad, шифртексту и их длинам, ключ — блок 0
+void computeTag(ChaCha20& cipher, const uchar* aad, size_t aadSize, const uchar* ct, size_t ctSize,
+                uchar tag[16])
+{
+    uchar otk[64];
+    cipher.input[12] = 0;
+    cipher.block(otk);
+    Poly1305 mac(otk);
+    mac.update(aad, aadSize);
+    mac.padTo16();
+    mac.update(ct, ctSize);
+    mac.padTo16();
+    uchar lengths[16];
+    store32le(lengths + 0, quint32(aadSize));
+    store32le(lengths + 4, quint32(quint64(aadSize) >> 32));
+    store32le(lengths + 8, quint32(ctSize));
+    store32le(lengths + 12, quint32(quint64(ctSize) >> 32));
+    mac.update(lengths, sizeof(lengths));
+    mac.final(tag);
+    std::memset(otk, 0, sizeof(otk));
+}
+
+void sealInPlace(const uchar key[32], const uchar nonce[12], const uchar* aad, size_t aadSize,
+                 uchar* data, size_t size, uchar tag[16])
+{
+    ChaCha20 cipher(key, nonce, 1);
+    cipher.apply(data, size);
+    computeTag(cipher, aad, aadSize, data, size, tag);
+}
+
+bool openInPlace(const uchar key[32], const uchar nonce[12], const uchar* aad, size_t aadSize,
+                 uchar* data, size_t size, const uchar tag[16])
+{
+    ChaCha20 cipher(key, nonce, 1);
+    uchar expected[16];
+    computeTag(cipher, aad, aadSize, data, size, expected);
+    uchar diff = 0;
+    for (int i = 0; i < 16; ++i) diff |= uchar(expected[i] ^ tag[i]);
+    if (diff != 0) return false;
+    cipher.input[12] = 1;
+    cipher.apply(data, size);
+    return true;
+}
+
+inline const uchar* bytes(const QByteArray& a) { return reinterpret_cast<const uchar*>(a.constData()); }
+inline uchar* bytes(QByteArray& a) { return reinterpret_cast<uchar*>(a.data()); }
+
+void chunkNonce(const QByteArray& header, quint32 index, bool last, uchar nonce[12])
+{
+    std::memcpy(nonce, header.constData() + 12, kPrefixSize);
+    nonce[7] = uchar(index >> 24);
+    nonce[8] = uchar(index >> 16);
+    nonce[9] = uchar(index >> 8);
+    nonce[10] = uchar(index);
+    nonce[11] = last ? 1 : 0;
+}
+
+// Читает до size байт, пока устройство отдаёт данные (сокеты и пайпы отдают частями)
+qint64 readFull(QIODevice& in, char* data, qint64 size)
+{
+    qint64 total = 0;
+    while (total < size) {
+        const qint64 n = in.read(data + total, size - total);
+        if (n < 0) return -1;
+        if (n == 0 && !in.waitForReadyRead(-1)) break;
+        total += n;
+    }
+    return total;
+}
+
+} // namespace
+
+QByteArray Aead::randomBytes(int size)
+{
+    QByteArray out(size, Qt::Uninitialized);
+    auto* rng = QRandomGenerator::system();
+    for (int i = 0; i < out.size(); i += 4) {
+        const quint32 r = rng->generate();
+        std::memcpy(out.data() + i, &r, size_t(qMin(4, out.size() - i)));
+    }
+    return out;
+}
+
+QByteArray Aead::seal(const QByteArray& key, const QByteArray& plaintext, const QByteArray& aad)
+{
+    if (key.size() != kKeySize) return QByteArray();
+    QByteArray out = randomBytes(kNonceSize);
+    out.append(plaintext);
+    out.resize(kNonceSize + plaintext.size() + kTagSize);
+    uchar* p = bytes(out);
+    sealInPlace(bytes(key), p, bytes(aad), size_t(aad.size()), p + kNonceSize, size_t(plaintext.size()),
+                p + kNonceSize + plaintext.size());
+    return out;
+}
+
+bool Aead::open(const QByteArray& key, const QByteArray& sealed, QByteArray* plaintext, const QByteArray& aad)
+{
+    if (key.size() != kKeySize || sealed.size() < kNonceSize + kTagSize) return false;
+    const int size = sealed.size() - kNonceSize - kTagSize;
+    QByteArray data = sealed.mid(kNonceSize, size);
+    if (!openInPlace(bytes(key), bytes(sealed), bytes(aad), size_t(aad.size()), bytes(data), size_t(size),
+                     bytes(sealed) + kNonceSize + size)) {
+        return false;
+    }
+    if (plaintext) *plaintext = data;
+    return true;
+}
+
+bool Aead::encryptStream(const QByteArray& key, QIODevice& in, QIODevice& out, const Progress& progress)
+{
+    if (key.size() != kKeySize) return false;
+
+    QByteArray header(kStreamMagic, sizeof(kStreamMagic));
+    uchar size[4];
+    store32le(size, quint32(kChunkSize));
+    header.append(reinterpret_cast<const char*>(size), sizeof(size));
+    header.append(randomBytes(kPrefixSize));
+    header.append('\0'); // версия формата
+    if (out.write(header) != header.size()) return false;
+
+    // Признак последнего куска известен, только когда следующий прочитан пустым
+    QByteArray current(kChunkSize + kTagSize, Qt::Uninitialized);
+    QByteArray next(kChunkSize + kTagSize, Qt::Uninitialized);
+    qint64 currentSize = readFull(in, current.data(), kChunkSize);
+    qint64 done = 0;
+    uchar nonce[kNonceSize];
+    for (quint32 index = 0;; ++index) {
+        if (currentSize < 0) return false;
+        const qint64 nextSize = currentSize < kChunkSize ? 0 : readFull(in, next.data(), kChunkSize);
+        if (nextSize < 0) return false;
+        const bool last = nextSize == 0;
+
+        chunkNonce(header, index, last, nonce);
+        uchar* data = bytes(current);
+        sealInPlace(bytes(key), nonce, bytes(header), size_t(header.size()), data, size_t(currentSize),
+                    data + currentSize);
+        if (out.write(current.constData(), currentSize + kTagSize) != currentSize + kTagSize) return false;
+
+        done += currentSize;
+        if (progress && !progress(done)) return false;
+        if (last) break;
+        current.swap(next);
+        currentSize = nextSize;
+    }
+    return true;
+}
+
+bool Aead::decryptStream(const QByteArray& key, QIODevice& in, QIODevice& out, const Progress& progress)
+{
+    if (key.size() != kKeySize) return false;
+
+    QByteArray header(kHeaderSize, Qt::Uninitialized);
+    if (readFull(in, header.data(), kHeaderSize) != kHeaderSize) return false;
+    if (std::memcmp(header.constData(), kStreamMagic, sizeof(kStreamMagic)) != 0 || header[kHeaderSize - 1] != '\0') {
+        return false;
+    }
+    const qint64 chunkSize = load32le(bytes(header) + 8);
+    if (chunkSize <= 0 || chunkSize > 64 * kChunkSize) return false;
+
+    const qint64 stored = chunkSize + kTagSize;
+    QByteArray current(int(stored), Qt::Uninitialized);
+    QByteArray next(int(stored), Qt::Uninitialized);
+    qint64 currentSize = readFull(in, current.data(), stored);
+    qint64 done = 0;
+    uchar nonce[kNonceSize];
+    for (quint32 index = 0;; ++index) {
+        if (currentSize < kTagSize) return false; // обрезан или пуст
+        const qint64 nextSize = currentSize < stored ? 0 : readFull(in, next.data(), stored);
+        if (nextSize < 0) return false;
+        const bool last = nextSize == 0;
+
+        const qint64 plainSize = currentSize - kTagSize;
+        chunkNonce(header, index, last, nonce);
+        uchar* data = bytes(current);
+        if (!openInPlace(bytes(key), nonce, bytes(header), size_t(header.size()), data, size_t(plainSize),
+                         data + plainSize)) {
+            return false;
+        }
+        if (out.write(current.constData(), plainSize) != plainSize) return false;
+
+        done += plainSize;
+        if (progress && !progress(done)) return false;
+        if (last) break;
+        current.swap(next);
+        currentSize = nextSize;
+    }
+    return true;
+}
+
+bool Aead::isEncryptedStream(QIODevice& in)
+{
+    const QByteArray head = in.peek(sizeof(kStreamMagic));
+    return head.size() == int(sizeof(kStreamMagic)) &&
+           std::memcmp(head.constData(), kStreamMagic, sizeof(kStreamMagic)) == 0;
+}
@@ -0,0 +1,128 @@
+#include "AuditChain.h"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QMessageAuthenticationCode>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QtEndian>
+#include <atomic>
+
+namespace {
+
+void addInt64(QCryptographicHash& h, qint64 value)
+{
+    uchar buf[8];
+    qToBigEndian<qint64>(value, buf);
+    h.addData(QByteArrayView(reinterpret_cast<const char*>(buf), sizeof(buf)));
+}
+
+// Строка с длиной впереди: границы полей однозначны, "ab"+"c" != "a"+"bc"
+void addString(QCryptographicHash& h, const QString& value)
+{
+    const QByteArray utf8 = value.toUtf8();
+    uchar len[4];
+    qToBigEndian<quint32>(static_cast<quint32>(utf8.size()), len);
+    h.addData(QByteArrayView(reinterpret_cast<const char*>(len), sizeof(len)));
+    h.addData(utf8);
+}
+
+} // namespace
+
+QByteArray AuditChain::genesis()
+{
+    return QByteArray(kHashSize, '\0');
+}
+
+QByteArray AuditChain::rowHash(const QByteArray& prev, qint64 id, qint64 tsMs, const QString& ts,
+                               const QString& actor, const QString& event, const QString& details,
+                               int severity)
+{
+    QCryptographicHash h(QCryptographicHash::Sha256);
+    h.addData(prev);
+    addInt64(h, id);
+    addInt64(h, tsMs);
+    addInt64(h, severity);
+    addString(h, ts);
+    addString(h, actor);
+    addString(h, event);
+    addString(h, details);
+    return h.result();
+}
+
+QByteArray AuditChain::checkpointSignature(const QByteArray& key, qint64 lastId, const QByteArray& hash,
+                                           qint64 createdMs, int kind)
+{
+    QByteArray message;
+    message.reserve(8 + kHashSize + 8 + 8);
+    uchar buf[8];
+    qToBigEndian<qint64>(lastId, buf);
+    message.append(reinterpret_cast<const char*>(buf), sizeof(buf));
+    message.append(hash);
+    qToBigEndian<qint64>(createdMs, buf);
+    message.append(reinterpret_cast<const char*>(buf), sizeof(buf));
+    qToBigEndian<qint64>(kind, buf);
+    message.append(reinterpret_cast<const char*>(buf), sizeof(buf));
+    return QMessageAuthenticationCode::hash(message, key, QCryptographicHash::Sha256);
+}
+
+QByteArray AuditChain::deriveKey(const QByteArray& dataKey)
+{
+    if (dataKey.isEmpty()) return QByteArray();
+    return QMessageAuthenticationCode::hash(QByteArrayLiteral("audit-checkpoint-v1"), dataKey,
+                                            QCryptographicHash::Sha256);
+}
+
+QByteArray AuditChain::readLegacyKey(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+    const QByteArray key = file.readAll();
+    return key.size() == kHashSize ? key : QByteArray();
+}
+
+AuditChain::RangeResult AuditChain::verifyRange(const QString& dbPath, const QString& partition,
+                                                qint64 afterId, const QByteArray& prev)
+{
+    RangeResult result;
+    // Проверки могут идти одновременно (окно журнала, verifyIntegrity) и по
+    // одной партиции — имя соединения должно быть уникальным
+    static std::atomic<quint64> counter{0};
+    const QString connection = QString("audit_verify_%1_%2").arg(partition).arg(++counter);
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection);
+        db.setDatabaseName(dbPath);
+        db.setConnectOptions("QSQLITE_OPEN_READONLY");
+        if (!db.open()) {
+            result.error = db.lastError().text();
+        } else {
+            QSqlQuery q(db);
+            q.setForwardOnly(true);
+            q.prepare(QString("SELECT id, ts_ms, ts, actor, event, details, severity, hash "
+                              "FROM %1 WHERE id > ? ORDER BY id;").arg(partition));
+            q.addBindValue(afterId);
+            if (!q.exec()) {
+                result.error = q.lastError().text();
+            } else {
+                QByteArray link = prev;
+                while (q.next()) {
+                    const qint64 id = q.value(0).toLongLong();
+                    const QByteArray expected = rowHash(link, id, q.value(1).toLongLong(), q.value(2).toString(),
+                                                        q.value(3).toString(), q.value(4).toString(),
+                                                        q.value(5).toString(), q.value(6).toInt());
+                    ++result.rows;
+                    link = q.value(7).toByteArray();
+                    if (link != expected) {
+                        result.firstBadId = id;
+                        break;
+                    }
+                    result.lastId = id;
+                    result.lastHash = link;
+                }
+            }
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connection);
+    return result;
+}
@@ -1,4 +1,9 @@
 #include "AuditLogDialog.h"
+#include <QThread>
+
+namespace {
+constexpr int kPageSize = 500;
+}
 
 AuditLogDialog::AuditLogDialog(QWidget* parent) : QDialog(parent) {
     setWindowTitle(tr("Журнал событий (только для администратора)"));
@@ -22,11 +27,16 @@ AuditLogDialog::AuditLogDialog(QWidget* parent) : QDialog(parent) {
     m_sevCombo->addItem("Warning", (int)AuditSeverity::Warning);
     m_sevCombo->addItem("Error", (int)AuditSeverity::Error);
     m_sevCombo->addItem("Security", (int)AuditSeverity::Security);
+    m_eventCombo = new QComboBox(this);
+    m_actorCombo = new QComboBox(this);
+    reloadFilterValues();
 
     form->addRow(tr("Поиск:"), m_filterEdit);
     form->addRow(tr("С:"), m_fromEdit);
     form->addRow(tr("По:"), m_toEdit);
     form->addRow(tr("Уровень:"), m_sevCombo);
+    form->addRow(tr("Событие:"), m_eventCombo);
+    form->addRow(tr("Пользователь:"), m_actorCombo);
     v->addLayout(form);
 
     // Кнопки строкой
@@ -34,9 +44,11 @@ AuditLogDialog::AuditLogDialog(QWidget* parent) : QDialog(parent) {
     auto* btnReload = new QPushButton(tr("Обновить"), this);
     m_btnExport = new QPushButton(tr("Экспорт CSV"), this);
     m_btnClear  = new QPushButton(tr("Очистить старше 90 дней"), this);
+    m_btnVerify = new QPushButton(tr("Проверить целостность"), this);
     h->addWidget(btnReload);
     h->addWidget(m_btnExport);
     h->addWidget(m_btnClear);
+    h->addWidget(m_btnVerify);
     h->addStretch();
     v->addLayout(h);
 
@@ -49,27 +61,71 @@ AuditLogDialog::AuditLogDialog(QWidget* parent) : QDialog(parent) {
     m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
     v->addWidget(m_table);
 
+    // Дочитывание следующей страницы с места, где остановились
+    auto* pager = new QHBoxLayout();
+    m_countLabel = new QLabel(this);
+    m_btnMore = new QPushButton(tr("Показать ещё"), this);
+    pager->addWidget(m_countLabel);
+    pager->addStretch();
+    pager->addWidget(m_btnMore);
+    v->addLayout(pager);
+
     // Соединения
     connect(btnReload,   &QPushButton::clicked, this, &AuditLogDialog::reload);
     connect(m_btnExport, &QPushButton::clicked, this, &AuditLogDialog::exportCsv);
     connect(m_btnClear,  &QPushButton::clicked, this, &AuditLogDialog::clearOld);
+    connect(m_btnVerify, &QPushButton::clicked, this, &AuditLogDialog::verifyChain);
     connect(m_filterEdit,&QLineEdit::textChanged, this, &AuditLogDialog::reload);
     connect(m_fromEdit,  &QDateEdit::dateChanged, this, &AuditLogDialog::reload);
     connect(m_toEdit,    &QDateEdit::dateChanged, this, &AuditLogDialog::reload);
     connect(m_sevCombo,  &QComboBox::currentIndexChanged, this, &AuditLogDialog::reload);
+    connect(m_eventCombo,&QComboBox::currentIndexChanged, this, &AuditLogDialog::reload);
+    connect(m_actorCombo,&QComboBox::currentIndexChanged, this, &AuditLogDialog::reload);
+    connect(m_btnMore,   &QPushButton::clicked, this, &AuditLogDialog::loadMore);
 
     reload();
 }
 
-void AuditLogDialog::reload() {
-    QDateTime from(m_fromEdit->date(), QTime(0,0,0));
-    QDateTime to(m_toEdit->date(), QTime(23,59,59, 999));
-    const QString filter = m_filterEdit->text();
-    const int sev = m_sevCombo->currentData().toInt();
+AuditLogDialog::~AuditLogDialog() {
+    // Результат уже некому показать, но поток держит соединения к audit.db
+    if (m_verifyThread) m_verifyThread->wait();
+}
 
-    const auto rows = AuditLogger::instance().fetch(1000, from, to, filter, sev);
+AuditQuery AuditLogDialog::currentQuery() const {
+    AuditQuery query;
+    query.from = QDateTime(m_fromEdit->date(), QTime(0,0,0));
+    query.to = QDateTime(m_toEdit->date(), QTime(23,59,59, 999));
+    query.text = m_filterEdit->text();
+    query.severity = m_sevCombo->currentData().toInt();
+    query.event = m_eventCombo->currentData().toString();
+    query.actor = m_actorCombo->currentData().toString();
+    return query;
+}
+
+void AuditLogDialog::reloadFilterValues() {
+    auto fill = [](QComboBox* combo, const QString& any, const QStringList& values) {
+        const QString current = combo->currentData().toString();
+        QSignalBlocker block(combo);
+        combo->clear();
+        combo->addItem(any, QString());
+        for (const QString& value : values) combo->addItem(value, value);
+        const int index = combo->findData(current);
+        combo->setCurrentIndex(index < 0 ? 0 : index);
+    };
+    fill(m_eventCombo, tr("Любое"), AuditLogger::instance().knownEvents());
+    fill(m_actorCombo, tr("Любой"), AuditLogger::instance().knownActors());
+}
 
+void AuditLogDialog::reload() {
     m_table->setRowCount(0);
+    m_cursor = AuditCursor();
+    loadMore();
+}
+
+void AuditLogDialog::loadMore() {
+    const auto rows = AuditLogger::instance().fetchPage(currentQuery(), kPageSize, &m_cursor);
+
+    m_table->setUpdatesEnabled(false);
     for (const auto& m : rows) {
         const int r = m_table->rowCount();
         m_table->insertRow(r);
@@ -84,6 +140,11 @@ void AuditLogDialog::reload() {
         else if (sev == (int)AuditSeverity::Security) sevText = "Security";
         m_table->setItem(r, 4, new QTableWidgetItem(sevText));
     }
+    m_table->setUpdatesEnabled(true);
+
+    // Неполная страница — дальше строк нет
+    m_btnMore->setEnabled(rows.size() == kPageSize);
+    m_countLabel->setText(tr("Показано: %1").arg(m_table->rowCount()));
 }
 
 void AuditLogDialog::exportCsv() {
@@ -94,14 +155,9 @@ void AuditLogDialog::exportCsv() {
                                                       suggested, "CSV (*.csv)");
     if (path.isEmpty()) return;
 
-    QDateTime from(m_fromEdit->date(), QTime(0,0,0));
-    QDateTime to(m_toEdit->date(), QTime(23,59,59, 999));
-    const QString filter = m_filterEdit->text();
-    const int sev = m_sevCombo->currentData().toInt();
-
-    const auto rows = AuditLogger::instance().fetch(0, from, to, filter, sev); // без лимита
-    if (AuditLogger::exportCsv(path, rows)) {
-        QMessageBox::information(this, tr("Готово"), tr("CSV сохранён."));
+    int written = 0;
+    if (AuditLogger::instance().exportCsv(path, currentQuery(), &written)) {
+        QMessageBox::information(this, tr("Готово"), tr("CSV сохранён, строк: %1.").arg(written));
     } else {
         QMessageBox::warning(this, tr("Ошибка"), tr("Не удалось сохранить CSV."));
     }
@@ -113,9 +169,51 @@ void AuditLogDialog::clearOld() {
 
     const QDateTime before = QDateTime::currentDateTime().addDays(-90);
     if (AuditLogger::instance().clearOlderThan(before)) {
+        reloadFilterValues();
         reload();
         QMessageBox::information(this, tr("Готово"), tr("Старые записи удалены."));
     } else {
         QMessageBox::warning(this, tr("Ошибка"), tr("Не удалось очистить журнал."));
     }
 }
+
+void AuditLogDialog::verifyChain() {
+    if (m_verifyThread) return;
+    m_btnVerify->setEnabled(false);
+    m_btnVerify->setText(tr("Проверка…"));
+
+    // Проверка читает весь журнал и ждёт месяцы в пуле потоков — окно
+    // не должно стоять это время. Результат возвращается в поток окна
+    QThread* thread = QThread::create([this]() {
+        const AuditVerifyResult result = AuditLogger::instance().verifyIntegrity();
+        QMetaObject::invokeMethod(this, [this, result]() { showVerifyResult(result); },
+                                  Qt::QueuedConnection);
+    });
+    thread->setParent(this);
+    m_verifyThread = thread;
+    connect(thread, &QThread::finished, this, [this, thread]() {
+        if (m_verifyThread == thread) m_verifyThread = nullptr;
+        thread->deleteLater();
+    });
+    thread->start(QThread::LowPriority);
+}
+
+void AuditLogDialog::showVerifyResult(const AuditVerifyResult& result) {
+    m_btnVerify->setText(tr("Проверить целостность"));
+    m_btnVerify->setEnabled(true);
+
+    const QString details = tr("%1\n\nСтрок: %2, месяцев: %3, контрольных точек: %4, время: %5 мс%6")
+        .arg(result.message)
+        .arg(result.rowsChecked)
+        .arg(result.partitions)
+        .arg(result.checkpoints)
+        .arg(result.elapsedMs)
+        .arg(result.incremental ? tr("\n(с последней проверенной точки)") : QString());
+    if (result.ok) {
+        QMessageBox::information(this, tr("Журнал цел"), details);
+    } else {
+        AuditLogger::instance().log("Audit chain broken", QString("first_bad_id=%1").arg(result.firstBadId),
+                                    AuditSeverity::Security);
+        QMessageBox::critical(this, tr("Журнал изменён"), details);
+    }
+}
@@ -1,123 +1,315 @@
 #include "AuditLogger.h"
+#include "security.h"
+#include "database.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
 #include <QSqlQuery>
 #include <QSqlError>
-#include <QFile>
+#include <QSaveFile>
 #include <QTextStream>
+#include <QThread>
+#include <QDebug>
+#include <chrono>
+
+namespace {
+
+constexpr std::size_t kRingCapacity = 4096;
+constexpr int kBatchSize = 256;                        // строк на одну транзакцию
+constexpr auto kIdleWait = std::chrono::milliseconds(250);
+constexpr auto kSpaceWait = std::chrono::milliseconds(50); // шаг ожидания места для Error/Security
+const char* const kWriterConnection = "audit_writer";
+const char* const kStoreConnection = "audit_main";
+
+} // namespace
 
-AuditLogger::AuditLogger(QObject* parent) : QObject(parent) {}
+AuditLogger::AuditLogger(QObject* parent) : QObject(parent), m_ring(kRingCapacity) {}
+AuditLogger::~AuditLogger() { shutdown(); }
 AuditLogger& AuditLogger::instance() { static AuditLogger g; return g; }
 
-void AuditLogger::init(const QString& connectionName) {
+void AuditLogger::init(const QString& connectionName, const QString& auditDbPath) {
+    stopWriter();
     m_connectionName = connectionName;
-    ensureTable();
+
+    const QSqlDatabase operational = operationalDatabase();
+    const QString operationalPath = operational.isValid() ? operational.databaseName() : QString();
+    const bool operationalOnDisk = !operationalPath.isEmpty() && operationalPath != ":memory:";
+
+    QString path = auditDbPath;
+    if (path.isEmpty() && operationalOnDisk) {
+        path = QFileInfo(operationalPath).absoluteDir().filePath("audit.db");
+    }
+
+    // Ключ подписи выводится из ключа данных: ни в audit.db, ни рядом с ним
+    // его нет, и пересчитать цепочку после правки без мастер-пароля нельзя.
+    // Пароль не введён — точки не пишутся (см. AuditStore::setSigningKey)
+    m_signingKey = AuditChain::deriveKey(Security::dataKey());
+
+    m_store.reset(new AuditStore(kStoreConnection));
+    m_store->setSigningKey(m_signingKey);
+    if (!m_store->open(path.isEmpty() ? QStringLiteral(":memory:") : path)) {
+        m_store.reset();
+        return;
+    }
+    if (operationalOnDisk) {
+        // Зашифрованную рабочую БД подключаем с её ключом и параметрами
+        const Database& database = Database::getInstance();
+        if (database.getDatabasePath() == operationalPath && database.isEncrypted()) {
+            m_store->importLegacy(operationalPath, database.cipherKey(), database.cipherFormat());
+        } else {
+            m_store->importLegacy(operationalPath);
+        }
+    }
+
+    // Прежние версии хранили ключ в audit.key рядом с журналом: его точки
+    // переподписываются новым ключом, после чего файл удаляется
+    if (!path.isEmpty() && !m_signingKey.isEmpty()) {
+        const QString legacyKeyPath = QFileInfo(path).absoluteDir().filePath("audit.key");
+        const QByteArray legacyKey = AuditChain::readLegacyKey(legacyKeyPath);
+        if (!legacyKey.isEmpty() && m_store->resignCheckpoints(legacyKey)) QFile::remove(legacyKeyPath);
+    }
+
+    // Писателю нужно своё соединение к тому же файлу; in-memory журнал второе
+    // соединение не увидит — тогда остаёмся на синхронной записи
+    m_databasePath = path;
+    startWriter();
+
+    static bool quitHooked = false;
+    if (!quitHooked && QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+                this, &AuditLogger::shutdown);
+        quitHooked = true;
+    }
 }
 
 void AuditLogger::setActorProvider(std::function<QString()> provider) {
     m_actorProvider = std::move(provider);
 }
 
-void AuditLogger::ensureTable() {
-    QSqlDatabase db = m_connectionName.isEmpty()
+QSqlDatabase AuditLogger::operationalDatabase() const {
+    return m_connectionName.isEmpty()
             ? QSqlDatabase::database()
             : QSqlDatabase::database(m_connectionName);
-    if (!db.isValid()) return;
-    if (!db.isOpen())  db.open();
-
-    QSqlQuery q(db);
-    q.exec(R"SQL(
-        CREATE TABLE IF NOT EXISTS audit_log (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            ts TEXT NOT NULL,
-            actor TEXT,
-            event TEXT NOT NULL,
-            details TEXT,
-            severity INTEGER NOT NULL DEFAULT 0
-        );
-    )SQL");
-    q.exec("CREATE INDEX IF NOT EXISTS idx_audit_ts ON audit_log(ts DESC);");
-    q.exec("CREATE INDEX IF NOT EXISTS idx_audit_sev ON audit_log(severity);");
 }
 
 void AuditLogger::log(const QString& event, const QString& details, AuditSeverity severity) {
-    QSqlDatabase db = m_connectionName.isEmpty()
-            ? QSqlDatabase::database()
-            : QSqlDatabase::database(m_connectionName);
-    if (!db.isValid()) return;
-    if (!db.isOpen())  db.open();
+    AuditRecord record;
+    record.msecs = QDateTime::currentMSecsSinceEpoch();
+    record.actor = m_actorProvider ? m_actorProvider() : QStringLiteral("user");
+    record.event = event;
+    record.details = details;
+    record.severity = static_cast<int>(severity);
+
+    if (!m_writerRunning.load(std::memory_order_acquire)) {
+        writeOnOwner(record);
+        return;
+    }
+
+    // tryPush забирает запись только при успехе
+    if (m_ring.tryPush(std::move(record))) {
+        if (m_ring.sizeApprox() >= static_cast<std::size_t>(kBatchSize)) m_wake.notify_one();
+        return;
+    }
+
+    // Буфер полон: рядовые события отбрасываем и считаем
+    if (severity == AuditSeverity::Info || severity == AuditSeverity::Warning) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        m_droppedTotal.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
 
-    const QString actor = m_actorProvider ? m_actorProvider() : QStringLiteral("user");
-    const QString ts = QDateTime::currentDateTime().toString(Qt::ISODateWithMs);
+    // Error/Security: будим писателя и ждём, пока он освободит место.
+    // Соединение окна отсюда не трогаем — log() зовут из любых потоков
+    while (m_writerRunning.load(std::memory_order_acquire)) {
+        m_wake.notify_one();
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_space.wait_for(lock, kSpaceWait, [this]() {
+                return m_ring.sizeApprox() < m_ring.capacity()
+                    || !m_writerRunning.load(std::memory_order_acquire);
+            });
+        }
+        if (m_ring.tryPush(std::move(record))) return;
+    }
+    // Писатель остановлен, пока ждали: его хвост дописывает stopWriter
+    writeOnOwner(record);
+}
 
-    QSqlQuery q(db);
-    q.prepare("INSERT INTO audit_log(ts, actor, event, details, severity) VALUES(?,?,?,?,?);");
-    q.addBindValue(ts);
-    q.addBindValue(actor);
-    q.addBindValue(event);
-    q.addBindValue(details);
-    q.addBindValue(static_cast<int>(severity));
-    q.exec(); // если упадёт — просто пропустим, логирование вспомогательное
+void AuditLogger::writeSync(const AuditRecord& record) {
+    if (!m_store) return;
+    m_store->insert({record}); // если упадёт — просто пропустим, логирование вспомогательное
 }
 
-QList<QVariantMap> AuditLogger::fetch(int limit, const QDateTime& from, const QDateTime& to,
-                                      const QString& textFilter, int severityFilter) {
-    QList<QVariantMap> res;
-    QSqlDatabase db = m_connectionName.isEmpty()
-            ? QSqlDatabase::database()
-            : QSqlDatabase::database(m_connectionName);
-    if (!db.isValid()) return res;
-    if (!db.isOpen())  db.open();
-
-    QString sql = "SELECT id, ts, actor, event, details, severity FROM audit_log WHERE 1=1";
-    QList<QVariant> binds;
-
-    if (from.isValid()) { sql += " AND ts >= ?"; binds << from.toString(Qt::ISODateWithMs); }
-    if (to.isValid())   { sql += " AND ts <= ?"; binds << to.toString(Qt::ISODateWithMs); }
-    if (!textFilter.trimmed().isEmpty()) {
-        sql += " AND (LOWER(actor) LIKE ? OR LOWER(event) LIKE ? OR LOWER(details) LIKE ?)";
-        const QString f = "%" + textFilter.trimmed().toLower() + "%";
-        binds << f << f << f;
+void AuditLogger::writeOnOwner(const AuditRecord& record) {
+    // Соединение m_store принадлежит потоку логгера
+    if (QThread::currentThread() == thread()) {
+        writeSync(record);
+        return;
+    }
+    QMetaObject::invokeMethod(this, [this, record]() { writeSync(record); }, Qt::QueuedConnection);
+}
+
+void AuditLogger::flush() {
+    if (!m_writerRunning.load(std::memory_order_acquire)) return;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const quint64 target = ++m_flushRequested;
+    m_wake.notify_one();
+    m_flushed.wait(lock, [this, target]() { return m_flushDone >= target; });
+}
+
+void AuditLogger::shutdown() {
+    stopWriter();
+    if (m_store) m_store->checkpoint(); // хвост цепочки тоже под подписью
+    m_store.reset(); // соединения закрываем, пока жив QCoreApplication
+}
+
+void AuditLogger::startWriter() {
+    if (m_writerRunning.load() || m_databasePath.isEmpty()) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = false;
+        m_flushRequested = m_flushDone = 0;
     }
-    if (severityFilter >= 0) {
-        sql += " AND severity = ?";
-        binds << severityFilter;
+    m_writerRunning.store(true, std::memory_order_release);
+    m_writer = std::thread(&AuditLogger::writerLoop, this);
+}
+
+void AuditLogger::stopWriter() {
+    if (!m_writerRunning.load()) return;
+    m_writerRunning.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
     }
-    sql += " ORDER BY ts DESC";
-    if (limit > 0) sql += QString(" LIMIT %1").arg(limit);
-
-    QSqlQuery q(db);
-    q.prepare(sql);
-    for (const auto& v : binds) q.addBindValue(v);
-    q.exec();
-    while (q.next()) {
+    m_wake.notify_one();
+    m_space.notify_all();
+    if (m_writer.joinable()) m_writer.join();
+
+    // Всё, что успели положить между остановкой и выходом писателя
+    AuditRecord record;
+    while (m_ring.tryPop(record)) writeSync(record);
+}
+
+void AuditLogger::writerLoop() {
+    AuditStore store(kWriterConnection);
+    store.setSigningKey(m_signingKey);
+    store.open(m_databasePath);
+
+    QList<AuditRecord> batch;
+    batch.reserve(kBatchSize + 1);
+    for (;;) {
+        bool stop = false;
+        quint64 flushTarget = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait_for(lock, kIdleWait, [this]() {
+                return m_stop || m_flushRequested != m_flushDone
+                    || m_ring.sizeApprox() >= static_cast<std::size_t>(kBatchSize);
+            });
+            stop = m_stop;
+            flushTarget = m_flushRequested;
+        }
+
+        // Выбираем очередь до дна пачками по kBatchSize
+        for (;;) {
+            batch.clear();
+            AuditRecord record;
+            while (batch.size() < kBatchSize && m_ring.tryPop(record)) batch.append(std::move(record));
+            const bool more = batch.size() == kBatchSize;
+            if (!batch.isEmpty()) m_space.notify_all();
+
+            const quint64 dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+            if (dropped > 0) {
+                AuditRecord note;
+                note.msecs = QDateTime::currentMSecsSinceEpoch();
+                note.actor = QStringLiteral("system");
+                note.event = QStringLiteral("Audit events dropped");
+                note.details = QString("count=%1").arg(dropped);
+                note.severity = static_cast<int>(AuditSeverity::Warning);
+                batch.append(note);
+            }
+            if (batch.isEmpty()) break;
+            // Одна транзакция — одна синхронизация журнала на всю пачку
+            if (!store.insert(batch)) {
+                qDebug() << "Аудит: не удалось записать пачку событий:" << store.lastError();
+            }
+            if (!more) break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_flushDone = flushTarget;
+        }
+        m_flushed.notify_all();
+        if (stop) break;
+    }
+}
+
+QList<QVariantMap> AuditLogger::fetchPage(const AuditQuery& query, int limit, AuditCursor* cursor) {
+    QList<QVariantMap> res;
+    flush(); // читатель должен видеть всё, что уже залогировано
+    if (!m_store) return res;
+
+    const AuditCursor start = cursor ? *cursor : AuditCursor();
+    m_store->forEach(query, start, limit, [&res, cursor](const QSqlQuery& q) {
         QVariantMap m;
         m["id"] = q.value(0);
-        m["ts"] = q.value(1);
-        m["actor"] = q.value(2);
-        m["event"] = q.value(3);
-        m["details"] = q.value(4);
-        m["severity"] = q.value(5);
+        m["ts"] = q.value(2);
+        m["actor"] = q.value(3);
+        m["event"] = q.value(4);
+        m["details"] = q.value(5);
+        m["severity"] = q.value(6);
         res << m;
-    }
+        if (cursor) {
+            cursor->tsMs = q.value(1).toLongLong();
+            cursor->id = q.value(0).toLongLong();
+        }
+        return true;
+    });
     return res;
 }
 
+QStringList AuditLogger::knownEvents() {
+    flush();
+    return m_store ? m_store->distinctValues("event") : QStringList();
+}
+
+QStringList AuditLogger::knownActors() {
+    flush();
+    return m_store ? m_store->distinctValues("actor") : QStringList();
+}
+
+AuditVerifyResult AuditLogger::verifyIntegrity(bool full) {
+    flush(); // проверяем всё, что уже залогировано
+    AuditVerifyResult result;
+    result.message = "Журнал не открыт";
+
+    // Журнал в памяти виден только соединению окна
+    if (m_databasePath.isEmpty()) {
+        if (!m_store || QThread::currentThread() != thread()) return result;
+        return m_store->verify(full);
+    }
+
+    // Файл журнала — на своём соединении: проверку можно вести из рабочего потока
+    static std::atomic<quint64> counter{0};
+    AuditStore store(QString("audit_check_%1").arg(++counter));
+    store.setSigningKey(m_signingKey);
+    if (!store.open(m_databasePath)) return result;
+    return store.verify(full);
+}
+
 bool AuditLogger::clearOlderThan(const QDateTime& before) {
     if (!before.isValid()) return false;
-    QSqlDatabase db = m_connectionName.isEmpty()
-            ? QSqlDatabase::database()
-            : QSqlDatabase::database(m_connectionName);
-    if (!db.isValid()) return false;
-    if (!db.isOpen())  db.open();
-
-    QSqlQuery q(db);
-    q.prepare("DELETE FROM audit_log WHERE ts < ?;");
-    q.addBindValue(before.toString(Qt::ISODateWithMs));
-    return q.exec();
+    flush(); // очистка не должна разминуться со стоящими в очереди событиями
+    return m_store && m_store->dropOlderThan(before);
 }
 
-bool AuditLogger::exportCsv(const QString& path, const QList<QVariantMap>& rows) {
-    QFile f(path);
-    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) return false;
+bool AuditLogger::exportCsv(const QString& path, const AuditQuery& query, int* rowsWritten) {
+    flush();
+    if (!m_store) return false;
+
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
     QTextStream out(&f);
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
     out.setEncoding(QStringConverter::Utf8);
@@ -125,15 +317,19 @@ bool AuditLogger::exportCsv(const QString& path, const QList<QVariantMap>& rows)
     out.setCodec("UTF-8");
 #endif
     out << "id;ts;actor;event;details;severity\n";
-    for (const auto& m : rows) {
-        auto esc = [](const QString& s){ QString x=s; x.replace("\"","\"\""); return "\"" + x + "\""; };
-        out << m.value("id").toString() << ";"
-            << esc(m.value("ts").toString()) << ";"
-            << esc(m.value("actor").toString()) << ";"
-            << esc(m.value("event").toString()) << ";"
-            << esc(m.value("details").toString()) << ";"
-            << m.value("severity").toString() << "\n";
-    }
-    f.close();
-    return true;
+    auto esc = [](const QString& s){ QString x=s; x.replace("\"","\"\""); return "\"" + x + "\""; };
+    int written = 0;
+    const bool ok = m_store->forEach(query, AuditCursor(), 0, [&](const QSqlQuery& q) {
+        out << q.value(0).toString() << ";"
+            << esc(q.value(2).toString()) << ";"
+            << esc(q.value(3).toString()) << ";"
+            << esc(q.value(4).toString()) << ";"
+            << esc(q.value(5).toString()) << ";"
+            << q.value(6).toString() << "\n";
+        ++written;
+        return out.status() == QTextStream::Ok;
+    });
+    out.flush();
+    if (rowsWritten) *rowsWritten = written;
+    return ok && out.status() == QTextStream::Ok && f.commit();
 }
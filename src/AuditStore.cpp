@@ -0,0 +1,824 @@
+#include "AuditStore.h"
+#include <QRegularExpression>
+#include <QSqlError>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+const char* const kPartitionGlob = "audit_[0-9][0-9][0-9][0-9][0-9][0-9]";
+
+// Начальный id нового месяца: максимум по существующим месяцам и по отметке,
+// сохранённой перед удалением старых месяцев
+const char* const kLastIdSql =
+    "SELECT MAX(COALESCE((SELECT MAX(seq) FROM sqlite_sequence WHERE name GLOB 'audit_[0-9]*'), 0),"
+    "           COALESCE((SELECT value FROM audit_meta WHERE key = 'last_id'), 0))";
+
+// Версия схемы месяцев: 2 — ts_ms, индексы по событию/пользователю, FTS5;
+// 3 — цепочка хешей и контрольные точки
+constexpr int kSchemaVersion = 3;
+
+// Подписанная точка каждые столько строк: столько максимум придётся
+// перепроверить после последней точки
+constexpr qint64 kCheckpointEvery = 1000;
+constexpr int kSealChunk = 5000;
+
+// Виды контрольных точек
+enum CheckpointKind {
+    CheckpointPeriodic  = 0,
+    CheckpointRetention = 1,   // последняя строка перед удалением по сроку хранения
+    CheckpointVerified  = 2    // конец успешно проверенного участка
+};
+
+// ts хранится в местном времени без смещения; julianday(..., 'utc') переводит в UTC
+const char* const kTsMsFromTs =
+    "CAST(ROUND((julianday(ts, 'utc') - 2440587.5) * 86400000) AS INTEGER)";
+
+// Строка поиска -> запрос FTS5: каждое слово — фраза с поиском по началу,
+// слова объединяются через AND. Кавычки экранируются, поэтому синтаксис
+// FTS из пользовательского ввода не исполняется
+QString ftsMatch(const QString& text)
+{
+    QStringList terms;
+    const QStringList words = text.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
+    for (QString word : words) {
+        word.replace('"', "\"\"");
+        terms.append(QLatin1Char('"') + word + QLatin1String("\"*"));
+    }
+    return terms.join(' ');
+}
+
+} // namespace
+
+AuditStore::AuditStore(const QString& connectionName)
+    : m_connectionName(connectionName)
+{
+}
+
+AuditStore::~AuditStore()
+{
+    close();
+}
+
+QSqlDatabase AuditStore::database() const
+{
+    return QSqlDatabase::database(m_connectionName, false);
+}
+
+bool AuditStore::open(const QString& path)
+{
+    close();
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
+        db.setDatabaseName(path);
+        if (!db.open()) {
+            qDebug() << "Аудит: не удалось открыть" << path << db.lastError().text();
+            return false;
+        }
+
+        // auto_vacuum действует только до создания первой таблицы — для нового
+        // файла этого достаточно, чтобы DROP месяца возвращал место диску
+        QSqlQuery q(db);
+        q.exec("PRAGMA auto_vacuum = INCREMENTAL;");
+        q.exec("PRAGMA journal_mode = WAL;");
+        q.exec("PRAGMA synchronous = NORMAL;");
+        q.exec("CREATE TABLE IF NOT EXISTS audit_meta (key TEXT PRIMARY KEY, value INTEGER);");
+        q.exec(R"SQL(
+            CREATE TABLE IF NOT EXISTS audit_checkpoint (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                last_id INTEGER NOT NULL,
+                hash BLOB NOT NULL,
+                created_ms INTEGER NOT NULL,
+                kind INTEGER NOT NULL DEFAULT 0,
+                signature BLOB NOT NULL
+            );
+        )SQL");
+        q.exec("CREATE INDEX IF NOT EXISTS idx_audit_checkpoint_last ON audit_checkpoint(last_id);");
+
+        // Без FTS5 поиск по тексту откатывается на LIKE
+        m_fts = q.exec("CREATE VIRTUAL TABLE temp.audit_fts_probe USING fts5(x);");
+        if (m_fts) q.exec("DROP TABLE temp.audit_fts_probe;");
+    }
+    m_path = path;
+    m_known.clear();
+    return upgradeSchema();
+}
+
+// Месяцы старых версий доводятся до текущей схемы один раз; существующие
+// строки при этом сцепляются хешами в порядке id
+bool AuditStore::upgradeSchema()
+{
+    QSqlQuery q(database());
+    auto version = [&q]() {
+        return q.exec("SELECT value FROM audit_meta WHERE key = 'schema';") && q.next() ? q.value(0).toInt() : 0;
+    };
+    if (version() >= kSchemaVersion) return true;
+    if (!q.exec("BEGIN IMMEDIATE;")) return false;
+    if (version() >= kSchemaVersion) { // успело другое соединение
+        q.exec("COMMIT;");
+        return true;
+    }
+
+    bool ok = true;
+    const QStringList names = partitions();
+    for (const QString& name : names) {
+        QSet<QString> columns;
+        if (q.exec(QString("PRAGMA table_info(%1);").arg(name))) {
+            while (q.next()) columns.insert(q.value(1).toString());
+        }
+        const bool hasTsMs = columns.contains("ts_ms");
+        ok = (hasTsMs || (q.exec(QString("ALTER TABLE %1 ADD COLUMN ts_ms INTEGER NOT NULL DEFAULT 0;").arg(name))
+                          && q.exec(QString("UPDATE %1 SET ts_ms = %2;").arg(name, kTsMsFromTs))))
+            && (columns.contains("hash") || q.exec(QString("ALTER TABLE %1 ADD COLUMN hash BLOB;").arg(name)))
+            && q.exec(QString("DROP INDEX IF EXISTS idx_%1_ts;").arg(name))
+            && q.exec(QString("DROP INDEX IF EXISTS idx_%1_sev;").arg(name))
+            && createPartitionObjects(q, name)
+            && (hasTsMs || !m_fts || q.exec(QString("INSERT INTO %1_fts(%1_fts) VALUES('rebuild');").arg(name)));
+        if (!ok) break;
+    }
+    ok = ok && sealPending(q) && q.exec(QString("INSERT OR REPLACE INTO audit_meta(key, value) VALUES('schema', %1);").arg(kSchemaVersion))
+            && q.exec("COMMIT;");
+    if (!ok) {
+        qDebug() << "Аудит: не удалось обновить схему журнала:" << q.lastError().text();
+        q.exec("ROLLBACK;");
+    }
+    return ok;
+}
+
+void AuditStore::close()
+{
+    if (!QSqlDatabase::contains(m_connectionName)) return;
+    {
+        QSqlDatabase db = database();
+        if (db.isOpen()) db.close();
+    }
+    QSqlDatabase::removeDatabase(m_connectionName);
+    m_known.clear();
+}
+
+bool AuditStore::isOpen() const
+{
+    return QSqlDatabase::contains(m_connectionName) && database().isOpen();
+}
+
+QString AuditStore::lastError() const
+{
+    return database().lastError().text();
+}
+
+QString AuditStore::partitionName(const QDateTime& ts)
+{
+    return "audit_" + ts.toString("yyyyMM");
+}
+
+bool AuditStore::ensurePartition(const QString& name)
+{
+    if (m_known.contains(name)) return true;
+
+    QSqlDatabase db = database();
+    QSqlQuery q(db);
+    const bool ok = q.exec(QString(R"SQL(
+        CREATE TABLE IF NOT EXISTS %1 (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            ts TEXT NOT NULL,
+            actor TEXT,
+            event TEXT NOT NULL,
+            details TEXT,
+            severity INTEGER NOT NULL DEFAULT 0,
+            ts_ms INTEGER NOT NULL DEFAULT 0,
+            hash BLOB
+        );
+    )SQL").arg(name))
+        && createPartitionObjects(q, name);
+    if (!ok) {
+        qDebug() << "Аудит: не удалось создать" << name << q.lastError().text();
+        return false;
+    }
+
+    // Новый месяц продолжает нумерацию предыдущих
+    q.prepare(QString("INSERT INTO sqlite_sequence(name, seq) SELECT ?, (%1) "
+                      "WHERE NOT EXISTS (SELECT 1 FROM sqlite_sequence WHERE name = ?);").arg(kLastIdSql));
+    q.addBindValue(name);
+    q.addBindValue(name);
+    if (!q.exec()) {
+        qDebug() << "Аудит: не удалось продолжить нумерацию" << name << q.lastError().text();
+        return false;
+    }
+    m_known.insert(name);
+    return true;
+}
+
+// Индексы и FTS месяца; всё идемпотентно. Индекс по ts_ms неявно
+// продолжается rowid (= id), поэтому покрывает и порядок (ts_ms, id)
+bool AuditStore::createPartitionObjects(QSqlQuery& q, const QString& name)
+{
+    bool ok = q.exec(QString("CREATE INDEX IF NOT EXISTS idx_%1_time ON %1(ts_ms);").arg(name))
+        && q.exec(QString("CREATE INDEX IF NOT EXISTS idx_%1_event ON %1(event, ts_ms);").arg(name))
+        && q.exec(QString("CREATE INDEX IF NOT EXISTS idx_%1_actor ON %1(actor, ts_ms);").arg(name))
+        && q.exec(QString("CREATE INDEX IF NOT EXISTS idx_%1_sev_time ON %1(severity, ts_ms);").arg(name));
+    if (!ok || !m_fts) return ok;
+
+    // Внешнее содержимое: текст хранится один раз в самом месяце, FTS держит
+    // только индекс и синхронизируется триггерами
+    return q.exec(QString("CREATE VIRTUAL TABLE IF NOT EXISTS %1_fts USING fts5("
+                          "actor, event, details, content='%1', content_rowid='id');").arg(name))
+        && q.exec(QString("CREATE TRIGGER IF NOT EXISTS %1_fts_ai AFTER INSERT ON %1 BEGIN "
+                          "INSERT INTO %1_fts(rowid, actor, event, details) "
+                          "VALUES (new.id, new.actor, new.event, new.details); END;").arg(name))
+        && q.exec(QString("CREATE TRIGGER IF NOT EXISTS %1_fts_ad AFTER DELETE ON %1 BEGIN "
+                          "INSERT INTO %1_fts(%1_fts, rowid, actor, event, details) "
+                          "VALUES ('delete', old.id, old.actor, old.event, old.details); END;").arg(name));
+}
+
+bool AuditStore::insert(const QList<AuditRecord>& records)
+{
+    if (records.isEmpty()) return true;
+    QSqlDatabase db = database();
+    if (!db.isOpen()) return false;
+
+    // IMMEDIATE: сразу берём блокировку записи, чтобы не споткнуться о
+    // второе соединение посреди транзакции
+    QSqlQuery control(db);
+    if (!control.exec("BEGIN IMMEDIATE;")) return false;
+
+    // Голову цепочки читаем внутри транзакции: второе соединение могло
+    // дописать строки с прошлого раза. id выдаём сами — следующий за головой
+    qint64 headId = 0;
+    QByteArray headHash;
+    bool ok = readHead(control, &headId, &headHash);
+
+    // События в пачке идут по времени, так что запрос переподготавливается разве что на стыке месяцев
+    QSqlQuery q(db);
+    QString current;
+    for (const AuditRecord& r : records) {
+        if (!ok) break;
+        const QDateTime ts = QDateTime::fromMSecsSinceEpoch(r.msecs);
+        const QString name = partitionName(ts);
+        if (name != current) {
+            if (!ensurePartition(name)) { ok = false; break; }
+            q.prepare(QString("INSERT INTO %1(id, ts, ts_ms, actor, event, details, severity, hash) "
+                              "VALUES(?,?,?,?,?,?,?,?);").arg(name));
+            current = name;
+        }
+        const qint64 id = headId + 1;
+        const QString tsText = ts.toString(Qt::ISODateWithMs);
+        const QByteArray hash = AuditChain::rowHash(headHash, id, r.msecs, tsText,
+                                                    r.actor, r.event, r.details, r.severity);
+        q.addBindValue(id);
+        q.addBindValue(tsText);
+        q.addBindValue(r.msecs);
+        q.addBindValue(r.actor);
+        q.addBindValue(r.event);
+        q.addBindValue(r.details);
+        q.addBindValue(r.severity);
+        q.addBindValue(hash);
+        // Неудачная строка не ломает остальные: голова сдвигается только после записи
+        if (q.exec()) {
+            headId = id;
+            headHash = hash;
+        }
+    }
+
+    if (ok) ok = writeHead(control, headId, headHash);
+    if (ok && !m_key.isEmpty()) {
+        if (control.exec("SELECT COALESCE(MAX(last_id), 0) FROM audit_checkpoint;") && control.next()
+            && headId - control.value(0).toLongLong() >= kCheckpointEvery) {
+            ok = addCheckpoint(control, headId, headHash, CheckpointPeriodic);
+        }
+    }
+
+    if (ok && control.exec("COMMIT;")) return true;
+    control.exec("ROLLBACK;");
+    m_known.clear(); // созданные в откаченной транзакции месяцы пропали
+    return false;
+}
+
+bool AuditStore::readHead(QSqlQuery& q, qint64* id, QByteArray* hash)
+{
+    *id = 0;
+    *hash = AuditChain::genesis();
+    if (!q.exec("SELECT key, value FROM audit_meta WHERE key IN ('head_id', 'head_hash');")) return false;
+    bool found = false;
+    while (q.next()) {
+        if (q.value(0).toString() == "head_id") {
+            *id = q.value(1).toLongLong();
+            found = true;
+        } else {
+            *hash = q.value(1).toByteArray();
+        }
+    }
+    // Цепочки ещё нет — нумерация продолжает уже выданные id
+    if (!found && q.exec(QString("%1;").arg(kLastIdSql)) && q.next()) *id = q.value(0).toLongLong();
+    return true;
+}
+
+bool AuditStore::writeHead(QSqlQuery& q, qint64 id, const QByteArray& hash)
+{
+    q.prepare("INSERT OR REPLACE INTO audit_meta(key, value) VALUES('head_id', ?), ('head_hash', ?);");
+    q.addBindValue(id);
+    q.addBindValue(hash);
+    return q.exec();
+}
+
+// Досцепить строки без hash (записанные до цепочки или перенесённые из
+// старой таблицы) за текущей головой. Вызывается внутри транзакции
+bool AuditStore::sealPending(QSqlQuery& q)
+{
+    qint64 headId = 0;
+    QByteArray headHash;
+    if (!q.exec("SELECT 1 FROM audit_meta WHERE key = 'head_id';")) return false;
+    if (q.next()) {
+        if (!readHead(q, &headId, &headHash)) return false;
+    } else {
+        headHash = AuditChain::genesis(); // все строки без hash сцепляются с начала
+    }
+
+    struct Row { qint64 id; QByteArray hash; };
+    const QStringList names = partitions();
+    bool sealed = false;
+    for (const QString& name : names) {
+        for (;;) {
+            q.prepare(QString("SELECT id, ts_ms, ts, actor, event, details, severity FROM %1 "
+                              "WHERE hash IS NULL AND id > ? ORDER BY id LIMIT %2;").arg(name).arg(kSealChunk));
+            q.addBindValue(headId);
+            if (!q.exec()) return false;
+            std::vector<Row> rows;
+            while (q.next()) {
+                const qint64 id = q.value(0).toLongLong();
+                headHash = AuditChain::rowHash(headHash, id, q.value(1).toLongLong(), q.value(2).toString(),
+                                               q.value(3).toString(), q.value(4).toString(),
+                                               q.value(5).toString(), q.value(6).toInt());
+                headId = id;
+                rows.push_back({id, headHash});
+            }
+            if (rows.empty()) break;
+            q.prepare(QString("UPDATE %1 SET hash = ? WHERE id = ?;").arg(name));
+            for (const Row& row : rows) {
+                q.addBindValue(row.hash);
+                q.addBindValue(row.id);
+                if (!q.exec()) return false;
+            }
+            sealed = true;
+        }
+    }
+    return !sealed || writeHead(q, headId, headHash);
+}
+
+bool AuditStore::addCheckpoint(QSqlQuery& q, qint64 lastId, const QByteArray& hash, int kind)
+{
+    if (m_key.isEmpty()) return true;
+    const qint64 createdMs = QDateTime::currentMSecsSinceEpoch();
+    q.prepare("INSERT INTO audit_checkpoint(last_id, hash, created_ms, kind, signature) VALUES(?,?,?,?,?);");
+    q.addBindValue(lastId);
+    q.addBindValue(hash);
+    q.addBindValue(createdMs);
+    q.addBindValue(kind);
+    q.addBindValue(AuditChain::checkpointSignature(m_key, lastId, hash, createdMs, kind));
+    return q.exec();
+}
+
+bool AuditStore::checkpoint()
+{
+    QSqlDatabase db = database();
+    if (!db.isOpen() || m_key.isEmpty()) return false;
+    QSqlQuery q(db);
+    if (!q.exec("BEGIN IMMEDIATE;")) return false;
+    qint64 headId = 0;
+    QByteArray headHash;
+    bool ok = readHead(q, &headId, &headHash)
+        && q.exec("SELECT COALESCE(MAX(last_id), 0) FROM audit_checkpoint;") && q.next();
+    if (ok && headId > q.value(0).toLongLong()) ok = addCheckpoint(q, headId, headHash, CheckpointPeriodic);
+    if (ok && q.exec("COMMIT;")) return true;
+    q.exec("ROLLBACK;");
+    return false;
+}
+
+bool AuditStore::resignCheckpoints(const QByteArray& oldKey)
+{
+    QSqlDatabase db = database();
+    if (!db.isOpen() || m_key.isEmpty() || oldKey.isEmpty()) return false;
+    if (oldKey == m_key) return true;
+    QSqlQuery q(db);
+    if (!q.exec("BEGIN IMMEDIATE;")) return false;
+
+    QSqlQuery update(db);
+    update.prepare("UPDATE audit_checkpoint SET signature = ? WHERE id = ?;");
+    int resigned = 0;
+    bool ok = q.exec("SELECT id, last_id, hash, created_ms, kind, signature FROM audit_checkpoint;");
+    while (ok && q.next()) {
+        const qint64 lastId = q.value(1).toLongLong();
+        const QByteArray hash = q.value(2).toByteArray();
+        const qint64 createdMs = q.value(3).toLongLong();
+        const int kind = q.value(4).toInt();
+        if (AuditChain::checkpointSignature(oldKey, lastId, hash, createdMs, kind) != q.value(5).toByteArray()) {
+            continue;
+        }
+        update.addBindValue(AuditChain::checkpointSignature(m_key, lastId, hash, createdMs, kind));
+        update.addBindValue(q.value(0));
+        ok = update.exec();
+        ++resigned;
+    }
+    q.finish();
+    if (ok && q.exec("COMMIT;")) {
+        qDebug() << "Аудит: контрольные точки переподписаны:" << resigned;
+        return true;
+    }
+    q.exec("ROLLBACK;");
+    return false;
+}
+
+// Звено перед строкой id: хранимый hash ближайшей предыдущей строки или
+// контрольная точка, если предыдущие строки удалены по сроку хранения
+QByteArray AuditStore::hashBefore(const QStringList& names, int index, qint64 id)
+{
+    QSqlQuery q(database());
+    qint64 bestId = 0;
+    QByteArray best = AuditChain::genesis();
+    for (int i = index; i >= 0; --i) {
+        q.prepare(QString("SELECT id, hash FROM %1 WHERE id < ? ORDER BY id DESC LIMIT 1;").arg(names.at(i)));
+        q.addBindValue(id);
+        if (q.exec() && q.next()) {
+            bestId = q.value(0).toLongLong();
+            best = q.value(1).toByteArray();
+            break;
+        }
+    }
+    q.prepare("SELECT last_id, hash FROM audit_checkpoint WHERE last_id < ? ORDER BY last_id DESC LIMIT 1;");
+    q.addBindValue(id);
+    if (q.exec() && q.next() && q.value(0).toLongLong() > bestId) best = q.value(1).toByteArray();
+    return best;
+}
+
+AuditVerifyResult AuditStore::verify(bool full)
+{
+    AuditVerifyResult result;
+    QElapsedTimer timer;
+    timer.start();
+    QSqlDatabase db = database();
+    if (!db.isOpen()) {
+        result.message = "Журнал не открыт";
+        return result;
+    }
+    if (m_key.isEmpty()) {
+        result.message = "Нет ключа подписи контрольных точек";
+        return result;
+    }
+
+    // 1. Откуда начинать: последняя подписанная точка «проверено». Подделать
+    // её без ключа нельзя, поэтому строки до неё повторно не читаем
+    QSqlQuery q(db);
+    qint64 startId = 0;
+    if (!full) {
+        q.prepare("SELECT last_id, hash, created_ms, signature FROM audit_checkpoint "
+                  "WHERE kind = ? ORDER BY last_id DESC LIMIT 1;");
+        q.addBindValue(CheckpointVerified);
+        if (q.exec() && q.next()) {
+            const qint64 lastId = q.value(0).toLongLong();
+            const QByteArray expected = AuditChain::checkpointSignature(
+                m_key, lastId, q.value(1).toByteArray(), q.value(2).toLongLong(), CheckpointVerified);
+            if (expected == q.value(3).toByteArray()) {
+                startId = lastId;
+                result.incremental = true;
+            }
+        }
+    }
+
+    // 2. По заданию на месяц: строки с id > startId, звено перед первой из них
+    struct Job {
+        QString partition;
+        QByteArray prev;
+        AuditChain::RangeResult result;
+        qint64 lastId = 0;
+        QByteArray lastHash;
+    };
+    const QStringList names = partitions();
+    std::vector<Job> jobs;
+    for (int i = 0; i < names.size(); ++i) {
+        q.prepare(QString("SELECT MIN(id) FROM %1 WHERE id > ?;").arg(names.at(i)));
+        q.addBindValue(startId);
+        if (!q.exec() || !q.next() || q.value(0).isNull()) continue;
+        Job job;
+        job.partition = names.at(i);
+        job.prev = hashBefore(names, i, q.value(0).toLongLong());
+        jobs.push_back(job);
+    }
+
+    // 3. Месяцы независимы: звено на стыке берётся из хранимого hash, а сам
+    // этот hash проверяет задание предыдущего месяца
+    {
+        QThreadPool pool;
+        pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+        const QString path = m_path;
+        for (Job& job : jobs) {
+            pool.start([&job, path, startId]() {
+                job.result = AuditChain::verifyRange(path, job.partition, startId, job.prev);
+            });
+        }
+        pool.waitForDone();
+    }
+
+    result.ok = true;
+    result.partitions = static_cast<int>(jobs.size());
+    qint64 verifiedId = startId;
+    QByteArray verifiedHash;
+    for (const Job& job : jobs) {
+        result.rowsChecked += job.result.rows;
+        if (!job.result.error.isEmpty()) {
+            result.ok = false;
+            result.message = job.result.error;
+        }
+        if (job.result.firstBadId > 0) {
+            result.ok = false;
+            if (result.firstBadId == 0 || job.result.firstBadId < result.firstBadId) {
+                result.firstBadId = job.result.firstBadId;
+            }
+        }
+    }
+
+    // 4. Подписи и совпадение точек с хранимыми (уже сверенными) hash строк.
+    // Строки точки может не быть только в удалённой по сроку хранения части
+    qint64 retainedFrom = 0;
+    if (q.exec(QString("SELECT COALESCE(MAX(last_id), 0) FROM audit_checkpoint WHERE kind = %1;")
+               .arg(CheckpointRetention)) && q.next()) {
+        retainedFrom = q.value(0).toLongLong();
+    }
+    QHash<qint64, QByteArray> rowHashes; // last_id -> hash строки
+    for (const QString& name : names) {
+        q.prepare(QString("SELECT c.last_id, p.hash FROM audit_checkpoint c JOIN %1 p ON p.id = c.last_id "
+                          "WHERE c.last_id >= ?;").arg(name));
+        q.addBindValue(startId);
+        if (!q.exec()) continue;
+        while (q.next()) rowHashes.insert(q.value(0).toLongLong(), q.value(1).toByteArray());
+    }
+    q.prepare("SELECT last_id, hash, created_ms, kind, signature FROM audit_checkpoint "
+              "WHERE last_id >= ? ORDER BY last_id;");
+    q.addBindValue(startId);
+    if (q.exec()) {
+        while (q.next()) {
+            ++result.checkpoints;
+            const qint64 lastId = q.value(0).toLongLong();
+            const QByteArray hash = q.value(1).toByteArray();
+            const QByteArray expected = AuditChain::checkpointSignature(
+                m_key, lastId, hash, q.value(2).toLongLong(), q.value(3).toInt());
+            const auto row = rowHashes.constFind(lastId);
+            const bool rowOk = row != rowHashes.constEnd() ? row.value() == hash : lastId <= retainedFrom;
+            if (expected != q.value(4).toByteArray() || !rowOk) {
+                result.ok = false;
+                if (result.firstBadId == 0 || lastId < result.firstBadId) result.firstBadId = lastId;
+            }
+        }
+    }
+
+    // 5. Закрепляем проверенный участок подписанной точкой
+    if (result.ok) {
+        for (const Job& job : jobs) {
+            if (job.result.lastId > verifiedId) {
+                verifiedId = job.result.lastId;
+                verifiedHash = job.result.lastHash;
+            }
+        }
+        if (verifiedId > startId && q.exec("BEGIN IMMEDIATE;")) {
+            if (addCheckpoint(q, verifiedId, verifiedHash, CheckpointVerified)) q.exec("COMMIT;");
+            else q.exec("ROLLBACK;");
+        }
+        result.message = QString("Цепочка цела: проверено строк %1").arg(result.rowsChecked);
+    } else if (result.message.isEmpty()) {
+        result.message = QString("Цепочка нарушена начиная с записи id=%1").arg(result.firstBadId);
+    }
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
+
+QStringList AuditStore::partitions(const QDateTime& from, const QDateTime& to)
+{
+    QStringList result;
+    QSqlQuery q(database());
+    q.prepare("SELECT name FROM sqlite_master WHERE type = 'table' AND name GLOB ? ORDER BY name;");
+    q.addBindValue(QString(kPartitionGlob));
+    if (!q.exec()) return result;
+
+    // Имена audit_YYYYMM сравниваются как строки в том же порядке, что и месяцы
+    const QString first = from.isValid() ? partitionName(from) : QString();
+    const QString last = to.isValid() ? partitionName(to) : QString();
+    while (q.next()) {
+        const QString name = q.value(0).toString();
+        if (!first.isEmpty() && name < first) continue;
+        if (!last.isEmpty() && name > last) continue;
+        result.append(name);
+    }
+    return result;
+}
+
+QString AuditStore::whereClause(const QString& partition, const AuditQuery& query,
+                                const AuditCursor& cursor, QVariantList& binds) const
+{
+    QStringList conditions;
+    if (query.from.isValid()) { conditions << "ts_ms >= ?"; binds << query.from.toMSecsSinceEpoch(); }
+    if (query.to.isValid())   { conditions << "ts_ms <= ?"; binds << query.to.toMSecsSinceEpoch(); }
+    if (query.severity >= 0)  { conditions << "severity = ?"; binds << query.severity; }
+    if (!query.event.isEmpty()) { conditions << "event = ?"; binds << query.event; }
+    if (!query.actor.isEmpty()) { conditions << "actor = ?"; binds << query.actor; }
+
+    const QString text = query.text.trimmed();
+    if (!text.isEmpty()) {
+        const QString match = m_fts ? ftsMatch(text) : QString();
+        if (!match.isEmpty()) {
+            conditions << QString("id IN (SELECT rowid FROM %1_fts WHERE %1_fts MATCH ?)").arg(partition);
+            binds << match;
+        } else {
+            conditions << "(LOWER(actor) LIKE ? OR LOWER(event) LIKE ? OR LOWER(details) LIKE ?)";
+            const QString f = "%" + text.toLower() + "%";
+            binds << f << f << f;
+        }
+    }
+    if (!cursor.isNull()) {
+        conditions << "(ts_ms < ? OR (ts_ms = ? AND id < ?))";
+        binds << cursor.tsMs << cursor.tsMs << cursor.id;
+    }
+    return conditions.isEmpty() ? QString() : " WHERE " + conditions.join(" AND ");
+}
+
+bool AuditStore::forEach(const AuditQuery& query, const AuditCursor& cursor, int limit, const RowHandler& row)
+{
+    QSqlDatabase db = database();
+    if (!db.isOpen()) return false;
+
+    // Месяцы новее позиции курсора уже прочитаны
+    QDateTime to = query.to;
+    if (!cursor.isNull()) {
+        const QDateTime at = QDateTime::fromMSecsSinceEpoch(cursor.tsMs);
+        if (!to.isValid() || at < to) to = at;
+    }
+    QStringList names = partitions(query.from, to);
+    std::reverse(names.begin(), names.end());
+
+    int remaining = limit;
+    for (const QString& name : names) {
+        QVariantList binds;
+        QString sql = QString("SELECT id, ts_ms, ts, actor, event, details, severity FROM %1").arg(name)
+            + whereClause(name, query, cursor, binds)
+            + " ORDER BY ts_ms DESC, id DESC";
+        if (limit > 0) sql += QString(" LIMIT %1").arg(remaining);
+
+        QSqlQuery q(db);
+        q.setForwardOnly(true);
+        q.prepare(sql);
+        for (const QVariant& v : binds) q.addBindValue(v);
+        if (!q.exec()) {
+            qDebug() << "Аудит: ошибка чтения" << name << q.lastError().text();
+            return false;
+        }
+        while (q.next()) {
+            if (!row(q)) return true;
+            if (limit > 0 && --remaining == 0) return true;
+        }
+    }
+    return true;
+}
+
+QStringList AuditStore::distinctValues(const QString& column)
+{
+    QStringList result;
+    if (column != "event" && column != "actor") return result;
+
+    // По индексу (column, ts_ms) DISTINCT в пределах месяца не требует сортировки
+    const QStringList names = partitions();
+    if (names.isEmpty()) return result;
+    QStringList parts;
+    for (const QString& name : names) parts << QString("SELECT DISTINCT %1 FROM %2").arg(column, name);
+
+    QSqlQuery q(database());
+    q.setForwardOnly(true);
+    if (q.exec(parts.join(" UNION ") + " ORDER BY 1;")) {
+        while (q.next()) {
+            const QString value = q.value(0).toString();
+            if (!value.isEmpty()) result << value;
+        }
+    }
+    return result;
+}
+
+bool AuditStore::dropOlderThan(const QDateTime& before)
+{
+    QSqlDatabase db = database();
+    if (!db.isOpen() || !before.isValid()) return false;
+
+    const QString boundary = partitionName(before);
+    const QStringList names = partitions();
+
+    QSqlQuery q(db);
+    if (!q.exec("BEGIN IMMEDIATE;")) return false;
+
+    // Запоминаем последний выданный id: после DROP его sqlite_sequence забудет
+    bool ok = q.exec(QString("INSERT OR REPLACE INTO audit_meta(key, value) VALUES('last_id', (%1));").arg(kLastIdSql));
+
+    // Последняя удаляемая строка становится подписанной точкой: с её hash
+    // сцеплена первая оставшаяся, и проверка начнётся от неё
+    qint64 lastRemovedId = 0;
+    QByteArray lastRemovedHash;
+    for (const QString& name : names) {
+        if (!ok || name > boundary) break;
+        if (name < boundary) {
+            q.prepare(QString("SELECT id, hash FROM %1 ORDER BY id DESC LIMIT 1;").arg(name));
+        } else {
+            q.prepare(QString("SELECT id, hash FROM %1 WHERE ts_ms < ? ORDER BY id DESC LIMIT 1;").arg(name));
+            q.addBindValue(before.toMSecsSinceEpoch());
+        }
+        ok = q.exec();
+        if (ok && q.next() && q.value(0).toLongLong() > lastRemovedId) {
+            lastRemovedId = q.value(0).toLongLong();
+            lastRemovedHash = q.value(1).toByteArray();
+        }
+    }
+    if (ok && lastRemovedId > 0) {
+        ok = addCheckpoint(q, lastRemovedId, lastRemovedHash, CheckpointRetention);
+        if (ok) {
+            q.prepare("DELETE FROM audit_checkpoint WHERE last_id < ?;");
+            q.addBindValue(lastRemovedId);
+            ok = q.exec();
+        }
+    }
+    for (const QString& name : names) {
+        if (!ok || name > boundary) break;
+        if (name < boundary) {
+            ok = q.exec(QString("DROP TABLE IF EXISTS %1_fts;").arg(name))
+                && q.exec(QString("DROP TABLE %1;").arg(name));
+            m_known.remove(name);
+        } else {
+            q.prepare(QString("DELETE FROM %1 WHERE ts_ms < ?;").arg(name));
+            q.addBindValue(before.toMSecsSinceEpoch());
+            ok = q.exec();
+        }
+    }
+
+    if (!ok || !q.exec("COMMIT;")) {
+        qDebug() << "Аудит: не удалось удалить старые месяцы:" << q.lastError().text();
+        q.exec("ROLLBACK;");
+        m_known.clear();
+        return false;
+    }
+    q.exec("PRAGMA incremental_vacuum;");
+    return true;
+}
+
+bool AuditStore::importLegacy(const QString& operationalPath, const QByteArray& key,
+                              const SqlCipher::Options& format)
+{
+    QSqlDatabase db = database();
+    if (!db.isOpen() || operationalPath.isEmpty()) return false;
+
+    if (!SqlCipher::attach(db, operationalPath, QStringLiteral("legacy"), key, format)) {
+        qDebug() << "Аудит: операционная БД не подключена для переноса audit_log";
+        return false;
+    }
+    QSqlQuery q(db);
+
+    bool ok = true;
+    if (q.exec("SELECT 1 FROM legacy.sqlite_master WHERE type = 'table' AND name = 'audit_log';") && q.next()) {
+        ok = q.exec("BEGIN IMMEDIATE;");
+        const QString month = "substr(ts, 1, 4) || substr(ts, 6, 2)";
+
+        qint64 total = 0;
+        if (ok && q.exec("SELECT COUNT(*) FROM legacy.audit_log;") && q.next()) total = q.value(0).toLongLong();
+
+        QStringList months;
+        if (ok && q.exec(QString("SELECT DISTINCT %1 FROM legacy.audit_log ORDER BY 1;").arg(month))) {
+            while (q.next()) months.append(q.value(0).toString());
+        }
+
+        // id переносятся как есть — ссылки на записи в выгрузках остаются верными
+        qint64 copied = 0;
+        for (const QString& m : months) {
+            const QString name = "audit_" + m;
+            bool digits = false;
+            m.toInt(&digits);
+            if (!ok || m.size() != 6 || !digits) continue; // ts не в ISO — такие строки не переносим
+            ok = ensurePartition(name);
+            if (!ok) break;
+            q.prepare(QString("INSERT INTO %1(id, ts, ts_ms, actor, event, details, severity) "
+                              "SELECT id, ts, %3, actor, event, details, severity FROM legacy.audit_log "
+                              "WHERE %2 = ?;").arg(name, month, kTsMsFromTs));
+            q.addBindValue(m);
+            ok = q.exec();
+            copied += q.numRowsAffected();
+        }
+
+        // Таблицу удаляем, только если перенесено всё
+        ok = ok && copied == total
+            && sealPending(q)
+            && q.exec("DROP TABLE legacy.audit_log;")
+            && q.exec("COMMIT;");
+        if (!ok) {
+            qDebug() << "Аудит: перенос audit_log не выполнен:" << q.lastError().text();
+            q.exec("ROLLBACK;");
+            m_known.clear();
+        }
+    }
+    q.exec("DETACH DATABASE legacy;");
+    return ok;
+}
@@ -0,0 +1,273 @@
+#include "BackupService.h"
+#include "Aead.h"
+#include "database.h"
+#include "security.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QVariant>
+#include <sqlite3.h>
+
+namespace {
+// Соединение драйвера QSQLITE; приложение связано с той же библиотекой
+// SQLite, что и драйвер (см. USE_SQLCIPHER в CMakeLists.txt)
+sqlite3* handleOf(QSqlDatabase& db)
+{
+    QVariant v = db.driver()->handle();
+    if (v.isValid() && qstrcmp(v.typeName(), "sqlite3*") == 0) {
+        return *static_cast<sqlite3**>(v.data());
+    }
+    return nullptr;
+}
+
+void removeSidecars(const QString& path)
+{
+    QFile::remove(path + "-journal");
+    QFile::remove(path + "-wal");
+    QFile::remove(path + "-shm");
+}
+} // namespace
+
+BackupService::BackupService(QObject* parent)
+    : QObject(parent)
+{
+}
+
+BackupService::~BackupService()
+{
+    cancel();
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+bool BackupService::start(const QString& path, bool encrypt)
+{
+    if (isActive()) return false;
+    // Отменённая копия ещё может держать свои соединения и временный файл
+    waitForFinished();
+    const QByteArray dataKey = encrypt ? Security::dataKey() : QByteArray();
+    if (encrypt && dataKey.isEmpty()) return false;
+
+    const quint64 jobId = ++m_nextJobId;
+    auto cancelFlag = std::make_shared<std::atomic_bool>(false);
+    m_cancel = cancelFlag;
+    m_activeJob = jobId;
+
+    QThread* thread = QThread::create([this, jobId, path, dataKey, cancelFlag]() {
+        int lastPercent = -1;
+        auto report = [this, jobId, cancelFlag, &lastPercent](int percent) {
+            if (percent != lastPercent) {
+                lastPercent = percent;
+                QMetaObject::invokeMethod(this, [this, jobId, percent]() {
+                    if (jobId == m_activeJob) emit progress(percent);
+                }, Qt::QueuedConnection);
+            }
+            return !cancelFlag->load();
+        };
+        QString error;
+        const bool ok = backup(path, dataKey, report, &error);
+        QMetaObject::invokeMethod(this, [=]() { onJobDone(jobId, path, ok, error); },
+                                  Qt::QueuedConnection);
+    });
+
+    m_thread = thread;
+    connect(thread, &QThread::finished, this, [this, thread]() {
+        if (m_thread == thread) m_thread = nullptr;
+        thread->deleteLater();
+    });
+    emit started(path);
+    thread->start(QThread::LowPriority);
+    return true;
+}
+
+void BackupService::cancel()
+{
+    if (m_cancel) m_cancel->store(true);
+    if (m_activeJob != 0) {
+        m_activeJob = 0;
+        emit cancelled();
+    }
+}
+
+void BackupService::waitForFinished()
+{
+    if (!m_thread) return;
+    // Объект потока удалит обработчик finished (deleteLater), когда дойдёт очередь
+    m_thread->wait();
+    m_thread = nullptr;
+}
+
+void BackupService::onJobDone(quint64 jobId, const QString& path, bool ok, const QString& error)
+{
+    if (jobId != m_activeJob) return; // отменена — результат не нужен
+    m_activeJob = 0;
+    emit finished(path, ok, error);
+}
+
+bool BackupService::backup(const QString& path, const QByteArray& dataKey,
+                           const Progress& progress, QString* error)
+{
+    Database& database = Database::getInstance();
+    const QString dbPath = database.getDatabasePath();
+    QString message;
+    if (path.isEmpty() || QFileInfo(path).absoluteFilePath() == QFileInfo(dbPath).absoluteFilePath()) {
+        message = "Недопустимый путь резервной копии";
+        if (error) *error = message;
+        return false;
+    }
+
+    const bool encrypt = !dataKey.isEmpty();
+    // Открытый снимок для зашифрованной копии живёт только в закрытом
+    // временном каталоге рядом с БД, а не рядом с файлом назначения.
+    // Открытая копия (.db) пишется рядом с назначением и переименовывается
+    std::unique_ptr<QTemporaryDir> tempDir;
+    if (encrypt) {
+        tempDir = database.privateTempDir();
+        if (!tempDir) {
+            if (error) *error = "Не удалось создать временный каталог";
+            return false;
+        }
+    }
+    const QString partPath = encrypt ? tempDir->filePath("snapshot.db") : path + ".part";
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile::remove(partPath);
+    removeSidecars(partPath);
+
+    // У зашифрованной копии страницы — первая половина шкалы, шифрование — вторая
+    const int span = encrypt ? 50 : 100;
+    auto pageProgress = [&progress, span](int percent) {
+        return !progress || progress(percent * span / 100);
+    };
+
+    static std::atomic<quint64> counter{0};
+    const quint64 id = ++counter;
+    const QString sourceName = QString("backup_source_%1").arg(id);
+    const QString targetName = QString("backup_target_%1").arg(id);
+    bool ok = false;
+    int restarts = 0;
+    {
+        QSqlDatabase source = QSqlDatabase::addDatabase("QSQLITE", sourceName);
+        source.setDatabaseName(dbPath);
+        source.setConnectOptions("QSQLITE_OPEN_READONLY");
+        QSqlDatabase target = QSqlDatabase::addDatabase("QSQLITE", targetName);
+        target.setDatabaseName(partPath);
+        // Файл под SQLCipher копируется постранично с тем же ключом: Backup API
+        // не перешифровывает страницы
+        if (!source.open() || !database.keyConnection(source)) {
+            message = "Не удалось открыть базу: " + source.lastError().text();
+        } else if (!target.open() || !database.keyConnection(target)) {
+            message = "Не удалось создать файл копии: " + target.lastError().text();
+        } else {
+            ok = copyPages(source, target, pageProgress, &restarts, &message);
+        }
+        target.close();
+        source.close();
+    }
+    QSqlDatabase::removeDatabase(targetName);
+    QSqlDatabase::removeDatabase(sourceName);
+    removeSidecars(partPath);
+
+    if (ok && encrypt) {
+        QFile in(partPath);
+        QSaveFile out(path);
+        const qint64 size = in.size();
+        ok = in.open(QIODevice::ReadOnly) && out.open(QIODevice::WriteOnly) &&
+             Aead::encryptStream(dataKey, in, out, [&progress, size](qint64 done) {
+                 return !progress || progress(50 + (size > 0 ? int(done * 50 / size) : 50));
+             }) &&
+             out.commit();
+        if (!ok) message = "Ошибка шифрования резервной копии";
+    } else if (ok) {
+        QFile::remove(path);
+        ok = QFile::rename(partPath, path);
+        if (!ok) message = "Не удалось записать файл копии";
+    }
+    QFile::remove(partPath);
+
+    if (restarts > 0) qDebug() << "Резервная копия начиналась заново из-за записи в БД:" << restarts;
+    if (!ok) qDebug() << "Ошибка резервного копирования:" << message;
+    if (error) *error = message;
+    return ok;
+}
+
+bool BackupService::copyPages(QSqlDatabase& source, QSqlDatabase& target, const Progress& progress,
+                              int* restarts, QString* error)
+{
+    sqlite3* src = handleOf(source);
+    sqlite3* dst = handleOf(target);
+    if (!src || !dst) {
+        *error = "Драйвер БД не поддерживает постраничное копирование";
+        return false;
+    }
+
+    // В WAL транзакция чтения на всё время копии не мешает писателям и
+    // фиксирует снимок: перезапусков не будет. В режиме журнала отката она
+    // заблокировала бы запись, поэтому там блокировка берётся на один шаг
+    QSqlQuery q(source);
+    const bool wal = q.exec("PRAGMA journal_mode") && q.next() &&
+                     q.value(0).toString().compare("wal", Qt::CaseInsensitive) == 0;
+    q.finish();
+    bool snapshot = false;
+    if (wal) {
+        snapshot = q.exec("BEGIN") && q.exec("SELECT count(*) FROM sqlite_master") && q.next();
+        q.finish();
+        if (!snapshot) q.exec("ROLLBACK");
+    }
+
+    sqlite3_backup* backup = sqlite3_backup_init(dst, "main", src, "main");
+    if (!backup) {
+        *error = QString::fromUtf8(sqlite3_errmsg(dst));
+        if (snapshot) q.exec("COMMIT");
+        return false;
+    }
+
+    int step = kPagesPerStep;
+    int lastRemaining = -1;
+    bool aborted = false;
+    int rc = SQLITE_OK;
+    for (;;) {
+        rc = sqlite3_backup_step(backup, step);
+        if (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED) break;
+
+        const int total = sqlite3_backup_pagecount(backup);
+        const int remaining = sqlite3_backup_remaining(backup);
+        if (rc == SQLITE_OK && lastRemaining >= 0 && remaining > lastRemaining) {
+            // Источник изменился из другого соединения — SQLite начал копию
+            // сначала. Крупнее шаг — меньше окно, в которое попадает запись
+            ++*restarts;
+            if (step < total) step *= 2;
+        }
+        if (rc == SQLITE_OK) lastRemaining = remaining;
+
+        const int percent = total > 0 ? int(qint64(total - remaining) * 100 / total) : 0;
+        if (progress && !progress(percent)) {
+            aborted = true;
+            break;
+        }
+        // Между шагами блокировок нет: здесь проходят записи с рабочих мест
+        QThread::msleep(rc == SQLITE_OK ? kStepPauseMs : kBusyPauseMs);
+    }
+    sqlite3_backup_finish(backup);
+    if (snapshot) q.exec("COMMIT");
+
+    if (aborted) {
+        *error = "Копирование прервано";
+        return false;
+    }
+    if (rc != SQLITE_DONE) {
+        *error = QString::fromUtf8(sqlite3_errstr(rc));
+        return false;
+    }
+    if (progress) progress(100);
+    return true;
+}
@@ -0,0 +1,84 @@
+#include "BlindIndex.h"
+#include "security.h"
+#include <QMessageAuthenticationCode>
+
+namespace {
+constexpr int kTokenBytes = 16;
+
+QString digitsOnly(const QString& value)
+{
+    QString digits;
+    digits.reserve(value.size());
+    for (const QChar ch : value) {
+        if (ch >= QLatin1Char('0') && ch <= QLatin1Char('9')) digits.append(ch);
+    }
+    return digits;
+}
+} // namespace
+
+QString BlindIndex::normalizePassport(const QString& value)
+{
+    return digitsOnly(value);
+}
+
+QString BlindIndex::normalizePhone(const QString& value)
+{
+    QString digits = digitsOnly(value);
+    if (digits.size() == 11 && digits.startsWith(QLatin1Char('8'))) {
+        digits[0] = QLatin1Char('7');
+    } else if (digits.size() == 10) {
+        digits.prepend(QLatin1Char('7'));
+    }
+    return digits;
+}
+
+QString BlindIndex::passportToken(const QString& passport)
+{
+    const QString normalized = normalizePassport(passport);
+    return normalized.isEmpty() ? QString() : token(key(), "passport", normalized);
+}
+
+QString BlindIndex::phoneToken(const QString& phone)
+{
+    const QString normalized = normalizePhone(phone);
+    return normalized.isEmpty() ? QString() : token(key(), "phone", normalized);
+}
+
+QStringList BlindIndex::phoneSuffixTokens(const QString& phone)
+{
+    QStringList tokens;
+    const QString normalized = normalizePhone(phone);
+    const QByteArray k = key();
+    if (k.isEmpty()) return tokens;
+    const int longest = qMin<int>(kMaxSuffix, normalized.size());
+    for (int length = kMinSuffix; length <= longest; ++length) {
+        tokens.append(token(k, "phone-suffix", normalized.right(length)));
+    }
+    return tokens;
+}
+
+QString BlindIndex::suffixToken(const QString& digits)
+{
+    const QString normalized = digitsOnly(digits);
+    if (normalized.size() < kMinSuffix || normalized.size() > kMaxSuffix) return QString();
+    return token(key(), "phone-suffix", normalized);
+}
+
+// Ключ индексов отделён от ключа шифрования: токены не раскрывают ключ данных
+QByteArray BlindIndex::key()
+{
+    const QByteArray dataKey = Security::dataKey();
+    if (dataKey.isEmpty()) return QByteArray();
+    return QMessageAuthenticationCode::hash(QByteArrayLiteral("blind-index-v1"), dataKey,
+                                            QCryptographicHash::Sha256);
+}
+
+QString BlindIndex::token(const QByteArray& key, const char* domain, const QString& normalized)
+{
+    if (key.isEmpty()) return QString();
+    QMessageAuthenticationCode mac(QCryptographicHash::Sha256, key);
+    mac.addData(domain, int(qstrlen(domain)));
+    mac.addData(":", 1);
+    mac.addData(normalized.toUtf8());
+    return QString::fromLatin1(mac.result().left(kTokenBytes).toHex());
+}
@@ -0,0 +1,180 @@
+#include "ContractDocument.h"
+#include "ReportSink.h"
+#include "customer.h"
+#include "database.h"
+#include "equipment.h"
+#include "rental.h"
+#include <QHash>
+#include <QSqlQuery>
+
+namespace {
+
+QString money(double value)
+{
+    return QString::number(value, 'f', 2);
+}
+
+QString dateTime(const QDateTime& value)
+{
+    return value.toString("dd.MM.yyyy HH:mm");
+}
+
+} // namespace
+
+ContractData ContractData::fromRental(const Rental& rental)
+{
+    ContractData d;
+    d.rentalId = rental.getId();
+    if (const Customer* c = rental.getCustomer()) {
+        d.customerName = c->getName();
+        d.customerPhone = c->getPhone();
+        d.customerEmail = c->getEmail();
+        d.customerPassport = c->getPassport();
+        d.customerAddress = c->getAddress();
+    }
+    if (const Equipment* e = rental.getEquipment()) {
+        d.equipmentName = e->getName();
+        d.equipmentCategory = e->getCategory();
+        d.equipmentPrice = money(e->getPrice());
+    } else {
+        d.equipmentPrice = money(0.0);
+    }
+    d.quantity = QString::number(rental.getQuantity());
+    d.start = dateTime(rental.getStartDate());
+    d.end = dateTime(rental.getEndDate());
+    d.totalPrice = money(rental.getTotalPrice());
+    d.deposit = money(rental.getDeposit());
+    d.notes = rental.getNotes();
+    d.completed = rental.isCompleted();
+    d.finalPrice = money(rental.getTotalPrice() + rental.getDamageCost() + rental.getCleaningCost());
+    d.damageCost = money(rental.getDamageCost());
+    d.cleaningCost = money(rental.getCleaningCost());
+    d.finalDeposit = money(rental.getFinalDeposit());
+    return d;
+}
+
+QList<ContractData> ContractData::loadMany(const QList<int>& ids)
+{
+    QHash<int, ContractData> byId;
+    QSqlQuery query = Database::getInstance().getContractRows(ids);
+    while (query.next()) {
+        ContractData d;
+        d.rentalId = query.value("id").toInt();
+        d.customerName = query.value("customer_name").toString();
+        d.customerPhone = Database::customerField("phone", query.value("customer_phone"));
+        d.customerEmail = query.value("customer_email").toString();
+        d.customerPassport = Database::customerField("passport", query.value("customer_passport"));
+        d.customerAddress = Database::customerField("address", query.value("customer_address"));
+        d.equipmentName = query.value("equipment_name").toString();
+        d.equipmentCategory = query.value("equipment_category").toString();
+        d.equipmentPrice = money(query.value("equipment_price").toDouble());
+        d.quantity = query.value("quantity").toString();
+        d.start = dateTime(query.value("start_date").toDateTime());
+        d.end = dateTime(query.value("end_date").toDateTime());
+        const double total = query.value("total_price").toDouble();
+        const double damage = query.value("damage_cost").toDouble();
+        const double cleaning = query.value("cleaning_cost").toDouble();
+        d.totalPrice = money(total);
+        d.deposit = money(query.value("deposit").toDouble());
+        d.notes = query.value("notes").toString();
+        d.completed = query.value("status").toString() == "completed";
+        // Итог — как Rental::calculateFinalPrice()
+        d.finalPrice = money(total + damage + cleaning);
+        d.damageCost = money(damage);
+        d.cleaningCost = money(cleaning);
+        d.finalDeposit = money(query.value("final_deposit").toDouble());
+        byId.insert(d.rentalId, d);
+    }
+
+    QList<ContractData> result;
+    result.reserve(byId.size());
+    for (int id : ids) {
+        auto it = byId.constFind(id);
+        if (it != byId.constEnd()) result.append(it.value());
+    }
+    return result;
+}
+
+QMap<QString, QString> ContractData::placeholders() const
+{
+    return {
+        {"{{DATE}}", QDate::currentDate().toString("dd.MM.yyyy")},
+        {"{{CUSTOMER_NAME}}", customerName},
+        {"{{CUSTOMER_PHONE}}", customerPhone},
+        {"{{CUSTOMER_EMAIL}}", customerEmail},
+        {"{{CUSTOMER_PASSPORT}}", customerPassport},
+        {"{{CUSTOMER_ADDRESS}}", customerAddress},
+        {"{{EQUIPMENT_NAME}}", equipmentName},
+        {"{{EQUIPMENT_CATEGORY}}", equipmentCategory},
+        {"{{QUANTITY}}", quantity},
+        {"{{START}}", start},
+        {"{{END}}", end},
+        {"{{TOTAL}}", totalPrice},
+        {"{{DEPOSIT}}", deposit},
+        {"{{NOTES}}", notes}
+    };
+}
+
+void writeContract(ReportSink& sink, const ContractData& d)
+{
+    sink.title("Договор аренды оборудования");
+    sink.text(QString("Дата печати: %1").arg(dateTime(QDateTime::currentDateTime())));
+
+    sink.heading("Стороны");
+    sink.beginTable({});
+    sink.row({"Клиент", d.customerName});
+    sink.row({"Телефон", d.customerPhone});
+    sink.row({"Email", d.customerEmail});
+    sink.row({"Паспорт", d.customerPassport});
+    sink.row({"Адрес регистрации", d.customerAddress});
+    sink.endTable();
+
+    sink.heading("Предмет договора");
+    sink.beginTable({});
+    sink.row({"Оборудование", d.equipmentName});
+    sink.row({"Категория", d.equipmentCategory});
+    sink.row({"Количество", d.quantity});
+    sink.row({"Период аренды", QString("%1 — %2").arg(d.start, d.end)});
+    sink.endTable();
+
+    sink.heading("Стоимость");
+    sink.beginTable({});
+    sink.row({"Цена за 1-й день", d.equipmentPrice + " ₽"});
+    sink.row({"Итоговая стоимость", d.totalPrice + " ₽"});
+    sink.row({"Залог", d.deposit + " ₽"});
+    sink.endTable();
+
+    if (!d.notes.isEmpty()) {
+        sink.heading("Примечания");
+        sink.text(d.notes);
+    }
+
+    sink.heading("Подписи");
+    sink.beginTable({"Арендодатель", "Арендатор"});
+    sink.row({"____________________", "____________________"});
+    sink.endTable();
+}
+
+void writeReceipt(ReportSink& sink, const ContractData& d)
+{
+    sink.title(QString("Квитанция по аренде №%1").arg(d.rentalId));
+    sink.text(QString("Дата печати: %1").arg(dateTime(QDateTime::currentDateTime())));
+
+    sink.beginTable({});
+    sink.row({"Клиент", d.customerName});
+    sink.row({"Оборудование", QString("%1 × %2").arg(d.equipmentName, d.quantity)});
+    sink.row({"Период аренды", QString("%1 — %2").arg(d.start, d.end)});
+    sink.row({"Стоимость аренды", d.totalPrice + " ₽"});
+    sink.row({"Залог принят", d.deposit + " ₽"});
+    if (d.completed) {
+        sink.row({"Повреждения", d.damageCost + " ₽"});
+        sink.row({"Уборка", d.cleaningCost + " ₽"});
+        sink.row({"Итого к оплате", d.finalPrice + " ₽"});
+        sink.row({"Залог возвращён", d.finalDeposit + " ₽"});
+    }
+    sink.endTable();
+
+    sink.beginTable({"Принял", "Сдал"});
+    sink.row({"____________________", "____________________"});
+    sink.endTable();
+}
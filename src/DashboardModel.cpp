@@ -0,0 +1,164 @@
+#include "DashboardModel.h"
+#include "database.h"
+#include <QDebug>
+#include <QSqlError>
+#include <QSqlQuery>
+
+DashboardModel::DashboardModel(RentalManager* manager, QObject* parent)
+    : QObject(parent)
+{
+    connect(manager, &RentalManager::rentalCreated, this, &DashboardModel::onRentalCreated);
+    connect(manager, &RentalManager::rentalCompleted, this, &DashboardModel::onRentalCompleted);
+    connect(manager, &RentalManager::rentalCancelled, this, &DashboardModel::onRentalCancelled);
+    connect(manager, &RentalManager::rentalsCompleted, this, &DashboardModel::onRentalsCompleted);
+    connect(manager, &RentalManager::overdueRentalDetected, this, &DashboardModel::onRentalOverdue);
+    // После восстановления из копии и смены категории оборудования итоги
+    // считаются заново: оба события редкие, а категория хранится у каждой аренды
+    connect(manager, &RentalManager::databaseReplaced, this, &DashboardModel::reload);
+    connect(manager, &RentalManager::equipmentUpdated, this, &DashboardModel::reload);
+
+    m_midnightTimer.setSingleShot(true);
+    connect(&m_midnightTimer, &QTimer::timeout, this, &DashboardModel::onNewDay);
+}
+
+bool DashboardModel::reload()
+{
+    Database& db = Database::getInstance();
+    QSqlQuery query = db.getDashboardActiveRentals();
+    if (!query.isActive()) {
+        qDebug() << "Ошибка загрузки сводки:" << query.lastError().text();
+        return false;
+    }
+
+    m_active.clear();
+    m_unitsOut.clear();
+    m_totals = DashboardTotals();
+    m_today = QDate::currentDate();
+
+    const QDateTime now = QDateTime::currentDateTime();
+    while (query.next()) {
+        ActiveRental entry;
+        entry.quantity = query.value(1).toInt();
+        entry.totalPrice = query.value(2).toDouble();
+        entry.deposit = query.value(3).toDouble();
+        entry.overdue = query.value(4).toDateTime() < now;
+        entry.category = query.value(5).toString();
+        const int id = query.value(0).toInt();
+
+        m_active.insert(id, entry);
+        m_unitsOut[entry.category] += entry.quantity;
+        ++m_totals.activeRentals;
+        if (entry.overdue) ++m_totals.overdueRentals;
+        m_totals.depositsHeld += entry.deposit;
+    }
+    m_totals.todayRevenue = db.getRevenueCompletedOn(m_today);
+
+    scheduleMidnight();
+    emit reset();
+    return true;
+}
+
+QMap<QString, int> DashboardModel::unitsOutByCategory() const
+{
+    QMap<QString, int> result;
+    for (auto it = m_unitsOut.cbegin(); it != m_unitsOut.cend(); ++it) {
+        if (it.value() != 0) result.insert(it.key(), it.value());
+    }
+    return result;
+}
+
+void DashboardModel::addUnits(const QString& category, int delta)
+{
+    int& units = m_unitsOut[category];
+    units += delta;
+    emit categoryUnitsChanged(category, units);
+}
+
+void DashboardModel::addActive(int rentalId, const ActiveRental& entry)
+{
+    if (m_active.contains(rentalId)) return;
+    m_active.insert(rentalId, entry);
+    ++m_totals.activeRentals;
+    if (entry.overdue) ++m_totals.overdueRentals;
+    m_totals.depositsHeld += entry.deposit;
+    addUnits(entry.category, entry.quantity);
+    emit totalsChanged();
+}
+
+void DashboardModel::removeActive(int rentalId, double revenue)
+{
+    auto it = m_active.find(rentalId);
+    if (it == m_active.end()) return;
+    const ActiveRental entry = it.value();
+    m_active.erase(it);
+
+    --m_totals.activeRentals;
+    if (entry.overdue) --m_totals.overdueRentals;
+    m_totals.depositsHeld -= entry.deposit;
+    if (revenue >= 0.0) m_totals.todayRevenue += revenue;
+    addUnits(entry.category, -entry.quantity);
+    emit totalsChanged();
+}
+
+void DashboardModel::onRentalCreated(Rental* rental)
+{
+    if (!rental || !rental->isActive()) return;
+    ActiveRental entry;
+    entry.category = rental->getEquipment() ? rental->getEquipment()->getCategory() : QString();
+    entry.quantity = rental->getQuantity();
+    entry.totalPrice = rental->getTotalPrice();
+    entry.deposit = rental->getDeposit();
+    entry.overdue = rental->isOverdue();
+    addActive(rental->getId(), entry);
+}
+
+void DashboardModel::onRentalCompleted(Rental* rental)
+{
+    if (!rental) return;
+    removeActive(rental->getId(), rental->getFinalPrice());
+}
+
+void DashboardModel::onRentalCancelled(Rental* rental)
+{
+    if (!rental) return;
+    removeActive(rental->getId(), -1.0);
+}
+
+void DashboardModel::onRentalsCompleted(const QList<RentalReturnLine>& lines)
+{
+    for (const RentalReturnLine& line : lines) {
+        auto it = m_active.constFind(line.rentalId);
+        if (it == m_active.constEnd()) continue;
+        // Итог — как Rental::calculateFinalPrice()
+        removeActive(line.rentalId, it->totalPrice + line.damageCost + line.cleaningCost);
+    }
+}
+
+void DashboardModel::onRentalOverdue(Rental* rental)
+{
+    if (!rental) return;
+    auto it = m_active.find(rental->getId());
+    if (it == m_active.end() || it->overdue) return;
+    it->overdue = true;
+    ++m_totals.overdueRentals;
+    emit totalsChanged();
+}
+
+void DashboardModel::onNewDay()
+{
+    // Выручка «за сегодня» начинается с нуля, остальные показатели не зависят от даты
+    if (QDate::currentDate() != m_today) {
+        m_today = QDate::currentDate();
+        m_totals.todayRevenue = 0.0;
+        emit totalsChanged();
+    }
+    scheduleMidnight();
+}
+
+void DashboardModel::scheduleMidnight()
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    const QDateTime midnight(now.date().addDays(1), QTime(0, 0));
+    // Запас в секунду, чтобы таймер не сработал чуть раньше полуночи
+    m_midnightTimer.start(static_cast<int>(now.msecsTo(midnight)) + 1000);
+}
@@ -0,0 +1,140 @@
+#include "DocumentBatchJob.h"
+#include "ContractDocument.h"
+#include "DocxTemplate.h"
+#include "PdfRenderer.h"
+#include <QDateTime>
+#include <QDir>
+#include <QMetaObject>
+
+namespace {
+
+// Результат одной задачи; пустой error — успех
+struct TaskResult {
+    QStringList files;
+    QString error;
+};
+
+TaskResult renderOne(const ContractData& data, const DocumentBatchRequest& request,
+                     const std::shared_ptr<const DocxTemplate>& docx)
+{
+    TaskResult result;
+    const QDir dir(request.outputDir);
+    if (docx) {
+        const QString path = dir.filePath(QString("Договор_%1.docx").arg(data.rentalId));
+        if (!docx->write(data.placeholders(), path, &result.error)) return result;
+        result.files.append(path);
+    }
+    const PdfRenderer renderer;
+    if (request.pdf) {
+        const QString path = dir.filePath(QString("Договор_%1.pdf").arg(data.rentalId));
+        if (!renderer.renderContract(data, path, &result.error)) return result;
+        result.files.append(path);
+    }
+    if (request.receipts) {
+        const QString path = dir.filePath(QString("Квитанция_%1.pdf").arg(data.rentalId));
+        if (!renderer.renderReceipt(data, path, &result.error)) return result;
+        result.files.append(path);
+    }
+    return result;
+}
+
+TaskResult renderMerged(const QList<ContractData>& items, const DocumentBatchRequest& request,
+                        const std::atomic_bool& cancel)
+{
+    TaskResult result;
+    const QString path = QDir(request.outputDir).filePath(
+        QString("Договоры_%1.pdf").arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmm")));
+    if (PdfRenderer().renderContracts(items, path, request.receipts, &cancel, &result.error)) {
+        result.files.append(path);
+    }
+    return result;
+}
+
+} // namespace
+
+DocumentBatchJob::DocumentBatchJob(QObject* parent)
+    : QObject(parent)
+{
+}
+
+DocumentBatchJob::~DocumentBatchJob()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+bool DocumentBatchJob::start(const DocumentBatchRequest& request, QString* error)
+{
+    auto fail = [error](const QString& message) {
+        if (error) *error = message;
+        return false;
+    };
+    if (isRunning()) return fail("Предыдущее задание ещё выполняется");
+    if (!QDir().mkpath(request.outputDir)) return fail("Не удалось создать каталог " + request.outputDir);
+
+    // Шаблон компилируется здесь один раз и дальше только читается из потоков
+    std::shared_ptr<const DocxTemplate> docx;
+    if (request.docx && !request.templatePath.isEmpty()) {
+        QString templateError;
+        docx = DocxTemplate::load(request.templatePath, &templateError);
+        if (!docx) return fail(templateError);
+    }
+
+    const QList<ContractData> items = ContractData::loadMany(request.rentalIds);
+    if (items.isEmpty()) return fail("Выбранные аренды не найдены");
+
+    const bool perItem = docx || request.pdf || request.receipts;
+    m_cancel = std::make_shared<std::atomic_bool>(false);
+    m_total = (perItem ? items.size() : 0) + (request.mergedPdf ? 1 : 0);
+    if (m_total == 0) return fail("Не выбран ни один вид документов");
+    m_pending = m_total;
+    m_failed = 0;
+    m_files.clear();
+    emit progress(0, m_total);
+
+    const std::shared_ptr<std::atomic_bool> cancelFlag = m_cancel;
+    if (perItem) {
+        for (const ContractData& data : items) {
+            m_pool.start([this, data, request, docx, cancelFlag]() {
+                TaskResult result;
+                if (cancelFlag->load(std::memory_order_relaxed)) {
+                    result.error = "Отменено";
+                } else {
+                    result = renderOne(data, request, docx);
+                }
+                QMetaObject::invokeMethod(this, [this, id = data.rentalId, result]() {
+                    onTaskDone(id, result.files, result.error);
+                }, Qt::QueuedConnection);
+            });
+        }
+    }
+    if (request.mergedPdf) {
+        m_pool.start([this, items, request, cancelFlag]() {
+            const TaskResult result = renderMerged(items, request, *cancelFlag);
+            QMetaObject::invokeMethod(this, [this, result]() {
+                onTaskDone(0, result.files, result.error);
+            }, Qt::QueuedConnection);
+        });
+    }
+    return true;
+}
+
+void DocumentBatchJob::cancel()
+{
+    if (m_cancel) m_cancel->store(true);
+}
+
+void DocumentBatchJob::onTaskDone(int rentalId, const QStringList& files, const QString& error)
+{
+    const bool cancelled = m_cancel && m_cancel->load();
+    m_files.append(files);
+    if (!error.isEmpty() && !cancelled) {
+        ++m_failed;
+        emit itemFailed(rentalId, error);
+    }
+    --m_pending;
+    emit progress(m_total - m_pending, m_total);
+    if (m_pending == 0) {
+        emit finished(m_files, m_failed, cancelled);
+    }
+}
@@ -0,0 +1,280 @@
+#include "DocxTemplate.h"
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSet>
+#include <algorithm>
+
+namespace {
+
+const QByteArray kDocumentPart = "word/document.xml";
+
+// Текстовый узел <w:t>: границы открывающего тега и содержимого
+struct TextNode {
+    qsizetype openStart;
+    qsizetype contentStart;
+    qsizetype contentEnd;
+    int paragraph;
+};
+
+// Кусок нового содержимого узла: текст или слот заполнителя
+struct Piece {
+    QByteArray text;
+    QString key;
+};
+
+// Тег с именем ровно name (<w:t, но не <w:tab или <w:tbl)
+bool tagAt(const QByteArray& xml, qsizetype pos, const char* name, qsizetype len)
+{
+    if (pos + len >= xml.size() || qstrncmp(xml.constData() + pos, name, len) != 0) return false;
+    const char next = xml.at(pos + len);
+    return next == '>' || next == ' ' || next == '/' || next == '\t' || next == '\r' || next == '\n';
+}
+
+QList<TextNode> scanTextNodes(const QByteArray& xml)
+{
+    QList<TextNode> nodes;
+    int paragraph = 0;
+    qsizetype pos = 0;
+    while ((pos = xml.indexOf('<', pos)) >= 0) {
+        if (tagAt(xml, pos, "<w:p", 4)) {
+            ++paragraph;
+        } else if (tagAt(xml, pos, "<w:t", 4)) {
+            const qsizetype close = xml.indexOf('>', pos);
+            if (close < 0) break;
+            if (xml.at(close - 1) != '/') {
+                const qsizetype end = xml.indexOf("</w:t>", close);
+                if (end < 0) break;
+                nodes.append(TextNode{pos, close + 1, end, paragraph});
+                pos = end + 6;
+                continue;
+            }
+        }
+        ++pos;
+    }
+    return nodes;
+}
+
+// Открывающий тег узла со слотом: пробелы по краям значения Word
+// сохранит только с xml:space="preserve"
+QByteArray preservedOpenTag(const QByteArray& tag)
+{
+    if (tag.contains("xml:space")) return tag;
+    return QByteArray("<w:t xml:space=\"preserve\"") + tag.mid(4);
+}
+
+struct CacheEntry {
+    QDateTime modified;
+    qint64 size = 0;
+    std::shared_ptr<const DocxTemplate> compiled;
+};
+
+QMutex g_cacheMutex;
+QHash<QString, CacheEntry> g_cache;
+
+} // namespace
+
+std::shared_ptr<const DocxTemplate> DocxTemplate::load(const QString& path, QString* error)
+{
+    const QFileInfo info(path);
+    if (!info.exists()) {
+        if (error) *error = QString("Шаблон не найден: %1").arg(path);
+        return nullptr;
+    }
+    const QString key = info.absoluteFilePath();
+    const QDateTime modified = info.lastModified();
+    const qint64 size = info.size();
+
+    {
+        QMutexLocker lock(&g_cacheMutex);
+        auto it = g_cache.constFind(key);
+        if (it != g_cache.constEnd() && it->modified == modified && it->size == size) {
+            return it->compiled;
+        }
+    }
+
+    // Компиляция вне блокировки: два потока могут скомпилировать один файл
+    // одновременно, в кэше останется любой из одинаковых результатов
+    auto compiled = std::make_shared<DocxTemplate>();
+    if (!compiled->compile(key, error)) return nullptr;
+
+    QMutexLocker lock(&g_cacheMutex);
+    g_cache.insert(key, CacheEntry{modified, size, compiled});
+    return compiled;
+}
+
+void DocxTemplate::clearCache()
+{
+    QMutexLocker lock(&g_cacheMutex);
+    g_cache.clear();
+}
+
+bool DocxTemplate::fill(const QString& templatePath, const QMap<QString, QString>& values,
+                        const QString& outputPath, QString* error)
+{
+    const std::shared_ptr<const DocxTemplate> compiled = load(templatePath, error);
+    return compiled && compiled->write(values, outputPath, error);
+}
+
+bool DocxTemplate::compile(const QString& path, QString* error)
+{
+    ZipReader reader;
+    if (!reader.open(path)) {
+        if (error) *error = reader.errorString();
+        return false;
+    }
+
+    QByteArray xml;
+    for (const ZipEntry& entry : reader.entries()) {
+        Part part;
+        part.entry = entry;
+        const bool ok = entry.name == kDocumentPart ? reader.read(entry, xml)
+                                                    : reader.rawData(entry, part.raw);
+        if (!ok) {
+            if (error) *error = reader.errorString();
+            return false;
+        }
+        if (entry.name == kDocumentPart) m_documentPart = m_parts.size();
+        m_parts.append(part);
+    }
+    if (m_documentPart < 0) {
+        if (error) *error = "В шаблоне нет word/document.xml";
+        return false;
+    }
+
+    const QList<TextNode> nodes = scanTextNodes(xml);
+    QByteArray literal;
+    qsizetype copied = 0;
+    auto emitSlot = [this, &literal](const QString& key) {
+        m_literalSize += literal.size();
+        m_segments.append(Segment{literal, key});
+        literal.clear();
+    };
+
+    for (qsizetype first = 0; first < nodes.size();) {
+        qsizetype last = first;
+        while (last < nodes.size() && nodes.at(last).paragraph == nodes.at(first).paragraph) ++last;
+
+        // Текст абзаца и начало каждого узла в нём
+        QByteArray text;
+        QList<qsizetype> starts;
+        for (qsizetype k = first; k < last; ++k) {
+            starts.append(text.size());
+            const TextNode& n = nodes.at(k);
+            text.append(xml.constData() + n.contentStart, n.contentEnd - n.contentStart);
+        }
+
+        struct Match {
+            qsizetype start;
+            qsizetype end;
+        };
+        QList<Match> matches;
+        qsizetype pos = 0;
+        while ((pos = text.indexOf("{{", pos)) >= 0) {
+            const qsizetype close = text.indexOf("}}", pos + 2);
+            if (close < 0) break;
+            // Ближайшее к закрытию «{{»: в «{{ {{DATE}}» заполнитель — {{DATE}}
+            const qsizetype open = text.lastIndexOf("{{", close);
+            matches.append(Match{open, close + 2});
+            pos = close + 2;
+        }
+
+        if (!matches.isEmpty()) {
+            const qsizetype count = last - first;
+            QList<QList<Piece>> content(count);
+            auto nodeAt = [&starts](qsizetype offset) {
+                return std::upper_bound(starts.cbegin(), starts.cend(), offset) - starts.cbegin() - 1;
+            };
+            // Обычный текст остаётся в своих узлах, заполнитель целиком
+            // становится слотом в узле, где он начинался
+            auto copyRange = [&](qsizetype from, qsizetype to) {
+                while (from < to) {
+                    const qsizetype k = nodeAt(from);
+                    const qsizetype nodeEnd = k + 1 < count ? starts.at(k + 1) : text.size();
+                    const qsizetype chunkEnd = qMin(to, nodeEnd);
+                    content[k].append(Piece{text.mid(from, chunkEnd - from), QString()});
+                    from = chunkEnd;
+                }
+            };
+            qsizetype cursor = 0;
+            for (const Match& m : std::as_const(matches)) {
+                copyRange(cursor, m.start);
+                content[nodeAt(m.start)].append(Piece{QByteArray(), QString::fromUtf8(text.mid(m.start, m.end - m.start))});
+                cursor = m.end;
+            }
+            copyRange(cursor, text.size());
+
+            for (qsizetype k = 0; k < count; ++k) {
+                const TextNode& n = nodes.at(first + k);
+                const QList<Piece>& pieces = content.at(k);
+                const bool hasSlot = std::any_of(pieces.cbegin(), pieces.cend(),
+                                                 [](const Piece& p) { return !p.key.isEmpty(); });
+                literal.append(xml.constData() + copied, n.openStart - copied);
+                const QByteArray tag = xml.mid(n.openStart, n.contentStart - n.openStart);
+                literal.append(hasSlot ? preservedOpenTag(tag) : tag);
+                for (const Piece& p : pieces) {
+                    if (p.key.isEmpty()) literal.append(p.text);
+                    else emitSlot(p.key);
+                }
+                copied = n.contentEnd;
+            }
+        }
+        first = last;
+    }
+    literal.append(xml.constData() + copied, xml.size() - copied);
+    emitSlot(QString());
+    return true;
+}
+
+QByteArray DocxTemplate::renderDocument(const QMap<QString, QString>& values) const
+{
+    QByteArray out;
+    out.reserve(m_literalSize + m_segments.size() * 32);
+    for (const Segment& s : m_segments) {
+        out.append(s.literal);
+        if (s.key.isEmpty()) continue;
+        auto it = values.constFind(s.key);
+        // Незнакомый заполнитель остаётся в документе как был
+        out.append(it != values.constEnd() ? it.value().toHtmlEscaped().toUtf8() : s.key.toUtf8());
+    }
+    return out;
+}
+
+QStringList DocxTemplate::placeholders() const
+{
+    QStringList keys;
+    QSet<QString> seen;
+    for (const Segment& s : m_segments) {
+        if (!s.key.isEmpty() && !seen.contains(s.key)) {
+            seen.insert(s.key);
+            keys.append(s.key);
+        }
+    }
+    return keys;
+}
+
+bool DocxTemplate::write(const QMap<QString, QString>& values, const QString& outputPath,
+                         QString* error) const
+{
+    auto fail = [error](const QString& message) {
+        if (error) *error = message;
+        return false;
+    };
+
+    QSaveFile file(outputPath);
+    if (!file.open(QIODevice::WriteOnly)) return fail(file.errorString());
+
+    // Порядок записей сохраняется: [Content_Types].xml остаётся первым
+    ZipWriter writer(&file);
+    for (int i = 0; i < m_parts.size(); ++i) {
+        const Part& part = m_parts.at(i);
+        const bool ok = i == m_documentPart ? writer.addFile(part.entry, renderDocument(values))
+                                            : writer.addRaw(part.entry, part.raw);
+        if (!ok) return fail(writer.errorString());
+    }
+    if (!writer.finish()) return fail(writer.errorString());
+    if (!file.commit()) return fail(file.errorString());
+    return true;
+}
@@ -0,0 +1,116 @@
+#include "NotificationCenter.h"
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QDebug>
+
+NotificationCenter::NotificationCenter(QObject* parent) : QObject(parent) {
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &NotificationCenter::deliver);
+}
+
+quint64 NotificationCenter::key(NotificationKind kind, int rentalId) {
+    return (quint64(quint32(kind)) << 32) | quint32(rentalId);
+}
+
+void NotificationCenter::setCoalesceInterval(int ms)    { m_coalesceMs = qMax(0, ms); }
+void NotificationCenter::setMinDigestInterval(int ms)   { m_minDigestIntervalMs = qMax(0, ms); }
+void NotificationCenter::setRepeatSuppression(int secs) { m_repeatSuppressSecs = qMax(0, secs); }
+void NotificationCenter::setSpoolDirectory(const QString& dir) { m_spoolDir = dir; }
+
+void NotificationCenter::post(NotificationKind kind, int rentalId, const QString& message) {
+    const quint64 k = key(kind, rentalId);
+    const QDateTime now = QDateTime::currentDateTime();
+
+    // Повтор в текущей пачке — только обновляем текст
+    auto pendingIt = m_pendingIndex.constFind(k);
+    if (pendingIt != m_pendingIndex.constEnd()) {
+        m_pending[pendingIt.value()].message = message;
+        return;
+    }
+
+    // Недавно уже показывали — не дёргаем оператора снова
+    auto lastIt = m_lastDelivered.constFind(k);
+    if (lastIt != m_lastDelivered.constEnd() &&
+        now.toMSecsSinceEpoch() - lastIt.value() < qint64(m_repeatSuppressSecs) * 1000) {
+        return;
+    }
+
+    Notification n;
+    n.kind = kind;
+    n.rentalId = rentalId;
+    n.message = message;
+    n.createdAt = now;
+    m_pendingIndex.insert(k, m_pending.size());
+    m_pending.append(n);
+    scheduleDelivery();
+}
+
+void NotificationCenter::scheduleDelivery() {
+    if (m_timer.isActive() || m_pending.isEmpty()) return;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const qint64 earliest = qMax(now + m_coalesceMs, m_lastDigestMs + m_minDigestIntervalMs);
+    m_timer.start(static_cast<int>(qMax<qint64>(0, earliest - now)));
+}
+
+void NotificationCenter::flush() {
+    m_timer.stop();
+    deliver();
+}
+
+void NotificationCenter::deliver() {
+    if (m_pending.isEmpty()) return;
+
+    const QList<Notification> items = m_pending;
+    m_pending.clear();
+    m_pendingIndex.clear();
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    m_lastDigestMs = now;
+    for (const Notification& n : items) {
+        m_lastDelivered.insert(key(n.kind, n.rentalId), now);
+    }
+
+    // Подчищаем отметки, которые уже не подавляют повторы
+    const qint64 horizon = now - qint64(m_repeatSuppressSecs) * 1000;
+    for (auto it = m_lastDelivered.begin(); it != m_lastDelivered.end();) {
+        if (it.value() < horizon) it = m_lastDelivered.erase(it);
+        else ++it;
+    }
+
+    if (!m_spoolDir.isEmpty() && !writeSpool(items)) {
+        qDebug() << "Не удалось записать дайджест уведомлений в" << m_spoolDir;
+    }
+    emit digestReady(items);
+}
+
+bool NotificationCenter::writeSpool(const QList<Notification>& items) const {
+    if (!QDir().mkpath(m_spoolDir)) return false;
+
+    QJsonArray arr;
+    for (const Notification& n : items) {
+        QJsonObject o;
+        o["kind"] = n.kind == NotificationKind::Overdue ? QStringLiteral("overdue")
+                                                        : QStringLiteral("return_reminder");
+        o["rental_id"] = n.rentalId;
+        o["message"] = n.message;
+        o["created_at"] = n.createdAt.toString(Qt::ISODate);
+        arr.append(o);
+    }
+    QJsonObject root;
+    root["generated_at"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    root["count"] = items.size();
+    root["items"] = arr;
+
+    // QSaveFile пишет во временный файл и переименовывает: внешний
+    // рассыльщик никогда не увидит недописанный дайджест
+    const QString name = QString("digest_%1.json")
+            .arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss_zzz"));
+    QSaveFile f(QDir(m_spoolDir).filePath(name));
+    if (!f.open(QIODevice::WriteOnly)) return false;
+    f.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    return f.commit();
+}
@@ -0,0 +1,87 @@
+#include "OverdueScheduler.h"
+
+namespace {
+// QTimer принимает int; длинные интервалы дробим, заодно переживаем перевод часов
+constexpr qint64 kMaxIntervalMs = 60LL * 60 * 1000;
+}
+
+OverdueScheduler::OverdueScheduler(QObject* parent) : QObject(parent) {
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &OverdueScheduler::onTimeout);
+}
+
+void OverdueScheduler::schedule(int rentalId, const QDateTime& deadline) {
+    if (rentalId <= 0 || !deadline.isValid()) return;
+
+    const qint64 ms = deadline.toMSecsSinceEpoch();
+    auto it = m_deadlines.find(rentalId);
+    if (it != m_deadlines.end() && it.value() == ms) return;
+
+    m_deadlines.insert(rentalId, ms);
+    m_heap.push({ms, rentalId});
+    compactIfNeeded();
+    rearm();
+}
+
+void OverdueScheduler::unschedule(int rentalId) {
+    // Запись в куче остаётся и будет отброшена, когда окажется наверху
+    if (m_deadlines.remove(rentalId) == 0) return;
+    compactIfNeeded();
+    rearm();
+}
+
+void OverdueScheduler::clear() {
+    m_deadlines.clear();
+    m_heap = {};
+    m_timer.stop();
+}
+
+bool OverdueScheduler::isLive(const Entry& e) const {
+    auto it = m_deadlines.constFind(e.rentalId);
+    return it != m_deadlines.constEnd() && it.value() == e.deadlineMs;
+}
+
+void OverdueScheduler::dropStaleTop() {
+    while (!m_heap.empty() && !isLive(m_heap.top())) {
+        m_heap.pop();
+    }
+}
+
+void OverdueScheduler::compactIfNeeded() {
+    // Не даём устаревшим записям разрастись: перестройка за O(n) амортизируется
+    if (m_heap.size() <= static_cast<size_t>(m_deadlines.size()) * 2 + 64) return;
+
+    std::vector<Entry> live;
+    live.reserve(m_deadlines.size());
+    for (auto it = m_deadlines.constBegin(); it != m_deadlines.constEnd(); ++it) {
+        live.push_back({it.value(), it.key()});
+    }
+    m_heap = decltype(m_heap)(std::greater<Entry>(), std::move(live));
+}
+
+void OverdueScheduler::rearm() {
+    dropStaleTop();
+    if (m_heap.empty()) {
+        m_timer.stop();
+        return;
+    }
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const qint64 wait = qBound<qint64>(0, m_heap.top().deadlineMs - now, kMaxIntervalMs);
+    m_timer.start(static_cast<int>(wait));
+}
+
+void OverdueScheduler::onTimeout() {
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    dropStaleTop();
+    while (!m_heap.empty() && m_heap.top().deadlineMs <= now) {
+        const Entry e = m_heap.top();
+        m_heap.pop();
+        if (!isLive(e)) continue;
+        // Аренда с наступившим сроком уходит из наблюдения: сигнал приходит один раз
+        m_deadlines.remove(e.rentalId);
+        emit deadlineReached(e.rentalId);
+        dropStaleTop();
+    }
+    rearm();
+}
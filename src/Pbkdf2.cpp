@@ -0,0 +1,287 @@
+#include "Pbkdf2.h"
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QStringList>
+#include <cstring>
+
+namespace {
+
+constexpr quint32 kRound[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+constexpr quint32 kInitial[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+constexpr int kBlockSize = 64;
+
+inline quint32 rotr(quint32 x, int n) { return (x >> n) | (x << (32 - n)); }
+
+inline quint32 load32(const uchar* p)
+{
+    return (quint32(p[0]) << 24) | (quint32(p[1]) << 16) | (quint32(p[2]) << 8) | quint32(p[3]);
+}
+
+inline void store32(uchar* p, quint32 v)
+{
+    p[0] = uchar(v >> 24);
+    p[1] = uchar(v >> 16);
+    p[2] = uchar(v >> 8);
+    p[3] = uchar(v);
+}
+
+void compress(quint32 state[8], const uchar block[kBlockSize])
+{
+    quint32 w[64];
+    for (int i = 0; i < 16; ++i) w[i] = load32(block + 4 * i);
+    for (int i = 16; i < 64; ++i) {
+        const quint32 s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const quint32 s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    quint32 a = state[0], b = state[1], c = state[2], d = state[3];
+    quint32 e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i) {
+        const quint32 t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + kRound[i] + w[i];
+        const quint32 t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+// Потоковый SHA-256 — только для подготовки (ключ длиннее блока, U1)
+struct Sha256 {
+    quint32 state[8];
+    uchar buffer[kBlockSize];
+    int used = 0;
+    quint64 total = 0;
+
+    Sha256() { std::memcpy(state, kInitial, sizeof(state)); }
+    // Продолжение после уже сжатых целых блоков (состояния ipad/opad)
+    Sha256(const quint32 from[8], quint64 consumed) : total(consumed) { std::memcpy(state, from, sizeof(state)); }
+
+    void update(const uchar* data, size_t size)
+    {
+        total += size;
+        while (size > 0) {
+            const size_t take = qMin<size_t>(size, size_t(kBlockSize - used));
+            std::memcpy(buffer + used, data, take);
+            used += int(take);
+            data += take;
+            size -= take;
+            if (used == kBlockSize) {
+                compress(state, buffer);
+                used = 0;
+            }
+        }
+    }
+
+    void final(uchar out[32])
+    {
+        const quint64 bits = total * 8;
+        buffer[used++] = 0x80;
+        if (used > kBlockSize - 8) {
+            std::memset(buffer + used, 0, size_t(kBlockSize - used));
+            compress(state, buffer);
+            used = 0;
+        }
+        std::memset(buffer + used, 0, size_t(kBlockSize - 8 - used));
+        store32(buffer + 56, quint32(bits >> 32));
+        store32(buffer + 60, quint32(bits));
+        compress(state, buffer);
+        for (int i = 0; i < 8; ++i) store32(out + 4 * i, state[i]);
+    }
+};
+
+// Затирание ключевого материала: через volatile, чтобы запись не выбросил оптимизатор
+void wipe(void* data, size_t size)
+{
+    volatile uchar* p = static_cast<volatile uchar*>(data);
+    while (size--) *p++ = 0;
+}
+
+void pbkdf2Sha256(const uchar* password, size_t passwordSize, const uchar* salt, size_t saltSize,
+                  quint32 iterations, uchar* out, size_t outSize)
+{
+    // Ключ HMAC длиннее блока сначала хешируется
+    uchar key[kBlockSize] = {};
+    if (passwordSize > size_t(kBlockSize)) {
+        Sha256 h;
+        h.update(password, passwordSize);
+        h.final(key);
+    } else if (passwordSize > 0) {
+        std::memcpy(key, password, passwordSize);
+    }
+
+    // Состояния после блоков K^ipad и K^opad — общие для всех итераций
+    uchar pad[kBlockSize];
+    quint32 inner[8], outer[8];
+    for (int i = 0; i < kBlockSize; ++i) pad[i] = key[i] ^ 0x36;
+    std::memcpy(inner, kInitial, sizeof(inner));
+    compress(inner, pad);
+    for (int i = 0; i < kBlockSize; ++i) pad[i] = key[i] ^ 0x5c;
+    std::memcpy(outer, kInitial, sizeof(outer));
+    compress(outer, pad);
+
+    // Блок для U(i) = HMAC(U(i-1)): 32 байта U, затем дополнение SHA-256 для
+    // сообщения длиной 64 + 32 байта — одинаковое у внутреннего и внешнего хеша
+    uchar block[kBlockSize] = {};
+    block[32] = 0x80;
+    block[62] = 0x03; // 768 бит
+    block[63] = 0x00;
+
+    quint32 state[8], acc[8];
+    for (quint32 index = 1; outSize > 0; ++index) {
+        // U1 = HMAC(salt || INT(index))
+        uchar counter[4];
+        store32(counter, index);
+        Sha256 first(inner, kBlockSize);
+        first.update(salt, saltSize);
+        first.update(counter, sizeof(counter));
+        first.final(block);
+        Sha256 second(outer, kBlockSize);
+        second.update(block, 32);
+        second.final(block);
+        for (int i = 0; i < 8; ++i) acc[i] = load32(block + 4 * i);
+
+        for (quint32 n = 1; n < iterations; ++n) {
+            std::memcpy(state, inner, sizeof(state));
+            compress(state, block);
+            for (int i = 0; i < 8; ++i) store32(block + 4 * i, state[i]);
+            std::memcpy(state, outer, sizeof(state));
+            compress(state, block);
+            for (int i = 0; i < 8; ++i) {
+                store32(block + 4 * i, state[i]);
+                acc[i] ^= state[i];
+            }
+        }
+
+        uchar chunk[32];
+        for (int i = 0; i < 8; ++i) store32(chunk + 4 * i, acc[i]);
+        const size_t take = qMin<size_t>(outSize, sizeof(chunk));
+        std::memcpy(out, chunk, take);
+        out += take;
+        outSize -= take;
+        wipe(chunk, sizeof(chunk));
+    }
+
+    wipe(key, sizeof(key));
+    wipe(pad, sizeof(pad));
+    wipe(block, sizeof(block));
+    wipe(inner, sizeof(inner));
+    wipe(outer, sizeof(outer));
+    wipe(state, sizeof(state));
+    wipe(acc, sizeof(acc));
+}
+
+const QLatin1String kRecordScheme("pbkdf2-sha256");
+
+} // namespace
+
+QByteArray Pbkdf2::derive(const QByteArray& password, const QByteArray& salt, int iterations, int keyLength)
+{
+    if (iterations <= 0 || keyLength <= 0) return QByteArray();
+    QByteArray key(keyLength, Qt::Uninitialized);
+    pbkdf2Sha256(reinterpret_cast<const uchar*>(password.constData()), size_t(password.size()),
+                 reinterpret_cast<const uchar*>(salt.constData()), size_t(salt.size()),
+                 quint32(iterations), reinterpret_cast<uchar*>(key.data()), size_t(key.size()));
+    return key;
+}
+
+int Pbkdf2::calibrate(int targetMs)
+{
+    // Пробный прогон удваивается, пока замер не станет заметно длиннее
+    // разрешения таймера и колебаний планировщика
+    constexpr qint64 kMinSampleNs = 50 * 1000 * 1000;
+    const QByteArray password("calibration");
+    const QByteArray salt(kSaltSize, '\x5a');
+    QElapsedTimer timer;
+    qint64 probe = 10000;
+    qint64 elapsedNs = 0;
+    for (;;) {
+        timer.start();
+        derive(password, salt, int(probe));
+        elapsedNs = qMax<qint64>(timer.nsecsElapsed(), 1);
+        if (elapsedNs >= kMinSampleNs || probe >= kMaxIterations) break;
+        probe *= 2;
+    }
+    const qint64 iterations = qint64(double(probe) * targetMs * 1e6 / double(elapsedNs));
+    return int(qBound<qint64>(kMinIterations, iterations, kMaxIterations));
+}
+
+QByteArray Pbkdf2::randomSalt(int size)
+{
+    QByteArray salt(size, Qt::Uninitialized);
+    auto* rng = QRandomGenerator::system();
+    for (int i = 0; i < salt.size(); i += 4) {
+        const quint32 r = rng->generate();
+        std::memcpy(salt.data() + i, &r, size_t(qMin(4, salt.size() - i)));
+    }
+    return salt;
+}
+
+QString Pbkdf2::makeRecord(const QString& password, int iterations)
+{
+    if (iterations <= 0) iterations = calibrate();
+    const QByteArray salt = randomSalt();
+    const QByteArray hash = derive(password.toUtf8(), salt, iterations);
+    return QStringLiteral("%1$%2$%3$%4")
+        .arg(kRecordScheme)
+        .arg(iterations)
+        .arg(QString::fromLatin1(salt.toBase64()))
+        .arg(QString::fromLatin1(hash.toBase64()));
+}
+
+bool Pbkdf2::isRecord(const QString& record)
+{
+    return record.startsWith(QString(kRecordScheme) + QLatin1Char('$'));
+}
+
+bool Pbkdf2::parseRecord(const QString& record, int* iterations, QByteArray* salt, QByteArray* hash)
+{
+    const QStringList parts = record.split(QLatin1Char('$'));
+    if (parts.size() != 4 || parts[0] != kRecordScheme) return false;
+    bool ok = false;
+    const int it = parts[1].toInt(&ok);
+    if (!ok || it <= 0 || it > kMaxIterations) return false;
+    const QByteArray s = QByteArray::fromBase64(parts[2].toLatin1());
+    const QByteArray h = QByteArray::fromBase64(parts[3].toLatin1());
+    if (s.isEmpty() || h.size() != kKeySize) return false;
+    if (iterations) *iterations = it;
+    if (salt) *salt = s;
+    if (hash) *hash = h;
+    return true;
+}
+
+bool Pbkdf2::verifyRecord(const QString& password, const QString& record)
+{
+    int iterations = 0;
+    QByteArray salt, stored;
+    if (!parseRecord(record, &iterations, &salt, &stored)) return false;
+    return constantTimeEquals(derive(password.toUtf8(), salt, iterations), stored);
+}
+
+int Pbkdf2::recordIterations(const QString& record)
+{
+    int iterations = 0;
+    return parseRecord(record, &iterations, nullptr, nullptr) ? iterations : 0;
+}
+
+bool Pbkdf2::constantTimeEquals(const QByteArray& a, const QByteArray& b)
+{
+    if (a.size() != b.size()) return false;
+    uchar diff = 0;
+    for (int i = 0; i < a.size(); ++i) diff |= uchar(a[i] ^ b[i]);
+    return diff == 0;
+}
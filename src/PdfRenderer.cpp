@@ -0,0 +1,53 @@
+#include "PdfRenderer.h"
+
+PdfRenderer::PdfRenderer(const PageTemplate& page)
+    : m_page(page)
+{
+}
+
+bool PdfRenderer::render(const QString& path, const Body& body, QString* error) const
+{
+    PdfReportSink sink(path, m_page);
+    if (!sink.begin()) {
+        if (error) *error = sink.errorString();
+        return false;
+    }
+    body(sink);
+    if (!sink.finish()) {
+        if (error) *error = QString("Не удалось записать %1").arg(path);
+        return false;
+    }
+    return true;
+}
+
+bool PdfRenderer::renderContract(const ContractData& data, const QString& path, QString* error) const
+{
+    return render(path, [&data](ReportSink& sink) { writeContract(sink, data); }, error);
+}
+
+bool PdfRenderer::renderReceipt(const ContractData& data, const QString& path, QString* error) const
+{
+    return render(path, [&data](ReportSink& sink) { writeReceipt(sink, data); }, error);
+}
+
+bool PdfRenderer::renderContracts(const QList<ContractData>& items, const QString& path, bool withReceipts,
+                                  const std::atomic_bool* cancel, QString* error) const
+{
+    bool cancelled = false;
+    const bool ok = render(path, [&](ReportSink& sink) {
+        for (int i = 0; i < items.size(); ++i) {
+            if (cancel && cancel->load(std::memory_order_relaxed)) {
+                cancelled = true;
+                return;
+            }
+            if (i > 0) sink.pageBreak();
+            writeContract(sink, items.at(i));
+            if (withReceipts) {
+                sink.pageBreak();
+                writeReceipt(sink, items.at(i));
+            }
+        }
+    }, error);
+    if (ok && cancelled && error) *error = "Отменено";
+    return ok && !cancelled;
+}
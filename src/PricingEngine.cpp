@@ -0,0 +1,378 @@
+#include "PricingEngine.h"
+#include "database.h"
+#include "equipment.h"
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+// Окно предрасчёта дневных коэффициентов: год назад и три года вперёд.
+// Аренды за его пределами считаются по правилам напрямую (медленный путь).
+constexpr int kHorizonPastDays = 366;
+constexpr int kHorizonDays = kHorizonPastDays + 3 * 366;
+
+QString ruleSetKey(const QList<int>& ids)
+{
+    QStringList parts;
+    parts.reserve(ids.size());
+    for (int id : ids) parts << QString::number(id);
+    return parts.join(',');
+}
+}
+
+QString PricingRule::typeToString(Type type)
+{
+    switch (type) {
+    case Season:   return "season";
+    case Weekend:  return "weekend";
+    case LongTerm: return "long_term";
+    case Group:    return "group";
+    }
+    return "season";
+}
+
+PricingRule::Type PricingRule::typeFromString(const QString& s)
+{
+    if (s == "weekend")   return Weekend;
+    if (s == "long_term") return LongTerm;
+    if (s == "group")     return Group;
+    return Season;
+}
+
+PricingEngine& PricingEngine::instance() { static PricingEngine g; return g; }
+
+PricingEngine::PricingEngine(QObject* parent) : QObject(parent) {}
+
+void PricingEngine::ensureRules()
+{
+    if (!m_rulesLoaded) reloadRules();
+}
+
+void PricingEngine::reloadRules()
+{
+    m_rules.clear();
+    invalidateAll();
+
+    Database& db = Database::getInstance();
+    if (!db.isOpen()) return; // попробуем при следующем расчёте
+
+    QSqlQuery query = db.getPricingRules();
+    while (query.next()) {
+        PricingRule r;
+        r.id = query.value("id").toInt();
+        r.type = PricingRule::typeFromString(query.value("rule_type").toString());
+        r.equipmentId = query.value("equipment_id").isNull() ? 0 : query.value("equipment_id").toInt();
+        r.category = query.value("category").toString();
+        r.startDate = QDate::fromString(query.value("start_date").toString(), Qt::ISODate);
+        r.endDate = QDate::fromString(query.value("end_date").toString(), Qt::ISODate);
+        r.minDays = query.value("min_days").toInt();
+        r.minQuantity = query.value("min_quantity").toInt();
+        r.percent = query.value("percent").toDouble();
+        r.active = query.value("active").toInt() != 0;
+        m_rules.insert(r.id, r);
+    }
+    m_rulesLoaded = true;
+}
+
+QList<PricingRule> PricingEngine::rules()
+{
+    ensureRules();
+    QList<PricingRule> result = m_rules.values();
+    std::sort(result.begin(), result.end(),
+              [](const PricingRule& a, const PricingRule& b) { return a.id < b.id; });
+    return result;
+}
+
+bool PricingEngine::addRule(PricingRule& rule)
+{
+    ensureRules();
+    int id = Database::getInstance().addPricingRule(PricingRule::typeToString(rule.type), rule.equipmentId,
+                                                    rule.category, rule.startDate, rule.endDate,
+                                                    rule.minDays, rule.minQuantity, rule.percent, rule.active);
+    if (id <= 0) return false;
+
+    rule.id = id;
+    m_rules.insert(id, rule);
+    invalidateForRule(rule);
+    return true;
+}
+
+bool PricingEngine::updateRule(const PricingRule& rule)
+{
+    ensureRules();
+    if (!Database::getInstance().updatePricingRule(rule.id, PricingRule::typeToString(rule.type), rule.equipmentId,
+                                                   rule.category, rule.startDate, rule.endDate,
+                                                   rule.minDays, rule.minQuantity, rule.percent, rule.active)) {
+        return false;
+    }
+
+    // Правило могло сменить область действия — сбрасываем и старую, и новую
+    auto it = m_rules.constFind(rule.id);
+    if (it != m_rules.constEnd()) invalidateForRule(it.value());
+    m_rules.insert(rule.id, rule);
+    invalidateForRule(rule);
+    return true;
+}
+
+bool PricingEngine::removeRule(int ruleId)
+{
+    ensureRules();
+    if (!Database::getInstance().deletePricingRule(ruleId)) return false;
+
+    auto it = m_rules.constFind(ruleId);
+    if (it != m_rules.constEnd()) {
+        const PricingRule old = it.value();
+        m_rules.remove(ruleId);
+        invalidateForRule(old);
+    }
+    return true;
+}
+
+void PricingEngine::invalidateEquipment(int equipmentId)
+{
+    m_tables.remove(equipmentId);
+}
+
+void PricingEngine::invalidateAll()
+{
+    m_tables.clear();
+    m_dayFactorCache.clear();
+}
+
+void PricingEngine::invalidateForRule(const PricingRule& rule)
+{
+    if (rule.equipmentId > 0) {
+        m_tables.remove(rule.equipmentId);
+    } else if (!rule.category.isEmpty()) {
+        for (auto it = m_tables.begin(); it != m_tables.end();) {
+            if (it.value().category == rule.category) it = m_tables.erase(it);
+            else ++it;
+        }
+    } else {
+        m_tables.clear();
+    }
+
+    // Общие массивы коэффициентов, собранные с участием правила, больше не нужны
+    if (rule.type == PricingRule::Season || rule.type == PricingRule::Weekend) {
+        const QString id = QString::number(rule.id);
+        for (auto it = m_dayFactorCache.begin(); it != m_dayFactorCache.end();) {
+            if (it.key().split(',').contains(id)) it = m_dayFactorCache.erase(it);
+            else ++it;
+        }
+    }
+}
+
+bool PricingEngine::ruleApplies(const PricingRule& rule, int equipmentId, const QString& category) const
+{
+    if (!rule.active) return false;
+    if (rule.equipmentId > 0) return rule.equipmentId == equipmentId;
+    if (!rule.category.isEmpty()) return rule.category == category;
+    return true;
+}
+
+int PricingEngine::specificity(const PricingRule& rule)
+{
+    if (rule.equipmentId > 0) return 2;
+    if (!rule.category.isEmpty()) return 1;
+    return 0;
+}
+
+double PricingEngine::dayFactor(const QList<int>& ruleIds, const QDate& day) const
+{
+    double factor = 1.0;
+    const bool weekend = day.dayOfWeek() >= Qt::Saturday;
+    for (int id : ruleIds) {
+        auto it = m_rules.constFind(id);
+        if (it == m_rules.constEnd()) continue;
+        const PricingRule& r = it.value();
+        if (r.type == PricingRule::Weekend) {
+            if (weekend) factor *= 1.0 + r.percent / 100.0;
+        } else if ((!r.startDate.isValid() || day >= r.startDate) &&
+                   (!r.endDate.isValid() || day <= r.endDate)) {
+            factor *= 1.0 + r.percent / 100.0;
+        }
+    }
+    return qMax(0.0, factor);
+}
+
+std::shared_ptr<const PricingEngine::DayFactors> PricingEngine::dayFactors(const QList<int>& ruleIds)
+{
+    const QString key = ruleSetKey(ruleIds);
+    auto it = m_dayFactorCache.constFind(key);
+    if (it != m_dayFactorCache.constEnd()) return it.value();
+
+    auto df = std::make_shared<DayFactors>();
+    df->origin = QDate::currentDate().addDays(-kHorizonPastDays);
+    df->factor.resize(kHorizonDays);
+    df->prefix.resize(kHorizonDays + 1);
+    df->prefix[0] = 0.0;
+    QDate day = df->origin;
+    for (int i = 0; i < kHorizonDays; ++i, day = day.addDays(1)) {
+        df->factor[i] = dayFactor(ruleIds, day);
+        df->prefix[i + 1] = df->prefix[i] + df->factor[i];
+    }
+
+    m_dayFactorCache.insert(key, df);
+    return df;
+}
+
+PricingEngine::TariffTable PricingEngine::buildTable(int equipmentId, const QString& category,
+                                                     double price, double additionalPrice)
+{
+    ensureRules();
+
+    TariffTable t;
+    t.equipmentId = equipmentId;
+    t.category = category;
+    t.firstDayPrice = price;
+    t.additionalDayPrice = additionalPrice > 0.0 ? additionalPrice : price;
+
+    QList<const PricingRule*> longTerm;
+    QList<const PricingRule*> group;
+    for (auto it = m_rules.constBegin(); it != m_rules.constEnd(); ++it) {
+        const PricingRule& r = it.value();
+        if (!ruleApplies(r, equipmentId, category)) continue;
+        switch (r.type) {
+        case PricingRule::Season:
+        case PricingRule::Weekend:  t.dayRuleIds << r.id; break;
+        case PricingRule::LongTerm: longTerm << &r; break;
+        case PricingRule::Group:    group << &r; break;
+        }
+    }
+
+    std::sort(t.dayRuleIds.begin(), t.dayRuleIds.end());
+    if (!t.dayRuleIds.isEmpty()) t.days = dayFactors(t.dayRuleIds);
+
+    // Ступени по убыванию порога; при равном пороге выигрывает более узкое правило
+    auto toTiers = [](QList<const PricingRule*> rules, bool byDays) {
+        std::sort(rules.begin(), rules.end(), [byDays](const PricingRule* a, const PricingRule* b) {
+            const int ta = byDays ? a->minDays : a->minQuantity;
+            const int tb = byDays ? b->minDays : b->minQuantity;
+            if (ta != tb) return ta > tb;
+            return specificity(*a) > specificity(*b);
+        });
+        std::vector<Tier> tiers;
+        tiers.reserve(rules.size());
+        for (const PricingRule* r : rules) {
+            tiers.push_back({byDays ? r->minDays : r->minQuantity, r->percent});
+        }
+        return tiers;
+    };
+    t.longTermTiers = toTiers(longTerm, true);
+    t.groupTiers = toTiers(group, false);
+    return t;
+}
+
+void PricingEngine::preload(const QList<int>& equipmentIds)
+{
+    ensureRules();
+
+    QList<int> missing;
+    for (int id : equipmentIds) {
+        if (id > 0 && !m_tables.contains(id) && !missing.contains(id)) missing << id;
+    }
+    if (missing.isEmpty()) return;
+
+    QSqlQuery query = Database::getInstance().getEquipmentPricing(missing);
+    while (query.next()) {
+        const int id = query.value("id").toInt();
+        m_tables.insert(id, buildTable(id, query.value("category").toString(),
+                                       query.value("price").toDouble(),
+                                       query.value("additional_day_price").toDouble()));
+    }
+}
+
+double PricingEngine::tierPercent(const std::vector<Tier>& tiers, int value)
+{
+    for (const Tier& t : tiers) {
+        if (value >= t.threshold) return t.percent;
+    }
+    return 0.0;
+}
+
+PriceQuote PricingEngine::evaluate(const TariffTable& t, int quantity,
+                                   const QDateTime& start, const QDateTime& end) const
+{
+    PriceQuote q;
+    q.equipmentId = t.equipmentId;
+    q.quantity = quantity;
+    if (!start.isValid() || !end.isValid() || quantity <= 0) return q;
+
+    const int days = qMax(static_cast<int>(start.daysTo(end)), 1);
+    const QDate first = start.date();
+    q.days = days;
+
+    if (!t.days) {
+        q.unitPrice = t.firstDayPrice + t.additionalDayPrice * (days - 1);
+    } else {
+        const DayFactors& df = *t.days;
+        const qint64 i0 = df.origin.daysTo(first);
+        if (i0 >= 0 && i0 + days <= static_cast<qint64>(df.factor.size())) {
+            q.unitPrice = t.firstDayPrice * df.factor[i0] +
+                          t.additionalDayPrice * (df.prefix[i0 + days] - df.prefix[i0 + 1]);
+        } else {
+            double sum = t.firstDayPrice * dayFactor(t.dayRuleIds, first);
+            for (int k = 1; k < days; ++k) {
+                sum += t.additionalDayPrice * dayFactor(t.dayRuleIds, first.addDays(k));
+            }
+            q.unitPrice = sum;
+        }
+    }
+
+    const double factor = (1.0 + tierPercent(t.longTermTiers, days) / 100.0) *
+                          (1.0 + tierPercent(t.groupTiers, quantity) / 100.0);
+    q.discountPercent = (factor - 1.0) * 100.0;
+    q.total = qRound64(qMax(0.0, q.unitPrice * quantity * factor) * 100.0) / 100.0;
+    q.ok = true;
+    return q;
+}
+
+PriceQuote PricingEngine::quote(const QuoteLine& line)
+{
+    return quote(QList<QuoteLine>{line}).value(0);
+}
+
+QList<PriceQuote> PricingEngine::quote(const QList<QuoteLine>& lines)
+{
+    QList<int> ids;
+    ids.reserve(lines.size());
+    for (const QuoteLine& l : lines) ids << l.equipmentId;
+    preload(ids); // одна выборка на все недостающие таблицы
+
+    QList<PriceQuote> result;
+    result.reserve(lines.size());
+    for (const QuoteLine& l : lines) {
+        auto it = m_tables.constFind(l.equipmentId);
+        if (it == m_tables.constEnd()) {
+            PriceQuote q;
+            q.equipmentId = l.equipmentId;
+            q.quantity = l.quantity;
+            result << q;
+            continue;
+        }
+        result << evaluate(it.value(), l.quantity, l.start, l.end);
+    }
+    return result;
+}
+
+PriceQuote PricingEngine::quote(const Equipment* equipment, int quantity,
+                                const QDateTime& start, const QDateTime& end)
+{
+    if (!equipment) return PriceQuote();
+
+    const int id = equipment->getId();
+    const double additional = equipment->getAdditionalDayPrice() > 0.0 ? equipment->getAdditionalDayPrice()
+                                                                       : equipment->getPrice();
+    auto it = m_tables.constFind(id);
+    // Объект мог быть изменён в памяти, но ещё не сохранён — таблица тогда не подходит
+    if (id > 0 && it != m_tables.constEnd() &&
+        it.value().category == equipment->getCategory() &&
+        it.value().firstDayPrice == equipment->getPrice() &&
+        it.value().additionalDayPrice == additional) {
+        return evaluate(it.value(), quantity, start, end);
+    }
+
+    TariffTable t = buildTable(id, equipment->getCategory(), equipment->getPrice(),
+                               equipment->getAdditionalDayPrice());
+    if (id <= 0) return evaluate(t, quantity, start, end);
+    return evaluate(*m_tables.insert(id, std::move(t)), quantity, start, end);
+}
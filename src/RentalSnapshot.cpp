@@ -0,0 +1,418 @@
+#include "RentalSnapshot.h"
+#include "database.h"
+#include "rental.h"
+#include "rentalmanager.h"
+#include <QDebug>
+#include <QSqlError>
+#include <QSet>
+#include <QSqlQuery>
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace {
+
+// Сумма по маске в четыре независимых аккумулятора: без -ffast-math компилятор
+// не переставляет сложения double, а так он может упаковать их в вектор.
+double maskedSum(const double* values, const std::uint8_t* mask, std::size_t n)
+{
+    double acc0 = 0.0, acc1 = 0.0, acc2 = 0.0, acc3 = 0.0;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 += values[i] * mask[i];
+        acc1 += values[i + 1] * mask[i + 1];
+        acc2 += values[i + 2] * mask[i + 2];
+        acc3 += values[i + 3] * mask[i + 3];
+    }
+    for (; i < n; ++i) {
+        acc0 += values[i] * mask[i];
+    }
+    return (acc0 + acc1) + (acc2 + acc3);
+}
+
+quint8 statusCode(const QString& status)
+{
+    if (status == "active") return RentalSnapshot::Active;
+    if (status == "completed") return RentalSnapshot::Completed;
+    if (status == "cancelled") return RentalSnapshot::Cancelled;
+    return RentalSnapshot::Other;
+}
+
+constexpr int kMaxIdsPerQuery = 500; // держимся ниже лимита параметров SQLite
+
+} // namespace
+
+RentalSnapshot::RentalSnapshot(QObject* parent)
+    : QObject(parent)
+{
+}
+
+QString RentalSnapshot::segmentName(CustomerSegment segment)
+{
+    switch (segment) {
+    case CustomerSegment::New:       return QStringLiteral("Новые (1 аренда)");
+    case CustomerSegment::Returning: return QString("Повторные (%1–%2)").arg(kReturningFrom).arg(kRegularFrom - 1);
+    case CustomerSegment::Regular:   return QString("Постоянные (от %1)").arg(kRegularFrom);
+    case CustomerSegment::Any:       break;
+    }
+    return QStringLiteral("Все клиенты");
+}
+
+void RentalSnapshot::clear()
+{
+    m_id.clear();
+    m_customerId.clear();
+    m_equipmentId.clear();
+    m_quantity.clear();
+    m_startDay.clear();
+    m_endDay.clear();
+    m_category.clear();
+    m_status.clear();
+    m_revenue.clear();
+    m_deposit.clear();
+    m_damage.clear();
+    m_cleaning.clear();
+    m_rowById.clear();
+    m_categories.clear();
+    m_categoryIndex.clear();
+}
+
+bool RentalSnapshot::load()
+{
+    clear();
+    if (!loadRows(QList<int>())) {
+        return false;
+    }
+    emit changed();
+    return true;
+}
+
+void RentalSnapshot::attach(RentalManager* manager)
+{
+    if (!manager) return;
+    auto refreshOne = [this](Rental* rental) {
+        if (rental) refreshRental(rental->getId());
+    };
+    connect(manager, &RentalManager::rentalCreated, this, refreshOne);
+    connect(manager, &RentalManager::rentalCompleted, this, refreshOne);
+    connect(manager, &RentalManager::rentalCancelled, this, refreshOne);
+    connect(manager, &RentalManager::equipmentUpdated, this, [this](Equipment* equipment) {
+        if (equipment) recategorize(equipment->getId(), equipment->getCategory());
+    });
+    connect(manager, &RentalManager::rentalsCompleted, this, [this](const QList<RentalReturnLine>& lines) {
+        QList<int> ids;
+        ids.reserve(lines.size());
+        for (const RentalReturnLine& line : lines) ids.append(line.rentalId);
+        refreshRentals(ids);
+    });
+}
+
+bool RentalSnapshot::refreshRental(int rentalId)
+{
+    return refreshRentals({rentalId});
+}
+
+bool RentalSnapshot::refreshRentals(const QList<int>& rentalIds)
+{
+    if (rentalIds.isEmpty()) return true;
+    for (int i = 0; i < rentalIds.size(); i += kMaxIdsPerQuery) {
+        if (!loadRows(rentalIds.mid(i, kMaxIdsPerQuery))) {
+            return false;
+        }
+    }
+    emit changed();
+    return true;
+}
+
+void RentalSnapshot::removeRental(int rentalId)
+{
+    auto it = m_rowById.find(rentalId);
+    if (it == m_rowById.end()) return;
+
+    // Последняя строка переезжает на место удалённой — колонки остаются плотными
+    const int row = it.value();
+    const int last = size() - 1;
+    m_rowById.erase(it);
+    if (row != last) {
+        m_id[row] = m_id[last];
+        m_customerId[row] = m_customerId[last];
+        m_equipmentId[row] = m_equipmentId[last];
+        m_quantity[row] = m_quantity[last];
+        m_startDay[row] = m_startDay[last];
+        m_endDay[row] = m_endDay[last];
+        m_category[row] = m_category[last];
+        m_status[row] = m_status[last];
+        m_revenue[row] = m_revenue[last];
+        m_deposit[row] = m_deposit[last];
+        m_damage[row] = m_damage[last];
+        m_cleaning[row] = m_cleaning[last];
+        m_rowById[m_id[row]] = row;
+    }
+    m_id.pop_back();
+    m_customerId.pop_back();
+    m_equipmentId.pop_back();
+    m_quantity.pop_back();
+    m_startDay.pop_back();
+    m_endDay.pop_back();
+    m_category.pop_back();
+    m_status.pop_back();
+    m_revenue.pop_back();
+    m_deposit.pop_back();
+    m_damage.pop_back();
+    m_cleaning.pop_back();
+    emit changed();
+}
+
+bool RentalSnapshot::loadRows(const QList<int>& rentalIds)
+{
+    QSqlQuery query = Database::getInstance().getRentalSnapshotRows(rentalIds);
+    if (!query.isActive()) {
+        qDebug() << "Ошибка загрузки снимка аренд:" << query.lastError().text();
+        return false;
+    }
+
+    QSet<int> missing(rentalIds.cbegin(), rentalIds.cend());
+    while (query.next()) {
+        const int id = query.value(0).toInt();
+        const quint8 status = statusCode(query.value(6).toString());
+        // completeRental пишет ущерб и чистку, а не final_price
+        const double revenue = status == Completed
+                ? query.value(7).toDouble() + query.value(10).toDouble() + query.value(11).toDouble()
+                : query.value(7).toDouble();
+        missing.remove(id);
+
+        int row;
+        auto it = m_rowById.constFind(id);
+        if (it != m_rowById.constEnd()) {
+            row = it.value();
+        } else {
+            row = size();
+            m_rowById.insert(id, row);
+            m_id.push_back(id);
+            m_customerId.emplace_back();
+            m_equipmentId.emplace_back();
+            m_quantity.emplace_back();
+            m_startDay.emplace_back();
+            m_endDay.emplace_back();
+            m_category.emplace_back();
+            m_status.emplace_back();
+            m_revenue.emplace_back();
+            m_deposit.emplace_back();
+            m_damage.emplace_back();
+            m_cleaning.emplace_back();
+        }
+        m_customerId[row] = query.value(1).toInt();
+        m_equipmentId[row] = query.value(2).toInt();
+        m_quantity[row] = query.value(3).toInt();
+        m_startDay[row] = query.value(4).toInt();
+        m_endDay[row] = query.value(5).toInt();
+        m_status[row] = status;
+        m_revenue[row] = revenue;
+        m_deposit[row] = query.value(9).toDouble();
+        m_damage[row] = query.value(10).toDouble();
+        m_cleaning[row] = query.value(11).toDouble();
+        m_category[row] = categoryCode(query.value(12).toString());
+    }
+
+    // Запрошенные, но не найденные аренды удалены из БД
+    for (int id : std::as_const(missing)) {
+        removeRental(id);
+    }
+    return true;
+}
+
+quint16 RentalSnapshot::categoryCode(const QString& category)
+{
+    if (category.isEmpty()) return kNoCategory;
+    auto it = m_categoryIndex.constFind(category);
+    if (it != m_categoryIndex.constEnd()) return it.value();
+    const quint16 code = static_cast<quint16>(m_categories.size());
+    m_categories.append(category);
+    m_categoryIndex.insert(category, code);
+    return code;
+}
+
+void RentalSnapshot::recategorize(int equipmentId, const QString& category)
+{
+    const quint16 code = categoryCode(category);
+    bool touched = false;
+    const std::size_t n = m_equipmentId.size();
+    for (std::size_t i = 0; i < n; ++i) {
+        if (m_equipmentId[i] != equipmentId || m_category[i] == code) continue;
+        m_category[i] = code;
+        touched = true;
+    }
+    compactCategories();
+    if (touched) emit changed();
+}
+
+void RentalSnapshot::compactCategories()
+{
+    // Коды, на которые не ссылается ни одна строка, выбрасываются из словаря
+    std::vector<quint16> remap(m_categories.size(), kNoCategory);
+    for (quint16 code : m_category) {
+        if (code != kNoCategory) remap[code] = 0;
+    }
+    if (std::find(remap.cbegin(), remap.cend(), kNoCategory) == remap.cend()) return;
+
+    QStringList names;
+    m_categoryIndex.clear();
+    for (std::size_t code = 0; code < remap.size(); ++code) {
+        if (remap[code] == kNoCategory) continue;
+        remap[code] = static_cast<quint16>(names.size());
+        m_categoryIndex.insert(m_categories.at(static_cast<int>(code)), remap[code]);
+        names.append(m_categories.at(static_cast<int>(code)));
+    }
+    m_categories = names;
+    for (quint16& code : m_category) {
+        if (code != kNoCategory) code = remap[code];
+    }
+}
+
+void RentalSnapshot::customerSegments(std::vector<quint8>& segments) const
+{
+    // id клиентов идут подряд от 1, поэтому счётчики — плотный массив, а не хеш
+    const std::size_t n = m_customerId.size();
+    qint32 maxId = 0;
+    for (std::size_t i = 0; i < n; ++i) maxId = std::max(maxId, m_customerId[i]);
+    std::vector<qint32> counts(static_cast<std::size_t>(maxId) + 1, 0);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (m_customerId[i] > 0) counts[m_customerId[i]] += m_status[i] != Cancelled;
+    }
+
+    segments.resize(counts.size());
+    for (std::size_t id = 0; id < counts.size(); ++id) {
+        const qint32 c = counts[id];
+        const CustomerSegment segment = c >= kRegularFrom ? CustomerSegment::Regular
+                                      : c >= kReturningFrom ? CustomerSegment::Returning
+                                      : CustomerSegment::New;
+        segments[id] = static_cast<quint8>(segment);
+    }
+}
+
+void RentalSnapshot::buildMask(const SnapshotFilter& filter, std::vector<std::uint8_t>& mask) const
+{
+    const std::size_t n = m_id.size();
+    mask.resize(n);
+
+    const qint32 from = filter.from.isValid() ? static_cast<qint32>(filter.from.toJulianDay())
+                                              : std::numeric_limits<qint32>::min();
+    const qint32 to = filter.to.isValid() ? static_cast<qint32>(filter.to.toJulianDay())
+                                          : std::numeric_limits<qint32>::max();
+    const bool anyCategory = filter.category.isEmpty();
+    // Неизвестная категория не совпадёт ни с одним кодом
+    const quint16 category = anyCategory ? kNoCategory
+                                         : m_categoryIndex.value(filter.category, kNoCategory - 1);
+    const quint8 statusMask = filter.statusMask;
+
+    const qint32* start = m_startDay.data();
+    const quint16* cat = m_category.data();
+    const qint32* cust = m_customerId.data();
+    const quint8* status = m_status.data();
+    std::uint8_t* out = mask.data();
+
+    // Без ветвлений: все условия считаются для каждой строки и сливаются побитово
+    for (std::size_t i = 0; i < n; ++i) {
+        const bool inRange = (start[i] >= from) & (start[i] <= to);
+        const bool categoryOk = anyCategory | (cat[i] == category);
+        const bool statusOk = (statusMask >> status[i]) & 1u;
+        out[i] = static_cast<std::uint8_t>(inRange & categoryOk & statusOk);
+    }
+
+    // Сегмент — свойство клиента: отдельный проход по таблице сегментов
+    if (filter.segment != CustomerSegment::Any) {
+        std::vector<quint8> segments;
+        customerSegments(segments);
+        const quint8 segment = static_cast<quint8>(filter.segment);
+        const quint8* seg = segments.data();
+        for (std::size_t i = 0; i < n; ++i) {
+            out[i] &= static_cast<std::uint8_t>(cust[i] > 0 && seg[cust[i]] == segment);
+        }
+    }
+}
+
+SnapshotTotals RentalSnapshot::sumMasked(const std::vector<std::uint8_t>& mask) const
+{
+    const std::size_t n = mask.size();
+    const std::uint8_t* m = mask.data();
+    const qint32* quantity = m_quantity.data();
+
+    SnapshotTotals totals;
+    qint64 count = 0;
+    qint64 units = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        count += m[i];
+        units += static_cast<qint64>(quantity[i]) * m[i];
+    }
+    totals.count = static_cast<int>(count);
+    totals.units = units;
+    totals.revenue = maskedSum(m_revenue.data(), m, n);
+    totals.deposits = maskedSum(m_deposit.data(), m, n);
+    totals.damage = maskedSum(m_damage.data(), m, n);
+    totals.cleaning = maskedSum(m_cleaning.data(), m, n);
+    return totals;
+}
+
+SnapshotTotals RentalSnapshot::totals(const SnapshotFilter& filter) const
+{
+    std::vector<std::uint8_t> mask;
+    buildMask(filter, mask);
+    return sumMasked(mask);
+}
+
+QMap<QString, SnapshotTotals> RentalSnapshot::byCategory(const SnapshotFilter& filter) const
+{
+    std::vector<std::uint8_t> mask;
+    buildMask(filter, mask);
+
+    // Группировка по коду словаря — плотный массив вместо хеша по строкам
+    std::vector<SnapshotTotals> groups(m_categories.size() + 1);
+    const std::size_t n = mask.size();
+    for (std::size_t i = 0; i < n; ++i) {
+        if (!mask[i]) continue;
+        const std::size_t code = m_category[i] == kNoCategory ? m_categories.size() : m_category[i];
+        SnapshotTotals& g = groups[code];
+        ++g.count;
+        g.units += m_quantity[i];
+        g.revenue += m_revenue[i];
+        g.deposits += m_deposit[i];
+        g.damage += m_damage[i];
+        g.cleaning += m_cleaning[i];
+    }
+
+    QMap<QString, SnapshotTotals> result;
+    for (std::size_t code = 0; code < groups.size(); ++code) {
+        if (groups[code].count == 0) continue;
+        const QString name = code < static_cast<std::size_t>(m_categories.size())
+                                 ? m_categories.at(static_cast<int>(code))
+                                 : QStringLiteral("Без категории");
+        result.insert(name, groups[code]);
+    }
+    return result;
+}
+
+QMap<QDate, SnapshotTotals> RentalSnapshot::byWeek(const SnapshotFilter& filter) const
+{
+    std::vector<std::uint8_t> mask;
+    buildMask(filter, mask);
+
+    // Юлианский день 0 — понедельник, поэтому неделя = день / 7
+    QHash<qint32, SnapshotTotals> weeks;
+    const std::size_t n = mask.size();
+    for (std::size_t i = 0; i < n; ++i) {
+        if (!mask[i]) continue;
+        SnapshotTotals& w = weeks[m_startDay[i] / 7];
+        ++w.count;
+        w.units += m_quantity[i];
+        w.revenue += m_revenue[i];
+        w.deposits += m_deposit[i];
+        w.damage += m_damage[i];
+        w.cleaning += m_cleaning[i];
+    }
+
+    QMap<QDate, SnapshotTotals> result;
+    for (auto it = weeks.cbegin(); it != weeks.cend(); ++it) {
+        result.insert(QDate::fromJulianDay(static_cast<qint64>(it.key()) * 7), it.value());
+    }
+    return result;
+}
@@ -0,0 +1,530 @@
+#include "ReportService.h"
+#include "ReportSink.h"
+#include "UtilizationEngine.h"
+#include "database.h"
+#include <QMap>
+#include <QPrinter>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <QDebug>
+#include <functional>
+
+namespace {
+
+constexpr int kCacheCostKb = 32 * 1024; // до ~32 МБ готового HTML
+
+constexpr int kPreviewRows = 2000;       // строк таблиц в предпросмотре на экране
+
+// Всё, что нужно построителю отчёта в рабочем потоке
+struct BuildContext {
+    QSqlDatabase db;
+    ReportRequest request;
+    const std::atomic_bool* cancel = nullptr;
+    std::function<void(int)> progress;
+    QString error;
+
+    bool isCancelled() const { return cancel->load(std::memory_order_relaxed); }
+
+    // Границы периода в формате хранения дат (ISO), конец — не включительно
+    QString from() const { return request.start.toString(Qt::ISODate); }
+    QString until() const { return request.end.addDays(1).toString(Qt::ISODate); }
+};
+
+// Прогресс по строкам: сигнал только при смене процента
+class RowProgress {
+public:
+    RowProgress(BuildContext& ctx, int total) : m_ctx(ctx), m_total(qMax(total, 1)) {}
+    void step() {
+        const int percent = static_cast<int>(qint64(++m_done) * 100 / m_total);
+        if (percent != m_last) {
+            m_last = percent;
+            m_ctx.progress(qMin(percent, 100));
+        }
+    }
+private:
+    BuildContext& m_ctx;
+    int m_total;
+    int m_done = 0;
+    int m_last = -1;
+};
+
+QString money(double value)
+{
+    return QString::number(value, 'f', 2);
+}
+
+int countRows(BuildContext& ctx, const QString& sql, const QVariantList& binds)
+{
+    QSqlQuery query(ctx.db);
+    query.prepare(sql);
+    for (const QVariant& v : binds) query.addBindValue(v);
+    if (!query.exec() || !query.next()) return 0;
+    return query.value(0).toInt();
+}
+
+bool buildRentalReport(BuildContext& ctx, ReportSink& sink)
+{
+    const int total = countRows(ctx, "SELECT COUNT(*) FROM rentals WHERE start_date >= ? AND start_date < ?",
+                                {ctx.from(), ctx.until()});
+
+    QSqlQuery query(ctx.db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT r.id, r.quantity, r.start_date, r.end_date, r.status, r.total_price, r.deposit, "
+                  "c.name AS customer_name, e.name AS equipment_name "
+                  "FROM rentals r "
+                  "LEFT JOIN customers c ON r.customer_id = c.id "
+                  "LEFT JOIN equipment e ON r.equipment_id = e.id "
+                  "WHERE r.start_date >= ? AND r.start_date < ? "
+                  "ORDER BY r.start_date");
+    query.addBindValue(ctx.from());
+    query.addBindValue(ctx.until());
+    if (!query.exec()) {
+        ctx.error = query.lastError().text();
+        return false;
+    }
+
+    double totalRevenue = 0.0;
+    double totalDeposits = 0.0;
+    int totalRentals = 0;
+    int activeRentals = 0;
+    int completedRentals = 0;
+    int overdueRentals = 0;
+    const QDateTime now = QDateTime::currentDateTime();
+    RowProgress progress(ctx, total);
+
+    sink.heading("Статистика аренд");
+    sink.beginTable({"ID", "Клиент", "Оборудование", "Количество", "Дата начала", "Дата окончания",
+                     "Статус", "Стоимость аренды", "Залог"});
+
+    while (query.next()) {
+        if (ctx.isCancelled()) return false;
+
+        const QDateTime start = QDateTime::fromString(query.value("start_date").toString(), Qt::ISODate);
+        const QDateTime end = QDateTime::fromString(query.value("end_date").toString(), Qt::ISODate);
+        const double price = query.value("total_price").toDouble();
+        const double deposit = query.value("deposit").toDouble();
+
+        QString status = query.value("status").toString();
+        if (status == "active") {
+            if (now > end) {
+                status = "Просрочено";
+                overdueRentals++;
+            } else {
+                status = "Активна";
+                activeRentals++;
+            }
+        } else if (status == "completed") {
+            completedRentals++;
+        }
+
+        totalRevenue += price;
+        totalDeposits += deposit;
+        totalRentals++;
+
+        sink.row({query.value("id").toString(),
+                  query.value("customer_name").toString(),
+                  query.value("equipment_name").toString(),
+                  query.value("quantity").toString(),
+                  start.toString("dd.MM.yyyy HH:mm"),
+                  end.toString("dd.MM.yyyy HH:mm"),
+                  status,
+                  money(price) + " ₽",
+                  money(deposit) + " ₽"});
+        progress.step();
+    }
+    sink.endTable();
+
+    sink.heading("Итоговая статистика");
+    sink.field("Всего аренд за период", QString::number(totalRentals));
+    sink.field("Активных аренд", QString::number(activeRentals));
+    sink.field("Завершенных аренд", QString::number(completedRentals));
+    sink.field("Просроченных аренд", QString::number(overdueRentals));
+    sink.field("Общая выручка", money(totalRevenue) + " ₽");
+    sink.field("Общая сумма залогов", money(totalDeposits) + " ₽");
+    return true;
+}
+
+QString percent(double value)
+{
+    return QString::number(value, 'f', 1) + " %";
+}
+
+QString unitDays(double value)
+{
+    return QString::number(value, 'f', 1);
+}
+
+bool buildEquipmentReport(BuildContext& ctx, ReportSink& sink)
+{
+    UtilizationEngine engine(ctx.request.start, ctx.request.end);
+    if (!engine.load(ctx.db, &ctx.error)) return false;
+    ctx.progress(30);
+
+    UtilizationReport report;
+    if (!engine.compute(report, ctx.cancel)) return false;
+    ctx.progress(60);
+
+    sink.heading(QString("Загрузка оборудования за %1 дн.").arg(report.days));
+    sink.field("Всего позиций", QString::number(report.items.size()));
+    sink.field("Всего единиц", QString::number(report.totalUnits));
+    sink.field("Занято единице-дней", unitDays(report.usedDays) + " из " + unitDays(report.capacityDays));
+    sink.field("Средняя загрузка", percent(report.percent));
+
+    sink.heading("По категориям:");
+    sink.beginTable({"Категория", "Позиций", "Единиц", "Занято ед.-дней", "Загрузка",
+                     "Пик одновременно", "Простаивало единиц"});
+    for (const CategoryUtilization& c : report.categories) {
+        sink.row({c.category,
+                  QString::number(c.items),
+                  QString::number(c.units),
+                  unitDays(c.usedDays),
+                  percent(c.percent),
+                  QString::number(c.peakConcurrent),
+                  QString::number(c.idleUnits)});
+    }
+    sink.endTable();
+
+    sink.heading("По позициям:");
+    sink.beginTable({"Оборудование", "Категория", "Единиц", "Занято ед.-дней", "Загрузка",
+                     "Пик одновременно", "Простаивало единиц"});
+    for (const EquipmentUtilization& e : report.items) {
+        if (ctx.isCancelled()) return false;
+        sink.row({e.name,
+                  e.category,
+                  QString::number(e.units),
+                  unitDays(e.usedDays),
+                  percent(e.percent),
+                  QString::number(e.peakConcurrent),
+                  QString::number(e.idleUnits)});
+    }
+    sink.endTable();
+    ctx.progress(100);
+    return true;
+}
+
+bool buildCustomerReport(BuildContext& ctx, ReportSink& sink)
+{
+    const int totalCustomers = countRows(ctx, "SELECT COUNT(*) FROM customers", {});
+    const int newCustomers = countRows(ctx, "SELECT COUNT(*) FROM customers WHERE created_at >= ? AND created_at < ?",
+                                       {ctx.from(), ctx.until()});
+
+    sink.heading(QString("Всего клиентов: %1").arg(totalCustomers));
+    sink.heading(QString("Новых клиентов за период: %1").arg(newCustomers));
+    if (newCustomers == 0) {
+        ctx.progress(100);
+        return true;
+    }
+
+    QSqlQuery query(ctx.db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT name, phone, email, created_at FROM customers "
+                  "WHERE created_at >= ? AND created_at < ? ORDER BY created_at");
+    query.addBindValue(ctx.from());
+    query.addBindValue(ctx.until());
+    if (!query.exec()) {
+        ctx.error = query.lastError().text();
+        return false;
+    }
+
+    RowProgress progress(ctx, newCustomers);
+    sink.beginTable({"Имя", "Телефон", "Email", "Дата регистрации"});
+    while (query.next()) {
+        if (ctx.isCancelled()) return false;
+        sink.row({query.value("name").toString(),
+                  Database::customerField("phone", query.value("phone")),
+                  query.value("email").toString(),
+                  query.value("created_at").toDateTime().toString("dd.MM.yyyy")});
+        progress.step();
+    }
+    sink.endTable();
+    return true;
+}
+
+QMap<QString, double> loadFinancialTotals(BuildContext& ctx, const QDate& from, const QDate& to)
+{
+    // Итоги из rental_daily_stats — не больше строки на день и оборудование
+    QMap<QString, double> totals;
+    QSqlQuery query(ctx.db);
+    query.prepare("SELECT "
+                  "COALESCE(SUM(revenue), 0) AS total_revenue, "
+                  "COALESCE(SUM(deposits), 0) AS total_deposits, "
+                  "COALESCE(SUM(damage), 0) AS total_damage, "
+                  "COALESCE(SUM(cleaning), 0) AS total_cleaning, "
+                  "COALESCE(SUM(rental_count), 0) AS rental_count, "
+                  "COALESCE(SUM(completed_count), 0) AS completed_count, "
+                  "COALESCE(SUM(active_count), 0) AS active_count "
+                  "FROM rental_daily_stats WHERE day >= ? AND day <= ?");
+    query.addBindValue(from.toString(Qt::ISODate));
+    query.addBindValue(to.toString(Qt::ISODate));
+    if (query.exec() && query.next()) {
+        for (const char* field : {"total_revenue", "total_deposits", "total_damage", "total_cleaning",
+                                  "rental_count", "completed_count", "active_count"}) {
+            totals[field] = query.value(field).toDouble();
+        }
+    } else {
+        ctx.error = query.lastError().text();
+    }
+    return totals;
+}
+
+bool buildFinancialReport(BuildContext& ctx, ReportSink& sink)
+{
+    const QDate startDate = ctx.request.start;
+    const QDate endDate = ctx.request.end;
+    QMap<QString, double> current = loadFinancialTotals(ctx, startDate, endDate);
+    ctx.progress(50);
+    QMap<QString, double> previous = loadFinancialTotals(ctx, startDate.addYears(-1), endDate.addYears(-1));
+    ctx.progress(100);
+    if (!ctx.error.isEmpty()) return false;
+
+    const double totalRevenue = current["total_revenue"];
+    const double totalDamage = current["total_damage"];
+    const double totalCleaning = current["total_cleaning"];
+
+    sink.heading("Финансовая статистика");
+    sink.beginTable({"Показатель", "Значение"});
+    sink.row({"Общая выручка", money(totalRevenue) + " ₽"});
+    sink.row({"Общие залоги", money(current["total_deposits"]) + " ₽"});
+    sink.row({"Стоимость повреждений", money(totalDamage) + " ₽"});
+    sink.row({"Стоимость уборки", money(totalCleaning) + " ₽"});
+    sink.row({"Чистая прибыль", money(totalRevenue - totalDamage - totalCleaning) + " ₽"});
+    sink.endTable();
+
+    sink.heading("Статистика аренд");
+    sink.field("Всего аренд", QString::number(qRound(current["rental_count"])));
+    sink.field("Завершенных", QString::number(qRound(current["completed_count"])));
+    sink.field("Активных", QString::number(qRound(current["active_count"])));
+
+    // Сравнение с прошлым годом
+    auto change = [](double now, double before) {
+        if (qFuzzyIsNull(before)) return QString("—");
+        return QString("%1%2%").arg(now >= before ? "+" : "").arg(QString::number((now - before) / before * 100.0, 'f', 1));
+    };
+    sink.heading(QString("Сравнение с периодом %1 - %2")
+                 .arg(startDate.addYears(-1).toString("dd.MM.yyyy"))
+                 .arg(endDate.addYears(-1).toString("dd.MM.yyyy")));
+    sink.beginTable({"Показатель", "Текущий период", "Год назад", "Изменение"});
+    const QList<QPair<QString, QString>> rows = {
+        {"Выручка", "total_revenue"},
+        {"Залоги", "total_deposits"},
+        {"Повреждения", "total_damage"},
+        {"Уборка", "total_cleaning"},
+        {"Количество аренд", "rental_count"}
+    };
+    for (const auto& row : rows) {
+        const bool isMoney = row.second != "rental_count";
+        const double now = current[row.second];
+        const double before = previous[row.second];
+        sink.row({row.first,
+                  isMoney ? money(now) + " ₽" : QString::number(qRound(now)),
+                  isMoney ? money(before) + " ₽" : QString::number(qRound(before)),
+                  change(now, before)});
+    }
+    sink.endTable();
+    return true;
+}
+
+bool buildReport(BuildContext& ctx, ReportSink& sink)
+{
+    if (!sink.begin()) {
+        ctx.error = sink.errorString();
+        return false;
+    }
+
+    const ReportRequest& r = ctx.request;
+    sink.title(r.type);
+    sink.field("Период", QString("%1 - %2").arg(r.start.toString("dd.MM.yyyy")).arg(r.end.toString("dd.MM.yyyy")));
+    sink.field("Дата генерации", QDateTime::currentDateTime().toString("dd.MM.yyyy HH:mm"));
+    sink.separator();
+
+    bool ok = false;
+    if (r.type == "Отчет по арендам")           ok = buildRentalReport(ctx, sink);
+    else if (r.type == "Отчет по оборудованию") ok = buildEquipmentReport(ctx, sink);
+    else if (r.type == "Отчет по клиентам")     ok = buildCustomerReport(ctx, sink);
+    else if (r.type == "Финансовый отчет")      ok = buildFinancialReport(ctx, sink);
+    else ctx.error = QString("Неизвестный тип отчёта: %1").arg(r.type);
+
+    if (!sink.finish() && ok) {
+        ctx.error = sink.errorString();
+        return false;
+    }
+    return ok;
+}
+
+} // namespace
+
+ReportService::ReportService(QObject* parent)
+    : QObject(parent)
+    , m_cache(kCacheCostKb)
+{
+}
+
+ReportService::~ReportService()
+{
+    cancel();
+    for (QThread* thread : m_threads) {
+        thread->wait();
+        delete thread;
+    }
+}
+
+QString ReportService::cacheKey(const ReportRequest& request, const QString& dataVersion)
+{
+    // Текущая дата в ключе: статус «просрочено» меняется и без записи в БД
+    return QString("%1|%2|%3|%4|%5").arg(request.type,
+                                          request.start.toString(Qt::ISODate),
+                                          request.end.toString(Qt::ISODate),
+                                          dataVersion,
+                                          QDate::currentDate().toString(Qt::ISODate));
+}
+
+void ReportService::clearCache()
+{
+    m_cache.clear();
+}
+
+void ReportService::cancel()
+{
+    if (m_cancel) m_cancel->store(true);
+    if (m_activeJob != 0) {
+        m_activeJob = 0;
+        m_activeKey.clear();
+        emit cancelled();
+    }
+}
+
+void ReportService::generate(const ReportRequest& request)
+{
+    const QString key = cacheKey(request, Database::getInstance().dataVersion());
+
+    if (const QString* cached = m_cache.object(key)) {
+        emit finished(request, *cached, true);
+        return;
+    }
+    // Тот же отчёт уже строится — второй клик ничего не повторяет
+    if (m_activeJob != 0 && key == m_activeKey) return;
+
+    startJob(request, key, Output::Preview, QString(), [](QString* preview) {
+        return std::unique_ptr<ReportSink>(new HtmlReportSink(preview, kPreviewRows));
+    });
+}
+
+QString ReportService::pageTitle(const ReportRequest& request)
+{
+    return QString("%1 за %2 — %3").arg(request.type,
+                                       request.start.toString("dd.MM.yyyy"),
+                                       request.end.toString("dd.MM.yyyy"));
+}
+
+void ReportService::exportTo(const ReportRequest& request, const QString& path, ReportFormat format)
+{
+    const PageTemplate page = PageTemplate::report(pageTitle(request));
+    startJob(request, QString(), Output::File, path, [path, format, page](QString*) {
+        std::unique_ptr<ReportSink> sink;
+        switch (format) {
+        case ReportFormat::Html: sink.reset(new HtmlReportSink(path)); break;
+        case ReportFormat::Csv:  sink.reset(new CsvReportSink(path)); break;
+        case ReportFormat::Pdf:  sink.reset(new PdfReportSink(path, page)); break;
+        }
+        return sink;
+    });
+}
+
+void ReportService::print(const ReportRequest& request, QPrinter* printer)
+{
+    // QPainter на QPrinter допустим в рабочем потоке; принтер живёт, пока жива задача
+    std::shared_ptr<QPrinter> owned(printer);
+    const PageTemplate page = PageTemplate::report(pageTitle(request));
+    startJob(request, QString(), Output::Print, QString(), [owned, page](QString*) {
+        return std::unique_ptr<ReportSink>(new PaintedReportSink(owned.get(), page));
+    });
+}
+
+void ReportService::startJob(const ReportRequest& request, const QString& key, Output output,
+                             const QString& path, SinkFactory makeSink)
+{
+    cancel();
+
+    const quint64 jobId = ++m_nextJobId;
+    auto cancelFlag = std::make_shared<std::atomic_bool>(false);
+    m_cancel = cancelFlag;
+    m_activeJob = jobId;
+    m_activeKey = key;
+
+    const QString dbPath = Database::getInstance().getDatabasePath();
+    QThread* thread = QThread::create([this, jobId, key, output, path, request, dbPath, cancelFlag, makeSink]() {
+        const QString connName = QString("report_job_%1").arg(jobId);
+        QString preview;
+        QString error;
+        bool ok = false;
+        {
+            BuildContext ctx;
+            ctx.db = QSqlDatabase::addDatabase("QSQLITE", connName);
+            ctx.db.setDatabaseName(dbPath);
+            ctx.db.setConnectOptions("QSQLITE_OPEN_READONLY");
+            ctx.request = request;
+            ctx.cancel = cancelFlag.get();
+            ctx.progress = [this, jobId](int percent) {
+                QMetaObject::invokeMethod(this, [this, jobId, percent]() {
+                    if (jobId == m_activeJob) emit progress(percent);
+                }, Qt::QueuedConnection);
+            };
+
+            if (!ctx.db.open()) {
+                error = ctx.db.lastError().text();
+            } else if (!Database::getInstance().keyConnection(ctx.db)) {
+                error = "Не удалось открыть зашифрованную базу";
+                ctx.db.close();
+            } else {
+                std::unique_ptr<ReportSink> sink = makeSink(&preview);
+                ok = buildReport(ctx, *sink);
+                error = ctx.error;
+                ctx.db.close();
+            }
+        }
+        QSqlDatabase::removeDatabase(connName);
+
+        const bool wasCancelled = cancelFlag->load();
+        if (!ok && error.isEmpty() && !wasCancelled) error = "Отчёт не построен";
+        if (!ok) preview.clear();
+        QMetaObject::invokeMethod(this, [=]() {
+            onJobDone(jobId, key, output, path, request, preview, error, wasCancelled);
+        }, Qt::QueuedConnection);
+    });
+
+    m_threads.append(thread);
+    connect(thread, &QThread::finished, this, [this, thread]() {
+        m_threads.removeOne(thread);
+        thread->deleteLater();
+    });
+    emit started();
+    thread->start();
+}
+
+void ReportService::onJobDone(quint64 jobId, const QString& key, Output output, const QString& path,
+                              const ReportRequest& request, const QString& html,
+                              const QString& error, bool wasCancelled)
+{
+    // Готовый результат полезен даже если его уже не ждут: ключ учитывает версию данных
+    if (output == Output::Preview && !wasCancelled && error.isEmpty() && !html.isEmpty()) {
+        m_cache.insert(key, new QString(html), qMax<int>(1, html.size() / 512));
+    }
+    if (jobId != m_activeJob) return;
+
+    m_activeJob = 0;
+    m_activeKey.clear();
+    if (wasCancelled) return;
+    if (!error.isEmpty()) {
+        qDebug() << "Ошибка генерации отчёта:" << error;
+        emit failed(error);
+        return;
+    }
+
+    switch (output) {
+    case Output::Preview: emit finished(request, html, false); break;
+    case Output::File:    emit exported(request, path); break;
+    case Output::Print:   emit printed(request); break;
+    }
+}
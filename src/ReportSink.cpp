@@ -0,0 +1,411 @@
+#include "ReportSink.h"
+#include <QFontMetrics>
+#include <QPageLayout>
+#include <QPageSize>
+#include <QPagedPaintDevice>
+#include <QPainter>
+
+namespace {
+const char* kTableOpen =
+    "<table border='1' cellpadding='5' cellspacing='0' style='border-collapse: collapse; width: 100%;'>";
+const char* kHeaderRowOpen = "<tr style='background-color: #1976d2; color: white;'>";
+}
+
+// ---------- HTML ----------
+
+HtmlReportSink::HtmlReportSink(QString* target, int maxRows)
+    : m_maxRows(maxRows)
+{
+    m_out.setString(target, QIODevice::WriteOnly);
+}
+
+HtmlReportSink::HtmlReportSink(const QString& path)
+    : m_file(path)
+    , m_toFile(true)
+    , m_document(true)
+    , m_maxRows(-1)
+{
+}
+
+bool HtmlReportSink::begin()
+{
+    if (m_toFile) {
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            m_error = m_file.errorString();
+            return false;
+        }
+        m_out.setDevice(&m_file);
+        m_out.setEncoding(QStringConverter::Utf8);
+    }
+    if (m_document) {
+        m_out << "<html><head><meta charset='utf-8'></head><body>\n";
+    }
+    return true;
+}
+
+void HtmlReportSink::title(const QString& text)
+{
+    m_out << "<h2>" << text.toHtmlEscaped() << "</h2>\n";
+}
+
+void HtmlReportSink::heading(const QString& text)
+{
+    m_out << "<h3>" << text.toHtmlEscaped() << "</h3>\n";
+}
+
+void HtmlReportSink::field(const QString& label, const QString& value)
+{
+    m_out << "<p><b>" << label.toHtmlEscaped() << ":</b> " << value.toHtmlEscaped() << "</p>\n";
+}
+
+void HtmlReportSink::text(const QString& text)
+{
+    m_out << "<p>" << text.toHtmlEscaped() << "</p>\n";
+}
+
+void HtmlReportSink::separator()
+{
+    m_out << "<hr>\n";
+}
+
+void HtmlReportSink::beginTable(const QStringList& header)
+{
+    m_rowsSkipped = 0;
+    m_out << kTableOpen << '\n';
+    if (header.isEmpty()) return;
+    m_out << kHeaderRowOpen;
+    for (const QString& h : header) m_out << "<th>" << h.toHtmlEscaped() << "</th>";
+    m_out << "</tr>\n";
+}
+
+void HtmlReportSink::row(const QStringList& cells)
+{
+    if (m_maxRows >= 0 && m_rowsWritten >= m_maxRows) {
+        ++m_rowsSkipped;
+        return;
+    }
+    ++m_rowsWritten;
+    m_out << "<tr>";
+    for (const QString& c : cells) m_out << "<td>" << c.toHtmlEscaped() << "</td>";
+    m_out << "</tr>\n";
+}
+
+void HtmlReportSink::endTable()
+{
+    m_out << "</table>\n";
+    if (m_rowsSkipped > 0) {
+        m_out << "<p><i>Показаны не все строки: ещё " << m_rowsSkipped
+              << ". Полный отчёт доступен через «Экспорт».</i></p>\n";
+    }
+}
+
+bool HtmlReportSink::finish()
+{
+    if (m_document) m_out << "</body></html>\n";
+    m_out.flush();
+    if (m_toFile) {
+        m_file.close();
+        if (m_file.error() != QFileDevice::NoError) {
+            m_error = m_file.errorString();
+            return false;
+        }
+    }
+    return true;
+}
+
+// ---------- CSV ----------
+
+CsvReportSink::CsvReportSink(const QString& path)
+    : m_file(path)
+{
+}
+
+bool CsvReportSink::begin()
+{
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_out.setDevice(&m_file);
+    m_out.setEncoding(QStringConverter::Utf8);
+    return true;
+}
+
+void CsvReportSink::writeRecord(const QStringList& cells)
+{
+    auto esc = [](const QString& s){ QString x=s; x.replace("\"","\"\""); return "\"" + x + "\""; };
+    for (int i = 0; i < cells.size(); ++i) {
+        if (i > 0) m_out << ";";
+        m_out << esc(cells.at(i));
+    }
+    m_out << "\n";
+}
+
+void CsvReportSink::heading(const QString& text)
+{
+    if (m_needsGap) m_out << "\n";
+    writeRecord({text});
+    m_needsGap = false;
+}
+
+void CsvReportSink::field(const QString& label, const QString& value)
+{
+    writeRecord({label, value});
+    m_needsGap = true;
+}
+
+void CsvReportSink::beginTable(const QStringList& header)
+{
+    if (m_needsGap) m_out << "\n";
+    if (!header.isEmpty()) writeRecord(header);
+}
+
+void CsvReportSink::row(const QStringList& cells)
+{
+    writeRecord(cells);
+}
+
+void CsvReportSink::endTable()
+{
+    m_needsGap = true;
+}
+
+bool CsvReportSink::finish()
+{
+    m_out.flush();
+    m_file.close();
+    if (m_file.error() != QFileDevice::NoError) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+// ---------- Постраничная отрисовка ----------
+
+PageTemplate PageTemplate::report(const QString& title)
+{
+    PageTemplate page;
+    page.header = title;
+    page.footer = "Стр. %1";
+    return page;
+}
+
+PageTemplate PageTemplate::contract()
+{
+    PageTemplate page;
+    page.header = "Прокат туристического оборудования";
+    page.footer = "Стр. %1";
+    return page;
+}
+
+PaintedReportSink::PaintedReportSink(QPagedPaintDevice* device, const PageTemplate& page)
+    : m_device(device)
+    , m_page(page)
+    , m_titleFont("Arial", 14, QFont::Bold)
+    , m_headingFont("Arial", 11, QFont::Bold)
+    , m_bodyFont("Arial", 9)
+    , m_boldFont("Arial", 9, QFont::Bold)
+    , m_smallFont("Arial", 7)
+{
+}
+
+PaintedReportSink::~PaintedReportSink()
+{
+    endPainting();
+}
+
+void PaintedReportSink::endPainting()
+{
+    if (m_painter && m_painter->isActive()) m_painter->end();
+}
+
+bool PaintedReportSink::begin()
+{
+    if (!m_device) {
+        m_error = "Устройство вывода не задано";
+        return false;
+    }
+    m_device->setPageSize(m_page.pageSize);
+    m_device->setPageMargins(m_page.marginsMm, QPageLayout::Millimeter);
+
+    m_painter = std::make_unique<QPainter>();
+    if (!m_painter->begin(m_device)) {
+        m_error = "Не удалось начать отрисовку";
+        return false;
+    }
+    // Шрифты в пунктах масштабируются под разрешение устройства; метрики
+    // зависят только от него, поэтому считаются один раз на документ
+    m_titleMetrics = std::make_unique<QFontMetrics>(m_titleFont, m_device);
+    m_headingMetrics = std::make_unique<QFontMetrics>(m_headingFont, m_device);
+    m_bodyMetrics = std::make_unique<QFontMetrics>(m_bodyFont, m_device);
+    m_boldMetrics = std::make_unique<QFontMetrics>(m_boldFont, m_device);
+    m_smallMetrics = std::make_unique<QFontMetrics>(m_smallFont, m_device);
+
+    const QRect page = m_painter->viewport();
+    m_pageWidth = page.width();
+    m_pageHeight = page.height();
+    const int decoration = m_smallMetrics->height() * 2;
+    m_contentTop = m_page.header.isEmpty() ? 0 : decoration;
+    m_contentBottom = m_pageHeight - (m_page.footer.isEmpty() ? 0 : decoration);
+    m_pageNumber = 1;
+    drawPageDecorations();
+    m_y = m_contentTop;
+    return true;
+}
+
+void PaintedReportSink::drawPageDecorations()
+{
+    const int lineHeight = m_smallMetrics->height();
+    m_painter->setFont(m_smallFont);
+    m_painter->setPen(Qt::darkGray);
+    if (!m_page.header.isEmpty()) {
+        m_painter->drawText(QRect(0, 0, m_pageWidth, lineHeight), Qt::AlignLeft | Qt::AlignVCenter,
+                            m_smallMetrics->elidedText(m_page.header, Qt::ElideRight, m_pageWidth));
+        m_painter->drawLine(0, lineHeight + lineHeight / 4, m_pageWidth, lineHeight + lineHeight / 4);
+    }
+    if (!m_page.footer.isEmpty()) {
+        const QString footer = m_page.footer.contains("%1") ? m_page.footer.arg(m_pageNumber) : m_page.footer;
+        m_painter->drawText(QRect(0, m_pageHeight - lineHeight, m_pageWidth, lineHeight),
+                            Qt::AlignRight | Qt::AlignVCenter, footer);
+    }
+    m_painter->setPen(Qt::black);
+}
+
+void PaintedReportSink::startPage()
+{
+    m_device->newPage();
+    ++m_pageNumber;
+    drawPageDecorations();
+    m_y = m_contentTop;
+}
+
+bool PaintedReportSink::ensureSpace(int height)
+{
+    if (m_y + height <= m_contentBottom) return false;
+    newPage();
+    return true;
+}
+
+void PaintedReportSink::newPage()
+{
+    startPage();
+    // Шапка таблицы повторяется на каждой странице
+    if (m_inTable && !m_tableHeader.isEmpty()) drawRow(m_tableHeader, true);
+}
+
+void PaintedReportSink::drawLine(const QString& text, const QFont& font, const QFontMetrics& fm,
+                                 int spacingBefore)
+{
+    m_painter->setFont(font);
+    const QRect bounds = fm.boundingRect(QRect(0, 0, m_pageWidth, m_contentBottom - m_contentTop),
+                                         Qt::TextWordWrap, text);
+    if (!ensureSpace(spacingBefore + bounds.height())) m_y += spacingBefore;
+    m_painter->drawText(QRect(0, m_y, m_pageWidth, bounds.height()), Qt::TextWordWrap, text);
+    m_y += bounds.height();
+}
+
+void PaintedReportSink::drawRow(const QStringList& cells, bool header)
+{
+    if (cells.isEmpty()) return;
+    const QFont& font = header ? m_boldFont : m_bodyFont;
+    const QFontMetrics& fm = header ? *m_boldMetrics : *m_bodyMetrics;
+    m_painter->setFont(font);
+    const int padding = fm.height() / 4;
+    const int rowHeight = fm.height() + 2 * padding;
+    const int colWidth = m_pageWidth / cells.size();
+
+    if (m_y + rowHeight > m_contentBottom) {
+        // Переносим строку; для шапки newPage() сам её нарисует
+        startPage();
+        if (!header && !m_tableHeader.isEmpty()) drawRow(m_tableHeader, true);
+        m_painter->setFont(font);
+    }
+
+    for (int i = 0; i < cells.size(); ++i) {
+        const QRect cell(i * colWidth, m_y, colWidth, rowHeight);
+        if (header) m_painter->fillRect(cell, QColor("#1976d2"));
+        m_painter->setPen(header ? Qt::white : Qt::black);
+        m_painter->drawText(cell.adjusted(padding, 0, -padding, 0), Qt::AlignVCenter | Qt::AlignLeft,
+                            fm.elidedText(cells.at(i), Qt::ElideRight, colWidth - 2 * padding));
+        m_painter->setPen(Qt::darkGray);
+        m_painter->drawRect(cell);
+    }
+    m_painter->setPen(Qt::black);
+    m_y += rowHeight;
+}
+
+void PaintedReportSink::title(const QString& text)
+{
+    drawLine(text, m_titleFont, *m_titleMetrics, 0);
+}
+
+void PaintedReportSink::heading(const QString& text)
+{
+    drawLine(text, m_headingFont, *m_headingMetrics, m_bodyMetrics->height());
+}
+
+void PaintedReportSink::field(const QString& label, const QString& value)
+{
+    drawLine(label + ": " + value, m_bodyFont, *m_bodyMetrics, 0);
+}
+
+void PaintedReportSink::text(const QString& text)
+{
+    drawLine(text, m_bodyFont, *m_bodyMetrics, 0);
+}
+
+void PaintedReportSink::separator()
+{
+    const int gap = m_bodyMetrics->height() / 2;
+    ensureSpace(2 * gap);
+    m_y += gap;
+    m_painter->drawLine(0, m_y, m_pageWidth, m_y);
+    m_y += gap;
+}
+
+void PaintedReportSink::pageBreak()
+{
+    if (m_y > m_contentTop) newPage();
+}
+
+void PaintedReportSink::beginTable(const QStringList& header)
+{
+    m_tableHeader = header;
+    m_inTable = true;
+    m_y += m_bodyMetrics->height() / 2;
+    if (!header.isEmpty()) drawRow(header, true);
+}
+
+void PaintedReportSink::row(const QStringList& cells)
+{
+    drawRow(cells, false);
+}
+
+void PaintedReportSink::endTable()
+{
+    m_inTable = false;
+    m_tableHeader.clear();
+}
+
+bool PaintedReportSink::finish()
+{
+    if (!m_painter || !m_painter->isActive()) return false;
+    return m_painter->end();
+}
+
+PdfReportSink::PdfReportSink(const QString& path, const PageTemplate& page)
+    : PaintedReportSink(nullptr, page)
+    , m_writer(path)
+{
+    m_writer.setResolution(page.resolution);
+    setDevice(&m_writer);
+}
+
+PdfReportSink::~PdfReportSink()
+{
+    // m_writer разрушается раньше базового класса: незавершённую отрисовку
+    // (ошибка, отмена) закрываем, пока устройство живо
+    endPainting();
+    setDevice(nullptr);
+}
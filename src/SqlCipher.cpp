@@ -0,0 +1,440 @@
+#include "SqlCipher.h"
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMessageAuthenticationCode>
+#include <QSettings>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QVariant>
+#include <sqlite3.h>
+
+namespace {
+constexpr int kBenchmarkRounds = 5;
+constexpr int kBenchmarkLookups = 200;
+const char* const kExportAlias = "cipher_export";
+
+QString quotePath(const QString& path)
+{
+    QString s = QDir::toNativeSeparators(path);
+    s.replace('\'', "''");
+    return "'" + s + "'";
+}
+
+bool isPowerOfTwo(int value)
+{
+    return value > 0 && (value & (value - 1)) == 0;
+}
+
+SqlCipher::Options readOptions(const QString& prefix, const SqlCipher::Options& defaults)
+{
+    QSettings settings;
+    SqlCipher::Options o;
+    o.enabled = settings.value(prefix + "enabled", defaults.enabled).toBool();
+    o.kdfIter = qMax(0, settings.value(prefix + "kdf_iter", defaults.kdfIter).toInt());
+    o.pageSize = settings.value(prefix + "page_size", defaults.pageSize).toInt();
+    if (!isPowerOfTwo(o.pageSize) || o.pageSize < SqlCipher::kMinPageSize ||
+        o.pageSize > SqlCipher::kMaxPageSize) {
+        o.pageSize = defaults.pageSize;
+    }
+    o.cacheKiB = qMax(0, settings.value(prefix + "cache_kib", defaults.cacheKiB).toInt());
+    return o;
+}
+
+void writeOptions(const QString& prefix, const SqlCipher::Options& o)
+{
+    QSettings settings;
+    settings.setValue(prefix + "enabled", o.enabled);
+    settings.setValue(prefix + "kdf_iter", o.kdfIter);
+    settings.setValue(prefix + "page_size", o.pageSize);
+    settings.setValue(prefix + "cache_kib", o.cacheKiB);
+}
+
+// Запросы окна: списки на вкладках, отчётная статистика и точечные чтения
+// карточек. params — откуда взять значения для запросов с параметром
+struct Workload {
+    const char* name;
+    const char* sql;
+    const char* params;
+};
+
+const Workload kWorkload[] = {
+    {"Клиенты: список", "SELECT * FROM customers ORDER BY name", nullptr},
+    {"Оборудование: список", "SELECT * FROM equipment ORDER BY name", nullptr},
+    {"Аренды с клиентами и оборудованием",
+     "SELECT r.*, c.name, e.name FROM rentals r "
+     "JOIN customers c ON r.customer_id = c.id "
+     "JOIN equipment e ON r.equipment_id = e.id "
+     "ORDER BY r.created_at DESC", nullptr},
+    {"Дневная статистика за год",
+     "SELECT day, SUM(rental_count), SUM(revenue), SUM(units_out) FROM rental_daily_stats "
+     "WHERE day >= date('now', '-1 year') GROUP BY day ORDER BY day", nullptr},
+    {"Карточка клиента по id", "SELECT * FROM customers WHERE id = ?",
+     "SELECT id FROM customers ORDER BY random() LIMIT %1"},
+    {"Аренда по id",
+     "SELECT r.*, c.name, e.name FROM rentals r "
+     "JOIN customers c ON r.customer_id = c.id "
+     "JOIN equipment e ON r.equipment_id = e.id WHERE r.id = ?",
+     "SELECT id FROM rentals ORDER BY random() LIMIT %1"},
+    {"Поиск по телефону", "SELECT id, name FROM customers WHERE phone_bidx = ?",
+     "SELECT phone_bidx FROM customers WHERE phone_bidx IS NOT NULL ORDER BY random() LIMIT %1"},
+};
+constexpr int kWorkloadSize = int(sizeof(kWorkload) / sizeof(kWorkload[0]));
+
+bool cancelled(const std::atomic_bool* cancel)
+{
+    return cancel && cancel->load();
+}
+
+// Соединение драйвера QSQLITE (та же библиотека, что и в BackupService)
+sqlite3* handleOf(QSqlDatabase& db)
+{
+    QVariant v = db.driver()->handle();
+    if (v.isValid() && qstrcmp(v.typeName(), "sqlite3*") == 0) {
+        return *static_cast<sqlite3**>(v.data());
+    }
+    return nullptr;
+}
+
+// sqlcipher_export — один оператор на всю базу; ненулевой ответ
+// обработчика прогресса прерывает его с SQLITE_INTERRUPT
+int exportProgress(void* cancel)
+{
+    return cancelled(static_cast<const std::atomic_bool*>(cancel)) ? 1 : 0;
+}
+
+void removeCopy(const QString& path)
+{
+    QFile::remove(path);
+    QFile::remove(path + "-journal");
+    QFile::remove(path + "-wal");
+    QFile::remove(path + "-shm");
+}
+
+// Все раунды по одной копии: времена складываются в ms[i], открытие — в openMs
+bool runWorkload(const QString& path, const QByteArray& key, const SqlCipher::Options& options,
+                 const QList<QVariantList>& params, QList<double>* ms, double* openMs,
+                 const std::atomic_bool* cancel, QString* error)
+{
+    const QString connection = "sqlcipher_benchmark_run";
+    bool ok = true;
+    for (int round = 0; ok && round < kBenchmarkRounds; ++round) {
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection);
+            db.setDatabaseName(path);
+            db.setConnectOptions("QSQLITE_OPEN_READONLY");
+            QElapsedTimer timer;
+            timer.start();
+            if (!db.open() || !SqlCipher::prepareConnection(db, key, options)) {
+                *error = db.lastError().text();
+                ok = false;
+            } else {
+                *openMs += timer.nsecsElapsed() / 1e6;
+                for (int i = 0; ok && i < kWorkloadSize; ++i) {
+                    if (cancelled(cancel)) { ok = false; break; }
+                    QSqlQuery q(db);
+                    q.setForwardOnly(true);
+                    timer.restart();
+                    if (!q.prepare(kWorkload[i].sql)) {
+                        *error = q.lastError().text();
+                        ok = false;
+                        break;
+                    }
+                    const QVariantList values = kWorkload[i].params ? params.at(i) : QVariantList{QVariant()};
+                    for (const QVariant& value : values) {
+                        if (kWorkload[i].params) q.bindValue(0, value);
+                        if (!q.exec()) {
+                            *error = q.lastError().text();
+                            ok = false;
+                            break;
+                        }
+                        while (q.next()) {}
+                    }
+                    (*ms)[i] += timer.nsecsElapsed() / 1e6;
+                }
+                db.close();
+            }
+        }
+        QSqlDatabase::removeDatabase(connection);
+    }
+    return ok;
+}
+} // namespace
+
+bool SqlCipher::Options::sameFormat(const Options& other) const
+{
+    if (enabled != other.enabled) return false;
+    return !enabled || (kdfIter == other.kdfIter && pageSize == other.pageSize);
+}
+
+SqlCipher::Options SqlCipher::load()
+{
+    return readOptions("database/sqlcipher_", Options());
+}
+
+void SqlCipher::save(const Options& options)
+{
+    writeOptions("database/sqlcipher_", options);
+}
+
+SqlCipher::Options SqlCipher::fileFormat()
+{
+    return readOptions("database/sqlcipher_file_", Options());
+}
+
+void SqlCipher::setFileFormat(const Options& options)
+{
+    writeOptions("database/sqlcipher_file_", options);
+}
+
+bool SqlCipher::isAvailable()
+{
+    static const bool available = []() {
+        const QString connection = "sqlcipher_probe";
+        bool ok = false;
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection);
+            db.setDatabaseName(":memory:");
+            if (db.open()) {
+                QSqlQuery q(db);
+                ok = q.exec("PRAGMA cipher_version") && q.next() && !q.value(0).toString().isEmpty();
+                if (ok) qDebug() << "SQLCipher" << q.value(0).toString();
+                db.close();
+            }
+        }
+        QSqlDatabase::removeDatabase(connection);
+        return ok;
+    }();
+    return available;
+}
+
+bool SqlCipher::isEncryptedFile(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    const QByteArray header = file.read(16);
+    return !header.isEmpty() && header != QByteArray("SQLite format 3\0", 16);
+}
+
+// Ключ файла отделён от ключа полей: утечка одного не раскрывает другой
+QByteArray SqlCipher::deriveKey(const QByteArray& dataKey)
+{
+    if (dataKey.isEmpty()) return QByteArray();
+    return QMessageAuthenticationCode::hash(QByteArrayLiteral("sqlcipher-v1"), dataKey,
+                                            QCryptographicHash::Sha256);
+}
+
+QString SqlCipher::keyLiteral(const QByteArray& key, int kdfIter)
+{
+    const QString hex = QString::fromLatin1(key.toHex());
+    return kdfIter > 0 ? "'" + hex + "'" : "\"x'" + hex + "'\"";
+}
+
+bool SqlCipher::prepareConnection(QSqlDatabase& db, const QByteArray& key, const Options& options)
+{
+    QSqlQuery q(db);
+    if (options.enabled) {
+        if (key.isEmpty()) {
+            qDebug() << "SQLCipher: нет ключа";
+            return false;
+        }
+        if (!q.exec("PRAGMA key = " + keyLiteral(key, options.kdfIter)) ||
+            !q.exec(QString("PRAGMA cipher_page_size = %1").arg(options.pageSize)) ||
+            (options.kdfIter > 0 && !q.exec(QString("PRAGMA kdf_iter = %1").arg(options.kdfIter)))) {
+            qDebug() << "SQLCipher: ошибка установки ключа:" << q.lastError().text();
+            return false;
+        }
+    }
+    // Отрицательное значение — размер в КиБ, а не в страницах
+    q.exec(QString("PRAGMA cache_size = -%1").arg(options.cacheKiB));
+    if (!q.exec("SELECT count(*) FROM sqlite_master")) {
+        qDebug() << "SQLCipher: база не читается (неверный ключ или параметры):" << q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool SqlCipher::attach(QSqlDatabase& db, const QString& path, const QString& alias,
+                       const QByteArray& key, const Options& options)
+{
+    if (options.enabled && key.isEmpty()) return false;
+    QSqlQuery q(db);
+    const QString keyClause = options.enabled ? keyLiteral(key, options.kdfIter) : QString("''");
+    if (!q.exec("ATTACH DATABASE " + quotePath(path) + " AS " + alias + " KEY " + keyClause)) {
+        qDebug() << "SQLCipher: ошибка ATTACH:" << q.lastError().text();
+        return false;
+    }
+    if (options.enabled &&
+        (!q.exec(QString("PRAGMA %1.cipher_page_size = %2").arg(alias).arg(options.pageSize)) ||
+         (options.kdfIter > 0 && !q.exec(QString("PRAGMA %1.kdf_iter = %2").arg(alias).arg(options.kdfIter))))) {
+        qDebug() << "SQLCipher: ошибка параметров" << alias << ":" << q.lastError().text();
+        q.exec("DETACH DATABASE " + alias);
+        return false;
+    }
+    return true;
+}
+
+bool SqlCipher::exportDatabase(QSqlDatabase& db, const QString& targetPath,
+                               const QByteArray& key, const Options& options,
+                               const std::atomic_bool* cancel)
+{
+    if (options.enabled && key.isEmpty()) return false;
+    if (cancelled(cancel)) return false;
+    QFile::remove(targetPath);
+
+    QSqlQuery q(db);
+    const QString alias = QString::fromLatin1(kExportAlias);
+    if (!attach(db, targetPath, alias, key, options)) {
+        qDebug() << "SQLCipher: не удалось создать копию";
+        QFile::remove(targetPath);
+        return false;
+    }
+
+    bool ok = true;
+    sqlite3* handle = cancel ? handleOf(db) : nullptr;
+    if (handle) sqlite3_progress_handler(handle, 1000, &exportProgress, const_cast<std::atomic_bool*>(cancel));
+    ok = ok && q.exec(QString("SELECT sqlcipher_export('%1')").arg(alias));
+    if (handle) sqlite3_progress_handler(handle, 0, nullptr, nullptr);
+    if (!ok && !cancelled(cancel)) qDebug() << "SQLCipher: ошибка экспорта:" << q.lastError().text();
+    q.exec("DETACH DATABASE " + alias);
+
+    ok = ok && !cancelled(cancel);
+    if (!ok) removeCopy(targetPath);
+    return ok;
+}
+
+SqlCipher::BenchmarkReport SqlCipher::benchmark(const QString& workDir, const QString& sourcePath,
+                                                const QByteArray& sourceKey, const Options& sourceFormat,
+                                                const QByteArray& key, const Options& candidate,
+                                                const std::atomic_bool* cancel)
+{
+    BenchmarkReport report;
+    if (!isAvailable()) {
+        report.error = "Драйвер QSQLITE собран без SQLCipher";
+        return report;
+    }
+    if (workDir.isEmpty() || !QFileInfo(workDir).isDir()) {
+        report.error = "Не удалось создать временный каталог";
+        return report;
+    }
+    const QString plainPath = QDir(workDir).filePath("plain.db");
+    const QString cipherPath = QDir(workDir).filePath("cipher.db");
+    // Открытая копия живёт не дольше замера, в том числе при ошибке и отмене
+    struct CopiesGuard {
+        QString plain, cipher;
+        ~CopiesGuard() { removeCopy(plain); removeCopy(cipher); }
+    } copies{plainPath, cipherPath};
+    Options plain = candidate;
+    plain.enabled = false;
+    Options encrypted = candidate;
+    encrypted.enabled = true;
+
+    // Обе копии — из текущей базы; ATTACH внутри транзакции SQLite запрещает,
+    // поэтому записи между экспортами возможны, но на замер они не влияют
+    const QString connection = "sqlcipher_benchmark_source";
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection);
+        db.setDatabaseName(sourcePath);
+        if (!db.open() || !prepareConnection(db, sourceKey, sourceFormat)) {
+            report.error = "Не удалось открыть базу: " + db.lastError().text();
+        } else {
+            if (!exportDatabase(db, plainPath, QByteArray(), plain, cancel) ||
+                !exportDatabase(db, cipherPath, key, encrypted, cancel)) {
+                report.error = cancelled(cancel) ? "Замер прерван" : "Не удалось подготовить копии базы";
+            }
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connection);
+    if (!report.error.isEmpty()) return report;
+    if (cancelled(cancel)) {
+        report.error = "Замер прерван";
+        return report;
+    }
+    report.databaseBytes = QFileInfo(plainPath).size();
+
+    // Значения параметров — одни и те же для обеих копий
+    QList<QVariantList> params;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection);
+        db.setDatabaseName(plainPath);
+        if (db.open()) {
+            for (const Workload& w : kWorkload) {
+                QVariantList values;
+                QSqlQuery q(db);
+                if (w.params && q.exec(QString::fromLatin1(w.params).arg(kBenchmarkLookups))) {
+                    while (q.next()) values.append(q.value(0));
+                }
+                params.append(values);
+            }
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connection);
+    if (params.size() != kWorkloadSize) {
+        report.error = "Не удалось открыть копию базы";
+        return report;
+    }
+
+    QList<double> plainMs, cipherMs;
+    for (int i = 0; i < kWorkloadSize; ++i) {
+        plainMs.append(0);
+        cipherMs.append(0);
+    }
+    // Файловый кэш ОС прогрет экспортом для обеих копий одинаково
+    if (!runWorkload(plainPath, QByteArray(), plain, params, &plainMs, &report.plainOpenMs, cancel, &report.error) ||
+        !runWorkload(cipherPath, key, encrypted, params, &cipherMs, &report.encryptedOpenMs, cancel, &report.error)) {
+        if (cancelled(cancel)) report.error = "Замер прерван";
+        return report;
+    }
+
+    report.rounds = kBenchmarkRounds;
+    report.plainOpenMs /= kBenchmarkRounds;
+    report.encryptedOpenMs /= kBenchmarkRounds;
+    for (int i = 0; i < kWorkloadSize; ++i) {
+        BenchmarkRow row;
+        row.name = QString::fromUtf8(kWorkload[i].name);
+        if (kWorkload[i].params) row.name += QString(" (×%1)").arg(params.at(i).size());
+        row.plainMs = plainMs.at(i) / kBenchmarkRounds;
+        row.encryptedMs = cipherMs.at(i) / kBenchmarkRounds;
+        report.rows.append(row);
+    }
+    report.ok = true;
+    return report;
+}
+
+QString SqlCipher::BenchmarkReport::toText() const
+{
+    if (!ok) return error;
+
+    auto overhead = [](double plain, double encrypted) {
+        if (plain <= 0) return QString("—");
+        return QString("%1%2%").arg(encrypted >= plain ? "+" : "").arg((encrypted / plain - 1) * 100, 0, 'f', 0);
+    };
+
+    QStringList lines;
+    lines << QString("Размер базы: %1 МБ, раундов: %2").arg(databaseBytes / 1048576.0, 0, 'f', 1).arg(rounds);
+    lines << QString("Открытие соединения: %1 мс → %2 мс")
+                 .arg(plainOpenMs, 0, 'f', 1).arg(encryptedOpenMs, 0, 'f', 1);
+    lines << QString();
+    lines << "Запрос: без шифрования → с шифрованием (мс за раунд)";
+    double plainTotal = 0, encryptedTotal = 0;
+    for (const BenchmarkRow& row : rows) {
+        lines << QString("%1: %2 → %3 (%4)")
+                     .arg(row.name)
+                     .arg(row.plainMs, 0, 'f', 1)
+                     .arg(row.encryptedMs, 0, 'f', 1)
+                     .arg(overhead(row.plainMs, row.encryptedMs));
+        plainTotal += row.plainMs;
+        encryptedTotal += row.encryptedMs;
+    }
+    lines << QString();
+    lines << QString("Всего: %1 → %2 мс (%3)")
+                 .arg(plainTotal, 0, 'f', 1).arg(encryptedTotal, 0, 'f', 1)
+                 .arg(overhead(plainTotal, encryptedTotal));
+    return lines.join('\n');
+}
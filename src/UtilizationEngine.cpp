@@ -0,0 +1,202 @@
+#include "UtilizationEngine.h"
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTime>
+#include <algorithm>
+
+namespace {
+
+constexpr qint64 kSecsPerDay = 86400;
+constexpr qint64 kUnixEpochJulianDay = 2440588; // 1970-01-01
+
+qint64 daySeconds(const QDate& date)
+{
+    return (date.toJulianDay() - kUnixEpochJulianDay) * kSecsPerDay;
+}
+
+double percentOf(double used, double capacity)
+{
+    return capacity > 0.0 ? used * 100.0 / capacity : 0.0;
+}
+
+} // namespace
+
+UtilizationEngine::UtilizationEngine(const QDate& start, const QDate& end)
+    : m_start(start)
+    , m_end(end)
+    , m_periodStart(daySeconds(start))
+    , m_periodEnd(daySeconds(end.addDays(1)))
+{
+}
+
+qint64 UtilizationEngine::wallSeconds(const QDateTime& dateTime)
+{
+    return daySeconds(dateTime.date()) + dateTime.time().msecsSinceStartOfDay() / 1000;
+}
+
+void UtilizationEngine::addEquipment(int id, const QString& name, const QString& category, int units)
+{
+    int code;
+    auto it = m_categoryIndex.constFind(category);
+    if (it != m_categoryIndex.constEnd()) {
+        code = it.value();
+    } else {
+        code = m_categories.size();
+        m_categories.append(category);
+        m_categoryIndex.insert(category, code);
+    }
+    m_itemById.insert(id, static_cast<int>(m_items.size()));
+    m_items.push_back({id, name, code, qMax(units, 0)});
+}
+
+void UtilizationEngine::addRental(int equipmentId, qint64 startSecs, qint64 endSecs, int quantity)
+{
+    auto it = m_itemById.constFind(equipmentId);
+    if (it == m_itemById.constEnd() || quantity <= 0) return;
+
+    // Только часть интервала внутри периода
+    const qint64 from = qMax(startSecs, m_periodStart);
+    const qint64 to = qMin(endSecs, m_periodEnd);
+    if (from >= to) return;
+
+    const int item = it.value();
+    const int category = m_items[item].category;
+    m_events.push_back({from, category, item, quantity});
+    m_events.push_back({to, category, item, -quantity});
+}
+
+bool UtilizationEngine::load(const QSqlDatabase& db, QString* error)
+{
+    QSqlQuery equipment(db);
+    equipment.setForwardOnly(true);
+    if (!equipment.exec("SELECT id, name, category, quantity FROM equipment ORDER BY category, name")) {
+        if (error) *error = equipment.lastError().text();
+        return false;
+    }
+    while (equipment.next()) {
+        addEquipment(equipment.value(0).toInt(), equipment.value(1).toString(),
+                     equipment.value(2).toString(), equipment.value(3).toInt());
+    }
+
+    // Активная аренда занимает оборудование до фактического возврата,
+    // поэтому просроченные продлеваются до текущего момента
+    const QDateTime now = QDateTime::currentDateTime();
+    QSqlQuery rentals(db);
+    rentals.setForwardOnly(true);
+    rentals.prepare("SELECT equipment_id, quantity, status, "
+                    "CAST(strftime('%s', start_date) AS INTEGER), "
+                    "CAST(strftime('%s', end_date) AS INTEGER) "
+                    "FROM rentals "
+                    "WHERE status <> 'cancelled' AND start_date < ? "
+                    "AND (end_date >= ? OR status = 'active')");
+    rentals.addBindValue(m_end.addDays(1).toString(Qt::ISODate));
+    rentals.addBindValue(m_start.toString(Qt::ISODate));
+    if (!rentals.exec()) {
+        if (error) *error = rentals.lastError().text();
+        return false;
+    }
+
+    const qint64 nowSecs = wallSeconds(now);
+    m_events.reserve(m_events.size() + 256);
+    while (rentals.next()) {
+        qint64 endSecs = rentals.value(4).toLongLong();
+        if (rentals.value(2).toString() == "active") {
+            endSecs = qMax(endSecs, nowSecs);
+        }
+        addRental(rentals.value(0).toInt(), rentals.value(3).toLongLong(), endSecs,
+                  rentals.value(1).toInt());
+    }
+    return true;
+}
+
+bool UtilizationEngine::compute(UtilizationReport& report, const std::atomic_bool* cancel) const
+{
+    std::vector<Event> events = m_events;
+    // Возвраты раньше выдач в ту же секунду: аренды «встык» не дают ложного пика
+    std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+        if (a.category != b.category) return a.category < b.category;
+        if (a.time != b.time) return a.time < b.time;
+        return a.delta < b.delta;
+    });
+
+    const std::size_t itemCount = m_items.size();
+    std::vector<int> itemOut(itemCount, 0);
+    std::vector<int> itemPeak(itemCount, 0);
+    std::vector<qint64> itemLast(itemCount, 0);
+    std::vector<qint64> itemUsed(itemCount, 0);   // единице-секунды
+    std::vector<int> categoryPeak(m_categories.size(), 0);
+    std::vector<qint64> categoryUsed(m_categories.size(), 0);
+
+    int category = -1;
+    int categoryOut = 0;
+    qint64 categoryLast = 0;
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        if ((i & 0xFFFF) == 0 && cancel && cancel->load(std::memory_order_relaxed)) {
+            return false;
+        }
+        const Event& e = events[i];
+        if (e.category != category) {
+            // Каждая выдача закрыта возвратом, так что к смене категории счётчик нулевой
+            category = e.category;
+            categoryOut = 0;
+            categoryLast = e.time;
+        }
+
+        itemUsed[e.item] += qint64(itemOut[e.item]) * (e.time - itemLast[e.item]);
+        itemLast[e.item] = e.time;
+        itemOut[e.item] += e.delta;
+        itemPeak[e.item] = qMax(itemPeak[e.item], itemOut[e.item]);
+
+        categoryUsed[category] += qint64(categoryOut) * (e.time - categoryLast);
+        categoryLast = e.time;
+        categoryOut += e.delta;
+        categoryPeak[category] = qMax(categoryPeak[category], categoryOut);
+    }
+
+    report = UtilizationReport();
+    report.start = m_start;
+    report.end = m_end;
+    report.days = static_cast<int>((m_periodEnd - m_periodStart) / kSecsPerDay);
+
+    QList<CategoryUtilization> categories;
+    categories.reserve(m_categories.size());
+    for (int c = 0; c < m_categories.size(); ++c) {
+        CategoryUtilization cu;
+        cu.category = m_categories.at(c);
+        cu.usedDays = double(categoryUsed[c]) / kSecsPerDay;
+        cu.peakConcurrent = categoryPeak[c];
+        categories.append(cu);
+    }
+
+    report.items.reserve(static_cast<int>(itemCount));
+    for (std::size_t i = 0; i < itemCount; ++i) {
+        const Item& item = m_items[i];
+        EquipmentUtilization eu;
+        eu.equipmentId = item.id;
+        eu.name = item.name;
+        eu.category = m_categories.at(item.category);
+        eu.units = item.units;
+        eu.capacityDays = double(item.units) * report.days;
+        eu.usedDays = double(itemUsed[i]) / kSecsPerDay;
+        eu.percent = percentOf(eu.usedDays, eu.capacityDays);
+        eu.peakConcurrent = itemPeak[i];
+        eu.idleUnits = qMax(0, item.units - itemPeak[i]);
+        report.items.append(eu);
+
+        CategoryUtilization& cu = categories[item.category];
+        ++cu.items;
+        cu.units += item.units;
+        cu.capacityDays += eu.capacityDays;
+    }
+
+    for (CategoryUtilization& cu : categories) {
+        cu.percent = percentOf(cu.usedDays, cu.capacityDays);
+        cu.idleUnits = qMax(0, cu.units - cu.peakConcurrent);
+        report.totalUnits += cu.units;
+        report.capacityDays += cu.capacityDays;
+        report.usedDays += cu.usedDays;
+    }
+    report.percent = percentOf(report.usedDays, report.capacityDays);
+    report.categories = categories;
+    return true;
+}
@@ -0,0 +1,305 @@
+#include "ZipArchive.h"
+#include <QFile>
+#include <QIODevice>
+#include <QtEndian>
+#include <zlib.h>
+
+namespace {
+
+constexpr quint32 kLocalHeaderSig = 0x04034b50;
+constexpr quint32 kCentralHeaderSig = 0x02014b50;
+constexpr quint32 kEndOfCentralDirSig = 0x06054b50;
+constexpr int kLocalHeaderSize = 30;
+constexpr int kCentralHeaderSize = 46;
+constexpr int kEndOfCentralDirSize = 22;
+constexpr quint16 kFlagDataDescriptor = 0x0008;
+constexpr quint16 kMethodStored = 0;
+constexpr quint16 kMethodDeflate = 8;
+constexpr quint16 kVersion = 20; // 2.0: deflate
+
+quint16 u16(const QByteArray& data, qint64 pos)
+{
+    return qFromLittleEndian<quint16>(data.constData() + pos);
+}
+
+quint32 u32(const QByteArray& data, qint64 pos)
+{
+    return qFromLittleEndian<quint32>(data.constData() + pos);
+}
+
+void put16(QByteArray& out, quint16 value)
+{
+    char buf[2];
+    qToLittleEndian(value, buf);
+    out.append(buf, 2);
+}
+
+void put32(QByteArray& out, quint32 value)
+{
+    char buf[4];
+    qToLittleEndian(value, buf);
+    out.append(buf, 4);
+}
+
+} // namespace
+
+// ---------- Чтение ----------
+
+bool ZipReader::open(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_error = file.errorString();
+        return false;
+    }
+    return setData(file.readAll());
+}
+
+bool ZipReader::setData(const QByteArray& data)
+{
+    m_data = data;
+    m_entries.clear();
+    m_index.clear();
+    m_error.clear();
+    return parseCentralDirectory();
+}
+
+bool ZipReader::parseCentralDirectory()
+{
+    // Конец центрального каталога ищем с хвоста: за ним может быть комментарий до 64 КБ
+    const qint64 size = m_data.size();
+    qint64 eocd = -1;
+    for (qint64 pos = size - kEndOfCentralDirSize; pos >= 0 && pos >= size - kEndOfCentralDirSize - 0xFFFF; --pos) {
+        if (u32(m_data, pos) == kEndOfCentralDirSig) {
+            eocd = pos;
+            break;
+        }
+    }
+    if (eocd < 0) {
+        m_error = "Файл не является ZIP-архивом";
+        return false;
+    }
+
+    const quint16 count = u16(m_data, eocd + 10);
+    const quint32 cdSize = u32(m_data, eocd + 12);
+    const quint32 cdOffset = u32(m_data, eocd + 16);
+    if (count == 0xFFFF || cdOffset == 0xFFFFFFFF || qint64(cdOffset) + cdSize > eocd) {
+        m_error = "ZIP64 и повреждённые архивы не поддерживаются";
+        return false;
+    }
+
+    qint64 pos = cdOffset;
+    m_entries.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        if (pos + kCentralHeaderSize > eocd || u32(m_data, pos) != kCentralHeaderSig) {
+            m_error = "Повреждён центральный каталог ZIP";
+            return false;
+        }
+        ZipEntry entry;
+        entry.flags = u16(m_data, pos + 8);
+        entry.method = u16(m_data, pos + 10);
+        entry.modTime = u16(m_data, pos + 12);
+        entry.modDate = u16(m_data, pos + 14);
+        entry.crc32 = u32(m_data, pos + 16);
+        entry.compressedSize = u32(m_data, pos + 20);
+        entry.uncompressedSize = u32(m_data, pos + 24);
+        const quint16 nameLen = u16(m_data, pos + 28);
+        const quint16 extraLen = u16(m_data, pos + 30);
+        const quint16 commentLen = u16(m_data, pos + 32);
+        entry.localHeaderOffset = u32(m_data, pos + 42);
+        entry.name = m_data.mid(pos + kCentralHeaderSize, nameLen);
+
+        m_index.insert(entry.name, m_entries.size());
+        m_entries.append(entry);
+        pos += kCentralHeaderSize + nameLen + extraLen + commentLen;
+    }
+    return true;
+}
+
+const ZipEntry* ZipReader::find(const QByteArray& name) const
+{
+    auto it = m_index.constFind(name);
+    return it == m_index.constEnd() ? nullptr : &m_entries.at(it.value());
+}
+
+bool ZipReader::rawData(const ZipEntry& entry, QByteArray& out)
+{
+    const qint64 pos = entry.localHeaderOffset;
+    if (pos + kLocalHeaderSize > m_data.size() || u32(m_data, pos) != kLocalHeaderSig) {
+        m_error = QString("Повреждена запись %1").arg(QString::fromUtf8(entry.name));
+        return false;
+    }
+    // Длины имени и extra в локальном заголовке могут отличаться от центральных
+    const qint64 start = pos + kLocalHeaderSize + u16(m_data, pos + 26) + u16(m_data, pos + 28);
+    if (start + entry.compressedSize > m_data.size()) {
+        m_error = QString("Обрезана запись %1").arg(QString::fromUtf8(entry.name));
+        return false;
+    }
+    out = m_data.mid(start, entry.compressedSize);
+    return true;
+}
+
+bool ZipReader::read(const ZipEntry& entry, QByteArray& out)
+{
+    QByteArray raw;
+    if (!rawData(entry, raw)) return false;
+
+    if (entry.method == kMethodStored) {
+        out = raw;
+    } else if (entry.method == kMethodDeflate) {
+        out.resize(entry.uncompressedSize);
+        z_stream zs = {};
+        // Отрицательное окно — «сырой» deflate без заголовка zlib, как в ZIP
+        if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+            m_error = "Не удалось инициализировать zlib";
+            return false;
+        }
+        zs.next_in = reinterpret_cast<Bytef*>(raw.data());
+        zs.avail_in = static_cast<uInt>(raw.size());
+        zs.next_out = reinterpret_cast<Bytef*>(out.data());
+        zs.avail_out = static_cast<uInt>(out.size());
+        const int rc = inflate(&zs, Z_FINISH);
+        const uLong produced = zs.total_out;
+        inflateEnd(&zs);
+        if (rc != Z_STREAM_END || produced != entry.uncompressedSize) {
+            m_error = QString("Ошибка распаковки %1").arg(QString::fromUtf8(entry.name));
+            return false;
+        }
+    } else {
+        m_error = QString("Метод сжатия %1 не поддерживается").arg(entry.method);
+        return false;
+    }
+
+    if (::crc32(0L, reinterpret_cast<const Bytef*>(out.constData()), static_cast<uInt>(out.size()))
+        != entry.crc32) {
+        m_error = QString("Неверная контрольная сумма %1").arg(QString::fromUtf8(entry.name));
+        return false;
+    }
+    return true;
+}
+
+// ---------- Запись ----------
+
+ZipWriter::ZipWriter(QIODevice* device)
+    : m_device(device)
+{
+}
+
+bool ZipWriter::writeLocal(ZipEntry& entry, const QByteArray& payload)
+{
+    // Размеры и CRC известны заранее, дескриптор данных после записи не нужен
+    entry.flags &= ~kFlagDataDescriptor;
+    entry.compressedSize = static_cast<quint32>(payload.size());
+    entry.localHeaderOffset = m_offset;
+
+    QByteArray header;
+    header.reserve(kLocalHeaderSize + entry.name.size());
+    put32(header, kLocalHeaderSig);
+    put16(header, kVersion);
+    put16(header, entry.flags);
+    put16(header, entry.method);
+    put16(header, entry.modTime);
+    put16(header, entry.modDate);
+    put32(header, entry.crc32);
+    put32(header, entry.compressedSize);
+    put32(header, entry.uncompressedSize);
+    put16(header, static_cast<quint16>(entry.name.size()));
+    put16(header, 0);
+    header.append(entry.name);
+
+    if (m_device->write(header) != header.size() || m_device->write(payload) != payload.size()) {
+        m_error = m_device->errorString();
+        return false;
+    }
+    const qint64 next = qint64(m_offset) + header.size() + payload.size();
+    if (next > 0xFFFFFFFFll) {
+        m_error = "Архив больше 4 ГБ требует ZIP64";
+        return false;
+    }
+    m_offset = static_cast<quint32>(next);
+    m_written.append(entry);
+    return true;
+}
+
+bool ZipWriter::addRaw(const ZipEntry& entry, const QByteArray& rawData)
+{
+    ZipEntry copy = entry;
+    return writeLocal(copy, rawData);
+}
+
+bool ZipWriter::addFile(const ZipEntry& like, const QByteArray& data)
+{
+    ZipEntry entry;
+    entry.name = like.name;
+    entry.flags = like.flags & 0x0800; // сохраняем только признак UTF-8 имени
+    entry.method = kMethodDeflate;
+    entry.modTime = like.modTime;
+    entry.modDate = like.modDate;
+    entry.uncompressedSize = static_cast<quint32>(data.size());
+    entry.crc32 = ::crc32(0L, reinterpret_cast<const Bytef*>(data.constData()), static_cast<uInt>(data.size()));
+
+    z_stream zs = {};
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        m_error = "Не удалось инициализировать zlib";
+        return false;
+    }
+    QByteArray compressed;
+    compressed.resize(static_cast<qsizetype>(deflateBound(&zs, static_cast<uLong>(data.size()))));
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    zs.avail_in = static_cast<uInt>(data.size());
+    zs.next_out = reinterpret_cast<Bytef*>(compressed.data());
+    zs.avail_out = static_cast<uInt>(compressed.size());
+    const int rc = deflate(&zs, Z_FINISH);
+    compressed.resize(static_cast<qsizetype>(zs.total_out));
+    deflateEnd(&zs);
+    if (rc != Z_STREAM_END) {
+        m_error = QString("Ошибка сжатия %1").arg(QString::fromUtf8(entry.name));
+        return false;
+    }
+    return writeLocal(entry, compressed);
+}
+
+bool ZipWriter::finish()
+{
+    QByteArray directory;
+    for (const ZipEntry& entry : m_written) {
+        put32(directory, kCentralHeaderSig);
+        put16(directory, kVersion);      // version made by: MS-DOS, 2.0
+        put16(directory, kVersion);
+        put16(directory, entry.flags);
+        put16(directory, entry.method);
+        put16(directory, entry.modTime);
+        put16(directory, entry.modDate);
+        put32(directory, entry.crc32);
+        put32(directory, entry.compressedSize);
+        put32(directory, entry.uncompressedSize);
+        put16(directory, static_cast<quint16>(entry.name.size()));
+        put16(directory, 0);             // extra
+        put16(directory, 0);             // комментарий
+        put16(directory, 0);             // номер диска
+        put16(directory, 0);             // внутренние атрибуты
+        put32(directory, 0);             // внешние атрибуты
+        put32(directory, entry.localHeaderOffset);
+        directory.append(entry.name);
+    }
+    if (m_written.size() > 0xFFFE) {
+        m_error = "Слишком много записей для ZIP без ZIP64";
+        return false;
+    }
+
+    const quint32 directorySize = static_cast<quint32>(directory.size());
+    put32(directory, kEndOfCentralDirSig);
+    put16(directory, 0);
+    put16(directory, 0);
+    put16(directory, static_cast<quint16>(m_written.size()));
+    put16(directory, static_cast<quint16>(m_written.size()));
+    put32(directory, directorySize);
+    put32(directory, m_offset);
+    put16(directory, 0);
+
+    if (m_device->write(directory) != directory.size()) {
+        m_error = m_device->errorString();
+        return false;
+    }
+    return true;
+}
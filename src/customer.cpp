@@ -118,10 +118,10 @@ Customer* Customer::loadById(int id)
         Customer* customer = new Customer();
         customer->m_id = query.value("id").toInt();
         customer->m_name = query.value("name").toString();
-        customer->m_phone = query.value("phone").toString();
+        customer->m_phone = Database::customerField("phone", query.value("phone"));
         customer->m_email = query.value("email").toString();
-        customer->m_passport = query.value("passport").toString();
-        customer->m_address = query.value("address").toString();
+        customer->m_passport = Database::customerField("passport", query.value("passport"));
+        customer->m_address = Database::customerField("address", query.value("address"));
         customer->m_passportIssueDate = query.value("passport_issue_date").toDate();
         customer->m_createdAt = query.value("created_at").toDateTime();
         customer->m_updatedAt = query.value("updated_at").toDateTime();
@@ -141,10 +141,10 @@ QList<Customer*> Customer::search(const QString& searchTerm)
         Customer* customer = new Customer();
         customer->m_id = query.value("id").toInt();
         customer->m_name = query.value("name").toString();
-        customer->m_phone = query.value("phone").toString();
+        customer->m_phone = Database::customerField("phone", query.value("phone"));
         customer->m_email = query.value("email").toString();
-        customer->m_passport = query.value("passport").toString();
-        customer->m_address = query.value("address").toString();
+        customer->m_passport = Database::customerField("passport", query.value("passport"));
+        customer->m_address = Database::customerField("address", query.value("address"));
         customer->m_passportIssueDate = query.value("passport_issue_date").toDate();
         customer->m_createdAt = query.value("created_at").toDateTime();
         customer->m_updatedAt = query.value("updated_at").toDateTime();
@@ -164,10 +164,10 @@ QList<Customer*> Customer::getAll()
         Customer* customer = new Customer();
         customer->m_id = query.value("id").toInt();
         customer->m_name = query.value("name").toString();
-        customer->m_phone = query.value("phone").toString();
+        customer->m_phone = Database::customerField("phone", query.value("phone"));
         customer->m_email = query.value("email").toString();
-        customer->m_passport = query.value("passport").toString();
-        customer->m_address = query.value("address").toString();
+        customer->m_passport = Database::customerField("passport", query.value("passport"));
+        customer->m_address = Database::customerField("address", query.value("address"));
         customer->m_passportIssueDate = query.value("passport_issue_date").toDate();
         customer->m_createdAt = query.value("created_at").toDateTime();
         customer->m_updatedAt = query.value("updated_at").toDateTime();
@@ -1,4 +1,8 @@
 #include "database.h"
+#include "Aead.h"
+#include "BackupService.h"
+#include "BlindIndex.h"
+#include <QRegularExpression>
 
 Database* Database::m_instance = nullptr;
 
@@ -43,7 +47,112 @@ void Database::initialize(const QString& dbPath)
 
 bool Database::setupEncryption()
 {
-    // Шифрование БД отключено. Используется только аутентификация приложения.
+    // Зашифрованный файл открывается только после ввода пароля: ключ выводится
+    // из ключа данных. Параметры — те, с которыми файл шифровали
+    m_cipher = SqlCipher::Options();
+    if (SqlCipher::isEncryptedFile(m_dbPath)) {
+        m_cipher = SqlCipher::fileFormat();
+        m_cipher.enabled = true;
+    }
+    m_cipher.cacheKiB = SqlCipher::load().cacheKiB;
+    return true;
+}
+
+// Приводит файл к настройкам: шифрует открытый, перешифровывает с новыми
+// kdf_iter/размером страницы или расшифровывает, если шифрование выключили.
+// Новый файл пишется рядом и подменяет старый только целиком; при ошибке
+// файл остаётся как был. false — только если файл нечем открыть
+bool Database::applyCipherSettings()
+{
+    const SqlCipher::Options wanted = SqlCipher::load();
+    m_cipher.cacheKiB = wanted.cacheKiB;
+    if (!wanted.enabled && !m_cipher.enabled) {
+        return true;
+    }
+
+    if (!SqlCipher::isAvailable()) {
+        if (m_cipher.enabled) {
+            qDebug() << "Файл БД зашифрован, а драйвер QSQLITE собран без SQLCipher";
+            return false;
+        }
+        qDebug() << "Шифрование БД включено, но драйвер QSQLITE собран без SQLCipher — файл остаётся открытым";
+        return true;
+    }
+    if (m_cipherKey.isEmpty()) {
+        qDebug() << "Нет ключа данных для шифрования БД";
+        return !m_cipher.enabled;
+    }
+    if (m_cipher.sameFormat(wanted)) {
+        return true;
+    }
+
+    const QFileInfo info(m_dbPath);
+    if (!info.exists() || info.size() == 0) {
+        // Новая база сразу создаётся в нужном виде
+        m_cipher = wanted;
+        SqlCipher::setFileFormat(m_cipher);
+        return true;
+    }
+
+    closeDatabase();
+    const QString rekeyPath = m_dbPath + ".rekey";
+    const QString connection = "sqlcipher_rekey";
+    bool ok = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection);
+        db.setDatabaseName(m_dbPath);
+        ok = db.open() && keyConnection(db) &&
+             SqlCipher::exportDatabase(db, rekeyPath, m_cipherKey, wanted);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connection);
+    if (!ok) {
+        qDebug() << "Не удалось перешифровать БД, файл оставлен как был";
+        return true;
+    }
+
+    const QString oldPath = m_dbPath + ".old";
+    QFile::remove(oldPath);
+    QFile::remove(m_dbPath + "-wal");
+    QFile::remove(m_dbPath + "-shm");
+    if (!QFile::rename(m_dbPath, oldPath) || !QFile::rename(rekeyPath, m_dbPath)) {
+        if (!QFile::exists(m_dbPath)) QFile::rename(oldPath, m_dbPath);
+        QFile::remove(rekeyPath);
+        qDebug() << "Не удалось заменить файл БД перешифрованным";
+        return true;
+    }
+    QFile::remove(oldPath);
+
+    m_cipher = wanted;
+    SqlCipher::setFileFormat(m_cipher);
+    qDebug() << (m_cipher.enabled ? "БД зашифрована (SQLCipher)" : "Шифрование БД снято");
+    return true;
+}
+
+bool Database::keyConnection(QSqlDatabase& db) const
+{
+    // Открытый файл — соединение как есть
+    if (!m_cipher.enabled) {
+        return true;
+    }
+    return SqlCipher::prepareConnection(db, m_cipherKey, m_cipher);
+}
+
+bool Database::openConnection()
+{
+    if (!m_db.open()) {
+        qDebug() << "Ошибка открытия базы данных:" << m_db.lastError().text();
+        return false;
+    }
+    if (!keyConnection(m_db)) {
+        m_db.close();
+        return false;
+    }
+    // WAL: читатели (резервная копия, отчёты) не блокируют запись и наоборот
+    QSqlQuery q(m_db);
+    if (!q.exec("PRAGMA journal_mode = WAL")) {
+        qDebug() << "Не удалось включить WAL:" << q.lastError().text();
+    }
     return true;
 }
 
@@ -59,8 +168,30 @@ bool Database::openDatabase(const QString& password)
         }
     }
 
-    if (!m_db.open()) {
-        qDebug() << "Ошибка открытия базы данных:" << m_db.lastError().text();
+    // Ключ файла БД выводится из ключа данных, открытого проверкой пароля
+    m_cipherKey = SqlCipher::deriveKey(Security::dataKey());
+    if (!applyCipherSettings()) {
+        return false;
+    }
+    if (!openStorage()) {
+        return false;
+    }
+    // Ключ данных открыт проверкой пароля — дошифровываем старые строки
+    secureCustomerRows();
+    return true;
+}
+
+bool Database::openStorage()
+{
+    if (m_isOpen) {
+        return true;
+    }
+    if (m_cipher.enabled && m_cipherKey.isEmpty()) {
+        qDebug() << "БД зашифрована: открытие после ввода пароля";
+        return false;
+    }
+    
+    if (!openConnection()) {
         return false;
     }
     
@@ -72,11 +203,55 @@ bool Database::openDatabase(const QString& password)
     }
     
     m_isOpen = true;
+    ++m_openGeneration;
     return true;
 }
 
+void Database::prefetch()
+{
+    if (!m_isOpen || m_prefetch) {
+        return;
+    }
+    
+    // Отдельное соединение только для чтения в своём потоке: проход по
+    // таблицам, которые главное окно читает первым делом, поднимает их
+    // страницы в файловый кэш ОС, пока пользователь вводит пароль
+    const QString path = m_dbPath;
+    m_prefetch = QThread::create([path]() {
+        const QString connection = "prefetch";
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection);
+            db.setDatabaseName(path);
+            db.setConnectOptions("QSQLITE_OPEN_READONLY");
+            if (db.open()) {
+                const QStringList tables = {"customers", "equipment", "rentals",
+                                            "pricing_rules", "rental_daily_stats"};
+                for (const QString& table : tables) {
+                    QSqlQuery q(db);
+                    q.setForwardOnly(true);
+                    if (!q.exec("SELECT * FROM " + table)) continue;
+                    while (q.next()) {
+                        if (QThread::currentThread()->isInterruptionRequested()) break;
+                    }
+                }
+                db.close();
+            }
+        }
+        QSqlDatabase::removeDatabase(connection);
+    });
+    connect(m_prefetch, &QThread::finished, this, [this]() {
+        m_prefetch->deleteLater();
+        m_prefetch = nullptr;
+    });
+    m_prefetch->start(QThread::LowPriority);
+}
+
 void Database::closeDatabase()
 {
+    if (m_prefetch) {
+        m_prefetch->requestInterruption();
+        m_prefetch->wait();
+    }
     if (m_isOpen) {
         m_db.close();
         m_isOpen = false;
@@ -88,12 +263,27 @@ bool Database::isOpen() const
     return m_isOpen;
 }
 
+QString Database::dataVersion()
+{
+    // Счётчик data_version ведут триггеры на бизнес-таблицах: журнал аудита и
+    // служебные записи его не трогают, а изменения из других соединений учитываются
+    QString version = QString::number(m_openGeneration);
+    QSqlQuery query(m_db);
+    if (query.exec("SELECT version FROM data_version WHERE id = 1") && query.next()) {
+        version += "." + query.value(0).toString();
+    }
+    return version;
+}
+
 bool Database::createTables()
 {
     return createCustomersTable() &&
            createEquipmentTable() &&
            createRentalsTable() &&
-           createSettingsTable();
+           createSettingsTable() &&
+           createPricingRulesTable() &&
+           createDailyStatsTable() &&
+           createDataVersionTable();
 }
 
 bool Database::createCustomersTable()
@@ -130,6 +320,39 @@ bool Database::createCustomersTable()
             alter.exec("ALTER TABLE customers ADD COLUMN passport_issue_date DATE");
         }
     }
+    
+    // Слепые индексы зашифрованных телефона и паспорта (см. BlindIndex)
+    QStringList columns;
+    if (pragma.exec("PRAGMA table_info(customers)")) {
+        while (pragma.next()) {
+            columns << pragma.value(1).toString();
+        }
+    }
+    QSqlQuery alter(m_db);
+    if (!columns.contains("phone_bidx")) {
+        alter.exec("ALTER TABLE customers ADD COLUMN phone_bidx TEXT");
+    }
+    if (!columns.contains("passport_bidx")) {
+        alter.exec("ALTER TABLE customers ADD COLUMN passport_bidx TEXT");
+    }
+    const QStringList statements = {
+        "CREATE INDEX IF NOT EXISTS idx_customers_phone_bidx ON customers(phone_bidx)",
+        "CREATE INDEX IF NOT EXISTS idx_customers_passport_bidx ON customers(passport_bidx)",
+        "CREATE TABLE IF NOT EXISTS customer_phone_suffix ("
+        "token TEXT NOT NULL,"
+        "customer_id INTEGER NOT NULL,"
+        "PRIMARY KEY (token, customer_id)"
+        ") WITHOUT ROWID",
+        "CREATE INDEX IF NOT EXISTS idx_customer_phone_suffix_customer ON customer_phone_suffix(customer_id)",
+        "CREATE TRIGGER IF NOT EXISTS trg_customers_suffix_delete AFTER DELETE ON customers BEGIN "
+        "DELETE FROM customer_phone_suffix WHERE customer_id = OLD.id; END"
+    };
+    for (const QString& statement : statements) {
+        if (!query.exec(statement)) {
+            qDebug() << "Ошибка создания индексов customers:" << query.lastError().text();
+            return false;
+        }
+    }
     return true;
 }
 
@@ -201,6 +424,11 @@ bool Database::createRentalsTable()
         return false;
     }
     
+    // Отчёты выбирают аренды по диапазону дат начала
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_rentals_start_date ON rentals (start_date)")) {
+        qDebug() << "Ошибка создания индекса rentals:" << query.lastError().text();
+    }
+    
     return true;
 }
 
@@ -221,50 +449,360 @@ bool Database::createSettingsTable()
     return true;
 }
 
+bool Database::createPricingRulesTable()
+{
+    QSqlQuery query(m_db);
+    // rule_type: season | weekend | long_term | group
+    // equipment_id/category NULL — правило действует на всё оборудование
+    QString sql = "CREATE TABLE IF NOT EXISTS pricing_rules ("
+                  "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                  "rule_type TEXT NOT NULL,"
+                  "equipment_id INTEGER,"
+                  "category TEXT,"
+                  "start_date DATE,"
+                  "end_date DATE,"
+                  "min_days INTEGER NOT NULL DEFAULT 0,"
+                  "min_quantity INTEGER NOT NULL DEFAULT 0,"
+                  "percent REAL NOT NULL DEFAULT 0,"
+                  "active INTEGER NOT NULL DEFAULT 1,"
+                  "created_at DATETIME DEFAULT CURRENT_TIMESTAMP,"
+                  "updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,"
+                  "FOREIGN KEY (equipment_id) REFERENCES equipment (id)"
+                  ")";
+    
+    if (!query.exec(sql)) {
+        qDebug() << "Ошибка создания таблицы pricing_rules:" << query.lastError().text();
+        return false;
+    }
+    
+    return true;
+}
+
+bool Database::createDailyStatsTable()
+{
+    // Агрегаты по дню начала аренды и оборудованию. Таблицу ведут триггеры на
+    // rentals, поэтому отчётам за период не нужно сканировать всю историю аренд.
+    const QStringList statements = {
+        "CREATE TABLE IF NOT EXISTS rental_daily_stats ("
+        "day TEXT NOT NULL,"
+        "equipment_id INTEGER NOT NULL,"
+        "category TEXT,"
+        "rental_count INTEGER NOT NULL DEFAULT 0,"
+        "active_count INTEGER NOT NULL DEFAULT 0,"
+        "completed_count INTEGER NOT NULL DEFAULT 0,"
+        "revenue REAL NOT NULL DEFAULT 0,"
+        "deposits REAL NOT NULL DEFAULT 0,"
+        "damage REAL NOT NULL DEFAULT 0,"
+        "cleaning REAL NOT NULL DEFAULT 0,"
+        "units_out INTEGER NOT NULL DEFAULT 0,"
+        "PRIMARY KEY (day, equipment_id)"
+        ")",
+        "CREATE INDEX IF NOT EXISTS idx_rental_daily_stats_category ON rental_daily_stats (category, day)",
+
+        "CREATE TRIGGER IF NOT EXISTS trg_rentals_stats_insert AFTER INSERT ON rentals BEGIN "
+        "INSERT INTO rental_daily_stats (day, equipment_id, category, rental_count, active_count, "
+        "completed_count, revenue, deposits, damage, cleaning, units_out) VALUES ("
+        "substr(NEW.start_date, 1, 10), NEW.equipment_id, "
+        "(SELECT category FROM equipment WHERE id = NEW.equipment_id), 1, "
+        "NEW.status = 'active', NEW.status = 'completed', NEW.total_price, NEW.deposit, "
+        "COALESCE(NEW.damage_cost, 0), COALESCE(NEW.cleaning_cost, 0), NEW.quantity) "
+        "ON CONFLICT (day, equipment_id) DO UPDATE SET "
+        "rental_count = rental_count + excluded.rental_count, "
+        "active_count = active_count + excluded.active_count, "
+        "completed_count = completed_count + excluded.completed_count, "
+        "revenue = revenue + excluded.revenue, "
+        "deposits = deposits + excluded.deposits, "
+        "damage = damage + excluded.damage, "
+        "cleaning = cleaning + excluded.cleaning, "
+        "units_out = units_out + excluded.units_out; "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS trg_rentals_stats_delete AFTER DELETE ON rentals BEGIN "
+        "UPDATE rental_daily_stats SET "
+        "rental_count = rental_count - 1, "
+        "active_count = active_count - (OLD.status = 'active'), "
+        "completed_count = completed_count - (OLD.status = 'completed'), "
+        "revenue = revenue - OLD.total_price, "
+        "deposits = deposits - OLD.deposit, "
+        "damage = damage - COALESCE(OLD.damage_cost, 0), "
+        "cleaning = cleaning - COALESCE(OLD.cleaning_cost, 0), "
+        "units_out = units_out - OLD.quantity "
+        "WHERE day = substr(OLD.start_date, 1, 10) AND equipment_id = OLD.equipment_id; "
+        "DELETE FROM rental_daily_stats WHERE day = substr(OLD.start_date, 1, 10) "
+        "AND equipment_id = OLD.equipment_id AND rental_count <= 0; "
+        "END",
+
+        // Обновление = снять старые значения и добавить новые (день/оборудование могли смениться)
+        "CREATE TRIGGER IF NOT EXISTS trg_rentals_stats_update AFTER UPDATE OF "
+        "equipment_id, quantity, start_date, total_price, deposit, damage_cost, cleaning_cost, status "
+        "ON rentals BEGIN "
+        "UPDATE rental_daily_stats SET "
+        "rental_count = rental_count - 1, "
+        "active_count = active_count - (OLD.status = 'active'), "
+        "completed_count = completed_count - (OLD.status = 'completed'), "
+        "revenue = revenue - OLD.total_price, "
+        "deposits = deposits - OLD.deposit, "
+        "damage = damage - COALESCE(OLD.damage_cost, 0), "
+        "cleaning = cleaning - COALESCE(OLD.cleaning_cost, 0), "
+        "units_out = units_out - OLD.quantity "
+        "WHERE day = substr(OLD.start_date, 1, 10) AND equipment_id = OLD.equipment_id; "
+        "INSERT INTO rental_daily_stats (day, equipment_id, category, rental_count, active_count, "
+        "completed_count, revenue, deposits, damage, cleaning, units_out) VALUES ("
+        "substr(NEW.start_date, 1, 10), NEW.equipment_id, "
+        "(SELECT category FROM equipment WHERE id = NEW.equipment_id), 1, "
+        "NEW.status = 'active', NEW.status = 'completed', NEW.total_price, NEW.deposit, "
+        "COALESCE(NEW.damage_cost, 0), COALESCE(NEW.cleaning_cost, 0), NEW.quantity) "
+        "ON CONFLICT (day, equipment_id) DO UPDATE SET "
+        "rental_count = rental_count + excluded.rental_count, "
+        "active_count = active_count + excluded.active_count, "
+        "completed_count = completed_count + excluded.completed_count, "
+        "revenue = revenue + excluded.revenue, "
+        "deposits = deposits + excluded.deposits, "
+        "damage = damage + excluded.damage, "
+        "cleaning = cleaning + excluded.cleaning, "
+        "units_out = units_out + excluded.units_out; "
+        "DELETE FROM rental_daily_stats WHERE day = substr(OLD.start_date, 1, 10) "
+        "AND equipment_id = OLD.equipment_id AND rental_count <= 0; "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS trg_equipment_stats_category AFTER UPDATE OF category ON equipment BEGIN "
+        "UPDATE rental_daily_stats SET category = NEW.category WHERE equipment_id = NEW.id; "
+        "END"
+    };
+    
+    for (const QString& sql : statements) {
+        QSqlQuery query(m_db);
+        if (!query.exec(sql)) {
+            qDebug() << "Ошибка создания rental_daily_stats:" << query.lastError().text();
+            return false;
+        }
+    }
+    
+    // Первое открытие старой БД: триггеров ещё не было, заполняем таблицу целиком
+    QSqlQuery check(m_db);
+    if (check.exec("SELECT (SELECT COUNT(*) FROM rental_daily_stats), (SELECT COUNT(*) FROM rentals)") &&
+        check.next() && check.value(0).toInt() == 0 && check.value(1).toInt() > 0) {
+        return rebuildDailyStats();
+    }
+    
+    return true;
+}
+
+bool Database::createDataVersionTable()
+{
+    QStringList statements = {
+        "CREATE TABLE IF NOT EXISTS data_version ("
+        "id INTEGER PRIMARY KEY CHECK (id = 1),"
+        "version INTEGER NOT NULL DEFAULT 0"
+        ")",
+        "INSERT OR IGNORE INTO data_version (id, version) VALUES (1, 0)"
+    };
+    for (const char* table : {"customers", "equipment", "rentals", "pricing_rules"}) {
+        for (const char* event : {"INSERT", "UPDATE", "DELETE"}) {
+            statements << QString("CREATE TRIGGER IF NOT EXISTS trg_%1_version_%2 AFTER %3 ON %1 BEGIN "
+                                  "UPDATE data_version SET version = version + 1 WHERE id = 1; END")
+                          .arg(table, QString(event).toLower(), event);
+        }
+    }
+    
+    for (const QString& sql : statements) {
+        QSqlQuery query(m_db);
+        if (!query.exec(sql)) {
+            qDebug() << "Ошибка создания data_version:" << query.lastError().text();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
 // Customer operations
 bool Database::addCustomer(const QString& name, const QString& phone, const QString& email,
                           const QString& passport, const QString& address, const QDate& passportIssueDate)
 {
+    SealedCustomer sealed;
+    if (!sealCustomerFields(phone, passport, address, &sealed)) {
+        return false;
+    }
+    
+    // Строка клиента и токены окончаний телефона — атомарно; SAVEPOINT,
+    // а не BEGIN: вызов может прийти из уже открытой транзакции
     QSqlQuery query(m_db);
-    query.prepare("INSERT INTO customers (name, phone, email, passport, address, passport_issue_date) "
-                  "VALUES (?, ?, ?, ?, ?, ?)");
+    query.exec("SAVEPOINT customer_write");
+    query.prepare("INSERT INTO customers (name, phone, email, passport, address, passport_issue_date, "
+                  "phone_bidx, passport_bidx) VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
     query.addBindValue(name);
-    query.addBindValue(phone);
+    query.addBindValue(sealed.phone);
     query.addBindValue(email);
-    query.addBindValue(passport);
-    query.addBindValue(address);
+    query.addBindValue(sealed.passport);
+    query.addBindValue(sealed.address);
     if (passportIssueDate.isValid()) query.addBindValue(passportIssueDate); else query.addBindValue(QVariant());
+    query.addBindValue(sealed.phoneIndex);
+    query.addBindValue(sealed.passportIndex);
 
     if (!query.exec()) {
         qDebug() << "Ошибка добавления клиента:" << query.lastError().text()
                  << ", driver:" << query.lastError().driverText()
                  << ", db:" << query.lastError().databaseText()
                  << ", with params";
+        releaseSavepoint(false);
         return false;
     }
-    return true;
+    // customer_phone_suffix — WITHOUT ROWID: last_insert_rowid() остаётся id клиента
+    const bool ok = writePhoneSuffixes(query.lastInsertId().toInt(), sealed.phoneSuffixes);
+    return releaseSavepoint(ok) && ok;
 }
 
 bool Database::updateCustomer(int id, const QString& name, const QString& phone,
                              const QString& email, const QString& passport, const QString& address, const QDate& passportIssueDate)
 {
+    SealedCustomer sealed;
+    if (!sealCustomerFields(phone, passport, address, &sealed)) {
+        return false;
+    }
+    
     QSqlQuery query(m_db);
+    query.exec("SAVEPOINT customer_write");
     query.prepare("UPDATE customers SET name = ?, phone = ?, email = ?, passport = ?, "
-                  "address = ?, passport_issue_date = ?, updated_at = CURRENT_TIMESTAMP WHERE id = ?");
+                  "address = ?, passport_issue_date = ?, phone_bidx = ?, passport_bidx = ?, "
+                  "updated_at = CURRENT_TIMESTAMP WHERE id = ?");
     query.addBindValue(name);
-    query.addBindValue(phone);
+    query.addBindValue(sealed.phone);
     query.addBindValue(email);
-    query.addBindValue(passport);
-    query.addBindValue(address);
+    query.addBindValue(sealed.passport);
+    query.addBindValue(sealed.address);
     if (passportIssueDate.isValid()) query.addBindValue(passportIssueDate); else query.addBindValue(QVariant());
+    query.addBindValue(sealed.phoneIndex);
+    query.addBindValue(sealed.passportIndex);
     query.addBindValue(id);
     
     if (!query.exec()) {
         qDebug() << "Ошибка обновления клиента:" << query.lastError().text();
+        releaseSavepoint(false);
+        return false;
+    }
+    if (query.numRowsAffected() <= 0) {
+        releaseSavepoint(false);
         return false;
     }
     
-    return query.numRowsAffected() > 0;
+    const bool ok = writePhoneSuffixes(id, sealed.phoneSuffixes);
+    return releaseSavepoint(ok) && ok;
+}
+
+// Телефон, паспорт и адрес хранятся зашифрованными (Security::encryptField),
+// контекст — имя колонки: шифртекст нельзя незаметно переставить в другое
+// поле. Для телефона и паспорта рядом пишутся слепые индексы (BlindIndex)
+bool Database::sealCustomerFields(const QString& phone, const QString& passport, const QString& address,
+                                  SealedCustomer* out)
+{
+    if (!Security::encryptField(phone, "customers.phone", &out->phone) ||
+        !Security::encryptField(passport, "customers.passport", &out->passport) ||
+        !Security::encryptField(address, "customers.address", &out->address)) {
+        qDebug() << "Ошибка шифрования данных клиента";
+        return false;
+    }
+    const QString phoneIndex = BlindIndex::phoneToken(phone);
+    const QString passportIndex = BlindIndex::passportToken(passport);
+    out->phoneIndex = phoneIndex.isEmpty() ? QVariant() : QVariant(phoneIndex);
+    out->passportIndex = passportIndex.isEmpty() ? QVariant() : QVariant(passportIndex);
+    out->phoneSuffixes = BlindIndex::phoneSuffixTokens(phone);
+    return true;
+}
+
+bool Database::writePhoneSuffixes(int customerId, const QStringList& tokens)
+{
+    QSqlQuery query(m_db);
+    query.prepare("DELETE FROM customer_phone_suffix WHERE customer_id = ?");
+    query.addBindValue(customerId);
+    if (!query.exec()) {
+        qDebug() << "Ошибка обновления индекса телефона:" << query.lastError().text();
+        return false;
+    }
+    query.prepare("INSERT OR IGNORE INTO customer_phone_suffix (token, customer_id) VALUES (?, ?)");
+    for (const QString& token : tokens) {
+        query.addBindValue(token);
+        query.addBindValue(customerId);
+        if (!query.exec()) {
+            qDebug() << "Ошибка обновления индекса телефона:" << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Database::releaseSavepoint(bool commit)
+{
+    QSqlQuery query(m_db);
+    if (!commit) {
+        query.exec("ROLLBACK TO customer_write");
+    }
+    return query.exec("RELEASE customer_write");
+}
+
+QString Database::customerField(const QString& column, const QVariant& stored)
+{
+    return Security::decryptField(stored.toString(), "customers." + column);
+}
+
+bool Database::secureCustomerRows()
+{
+    if (!Security::hasDataKey()) {
+        return false;
+    }
+    
+    // Строки, записанные до шифрования полей или без слепых индексов,
+    // дошифровываются и индексируются один раз одной транзакцией
+    QSqlQuery select(m_db);
+    if (!select.exec("SELECT id, phone, passport, address FROM customers WHERE "
+                     "(phone <> '' AND (phone NOT LIKE 'enc1:%' OR phone_bidx IS NULL)) "
+                     "OR (passport <> '' AND (passport NOT LIKE 'enc1:%' OR passport_bidx IS NULL)) "
+                     "OR (address <> '' AND address NOT LIKE 'enc1:%')")) {
+        qDebug() << "Ошибка выборки клиентов для шифрования:" << select.lastError().text();
+        return false;
+    }
+    QList<QPair<int, SealedCustomer>> rows;
+    while (select.next()) {
+        const QString phone = customerField("phone", select.value(1));
+        const QString passport = customerField("passport", select.value(2));
+        const QString address = customerField("address", select.value(3));
+        if ((phone.isEmpty() && !select.value(1).toString().isEmpty()) ||
+            (passport.isEmpty() && !select.value(2).toString().isEmpty()) ||
+            (address.isEmpty() && !select.value(3).toString().isEmpty())) {
+            qDebug() << "Клиент" << select.value(0).toInt() << "пропущен: поле не расшифровано";
+            continue;
+        }
+        SealedCustomer sealed;
+        if (!sealCustomerFields(phone, passport, address, &sealed)) {
+            return false;
+        }
+        rows.append({select.value(0).toInt(), sealed});
+    }
+    if (rows.isEmpty()) {
+        return true;
+    }
+    
+    if (!beginTransaction()) {
+        return false;
+    }
+    QSqlQuery update(m_db);
+    update.prepare("UPDATE customers SET phone = ?, passport = ?, address = ?, "
+                   "phone_bidx = ?, passport_bidx = ? WHERE id = ?");
+    for (const auto& row : rows) {
+        update.addBindValue(row.second.phone);
+        update.addBindValue(row.second.passport);
+        update.addBindValue(row.second.address);
+        update.addBindValue(row.second.phoneIndex);
+        update.addBindValue(row.second.passportIndex);
+        update.addBindValue(row.first);
+        if (!update.exec() || !writePhoneSuffixes(row.first, row.second.phoneSuffixes)) {
+            qDebug() << "Ошибка шифрования данных клиентов:" << update.lastError().text();
+            rollbackTransaction();
+            return false;
+        }
+    }
+    qDebug() << "Зашифрованы и проиндексированы данные" << rows.size() << "клиентов";
+    return commitTransaction();
 }
 
 bool Database::deleteCustomer(int id)
@@ -299,14 +837,41 @@ QSqlQuery Database::getCustomerById(int id)
 
 QSqlQuery Database::searchCustomers(const QString& searchTerm)
 {
+    // Телефон и паспорт зашифрованы: номер из цифр ищется только по слепым
+    // индексам — полный телефон и паспорт по колонкам *_bidx, последние
+    // 4–10 цифр телефона по токенам окончаний. SQLite объединяет их как
+    // MULTI-INDEX OR, без прохода по таблице. Текст ищется по подстроке
+    // в открытых имени и email
+    static const QRegularExpression numberLike(R"(^[\d\s()+-]+$)");
+    const QString digits = BlindIndex::normalizePassport(searchTerm);
+    QStringList conditions;
+    QVariantList binds;
+    if (numberLike.match(searchTerm).hasMatch() && digits.size() >= BlindIndex::kMinSuffix) {
+        if (BlindIndex::normalizePhone(searchTerm).size() == 11) {
+            conditions << "phone_bidx = ?";
+            binds << BlindIndex::phoneToken(searchTerm);
+        }
+        if (digits.size() == 10) {
+            conditions << "passport_bidx = ?";
+            binds << BlindIndex::passportToken(searchTerm);
+        }
+        const QString suffix = BlindIndex::suffixToken(searchTerm);
+        if (!suffix.isEmpty()) {
+            conditions << "id IN (SELECT customer_id FROM customer_phone_suffix WHERE token = ?)";
+            binds << suffix;
+        }
+    }
+    if (conditions.isEmpty()) {
+        const QString pattern = "%" + searchTerm + "%";
+        conditions << "name LIKE ?" << "email LIKE ?";
+        binds << pattern << pattern;
+    }
+    
     QSqlQuery query(m_db);
-    query.prepare("SELECT * FROM customers WHERE name LIKE ? OR phone LIKE ? OR email LIKE ? "
-                  "OR passport LIKE ? ORDER BY name");
-    QString pattern = "%" + searchTerm + "%";
-    query.addBindValue(pattern);
-    query.addBindValue(pattern);
-    query.addBindValue(pattern);
-    query.addBindValue(pattern);
+    query.prepare("SELECT * FROM customers WHERE " + conditions.join(" OR ") + " ORDER BY name");
+    for (const QVariant& value : binds) {
+        query.addBindValue(value);
+    }
     query.exec();
     return query;
 }
@@ -417,6 +982,125 @@ bool Database::updateEquipmentQuantity(int id, int newQuantity)
     return query.numRowsAffected() > 0;
 }
 
+bool Database::releaseEquipmentQuantity(int id, int quantity)
+{
+    QSqlQuery query(m_db);
+    query.prepare("UPDATE equipment SET available_quantity = MIN(quantity, available_quantity + ?), "
+                  "updated_at = CURRENT_TIMESTAMP WHERE id = ?");
+    query.addBindValue(quantity);
+    query.addBindValue(id);
+    
+    if (!query.exec()) {
+        qDebug() << "Ошибка возврата оборудования на склад:" << query.lastError().text();
+        return false;
+    }
+    
+    return query.numRowsAffected() > 0;
+}
+
+QSqlQuery Database::getEquipmentPricing(const QList<int>& ids)
+{
+    QSqlQuery query(m_db);
+    if (ids.isEmpty()) {
+        return query;
+    }
+    
+    QStringList placeholders;
+    for (int i = 0; i < ids.size(); ++i) {
+        placeholders << "?";
+    }
+    query.prepare("SELECT id, category, price, additional_day_price FROM equipment "
+                  "WHERE id IN (" + placeholders.join(", ") + ")");
+    for (int id : ids) {
+        query.addBindValue(id);
+    }
+    query.exec();
+    return query;
+}
+
+// Pricing rules
+int Database::addPricingRule(const QString& ruleType, int equipmentId, const QString& category,
+                             const QDate& startDate, const QDate& endDate, int minDays,
+                             int minQuantity, double percent, bool active)
+{
+    QSqlQuery query(m_db);
+    query.prepare("INSERT INTO pricing_rules (rule_type, equipment_id, category, start_date, end_date, "
+                  "min_days, min_quantity, percent, active) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    query.addBindValue(ruleType);
+    query.addBindValue(equipmentId > 0 ? QVariant(equipmentId) : QVariant());
+    query.addBindValue(category.isEmpty() ? QVariant() : QVariant(category));
+    query.addBindValue(startDate.isValid() ? QVariant(startDate.toString(Qt::ISODate)) : QVariant());
+    query.addBindValue(endDate.isValid() ? QVariant(endDate.toString(Qt::ISODate)) : QVariant());
+    query.addBindValue(minDays);
+    query.addBindValue(minQuantity);
+    query.addBindValue(percent);
+    query.addBindValue(active ? 1 : 0);
+    
+    if (!query.exec()) {
+        qDebug() << "Ошибка добавления правила тарифа:" << query.lastError().text();
+        return -1;
+    }
+    
+    return query.lastInsertId().toInt();
+}
+
+bool Database::updatePricingRule(int id, const QString& ruleType, int equipmentId, const QString& category,
+                                 const QDate& startDate, const QDate& endDate, int minDays,
+                                 int minQuantity, double percent, bool active)
+{
+    QSqlQuery query(m_db);
+    query.prepare("UPDATE pricing_rules SET rule_type = ?, equipment_id = ?, category = ?, start_date = ?, "
+                  "end_date = ?, min_days = ?, min_quantity = ?, percent = ?, active = ?, "
+                  "updated_at = CURRENT_TIMESTAMP WHERE id = ?");
+    query.addBindValue(ruleType);
+    query.addBindValue(equipmentId > 0 ? QVariant(equipmentId) : QVariant());
+    query.addBindValue(category.isEmpty() ? QVariant() : QVariant(category));
+    query.addBindValue(startDate.isValid() ? QVariant(startDate.toString(Qt::ISODate)) : QVariant());
+    query.addBindValue(endDate.isValid() ? QVariant(endDate.toString(Qt::ISODate)) : QVariant());
+    query.addBindValue(minDays);
+    query.addBindValue(minQuantity);
+    query.addBindValue(percent);
+    query.addBindValue(active ? 1 : 0);
+    query.addBindValue(id);
+    
+    if (!query.exec()) {
+        qDebug() << "Ошибка обновления правила тарифа:" << query.lastError().text();
+        return false;
+    }
+    
+    return query.numRowsAffected() > 0;
+}
+
+bool Database::deletePricingRule(int id)
+{
+    QSqlQuery query(m_db);
+    query.prepare("DELETE FROM pricing_rules WHERE id = ?");
+    query.addBindValue(id);
+    
+    if (!query.exec()) {
+        qDebug() << "Ошибка удаления правила тарифа:" << query.lastError().text();
+        return false;
+    }
+    
+    return query.numRowsAffected() > 0;
+}
+
+QSqlQuery Database::getPricingRules()
+{
+    QSqlQuery query(m_db);
+    query.exec("SELECT * FROM pricing_rules ORDER BY id");
+    return query;
+}
+
+QSqlQuery Database::getPricingRuleById(int id)
+{
+    QSqlQuery query(m_db);
+    query.prepare("SELECT * FROM pricing_rules WHERE id = ?");
+    query.addBindValue(id);
+    query.exec();
+    return query;
+}
+
 // Rental operations
 bool Database::addRental(int customerId, int equipmentId, int quantity,
                         const QDateTime& startDate, const QDateTime& endDate,
@@ -467,7 +1151,8 @@ bool Database::completeRental(int id, double damageCost, double cleaningCost,
 {
     QSqlQuery query(m_db);
     query.prepare("UPDATE rentals SET damage_cost = ?, cleaning_cost = ?, final_deposit = ?, "
-                  "status = 'completed', notes = ?, updated_at = CURRENT_TIMESTAMP WHERE id = ?");
+                  "status = 'completed', notes = ?, updated_at = CURRENT_TIMESTAMP "
+                  "WHERE id = ? AND status = 'active'");
     query.addBindValue(damageCost);
     query.addBindValue(cleaningCost);
     query.addBindValue(finalDeposit);
@@ -479,7 +1164,8 @@ bool Database::completeRental(int id, double damageCost, double cleaningCost,
         return false;
     }
     
-    return query.numRowsAffected() > 0;
+    // 0 строк — аренду уже вернули из другого места: второй возврат не проводим
+    return query.numRowsAffected() == 1;
 }
 
 bool Database::deleteRental(int id)
@@ -532,6 +1218,13 @@ QSqlQuery Database::getActiveRentals()
     return query;
 }
 
+QSqlQuery Database::getActiveRentalDeadlines()
+{
+    QSqlQuery query(m_db);
+    query.exec("SELECT id, end_date FROM rentals WHERE status = 'active'");
+    return query;
+}
+
 QSqlQuery Database::getRentalsByCustomer(int customerId)
 {
     QSqlQuery query(m_db);
@@ -561,6 +1254,157 @@ QSqlQuery Database::getRentalsByDateRange(const QDateTime& start, const QDateTim
     return query;
 }
 
+QSqlQuery Database::getRentalAnalyticsRows(const QDateTime& start, const QDateTime& end)
+{
+    // Только колонки, нужные аналитике; тот же отбор, что и getRentalsByDateRange
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    // Выручка завершённой аренды — как в RentalSnapshot: completeRental
+    // пишет ущерб и чистку, final_price при возврате не заполняется
+    query.prepare("SELECT r.status, r.quantity, r.end_date, r.total_price, "
+                  "r.total_price + IFNULL(r.damage_cost, 0) + IFNULL(r.cleaning_cost, 0) AS completed_price, "
+                  "r.deposit, c.name as customer_name, e.category as equipment_category "
+                  "FROM rentals r "
+                  "JOIN customers c ON r.customer_id = c.id "
+                  "JOIN equipment e ON r.equipment_id = e.id "
+                  "WHERE r.start_date >= ? AND r.start_date <= ?");
+    query.addBindValue(start);
+    query.addBindValue(end);
+    query.exec();
+    return query;
+}
+
+QSqlQuery Database::getRentalSnapshotRows(const QList<int>& ids)
+{
+    // Даты сразу переводятся в юлианский день (как QDate::toJulianDay),
+    // чтобы не разбирать строки дат на стороне приложения
+    QString sql = "SELECT r.id, r.customer_id, r.equipment_id, r.quantity, "
+                  "CAST(julianday(substr(r.start_date, 1, 10)) + 0.5 AS INTEGER) as start_day, "
+                  "CAST(julianday(substr(r.end_date, 1, 10)) + 0.5 AS INTEGER) as end_day, "
+                  "r.status, r.total_price, r.final_price, r.deposit, r.damage_cost, r.cleaning_cost, "
+                  "e.category as equipment_category "
+                  "FROM rentals r "
+                  "LEFT JOIN equipment e ON r.equipment_id = e.id";
+    if (!ids.isEmpty()) {
+        QStringList placeholders;
+        for (int i = 0; i < ids.size(); ++i) {
+            placeholders << "?";
+        }
+        sql += " WHERE r.id IN (" + placeholders.join(", ") + ")";
+    }
+
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    query.prepare(sql);
+    for (int id : ids) {
+        query.addBindValue(id);
+    }
+    query.exec();
+    return query;
+}
+
+QSqlQuery Database::getDashboardActiveRentals()
+{
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    query.exec("SELECT r.id, r.quantity, r.total_price, r.deposit, r.end_date, e.category "
+               "FROM rentals r "
+               "LEFT JOIN equipment e ON r.equipment_id = e.id "
+               "WHERE r.status = 'active'");
+    return query;
+}
+
+double Database::getRevenueCompletedOn(const QDate& day)
+{
+    // updated_at пишется через CURRENT_TIMESTAMP (UTC), день сравниваем в местном времени.
+    // Итог завершения — как Rental::calculateFinalPrice()
+    QSqlQuery query(m_db);
+    query.prepare("SELECT COALESCE(SUM(total_price + damage_cost + cleaning_cost), 0) FROM rentals "
+                  "WHERE status = 'completed' AND date(updated_at, 'localtime') = ?");
+    query.addBindValue(day.toString(Qt::ISODate));
+    if (!query.exec() || !query.next()) {
+        qDebug() << "Ошибка расчёта выручки за день:" << query.lastError().text();
+        return 0.0;
+    }
+    return query.value(0).toDouble();
+}
+
+QSqlQuery Database::getContractRows(const QList<int>& ids)
+{
+    // Всё, что печатается в договоре и квитанции, одним запросом
+    QSqlQuery query(m_db);
+    if (ids.isEmpty()) {
+        return query;
+    }
+    
+    QStringList placeholders;
+    for (int i = 0; i < ids.size(); ++i) {
+        placeholders << "?";
+    }
+    query.setForwardOnly(true);
+    query.prepare("SELECT r.*, "
+                  "c.name as customer_name, c.phone as customer_phone, c.email as customer_email, "
+                  "c.passport as customer_passport, c.address as customer_address, "
+                  "e.name as equipment_name, e.category as equipment_category, e.price as equipment_price "
+                  "FROM rentals r "
+                  "LEFT JOIN customers c ON r.customer_id = c.id "
+                  "LEFT JOIN equipment e ON r.equipment_id = e.id "
+                  "WHERE r.id IN (" + placeholders.join(", ") + ")");
+    for (int id : ids) {
+        query.addBindValue(id);
+    }
+    query.exec();
+    return query;
+}
+
+QSqlQuery Database::getRentalsByIds(const QList<int>& ids)
+{
+    QSqlQuery query(m_db);
+    if (ids.isEmpty()) {
+        return query;
+    }
+    
+    QStringList placeholders;
+    for (int i = 0; i < ids.size(); ++i) {
+        placeholders << "?";
+    }
+    query.prepare("SELECT r.*, c.name as customer_name, e.name as equipment_name "
+                  "FROM rentals r "
+                  "JOIN customers c ON r.customer_id = c.id "
+                  "JOIN equipment e ON r.equipment_id = e.id "
+                  "WHERE r.id IN (" + placeholders.join(", ") + ") "
+                  "ORDER BY r.id");
+    for (int id : ids) {
+        query.addBindValue(id);
+    }
+    query.exec();
+    return query;
+}
+
+// Transactions
+bool Database::beginTransaction()
+{
+    if (!m_db.transaction()) {
+        qDebug() << "Ошибка начала транзакции:" << m_db.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool Database::commitTransaction()
+{
+    if (!m_db.commit()) {
+        qDebug() << "Ошибка фиксации транзакции:" << m_db.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool Database::rollbackTransaction()
+{
+    return m_db.rollback();
+}
+
 // Reports
 QSqlQuery Database::getRentalReport(const QDateTime& start, const QDateTime& end)
 {
@@ -608,82 +1452,158 @@ QSqlQuery Database::getCustomerReport()
 
 QSqlQuery Database::getFinancialReport(const QDateTime& start, const QDateTime& end)
 {
+    // Читаем дневные агрегаты: не больше одной строки на день и оборудование
     QSqlQuery query(m_db);
     query.prepare("SELECT "
-                  "SUM(total_price) as total_revenue, "
-                  "SUM(deposit) as total_deposits, "
-                  "SUM(damage_cost) as total_damage, "
-                  "SUM(cleaning_cost) as total_cleaning, "
-                  "COUNT(*) as rental_count, "
-                  "COUNT(CASE WHEN status = 'completed' THEN 1 END) as completed_count, "
-                  "COUNT(CASE WHEN status = 'active' THEN 1 END) as active_count "
-                  "FROM rentals "
-                  "WHERE start_date >= ? AND start_date <= ?");
-    query.addBindValue(start);
-    query.addBindValue(end);
+                  "COALESCE(SUM(revenue), 0) as total_revenue, "
+                  "COALESCE(SUM(deposits), 0) as total_deposits, "
+                  "COALESCE(SUM(damage), 0) as total_damage, "
+                  "COALESCE(SUM(cleaning), 0) as total_cleaning, "
+                  "COALESCE(SUM(rental_count), 0) as rental_count, "
+                  "COALESCE(SUM(completed_count), 0) as completed_count, "
+                  "COALESCE(SUM(active_count), 0) as active_count, "
+                  "COALESCE(SUM(units_out), 0) as units_out "
+                  "FROM rental_daily_stats "
+                  "WHERE day >= ? AND day <= ?");
+    query.addBindValue(start.date().toString(Qt::ISODate));
+    query.addBindValue(end.date().toString(Qt::ISODate));
     query.exec();
     return query;
-} 
-
-// Экранируем путь для SQL-литерала
-static QString sqlQuotePath(const QString& p) {
-    QString s = QDir::toNativeSeparators(p);
-    s.replace('\'', "''");
-    return "'" + s + "'";
 }
 
-bool Database::backupDatabase(const QString& backupPath)
+QSqlQuery Database::getDailyStats(const QDate& start, const QDate& end)
 {
-    if (backupPath.isEmpty()) return false;
-    if (!m_db.isValid()) return false;
-    if (!m_db.isOpen() && !m_db.open()) return false;
-
-    // Нельзя бэкапить в сам же файл
-    if (QFileInfo(backupPath).canonicalFilePath() == QFileInfo(m_dbPath).canonicalFilePath())
-        return false;
+    QSqlQuery query(m_db);
+    query.prepare("SELECT day, "
+                  "SUM(rental_count) as rental_count, "
+                  "SUM(active_count) as active_count, "
+                  "SUM(completed_count) as completed_count, "
+                  "SUM(revenue) as revenue, "
+                  "SUM(deposits) as deposits, "
+                  "SUM(damage) as damage, "
+                  "SUM(cleaning) as cleaning, "
+                  "SUM(units_out) as units_out "
+                  "FROM rental_daily_stats "
+                  "WHERE day >= ? AND day <= ? "
+                  "GROUP BY day ORDER BY day");
+    query.addBindValue(start.toString(Qt::ISODate));
+    query.addBindValue(end.toString(Qt::ISODate));
+    query.exec();
+    return query;
+}
 
-    // Гарантируем каталог и чистим возможные старые копии
-    const QFileInfo dst(backupPath);
-    QDir().mkpath(dst.absolutePath());
-    QFile::remove(backupPath);
-    QFile::remove(backupPath + "-wal");
-    QFile::remove(backupPath + "-shm");
+namespace {
+// Эталонный расчёт агрегатов напрямую по rentals (для перестройки и сверки)
+const char* kDailyStatsSource =
+    "SELECT substr(r.start_date, 1, 10) AS day, r.equipment_id, e.category, "
+    "COUNT(*) AS rental_count, SUM(r.status = 'active') AS active_count, "
+    "SUM(r.status = 'completed') AS completed_count, SUM(r.total_price) AS revenue, "
+    "SUM(r.deposit) AS deposits, SUM(COALESCE(r.damage_cost, 0)) AS damage, "
+    "SUM(COALESCE(r.cleaning_cost, 0)) AS cleaning, SUM(r.quantity) AS units_out "
+    "FROM rentals r LEFT JOIN equipment e ON e.id = r.equipment_id "
+    "GROUP BY 1, 2";
+}
 
-    // Попытка 1: VACUUM INTO (консистентная копия)
-    {
-        QSqlQuery pragma(m_db);
-        pragma.exec("PRAGMA wal_checkpoint(TRUNCATE);"); // не помешает
-        QSqlQuery q(m_db);
-        const QString sql = "VACUUM INTO " + sqlQuotePath(backupPath) + ";";
-        if (q.exec(sql)) {
-            return true;
-        }
-        // если SQLite не поддерживает VACUUM INTO — пойдём в фолбэк
+bool Database::rebuildDailyStats()
+{
+    if (!beginTransaction()) {
+        return false;
     }
+    
+    QSqlQuery query(m_db);
+    if (!query.exec("DELETE FROM rental_daily_stats") ||
+        !query.exec(QString("INSERT INTO rental_daily_stats (day, equipment_id, category, rental_count, "
+                            "active_count, completed_count, revenue, deposits, damage, cleaning, units_out) ")
+                    + kDailyStatsSource)) {
+        qDebug() << "Ошибка перестроения rental_daily_stats:" << query.lastError().text();
+        rollbackTransaction();
+        return false;
+    }
+    
+    return commitTransaction();
+}
 
-    // Попытка 2 (фолбэк): блокируем записи и копируем файлы
-    bool ok = true;
-    {
-        QSqlQuery q(m_db);
-        q.exec("PRAGMA wal_checkpoint(TRUNCATE);");
-        ok = q.exec("BEGIN IMMEDIATE;"); // эксклюзивная блокировка на запись
-
-        ok = ok && QFile::copy(m_dbPath, backupPath);
+int Database::checkDailyStats()
+{
+    // Сравниваем в обе стороны; суммы округляем, чтобы не ловить погрешность REAL
+    const QString columns = "SELECT day, equipment_id, rental_count, active_count, completed_count, "
+                            "ROUND(revenue, 2), ROUND(deposits, 2), ROUND(damage, 2), ROUND(cleaning, 2), "
+                            "units_out FROM ";
+    const QString stored = columns + "rental_daily_stats";
+    const QString expected = columns + "(" + kDailyStatsSource + ")";
+    
+    QSqlQuery query(m_db);
+    const QString sql = QString("SELECT (SELECT COUNT(*) FROM (%1 EXCEPT %2)) + "
+                                "(SELECT COUNT(*) FROM (%2 EXCEPT %1))").arg(stored, expected);
+    if (!query.exec(sql) || !query.next()) {
+        qDebug() << "Ошибка сверки rental_daily_stats:" << query.lastError().text();
+        return -1;
+    }
+    
+    return query.value(0).toInt();
+} 
 
-        const QString wal = m_dbPath + "-wal";
-        const QString shm = m_dbPath + "-shm";
-        if (QFile::exists(wal))      ok = ok && QFile::copy(wal, backupPath + "-wal");
-        if (QFile::exists(shm))      ok = ok && QFile::copy(shm, backupPath + "-shm");
+// Постраничная копия на своих соединениях (BackupService): запись в базу
+// во время копирования не блокируется. Вызов синхронный — окно пользуется
+// BackupService::start, чтобы копия шла в фоне
+bool Database::backupDatabase(const QString& backupPath, bool encrypt)
+{
+    if (encrypt && !Security::hasDataKey()) return false;
+    return BackupService::backup(backupPath, encrypt ? Security::dataKey() : QByteArray());
+}
 
-        q.exec("COMMIT;");
+std::unique_ptr<QTemporaryDir> Database::privateTempDir() const
+{
+    // Каталог данных приложения, а не место назначения копии (флешка,
+    // синхронизируемые «Документы»): открытые данные туда не попадают
+    auto dir = std::make_unique<QTemporaryDir>(QFileInfo(m_dbPath).absolutePath() + "/.tmp-XXXXXX");
+    if (!dir->isValid() ||
+        !QFile::setPermissions(dir->path(), QFileDevice::ReadOwner | QFileDevice::WriteOwner |
+                                            QFileDevice::ExeOwner)) {
+        qDebug() << "Не удалось создать закрытый временный каталог";
+        return nullptr;
     }
-    return ok;
+    return dir;
 }
 
 bool Database::restoreDatabase(const QString& backupPath)
 {
     if (!QFile::exists(backupPath)) return false;
 
+    // Зашифрованную копию сначала расшифровываем в закрытый временный
+    // каталог: при ошибке (другой ключ, повреждение) текущая база остаётся
+    // нетронутой
+    QString sourcePath = backupPath;
+    const std::unique_ptr<QTemporaryDir> tempDir = privateTempDir();
+    if (!tempDir) return false;
+    const QString decryptedPath = tempDir->filePath("restore.db");
+    {
+        QFile in(backupPath);
+        if (!in.open(QIODevice::ReadOnly)) return false;
+        if (Aead::isEncryptedStream(in)) {
+            QFile out(decryptedPath);
+            if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+                !Aead::decryptStream(Security::dataKey(), in, out)) {
+                qDebug() << "Не удалось расшифровать резервную копию";
+                out.close();
+                QFile::remove(decryptedPath);
+                return false;
+            }
+            sourcePath = decryptedPath;
+        }
+    }
+    const bool ok = restoreFromFile(sourcePath);
+    QFile::remove(decryptedPath);
+    // Копия могла быть снята до шифрования полей
+    if (ok) {
+        secureCustomerRows();
+        emit databaseReplaced();
+    }
+    return ok;
+}
+
+bool Database::restoreFromFile(const QString& backupPath)
+{
     // 1) Полностью разрываем текущее соединение
     const QString conn = m_db.connectionName();
     if (m_db.isOpen()) m_db.close();
@@ -710,15 +1630,20 @@ bool Database::restoreDatabase(const QString& backupPath)
 
     if (!ok) return false;
 
-    // 4) Поднимаем соединение заново
+    // 4) Поднимаем соединение заново. Копия могла быть снята до включения
+    //    шифрования или после — приводим файл к текущим настройкам
     m_db = QSqlDatabase::addDatabase("QSQLITE", conn);
     m_db.setDatabaseName(m_dbPath);
-    m_isOpen = m_db.open();
+    setupEncryption();
+    if (!applyCipherSettings()) return false;
+    m_isOpen = openConnection();
     if (!m_isOpen) return false;
+    ++m_openGeneration;
 
     // 5) Базовые pragma
     QSqlQuery pq(m_db);
     pq.exec("PRAGMA foreign_keys=ON;");
 
-    return true;
+    // Копия могла быть снята старой версией: доводим схему (колонки индексов и т.п.)
+    return createTables();
 }
\ No newline at end of file
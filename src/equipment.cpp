@@ -1,5 +1,6 @@
 #include "equipment.h"
 #include "database.h"
+#include "PricingEngine.h"
 #include <QDebug>
 
 Equipment::Equipment(QObject *parent)
@@ -128,6 +129,7 @@ bool Equipment::save()
     } else {
         // Обновление существующего оборудования
         if (db.updateEquipment(m_id, m_name, m_category, m_price, m_deposit, m_quantity, m_description, m_additionalDayPrice)) {
+            PricingEngine::instance().invalidateEquipment(m_id);
             m_updatedAt = QDateTime::currentDateTime();
             return true;
         }
@@ -149,6 +151,7 @@ bool Equipment::remove()
     
     Database& db = Database::getInstance();
     if (db.deleteEquipment(m_id)) {
+        PricingEngine::instance().invalidateEquipment(m_id);
         m_id = 0;
         return true;
     }
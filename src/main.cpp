@@ -4,6 +4,7 @@
 #include <QStandardPaths>
 #include <QMessageBox>
 #include <QDebug>
+#include <QTimer>
 #include "mainwindow.h"
 #include "database.h"
 #include "security.h"
@@ -28,7 +29,16 @@ int main(int argc, char *argv[])
         // Инициализируем базу данных
         Database::initialize(dataPath + "/rental.db");
         
-        // Открываем базу данных (создаст таблицы при необходимости)
+        // Файл и схема открываются и кэш прогревается, пока пользователь вводит
+        // мастер-пароль: таймер срабатывает в цикле событий окна пароля.
+        // Зашифрованный файл без ключа не открывается — ждём пароля
+        QTimer::singleShot(0, []() {
+            if (Database::getInstance().openStorage()) {
+                Database::getInstance().prefetch();
+            }
+        });
+        
+        // Аутентификация; БД к этому моменту обычно уже открыта
         if (!Database::getInstance().openDatabase("")) {
             QMessageBox::critical(nullptr, "Ошибка БД", "Не удалось открыть базу данных");
             return -1;
@@ -25,14 +25,14 @@ MainWindow::MainWindow(QWidget *parent)
     m_database = &Database::getInstance();
     m_rentalManager = new RentalManager(this);
     
-    // Открываем базу данных
-    if (!m_database->openDatabase("")) {
+    // База открыта и пароль проверен в main(); здесь — только если окно создано без этого
+    if (!m_database->isOpen() && !m_database->openDatabase("")) {
         QMessageBox::critical(this, "Ошибка", "Не удалось открыть базу данных");
         return;
     }
     
-    // Инициализация аудит-логгера на текущем соединении (default)
-    AuditLogger::instance().init(/*если есть имя соединения, передай его сюда*/);
+    // Аудит-логгер: журнал в отдельном audit.db рядом с рабочей БД (соединение default)
+    AuditLogger::instance().init();
 
     // Провайдер "кто"
     AuditLogger::instance().setActorProvider([this](){
@@ -48,18 +48,28 @@ MainWindow::MainWindow(QWidget *parent)
     refreshEquipmentTable();
     refreshRentalTable();
     
+    // Сводка считается один раз, дальше обновляется по событиям менеджера
+    m_dashboardModel = new DashboardModel(m_rentalManager, this);
+    connect(m_dashboardModel, &DashboardModel::reset, this, &MainWindow::refreshDashboard);
+    connect(m_dashboardModel, &DashboardModel::totalsChanged, this, &MainWindow::updateDashboardTotals);
+    connect(m_dashboardModel, &DashboardModel::categoryUnitsChanged, this, &MainWindow::updateDashboardCategory);
+    m_dashboardModel->reload();
+    // Сводка открывается первой: снимок для срезов грузим после показа окна
+    if (m_tabWidget->currentWidget() == m_dashboardTab) {
+        QTimer::singleShot(0, this, &MainWindow::ensureRentalSnapshot);
+    }
+    
     // Загружаем единственный светлый стиль
     loadStyleSheet("light");
     
     // Обновление статуса
     updateStatus();
     
-    // Таймер для проверки просроченных аренд
-    QTimer *overdueTimer = new QTimer(this);
-    connect(overdueTimer, &QTimer::timeout, this, [this]() {
-        m_rentalManager->checkOverdueRentals();
-    });
-    overdueTimer->start(300000); // Проверка каждые 5 минут
+    // Просрочки отслеживаются по дедлайнам, без периодического сканирования;
+    // алерты приходят пачкой в немодальном окне
+    connect(m_rentalManager->notificationCenter(), &NotificationCenter::digestReady,
+            this, &MainWindow::showNotificationDigest);
+    m_rentalManager->startOverdueMonitoring();
     
     // Загрузка настроек
     loadSettings();
@@ -146,6 +156,18 @@ void MainWindow::setupStatusBar()
     m_dateLabel = new QLabel(QDateTime::currentDateTime().toString("dd.MM.yyyy hh:mm"));
     
     statusBar->addWidget(m_statusLabel);
+    
+    // Резервная копия идёт в фоне: ход и отмена — в строке состояния
+    m_backupService = new BackupService(this);
+    m_backupProgress = new QProgressBar();
+    m_backupProgress->setRange(0, 100);
+    m_backupProgress->setMaximumWidth(160);
+    m_backupProgress->setFormat("Копия: %p%");
+    m_backupProgress->setVisible(false);
+    m_cancelBackupBtn = new QPushButton("Отменить копию");
+    m_cancelBackupBtn->setVisible(false);
+    statusBar->addPermanentWidget(m_backupProgress);
+    statusBar->addPermanentWidget(m_cancelBackupBtn);
     statusBar->addPermanentWidget(m_userLabel);
     statusBar->addPermanentWidget(m_dateLabel);
     
@@ -162,6 +184,7 @@ void MainWindow::setupCentralWidget()
     m_tabWidget = new QTabWidget(this);
     setCentralWidget(m_tabWidget);
     
+    createDashboardTab();
     createCustomerTab();
     createEquipmentTab();
     createRentalTab();
@@ -292,25 +315,25 @@ void MainWindow::onSearchRental()
     statusBar()->showMessage(QString("Найдено аренд: %1").arg(filtered.size()), 3000);
 }
 
-// Печать текущего отчёта из QTextEdit
+// Печать текущего отчёта: строки потоком идут из БД на принтер
 void MainWindow::onReportPrint()
 {
     if (!m_reportsText) return;
-    QTextDocument doc;
-    doc.setHtml(m_reportsText->toHtml());
 
-    QPrinter printer(QPrinter::HighResolution);
-    printer.setPageSize(QPageSize(QPageSize::A4));
-    QPrintDialog pd(&printer, this);
+    auto* printer = new QPrinter(QPrinter::HighResolution);
+    printer->setPageSize(QPageSize(QPageSize::A4));
+    QPrintDialog pd(printer, this);
     pd.setWindowTitle("Печать отчёта");
-    if (pd.exec() == QDialog::Accepted) {
-        doc.print(&printer);
+    if (pd.exec() != QDialog::Accepted) {
+        delete printer;
+        return;
     }
 
-    AuditLogger::instance().log("Report printed", m_reportTypeCombo ? m_reportTypeCombo->currentText() : "");
+    m_statusLabel->setText("Печать отчета...");
+    m_reportService->print(currentReportRequest(), printer);
 }
 
-// Экспорт текущего отчёта: PDF или HTML
+// Экспорт текущего отчёта: PDF, HTML или CSV — полный, без лимита предпросмотра
 void MainWindow::onReportExport()
 {
     if (!m_reportsText) return;
@@ -319,33 +342,34 @@ void MainWindow::onReportExport()
         QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) +
         "/report_" + QDateTime::currentDateTime().toString("yyyyMMdd_HHmm");
 
-    const QString path = QFileDialog::getSaveFileName(
+    QString selectedFilter;
+    QString path = QFileDialog::getSaveFileName(
         this, "Экспорт отчёта", suggestedBase,
-        "PDF (*.pdf);;HTML (*.html)");
+        "PDF (*.pdf);;HTML (*.html);;CSV (*.csv)", &selectedFilter);
 
     if (path.isEmpty()) return;
 
-    if (path.endsWith(".pdf", Qt::CaseInsensitive)) {
-        QTextDocument doc;
-        doc.setHtml(m_reportsText->toHtml());
-        QPrinter printer(QPrinter::HighResolution);
-        printer.setOutputFormat(QPrinter::PdfFormat);
-        printer.setOutputFileName(path);
-        printer.setPageSize(QPageSize(QPageSize::A4));
-        doc.print(&printer);
-        QMessageBox::information(this, "Готово", "Отчёт сохранён в PDF.");
-    } else {
-        QFile f(path.endsWith(".html", Qt::CaseInsensitive) ? path : (path + ".html"));
-        if (f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
-            f.write(m_reportsText->toHtml().toUtf8());
-            f.close();
-            QMessageBox::information(this, "Готово", "Отчёт сохранён в HTML.");
-        } else {
-            QMessageBox::warning(this, "Ошибка", "Не удалось сохранить отчёт.");
-        }
-    }
+    // Расширение в имени важнее выбранного фильтра
+    ReportFormat format = selectedFilter.startsWith("CSV")  ? ReportFormat::Csv
+                        : selectedFilter.startsWith("HTML") ? ReportFormat::Html
+                                                            : ReportFormat::Pdf;
+    if (path.endsWith(".csv", Qt::CaseInsensitive))       format = ReportFormat::Csv;
+    else if (path.endsWith(".html", Qt::CaseInsensitive)) format = ReportFormat::Html;
+    else if (path.endsWith(".pdf", Qt::CaseInsensitive))  format = ReportFormat::Pdf;
+    const QString suffix = format == ReportFormat::Pdf ? ".pdf" : format == ReportFormat::Csv ? ".csv" : ".html";
+    if (!path.endsWith(suffix, Qt::CaseInsensitive)) path += suffix;
+
+    m_statusLabel->setText("Экспорт отчета...");
+    m_reportService->exportTo(currentReportRequest(), path, format);
+}
 
-    AuditLogger::instance().log("Report exported", m_reportTypeCombo ? m_reportTypeCombo->currentText() : "");
+ReportRequest MainWindow::currentReportRequest() const
+{
+    ReportRequest request;
+    request.type = m_reportTypeCombo->currentText();
+    request.start = m_reportStartDate->date();
+    request.end = m_reportEndDate->date();
+    return request;
 }
 
 // Меню «Настройки» Резервное копирование
@@ -355,31 +379,55 @@ void MainWindow::onSettingsBackup()
 
     const QString suggested =
         QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) +
-        "/rental_backup_" + QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss") + ".db";
+        "/rental_backup_" + QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss") + ".dbx";
 
+    // .dbx — копия, зашифрованная ключом данных; .db — открытая
     const QString fileName = QFileDialog::getSaveFileName(
         this, "Сохранить резервную копию", suggested,
-        "База данных (*.db);;Все файлы (*)");
+        "Зашифрованная копия (*.dbx);;База данных (*.db);;Все файлы (*)");
     if (fileName.isEmpty()) return;
 
-    if (m_database && m_database->backupDatabase(fileName)) {
-        QMessageBox::information(this, "Успех", "Резервная копия создана успешно!");
-        AuditLogger::instance().log("Backup created", fileName, AuditSeverity::Security);
-    } else {
-        QMessageBox::warning(this, "Ошибка", "Не удалось создать резервную копию.");
+    startBackup(this, fileName);
+}
+
+// Копия идёт в фоне; итог сообщает BackupService::finished
+void MainWindow::startBackup(QWidget* parent, const QString& fileName)
+{
+    const bool encrypt = fileName.endsWith(".dbx", Qt::CaseInsensitive);
+    if (m_backupService->isActive()) {
+        QMessageBox::information(parent, "Резервная копия", "Резервное копирование уже выполняется.");
+    } else if (!m_backupService->start(fileName, encrypt)) {
+        QMessageBox::warning(parent, "Ошибка", "Не удалось начать резервное копирование.");
         AuditLogger::instance().log("Backup failed", fileName, AuditSeverity::Error);
     }
 }
 
+bool MainWindow::ensureNoBackup(QWidget* parent)
+{
+    if (m_backupService->isActive()) {
+        QMessageBox::information(parent, "Резервная копия",
+            "Дождитесь окончания резервного копирования или отмените его.");
+        return false;
+    }
+    // Отменённая копия могла ещё не закрыть соединения с файлами БД
+    if (m_backupService->isRunning()) {
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        m_backupService->waitForFinished();
+        QApplication::restoreOverrideCursor();
+    }
+    return true;
+}
+
 // Меню «Настройки» Восстановление 
 void MainWindow::onSettingsRestore()
 {
+    if (!ensureNoBackup(this)) return;
     if (!AdminGuard::ensureAdmin(this, &m_adminSession, &m_adminMgr)) return;
 
     const QString fileName = QFileDialog::getOpenFileName(
         this, "Выбрать файл для восстановления",
         QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation),
-        "База данных (*.db);;Все файлы (*)");
+        "Резервные копии (*.dbx *.db);;Все файлы (*)");
     if (fileName.isEmpty()) return;
 
     if (QMessageBox::question(this, "Подтверждение",
@@ -491,24 +539,224 @@ void MainWindow::createRentalTab()
     m_newRentalBtn->setObjectName("newRentalBtn");
     m_completeRentalBtn = new QPushButton("Завершить аренду");
     m_completeRentalBtn->setObjectName("completeRentalBtn");
+    m_batchReturnBtn = new QPushButton("Групповой возврат");
+    m_batchReturnBtn->setObjectName("batchReturnBtn");
     m_viewRentalBtn = new QPushButton("Просмотр");
     m_viewRentalBtn->setObjectName("viewRentalBtn");
     m_printRentalBtn = new QPushButton("Печать договора");
+    m_batchPrintBtn = new QPushButton("Пакетная печать");
     
     // Инициализируем состояние кнопок
     m_completeRentalBtn->setEnabled(false);
+    m_batchReturnBtn->setEnabled(false);
     m_viewRentalBtn->setEnabled(false);
     
     buttonLayout->addWidget(m_newRentalBtn);
     buttonLayout->addWidget(m_completeRentalBtn);
+    buttonLayout->addWidget(m_batchReturnBtn);
     buttonLayout->addWidget(m_viewRentalBtn);
     buttonLayout->addWidget(m_printRentalBtn);
+    buttonLayout->addWidget(m_batchPrintBtn);
     buttonLayout->addStretch();
     layout->addLayout(buttonLayout);
     
     m_tabWidget->addTab(m_rentalTab, "Аренды");
 }
 
+void MainWindow::createDashboardTab()
+{
+    m_dashboardTab = new QWidget();
+    QVBoxLayout *layout = new QVBoxLayout(m_dashboardTab);
+    
+    QGroupBox *totalsGroup = new QGroupBox("Текущее состояние");
+    QFormLayout *formLayout = new QFormLayout(totalsGroup);
+    m_dashActiveLabel = new QLabel("—");
+    m_dashOverdueLabel = new QLabel("—");
+    m_dashRevenueLabel = new QLabel("—");
+    m_dashDepositsLabel = new QLabel("—");
+    formLayout->addRow("Активных аренд:", m_dashActiveLabel);
+    formLayout->addRow("Просрочено:", m_dashOverdueLabel);
+    formLayout->addRow("Выручка за сегодня:", m_dashRevenueLabel);
+    formLayout->addRow("Залогов на руках:", m_dashDepositsLabel);
+    layout->addWidget(totalsGroup);
+    
+    QGroupBox *categoryGroup = new QGroupBox("Выдано по категориям");
+    QVBoxLayout *categoryLayout = new QVBoxLayout(categoryGroup);
+    m_dashCategoryTable = new QTableWidget();
+    m_dashCategoryTable->setColumnCount(2);
+    m_dashCategoryTable->setHorizontalHeaderLabels({"Категория", "Единиц в аренде"});
+    m_dashCategoryTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_dashCategoryTable->setAlternatingRowColors(true);
+    categoryLayout->addWidget(m_dashCategoryTable);
+    layout->addWidget(categoryGroup);
+    
+    // Срезы считаются по снимку в памяти, без запроса к БД на каждый фильтр
+    QGroupBox *sliceGroup = new QGroupBox("Срезы по арендам");
+    QVBoxLayout *sliceLayout = new QVBoxLayout(sliceGroup);
+    QHBoxLayout *filterLayout = new QHBoxLayout();
+    m_sliceFromEdit = new QDateEdit(QDate::currentDate().addDays(-7 * 12));
+    m_sliceToEdit = new QDateEdit(QDate::currentDate());
+    m_sliceFromEdit->setCalendarPopup(true);
+    m_sliceToEdit->setCalendarPopup(true);
+    m_sliceCategoryCombo = new QComboBox();
+    m_sliceCategoryCombo->addItem("Все категории", QString());
+    m_sliceSegmentCombo = new QComboBox();
+    for (CustomerSegment segment : {CustomerSegment::Any, CustomerSegment::New,
+                                    CustomerSegment::Returning, CustomerSegment::Regular}) {
+        m_sliceSegmentCombo->addItem(RentalSnapshot::segmentName(segment), static_cast<int>(segment));
+    }
+    m_sliceGroupCombo = new QComboBox();
+    m_sliceGroupCombo->addItem("По категориям");
+    m_sliceGroupCombo->addItem("По неделям");
+    filterLayout->addWidget(new QLabel("Начало аренды с:"));
+    filterLayout->addWidget(m_sliceFromEdit);
+    filterLayout->addWidget(new QLabel("по:"));
+    filterLayout->addWidget(m_sliceToEdit);
+    filterLayout->addWidget(m_sliceCategoryCombo);
+    filterLayout->addWidget(m_sliceSegmentCombo);
+    filterLayout->addWidget(m_sliceGroupCombo);
+    filterLayout->addStretch();
+    sliceLayout->addLayout(filterLayout);
+    m_sliceTable = new QTableWidget();
+    m_sliceTable->setColumnCount(5);
+    m_sliceTable->setHorizontalHeaderLabels({"Группа", "Аренд", "Единиц", "Выручка", "Залоги"});
+    m_sliceTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_sliceTable->setAlternatingRowColors(true);
+    sliceLayout->addWidget(m_sliceTable);
+    m_sliceTotalsLabel = new QLabel("—");
+    sliceLayout->addWidget(m_sliceTotalsLabel);
+    layout->addWidget(sliceGroup);
+    
+    m_sliceTimer = new QTimer(this);
+    m_sliceTimer->setSingleShot(true);
+    m_sliceTimer->setInterval(200);
+    connect(m_sliceTimer, &QTimer::timeout, this, [this]() {
+        reloadSliceCategories();
+        refreshSlices();
+    });
+    connect(m_sliceFromEdit, &QDateEdit::dateChanged, this, &MainWindow::refreshSlices);
+    connect(m_sliceToEdit, &QDateEdit::dateChanged, this, &MainWindow::refreshSlices);
+    connect(m_sliceCategoryCombo, &QComboBox::currentIndexChanged, this, &MainWindow::refreshSlices);
+    connect(m_sliceSegmentCombo, &QComboBox::currentIndexChanged, this, &MainWindow::refreshSlices);
+    connect(m_sliceGroupCombo, &QComboBox::currentIndexChanged, this, &MainWindow::refreshSlices);
+    connect(m_tabWidget, &QTabWidget::currentChanged, this, [this](int index) {
+        if (m_tabWidget->widget(index) == m_dashboardTab) ensureRentalSnapshot();
+    });
+    
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    QPushButton *reloadBtn = new QPushButton("Пересчитать");
+    connect(reloadBtn, &QPushButton::clicked, this, [this]() {
+        if (m_dashboardModel) m_dashboardModel->reload();
+    });
+    buttonLayout->addWidget(reloadBtn);
+    buttonLayout->addStretch();
+    layout->addLayout(buttonLayout);
+    
+    m_tabWidget->addTab(m_dashboardTab, "Сводка");
+}
+
+void MainWindow::refreshDashboard()
+{
+    m_dashCategoryTable->setRowCount(0);
+    m_dashCategoryItems.clear();
+    const QMap<QString, int> units = m_dashboardModel->unitsOutByCategory();
+    for (auto it = units.cbegin(); it != units.cend(); ++it) {
+        updateDashboardCategory(it.key(), it.value());
+    }
+    updateDashboardTotals();
+}
+
+void MainWindow::updateDashboardTotals()
+{
+    const DashboardTotals totals = m_dashboardModel->totals();
+    m_dashActiveLabel->setText(QString::number(totals.activeRentals));
+    m_dashOverdueLabel->setText(QString::number(totals.overdueRentals));
+    m_dashRevenueLabel->setText(QString::number(totals.todayRevenue, 'f', 2) + " ₽");
+    m_dashDepositsLabel->setText(QString::number(totals.depositsHeld, 'f', 2) + " ₽");
+}
+
+void MainWindow::updateDashboardCategory(const QString& category, int units)
+{
+    // Строка категории ищется по хешу; новые категории дописываются в конец
+    QTableWidgetItem *item = m_dashCategoryItems.value(category);
+    if (!item) {
+        const int row = m_dashCategoryTable->rowCount();
+        m_dashCategoryTable->insertRow(row);
+        m_dashCategoryTable->setItem(row, 0, new QTableWidgetItem(category.isEmpty() ? "Без категории" : category));
+        item = new QTableWidgetItem();
+        m_dashCategoryTable->setItem(row, 1, item);
+        m_dashCategoryItems.insert(category, item);
+    }
+    item->setText(QString::number(units));
+}
+
+void MainWindow::ensureRentalSnapshot()
+{
+    if (m_rentalSnapshot || !m_rentalManager) return;
+    // Первая загрузка читает всю таблицу аренд; дальше снимок ведётся по событиям
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    m_rentalSnapshot = m_rentalManager->snapshot();
+    QApplication::restoreOverrideCursor();
+    connect(m_rentalSnapshot, &RentalSnapshot::changed, m_sliceTimer, qOverload<>(&QTimer::start));
+    reloadSliceCategories();
+    refreshSlices();
+}
+
+void MainWindow::reloadSliceCategories()
+{
+    if (!m_rentalSnapshot) return;
+    const QString current = m_sliceCategoryCombo->currentData().toString();
+    QStringList categories = m_rentalSnapshot->categories();
+    categories.sort();
+    QSignalBlocker block(m_sliceCategoryCombo);
+    m_sliceCategoryCombo->clear();
+    m_sliceCategoryCombo->addItem("Все категории", QString());
+    for (const QString& category : std::as_const(categories)) {
+        m_sliceCategoryCombo->addItem(category, category);
+    }
+    // Выбранная категория могла исчезнуть после правки оборудования
+    const int index = m_sliceCategoryCombo->findData(current);
+    m_sliceCategoryCombo->setCurrentIndex(index < 0 ? 0 : index);
+}
+
+void MainWindow::refreshSlices()
+{
+    if (!m_rentalSnapshot) return;
+    SnapshotFilter filter;
+    filter.from = m_sliceFromEdit->date();
+    filter.to = m_sliceToEdit->date();
+    filter.category = m_sliceCategoryCombo->currentData().toString();
+    filter.segment = static_cast<CustomerSegment>(m_sliceSegmentCombo->currentData().toInt());
+    
+    QList<QPair<QString, SnapshotTotals>> rows;
+    if (m_sliceGroupCombo->currentIndex() == 0) {
+        const QMap<QString, SnapshotTotals> groups = m_rentalSnapshot->byCategory(filter);
+        for (auto it = groups.cbegin(); it != groups.cend(); ++it) rows.append({it.key(), it.value()});
+    } else {
+        const QMap<QDate, SnapshotTotals> groups = m_rentalSnapshot->byWeek(filter);
+        for (auto it = groups.cbegin(); it != groups.cend(); ++it) {
+            rows.append({"Неделя с " + it.key().toString("dd.MM.yyyy"), it.value()});
+        }
+    }
+    
+    m_sliceTable->setUpdatesEnabled(false);
+    m_sliceTable->setRowCount(rows.size());
+    for (int row = 0; row < rows.size(); ++row) {
+        const SnapshotTotals& t = rows.at(row).second;
+        m_sliceTable->setItem(row, 0, new QTableWidgetItem(rows.at(row).first));
+        m_sliceTable->setItem(row, 1, new QTableWidgetItem(QString::number(t.count)));
+        m_sliceTable->setItem(row, 2, new QTableWidgetItem(QString::number(t.units)));
+        m_sliceTable->setItem(row, 3, new QTableWidgetItem(QString::number(t.revenue, 'f', 2)));
+        m_sliceTable->setItem(row, 4, new QTableWidgetItem(QString::number(t.deposits, 'f', 2)));
+    }
+    m_sliceTable->setUpdatesEnabled(true);
+    
+    const SnapshotTotals total = m_rentalSnapshot->totals(filter);
+    m_sliceTotalsLabel->setText(QString("Итого: аренд %1, единиц %2, выручка %3 ₽, залоги %4 ₽")
+        .arg(total.count).arg(total.units)
+        .arg(QString::number(total.revenue, 'f', 2), QString::number(total.deposits, 'f', 2)));
+}
+
 void MainWindow::createReportsTab()
 {
     m_reportsTab = new QWidget();
@@ -538,11 +786,18 @@ void MainWindow::createReportsTab()
     // Кнопки
     QHBoxLayout *buttonLayout = new QHBoxLayout();
     m_generateReportBtn = new QPushButton("Сгенерировать отчет");
+    m_cancelReportBtn  = new QPushButton("Отмена");
+    m_cancelReportBtn->setEnabled(false);
     m_reportPrintBtn   = new QPushButton("Печать");
     m_reportExportBtn  = new QPushButton("Экспорт");
+    m_reportProgress   = new QProgressBar();
+    m_reportProgress->setRange(0, 100);
+    m_reportProgress->setVisible(false);
     buttonLayout->addWidget(m_generateReportBtn);
+    buttonLayout->addWidget(m_cancelReportBtn);
     buttonLayout->addWidget(m_reportPrintBtn);
     buttonLayout->addWidget(m_reportExportBtn);
+    buttonLayout->addWidget(m_reportProgress);
     buttonLayout->addStretch();
     layout->addLayout(buttonLayout);
     
@@ -552,6 +807,8 @@ void MainWindow::createReportsTab()
     m_reportsText->setReadOnly(true);
     layout->addWidget(m_reportsText);
     
+    m_reportService = new ReportService(this);
+    
     m_tabWidget->addTab(m_reportsTab, "Отчеты");
 }
 
@@ -611,7 +868,7 @@ void MainWindow::setupConnections()
         dialog.setProperty("prefillCustomerName", customer->getDisplayName());
         if (dialog.exec() == QDialog::Accepted) {
             Rental* rental = dialog.getRental();
-            if (rental->save()) {
+            if (m_rentalManager->saveRental(rental)) {
                 refreshRentalTable();
                 statusBar()->showMessage("Аренда успешно создана", 3000);
             } else {
@@ -628,10 +885,74 @@ void MainWindow::setupConnections()
     
     connect(m_newRentalBtn, &QPushButton::clicked, this, &MainWindow::onNewRental);
     connect(m_completeRentalBtn, &QPushButton::clicked, this, &MainWindow::onCompleteRental);
+    connect(m_batchReturnBtn, &QPushButton::clicked, this, &MainWindow::onBatchCompleteRentals);
     connect(m_viewRentalBtn, &QPushButton::clicked, this, &MainWindow::onViewRental);
     connect(m_printRentalBtn, &QPushButton::clicked, this, &MainWindow::onPrintRental);
+    connect(m_batchPrintBtn, &QPushButton::clicked, this, &MainWindow::onBatchDocuments);
     
     connect(m_generateReportBtn, &QPushButton::clicked, this, &MainWindow::onReports);
+    connect(m_cancelReportBtn, &QPushButton::clicked, m_reportService, &ReportService::cancel);
+    
+    // Фоновая генерация отчётов
+    connect(m_reportService, &ReportService::started, this, [this]() {
+        m_reportProgress->setValue(0);
+        m_reportProgress->setVisible(true);
+        m_cancelReportBtn->setEnabled(true);
+    });
+    connect(m_reportService, &ReportService::progress, m_reportProgress, &QProgressBar::setValue);
+    connect(m_reportService, &ReportService::finished, this, &MainWindow::onReportFinished);
+    connect(m_reportService, &ReportService::exported, this, [this](const ReportRequest& request, const QString& path) {
+        m_reportProgress->setVisible(false);
+        m_cancelReportBtn->setEnabled(false);
+        m_statusLabel->setText("Отчет экспортирован");
+        QMessageBox::information(this, "Готово", QString("Отчёт сохранён: %1").arg(path));
+        AuditLogger::instance().log("Report exported", request.type);
+    });
+    connect(m_reportService, &ReportService::printed, this, [this](const ReportRequest& request) {
+        m_reportProgress->setVisible(false);
+        m_cancelReportBtn->setEnabled(false);
+        m_statusLabel->setText("Отчет отправлен на печать");
+        AuditLogger::instance().log("Report printed", request.type);
+    });
+    connect(m_reportService, &ReportService::cancelled, this, [this]() {
+        m_reportProgress->setVisible(false);
+        m_cancelReportBtn->setEnabled(false);
+        m_statusLabel->setText("Генерация отчета отменена");
+    });
+    connect(m_reportService, &ReportService::failed, this, [this](const QString& error) {
+        m_reportProgress->setVisible(false);
+        m_cancelReportBtn->setEnabled(false);
+        m_statusLabel->setText("Ошибка генерации отчета");
+        QMessageBox::warning(this, "Ошибка", "Не удалось сгенерировать отчёт:\n" + error);
+    });
+    
+    // Фоновое резервное копирование
+    connect(m_cancelBackupBtn, &QPushButton::clicked, m_backupService, &BackupService::cancel);
+    connect(m_backupService, &BackupService::started, this, [this]() {
+        m_backupProgress->setValue(0);
+        m_backupProgress->setVisible(true);
+        m_cancelBackupBtn->setVisible(true);
+        m_statusLabel->setText("Создание резервной копии...");
+    });
+    connect(m_backupService, &BackupService::progress, m_backupProgress, &QProgressBar::setValue);
+    connect(m_backupService, &BackupService::cancelled, this, [this]() {
+        m_backupProgress->setVisible(false);
+        m_cancelBackupBtn->setVisible(false);
+        m_statusLabel->setText("Резервное копирование отменено");
+    });
+    connect(m_backupService, &BackupService::finished, this, [this](const QString& path, bool ok, const QString& error) {
+        m_backupProgress->setVisible(false);
+        m_cancelBackupBtn->setVisible(false);
+        if (ok) {
+            m_statusLabel->setText("Резервная копия создана");
+            AuditLogger::instance().log("Backup created", path, AuditSeverity::Security);
+            QMessageBox::information(this, "Успех", "Резервная копия создана успешно!");
+        } else {
+            m_statusLabel->setText("Ошибка резервного копирования");
+            AuditLogger::instance().log("Backup failed", path + ": " + error, AuditSeverity::Error);
+            QMessageBox::warning(this, "Ошибка", "Не удалось создать резервную копию.\n" + error);
+        }
+    });
     
     // Соединения поиска
     connect(m_customerSearchEdit, &QLineEdit::textChanged, this, &MainWindow::onCustomerSearch);
@@ -712,7 +1033,7 @@ void MainWindow::onNewRental()
     RentalDialog dialog(this);
     if (dialog.exec() == QDialog::Accepted) {
         Rental* rental = dialog.getRental();
-        if (rental->save()) {
+        if (m_rentalManager->saveRental(rental)) {
             refreshRentalTable();
             statusBar()->showMessage("Аренда успешно создана", 3000);
             AuditLogger::instance().log("Rental created",
@@ -764,195 +1085,26 @@ void MainWindow::onViewRentals()
 
 void MainWindow::onReports()
 {
-    m_statusLabel->setText("Генерация отчета...");
+    const ReportRequest request = currentReportRequest();
     
-    QString reportType = m_reportTypeCombo->currentText();
-    QDate startDate = m_reportStartDate->date();
-    QDate endDate = m_reportEndDate->date();
-    
-    QString report = QString("<h2>%1</h2>").arg(reportType);
-    report += QString("<p><b>Период:</b> %1 - %2</p>").arg(startDate.toString("dd.MM.yyyy")).arg(endDate.toString("dd.MM.yyyy"));
-    report += QString("<p><b>Дата генерации:</b> %1</p>").arg(QDateTime::currentDateTime().toString("dd.MM.yyyy HH:mm"));
-    report += "<hr>";
-    
-    // Генерируем реальные отчеты
-    if (reportType == "Отчет по арендам") {
-        QList<Rental*> rentals = Rental::getAll();
-        double totalRevenue = 0.0;
-        double totalDeposits = 0.0;
-        int totalRentals = 0;
-        int activeRentals = 0;
-        int completedRentals = 0;
-        int overdueRentals = 0;
-        
-        report += "<h3>Статистика аренд</h3>";
-        report += "<table border='1' cellpadding='5' cellspacing='0' style='border-collapse: collapse; width: 100%;'>";
-        report += "<tr style='background-color: #1976d2; color: white;'>";
-        report += "<th>ID</th><th>Клиент</th><th>Оборудование</th><th>Количество</th><th>Дата начала</th><th>Дата окончания</th><th>Статус</th><th>Стоимость аренды</th><th>Залог</th>";
-        report += "</tr>";
-        
-        for (Rental* rental : rentals) {
-            if (rental->getStartDate().date() >= startDate && 
-                rental->getStartDate().date() <= endDate) {
-                
-                QString status = rental->getStatus();
-                if (status == "active") {
-                    if (rental->isOverdue()) {
-                        status = "Просрочено";
-                        overdueRentals++;
-                    } else {
-                        status = "Активна";
-                        activeRentals++;
-                    }
-                } else if (status == "completed") {
-                    completedRentals++;
-                }
-                
-                totalRevenue += rental->getTotalPrice();
-                totalDeposits += rental->getDeposit();
-                totalRentals++;
-                
-                report += "<tr>";
-                report += QString("<td>%1</td>").arg(rental->getId());
-                report += QString("<td>%1</td>").arg(rental->getCustomer()->getName());
-                report += QString("<td>%1</td>").arg(rental->getEquipment()->getName());
-                report += QString("<td>%1</td>").arg(rental->getQuantity());
-                report += QString("<td>%1</td>").arg(rental->getStartDate().toString("dd.MM.yyyy HH:mm"));
-                report += QString("<td>%1</td>").arg(rental->getEndDate().toString("dd.MM.yyyy HH:mm"));
-                report += QString("<td>%1</td>").arg(status);
-                report += QString("<td>%1 ₽</td>").arg(QString::number(rental->getTotalPrice(), 'f', 2));
-                report += QString("<td>%1 ₽</td>").arg(QString::number(rental->getDeposit(), 'f', 2));
-                report += "</tr>";
-            }
-        }
-        
-        report += "</table>";
-        report += "<br><h3>Итоговая статистика</h3>";
-        report += QString("<p><b>Всего аренд за период:</b> %1</p>").arg(totalRentals);
-        report += QString("<p><b>Активных аренд:</b> %1</p>").arg(activeRentals);
-        report += QString("<p><b>Завершенных аренд:</b> %1</p>").arg(completedRentals);
-        report += QString("<p><b>Просроченных аренд:</b> %1</p>").arg(overdueRentals);
-        report += QString("<p><b>Общая выручка:</b> <span style='color: green; font-weight: bold;'>%1 ₽</span></p>").arg(QString::number(totalRevenue, 'f', 2));
-        report += QString("<p><b>Общая сумма залогов:</b> <span style='color: blue; font-weight: bold;'>%1 ₽</span></p>").arg(QString::number(totalDeposits, 'f', 2));
-        
-    } else if (reportType == "Отчет по оборудованию") {
-        QList<Equipment*> equipment = Equipment::getAll();
-        report += QString("<h3>Всего оборудования: %1</h3>").arg(equipment.size());
-        
-        QMap<QString, int> categoryCount;
-        QMap<QString, double> categoryRevenue;
-        
-        for (Equipment* item : equipment) {
-            categoryCount[item->getCategory()]++;
-            // Примерная выручка (можно улучшить, добавив реальные данные)
-            categoryRevenue[item->getCategory()] += item->getPrice() * 30; // 30 дней
-        }
-        
-        report += "<h3>По категориям:</h3>";
-        report += "<table border='1' cellpadding='5' cellspacing='0' style='border-collapse: collapse; width: 100%;'>";
-        report += "<tr style='background-color: #1976d2; color: white;'>";
-        report += "<th>Категория</th><th>Количество</th><th>Примерная месячная выручка (₽)</th>";
-        report += "</tr>";
-        
-        for (auto it = categoryCount.begin(); it != categoryCount.end(); ++it) {
-            report += "<tr>";
-            report += QString("<td>%1</td>").arg(it.key());
-            report += QString("<td>%1 шт.</td>").arg(it.value());
-            report += QString("<td>%1 ₽</td>").arg(QString::number(categoryRevenue[it.key()], 'f', 2));
-            report += "</tr>";
-        }
-        
-        report += "</table>";
-        
-    } else if (reportType == "Отчет по клиентам") {
-        QList<Customer*> customers = Customer::getAll();
-        report += QString("<h3>Всего клиентов: %1</h3>").arg(customers.size());
-        
-        // Статистика по новым клиентам за период
-        int newCustomers = 0;
-        QList<Customer*> newCustomersList;
-        
-        for (Customer* customer : customers) {
-            if (customer->getCreatedAt().date() >= startDate && 
-                customer->getCreatedAt().date() <= endDate) {
-                newCustomers++;
-                newCustomersList.append(customer);
-            }
-        }
-        
-        report += QString("<h3>Новых клиентов за период: %1</h3>").arg(newCustomers);
-        
-        if (!newCustomersList.isEmpty()) {
-            report += "<table border='1' cellpadding='5' cellspacing='0' style='border-collapse: collapse; width: 100%;'>";
-            report += "<tr style='background-color: #1976d2; color: white;'>";
-            report += "<th>Имя</th><th>Телефон</th><th>Email</th><th>Дата регистрации</th>";
-            report += "</tr>";
-            
-            for (Customer* customer : newCustomersList) {
-                report += "<tr>";
-                report += QString("<td>%1</td>").arg(customer->getName());
-                report += QString("<td>%1</td>").arg(customer->getPhone());
-                report += QString("<td>%1</td>").arg(customer->getEmail());
-                report += QString("<td>%1</td>").arg(customer->getCreatedAt().toString("dd.MM.yyyy"));
-                report += "</tr>";
-            }
-            
-            report += "</table>";
-        }
-        
-    } else if (reportType == "Финансовый отчет") {
-        QList<Rental*> rentals = Rental::getAll();
-        double totalRevenue = 0.0;
-        double totalDeposits = 0.0;
-        double totalDamage = 0.0;
-        double totalCleaning = 0.0;
-        int totalRentals = 0;
-        int completedRentals = 0;
-        int activeRentals = 0;
-        
-        for (Rental* rental : rentals) {
-            if (rental->getStartDate().date() >= startDate && 
-                rental->getStartDate().date() <= endDate) {
-                totalRevenue += rental->getTotalPrice();
-                totalDeposits += rental->getDeposit();
-                totalDamage += rental->getDamageCost();
-                totalCleaning += rental->getCleaningCost();
-                totalRentals++;
-                
-                if (rental->getStatus() == "completed") {
-                    completedRentals++;
-                } else if (rental->getStatus() == "active") {
-                    activeRentals++;
-                }
-            }
-        }
-        
-        report += "<h3>Финансовая статистика</h3>";
-        report += "<table border='1' cellpadding='5' cellspacing='0' style='border-collapse: collapse; width: 100%;'>";
-        report += "<tr style='background-color: #1976d2; color: white;'>";
-        report += "<th>Показатель</th><th>Значение</th>";
-        report += "</tr>";
-        report += QString("<tr><td>Общая выручка</td><td style='color: green; font-weight: bold;'>%1 ₽</td></tr>").arg(QString::number(totalRevenue, 'f', 2));
-        report += QString("<tr><td>Общие залоги</td><td style='color: blue; font-weight: bold;'>%1 ₽</td></tr>").arg(QString::number(totalDeposits, 'f', 2));
-        report += QString("<tr><td>Стоимость повреждений</td><td style='color: red; font-weight: bold;'>%1 ₽</td></tr>").arg(QString::number(totalDamage, 'f', 2));
-        report += QString("<tr><td>Стоимость уборки</td><td style='color: orange; font-weight: bold;'>%1 ₽</td></tr>").arg(QString::number(totalCleaning, 'f', 2));
-        report += QString("<tr><td>Чистая прибыль</td><td style='color: green; font-weight: bold;'>%1 ₽</td></tr>").arg(QString::number(totalRevenue - totalDamage - totalCleaning, 'f', 2));
-        report += "</table>";
-        
-        report += "<br><h3>Статистика аренд</h3>";
-        report += QString("<p><b>Всего аренд:</b> %1</p>").arg(totalRentals);
-        report += QString("<p><b>Завершенных:</b> %1</p>").arg(completedRentals);
-        report += QString("<p><b>Активных:</b> %1</p>").arg(activeRentals);
-    }
+    // Отчёт строится в фоне; готовый кэшированный придёт сразу через finished
+    m_statusLabel->setText("Генерация отчета...");
+    m_reportService->generate(request);
+}
+
+void MainWindow::onReportFinished(const ReportRequest& request, const QString& html, bool fromCache)
+{
+    m_reportProgress->setVisible(false);
+    m_cancelReportBtn->setEnabled(false);
     
-    m_reportsText->setHtml(report);
-    m_statusLabel->setText("Отчет сгенерирован");
+    m_reportsText->setHtml(html);
+    m_statusLabel->setText(fromCache ? "Отчет сгенерирован (из кэша)" : "Отчет сгенерирован");
 
     AuditLogger::instance().log("Report generated",
         QString("type=%1 period=%2..%3")
-            .arg(reportType)
-            .arg(startDate.toString("yyyy-MM-dd"))
-            .arg(endDate.toString("yyyy-MM-dd")));
+            .arg(request.type)
+            .arg(request.start.toString("yyyy-MM-dd"))
+            .arg(request.end.toString("yyyy-MM-dd")));
 }
 
 void MainWindow::onSettings()
@@ -988,13 +1140,64 @@ void MainWindow::onSettings()
     QPushButton* backupBtn = new QPushButton("Создать резервную копию", dbGroup);
     QPushButton* restoreBtn = new QPushButton("Восстановить из копии", dbGroup);
     QPushButton* auditBtn = new QPushButton("Журнал событий", dbGroup);
+    QPushButton* checkStatsBtn = new QPushButton("Проверить статистику", dbGroup);
+    QPushButton* rebuildStatsBtn = new QPushButton("Перестроить статистику", dbGroup);
     
     dbLayout->addRow("", auditBtn);
     dbLayout->addRow("", backupBtn);
     dbLayout->addRow("", restoreBtn);
+    dbLayout->addRow("", checkStatsBtn);
+    dbLayout->addRow("", rebuildStatsBtn);
     
     layout->addWidget(dbGroup);
     
+    // Шифрование файла БД (SQLCipher): параметры применяются при следующем
+    // открытии базы, файл перешифровывается целиком
+    const SqlCipher::Options cipher = SqlCipher::load();
+    QGroupBox* cipherGroup = new QGroupBox("Шифрование базы (SQLCipher)", &settingsDialog);
+    QFormLayout* cipherLayout = new QFormLayout(cipherGroup);
+    QCheckBox* cipherCheck = new QCheckBox("Шифровать файл базы данных", cipherGroup);
+    cipherCheck->setChecked(cipher.enabled);
+    cipherLayout->addRow("", cipherCheck);
+    QSpinBox* kdfIterSpin = new QSpinBox(cipherGroup);
+    kdfIterSpin->setRange(0, 2000000);
+    kdfIterSpin->setSingleStep(10000);
+    kdfIterSpin->setSpecialValueText("0 (ключ без растяжения)");
+    kdfIterSpin->setValue(cipher.kdfIter);
+    cipherLayout->addRow("Итерации KDF:", kdfIterSpin);
+    QComboBox* pageSizeCombo = new QComboBox(cipherGroup);
+    for (int size = SqlCipher::kMinPageSize; size <= SqlCipher::kMaxPageSize; size *= 2) {
+        pageSizeCombo->addItem(QString("%1 байт").arg(size), size);
+    }
+    pageSizeCombo->setCurrentIndex(qMax(0, pageSizeCombo->findData(cipher.pageSize)));
+    cipherLayout->addRow("Размер страницы:", pageSizeCombo);
+    QSpinBox* cacheSpin = new QSpinBox(cipherGroup);
+    cacheSpin->setRange(512, 1024 * 1024);
+    cacheSpin->setSingleStep(4096);
+    cacheSpin->setSuffix(" КиБ");
+    cacheSpin->setValue(cipher.cacheKiB);
+    cipherLayout->addRow("Кэш страниц:", cacheSpin);
+    QLabel* cipherState = new QLabel(cipherGroup);
+    cipherState->setWordWrap(true);
+    cipherState->setText(!SqlCipher::isAvailable()
+        ? "Драйвер SQLite собран без SQLCipher — шифрование недоступно (см. BUILD_SQLCIPHER_PLUGIN в build.sh)"
+        : (m_database->isEncrypted() ? "Файл базы зашифрован" : "Файл базы не зашифрован"));
+    cipherLayout->addRow("", cipherState);
+    QPushButton* benchmarkBtn = new QPushButton("Замерить скорость с шифрованием", cipherGroup);
+    benchmarkBtn->setEnabled(SqlCipher::isAvailable() && Security::hasDataKey());
+    cipherLayout->addRow("", benchmarkBtn);
+    cipherCheck->setEnabled(SqlCipher::isAvailable() || cipher.enabled);
+    layout->addWidget(cipherGroup);
+
+    auto cipherOptions = [=]() {
+        SqlCipher::Options o;
+        o.enabled = cipherCheck->isChecked();
+        o.kdfIter = kdfIterSpin->value();
+        o.pageSize = pageSizeCombo->currentData().toInt();
+        o.cacheKiB = cacheSpin->value();
+        return o;
+    };
+    
     // Настройки уведомлений
     QGroupBox* notifyGroup = new QGroupBox("Уведомления", &settingsDialog);
     QFormLayout* notifyLayout = new QFormLayout(notifyGroup);
@@ -1031,26 +1234,24 @@ void MainWindow::onSettings()
         if (!AdminGuard::ensureAdmin(this, &m_adminSession, &m_adminMgr)) return;
 
         const QString suggested = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation)
-                                + "/rental_backup_" + QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss") + ".db";
+                                + "/rental_backup_" + QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss") + ".dbx";
 
         const QString fileName = QFileDialog::getSaveFileName(&settingsDialog,
-            "Сохранить резервную копию", suggested, "База данных (*.db);;Все файлы (*)");
+            "Сохранить резервную копию", suggested,
+            "Зашифрованная копия (*.dbx);;База данных (*.db);;Все файлы (*)");
         if (fileName.isEmpty()) return;
 
-        if (m_database->backupDatabase(fileName)) {
-            QMessageBox::information(&settingsDialog, "Успех", "Резервная копия создана успешно!");
-        } else {
-            QMessageBox::warning(&settingsDialog, "Ошибка", "Не удалось создать резервную копию.");
-        }
+        startBackup(&settingsDialog, fileName);
     });
 
     connect(restoreBtn, &QPushButton::clicked, [&, this]() {
+        if (!ensureNoBackup(&settingsDialog)) return;
         if (!AdminGuard::ensureAdmin(this, &m_adminSession, &m_adminMgr)) return;
 
         const QString fileName = QFileDialog::getOpenFileName(&settingsDialog,
             "Выбрать файл для восстановления",
             QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation),
-            "База данных (*.db);;Все файлы (*)");
+            "Резервные копии (*.dbx *.db);;Все файлы (*)");
         if (fileName.isEmpty()) return;
 
         if (QMessageBox::question(&settingsDialog, "Подтверждение",
@@ -1067,10 +1268,91 @@ void MainWindow::onSettings()
         }
     });
     
+    connect(benchmarkBtn, &QPushButton::clicked, [&, this]() {
+        // Замер идёт на копиях базы в закрытом временном каталоге рядом с БД —
+        // в фоне, окно не замирает; каталог живёт, пока идёт поток
+        std::shared_ptr<QTemporaryDir> tempDir(m_database->privateTempDir());
+        if (!tempDir) {
+            QMessageBox::warning(&settingsDialog, "Шифрование и скорость", "Не удалось создать временный каталог");
+            return;
+        }
+        const QString workDir = tempDir->path();
+        const SqlCipher::Options candidate = cipherOptions();
+        const QString path = m_database->getDatabasePath();
+        const QByteArray sourceKey = m_database->cipherKey();
+        const SqlCipher::Options sourceFormat = m_database->cipherFormat();
+        const QByteArray key = SqlCipher::deriveKey(Security::dataKey());
+        auto cancel = std::make_shared<std::atomic_bool>(false);
+        auto report = std::make_shared<SqlCipher::BenchmarkReport>();
+
+        QProgressDialog progress("Замер скорости запросов…", "Отмена", 0, 0, &settingsDialog);
+        progress.setWindowModality(Qt::WindowModal);
+        progress.setMinimumDuration(0);
+        QEventLoop loop;
+        QThread* worker = QThread::create([=]() {
+            *report = SqlCipher::benchmark(workDir, path, sourceKey, sourceFormat, key, candidate, cancel.get());
+        });
+        connect(worker, &QThread::finished, &loop, &QEventLoop::quit);
+        connect(worker, &QThread::finished, worker, &QObject::deleteLater);
+        connect(&progress, &QProgressDialog::canceled, [cancel]() { *cancel = true; });
+        worker->start(QThread::LowPriority);
+        progress.show();
+        loop.exec();
+        progress.close();
+
+        AuditLogger::instance().log("SQLCipher benchmark",
+            QString("kdf_iter=%1 page_size=%2 cache_kib=%3 ok=%4")
+                .arg(candidate.kdfIter).arg(candidate.pageSize).arg(candidate.cacheKiB).arg(report->ok));
+        if (report->ok) {
+            QMessageBox::information(&settingsDialog, "Шифрование и скорость", report->toText());
+        } else if (!cancel->load()) {
+            QMessageBox::warning(&settingsDialog, "Шифрование и скорость", report->toText());
+        }
+    });
+
+    connect(checkStatsBtn, &QPushButton::clicked, [&, this]() {
+        const int mismatches = m_database->checkDailyStats();
+        if (mismatches < 0) {
+            QMessageBox::warning(&settingsDialog, "Ошибка", "Не удалось проверить статистику.");
+        } else if (mismatches == 0) {
+            QMessageBox::information(&settingsDialog, "Статистика", "Дневная статистика согласована с арендами.");
+        } else {
+            QMessageBox::warning(&settingsDialog, "Статистика",
+                QString("Найдено расхождений: %1. Рекомендуется перестроить статистику.").arg(mismatches));
+        }
+        AuditLogger::instance().log("Daily stats check", QString("mismatches=%1").arg(mismatches));
+    });
+
+    connect(rebuildStatsBtn, &QPushButton::clicked, [&, this]() {
+        if (!AdminGuard::ensureAdmin(this, &m_adminSession, &m_adminMgr)) return;
+
+        if (m_database->rebuildDailyStats()) {
+            AuditLogger::instance().log("Daily stats rebuilt", "", AuditSeverity::Warning);
+            QMessageBox::information(&settingsDialog, "Готово", "Дневная статистика перестроена.");
+        } else {
+            QMessageBox::warning(&settingsDialog, "Ошибка", "Не удалось перестроить статистику.");
+        }
+    });
+    
     connect(buttonBox, &QDialogButtonBox::accepted, &settingsDialog, &QDialog::accept);
     connect(buttonBox, &QDialogButtonBox::rejected, &settingsDialog, &QDialog::reject);
     
     if (settingsDialog.exec() == QDialog::Accepted) {
+        const SqlCipher::Options wanted = cipherOptions();
+        const SqlCipher::Options current = SqlCipher::load();
+        if (!wanted.sameFormat(current) || wanted.cacheKiB != current.cacheKiB) {
+            if (AdminGuard::ensureAdmin(this, &m_adminSession, &m_adminMgr)) {
+                SqlCipher::save(wanted);
+                AuditLogger::instance().log("SQLCipher settings changed",
+                    QString("enabled=%1 kdf_iter=%2 page_size=%3 cache_kib=%4")
+                        .arg(wanted.enabled).arg(wanted.kdfIter).arg(wanted.pageSize).arg(wanted.cacheKiB),
+                    AuditSeverity::Security);
+                if (!wanted.sameFormat(current)) {
+                    QMessageBox::information(this, "Шифрование базы",
+                        "Файл базы будет перешифрован при следующем запуске программы.");
+                }
+            }
+        }
         loadStyleSheet("light");
         statusBar()->showMessage("Настройки сохранены и применены", 2000);
     }
@@ -1136,7 +1418,7 @@ void MainWindow::onEditEquipment()
     
     EquipmentDialog dialog(equipment, this);
     if (dialog.exec() == QDialog::Accepted) {
-        if (equipment->update()) {
+        if (m_rentalManager->updateEquipment(equipment)) {
             refreshEquipmentTable();
             statusBar()->showMessage("Оборудование успешно обновлено", 3000);
             AuditLogger::instance().log("Equipment updated", QString("id=%1 name=%2").arg(equipment->getId()).arg(equipment->getName()));
@@ -1258,7 +1540,7 @@ void MainWindow::onCompleteRental()
     connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
     
     if (dialog.exec() == QDialog::Accepted) {
-        if (rental->complete(damageCostSpin->value(), cleaningCostSpin->value(), finalDepositSpin->value(), notesEdit->toPlainText())) {
+        if (m_rentalManager->completeRental(rental, damageCostSpin->value(), cleaningCostSpin->value(), finalDepositSpin->value(), notesEdit->toPlainText())) {
             refreshRentalTable();
             statusBar()->showMessage("Аренда успешно завершена", 3000);
             AuditLogger::instance().log("Rental completed", QString("id=%1").arg(rental->getId()));
@@ -1270,6 +1552,127 @@ void MainWindow::onCompleteRental()
     delete rental;
 }
 
+void MainWindow::onBatchCompleteRentals()
+{
+    QList<int> ids;
+    for (const QModelIndex& index : m_rentalTable->selectionModel()->selectedRows(0)) {
+        ids.append(m_rentalTable->item(index.row(), 0)->text().toInt());
+    }
+    if (ids.isEmpty()) {
+        QMessageBox::information(this, "Информация", "Выберите аренды для возврата");
+        return;
+    }
+    
+    // Одним запросом загружаем все выбранные аренды, завершённые пропускаем
+    QSqlQuery query = m_database->getRentalsByIds(ids);
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle("Групповой возврат");
+    dialog.setModal(true);
+    dialog.setMinimumSize(900, 500);
+    
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
+    
+    QTableWidget* table = new QTableWidget(&dialog);
+    table->setColumnCount(8);
+    table->setHorizontalHeaderLabels({"ID", "Клиент", "Оборудование", "Количество", "Залог (₽)",
+                                      "Повреждения (₽)", "Уборка (₽)", "Возврат залога (₽)"});
+    table->setSelectionMode(QAbstractItemView::NoSelection);
+    layout->addWidget(table);
+    
+    struct LineWidgets {
+        int rentalId;
+        QDoubleSpinBox* damage;
+        QDoubleSpinBox* cleaning;
+        QDoubleSpinBox* finalDeposit;
+    };
+    QList<LineWidgets> lines;
+    int skipped = 0;
+    
+    while (query.next()) {
+        if (query.value("status").toString() != "active") {
+            skipped++;
+            continue;
+        }
+        const double deposit = query.value("deposit").toDouble();
+        const int row = table->rowCount();
+        table->insertRow(row);
+        table->setItem(row, 0, new QTableWidgetItem(query.value("id").toString()));
+        table->setItem(row, 1, new QTableWidgetItem(query.value("customer_name").toString()));
+        table->setItem(row, 2, new QTableWidgetItem(query.value("equipment_name").toString()));
+        table->setItem(row, 3, new QTableWidgetItem(query.value("quantity").toString()));
+        table->setItem(row, 4, new QTableWidgetItem(QString::number(deposit, 'f', 2)));
+        
+        QDoubleSpinBox* damageSpin = new QDoubleSpinBox(table);
+        damageSpin->setRange(0, 10000);
+        QDoubleSpinBox* cleaningSpin = new QDoubleSpinBox(table);
+        cleaningSpin->setRange(0, 1000);
+        QDoubleSpinBox* finalDepositSpin = new QDoubleSpinBox(table);
+        finalDepositSpin->setRange(0, deposit);
+        finalDepositSpin->setValue(deposit);
+        
+        // Возврат залога по умолчанию уменьшается на расходы строки
+        auto recalc = [=]() {
+            finalDepositSpin->setValue(qMax(0.0, deposit - damageSpin->value() - cleaningSpin->value()));
+        };
+        connect(damageSpin, QOverload<double>::of(&QDoubleSpinBox::valueChanged), &dialog, recalc);
+        connect(cleaningSpin, QOverload<double>::of(&QDoubleSpinBox::valueChanged), &dialog, recalc);
+        
+        table->setCellWidget(row, 5, damageSpin);
+        table->setCellWidget(row, 6, cleaningSpin);
+        table->setCellWidget(row, 7, finalDepositSpin);
+        lines.append(LineWidgets{query.value("id").toInt(), damageSpin, cleaningSpin, finalDepositSpin});
+    }
+    
+    if (lines.isEmpty()) {
+        QMessageBox::information(this, "Информация", "Среди выбранных нет активных аренд");
+        return;
+    }
+    
+    QFormLayout* formLayout = new QFormLayout();
+    QLineEdit* notesEdit = new QLineEdit(&dialog);
+    notesEdit->setPlaceholderText("Общая заметка для всех строк...");
+    formLayout->addRow("Заметки:", notesEdit);
+    if (skipped > 0) {
+        formLayout->addRow("", new QLabel(QString("Пропущено неактивных аренд: %1").arg(skipped), &dialog));
+    }
+    layout->addLayout(formLayout);
+    
+    QDialogButtonBox* buttonBox = new QDialogButtonBox(
+        QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    layout->addWidget(buttonBox);
+    
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+    
+    QList<RentalReturnLine> returnLines;
+    QStringList returnedIds;
+    for (const LineWidgets& w : lines) {
+        RentalReturnLine line;
+        line.rentalId = w.rentalId;
+        line.damageCost = w.damage->value();
+        line.cleaningCost = w.cleaning->value();
+        line.finalDeposit = w.finalDeposit->value();
+        line.notes = notesEdit->text();
+        returnLines.append(line);
+        returnedIds << QString::number(w.rentalId);
+    }
+    
+    if (m_rentalManager->completeRentals(returnLines)) {
+        refreshRentalTable();
+        refreshEquipmentTable();
+        statusBar()->showMessage(QString("Возвращено аренд: %1").arg(returnLines.size()), 3000);
+        AuditLogger::instance().log("Rentals batch completed", QString("ids=%1").arg(returnedIds.join(",")));
+    } else {
+        QMessageBox::warning(this, "Ошибка", "Не удалось выполнить групповой возврат. Изменения не сохранены.");
+        AuditLogger::instance().log("Rentals batch complete failed", QString("ids=%1").arg(returnedIds.join(",")), AuditSeverity::Error);
+    }
+}
+
 void MainWindow::onViewRental()
 {
     if (m_selectedRentalId == -1) {
@@ -1343,96 +1746,20 @@ void MainWindow::onPrintRental()
         return;
     }
 
-    Customer* c = rental->getCustomer();
-    Equipment* e = rental->getEquipment();
-    const QString customerName = c ? c->getName() : "";
-    const QString customerPhone = c ? c->getPhone() : "";
-    const QString customerEmail = c ? c->getEmail() : "";
-    const QString customerPassport = c ? c->getPassport() : "";
-    const QString customerAddress = c ? c->getAddress() : "";
-
-    const QString equipmentName = e ? e->getName() : "";
-    const QString equipmentCategory = e ? e->getCategory() : "";
-    const QString equipmentPrice = e ? QString::number(e->getPrice(), 'f', 2) : "0.00";
-
-    const QString startDt = rental->getStartDate().toString("dd.MM.yyyy HH:mm");
-    const QString endDt = rental->getEndDate().toString("dd.MM.yyyy HH:mm");
-    const QString quantity = QString::number(rental->getQuantity());
-    const QString totalPrice = QString::number(rental->getTotalPrice(), 'f', 2);
-    const QString deposit = QString::number(rental->getDeposit(), 'f', 2);
-
-    QString html;
-    html += "<html><head><meta charset='utf-8'><style>";
-    html += "body{font-family:'Segoe UI',Arial,sans-serif;color:#111;} h1{font-size:18px;margin:0 0 12px;}";
-    html += "table{width:100%;border-collapse:collapse;margin-top:10px;} th,td{border:1px solid #444;padding:6px;text-align:left;font-size:12px;}";
-    html += "section{margin-bottom:12px;} .muted{color:#666;font-size:12px;}";
-    html += "</style></head><body>";
-    html += "<h1>Договор аренды оборудования</h1>";
-    html += QString("<div class='muted'>Дата печати: %1</div>").arg(QDateTime::currentDateTime().toString("dd.MM.yyyy HH:mm"));
-
-    html += "<section><h3>Стороны</h3>";
-    html += "<table>";
-    html += QString("<tr><th>Клиент</th><td>%1</td></tr>").arg(customerName.toHtmlEscaped());
-    html += QString("<tr><th>Телефон</th><td>%1</td></tr>").arg(customerPhone.toHtmlEscaped());
-    html += QString("<tr><th>Email</th><td>%1</td></tr>").arg(customerEmail.toHtmlEscaped());
-    html += QString("<tr><th>Паспорт</th><td>%1</td></tr>").arg(customerPassport.toHtmlEscaped());
-    html += QString("<tr><th>Адрес регистрации</th><td>%1</td></tr>").arg(customerAddress.toHtmlEscaped());
-    html += "</table></section>";
-
-    html += "<section><h3>Предмет договора</h3>";
-    html += "<table>";
-    html += QString("<tr><th>Оборудование</th><td>%1</td></tr>").arg(equipmentName.toHtmlEscaped());
-    html += QString("<tr><th>Категория</th><td>%1</td></tr>").arg(equipmentCategory.toHtmlEscaped());
-    html += QString("<tr><th>Количество</th><td>%1</td></tr>").arg(quantity.toHtmlEscaped());
-    html += QString("<tr><th>Период аренды</th><td>%1 — %2</td></tr>").arg(startDt, endDt);
-    html += "</table></section>";
-
-    html += "<section><h3>Стоимость</h3>";
-    html += "<table>";
-    html += QString("<tr><th>Цена за 1-й день</th><td>%1 ₽</td></tr>").arg(equipmentPrice);
-    html += QString("<tr><th>Итоговая стоимость</th><td><b>%1 ₽</b></td></tr>").arg(totalPrice);
-    html += QString("<tr><th>Залог</th><td>%1 ₽</td></tr>").arg(deposit);
-    html += "</table></section>";
-
-    if (!rental->getNotes().isEmpty()) {
-        html += QString("<section><h3>Примечания</h3><div>%1</div></section>").arg(rental->getNotes().toHtmlEscaped());
-    }
-
-    html += "<section><h3>Подписи</h3>";
-    html += "<table><tr><th style='width:40%'>Арендодатель</th><th style='width:40%'>Арендатор</th></tr>";
-    html += "<tr><td style='height:60px;vertical-align:bottom'>____________________</td><td style='vertical-align:bottom'>____________________</td></tr></table>";
-    html += "</section>";
-
-    html += "</body></html>";
+    const ContractData contract = ContractData::fromRental(*rental);
 
     // Option A: Fill user-provided DOCX template if present
-    QString templatePath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/Договор Прокат Всего  2025.docx";
+    QString templatePath = contractTemplatePath();
     if (!QFile::exists(templatePath)) {
         templatePath = QFileDialog::getOpenFileName(this,
             "Выберите DOCX шаблон договора",
             QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation),
             "Шаблон договора (*.docx)");
     }
-    QMap<QString, QString> placeholders = {
-        {"{{DATE}}", QDate::currentDate().toString("dd.MM.yyyy")},
-        {"{{CUSTOMER_NAME}}", customerName},
-        {"{{CUSTOMER_PHONE}}", customerPhone},
-        {"{{CUSTOMER_EMAIL}}", customerEmail},
-        {"{{CUSTOMER_PASSPORT}}", customerPassport},
-        {"{{CUSTOMER_ADDRESS}}", customerAddress},
-        {"{{EQUIPMENT_NAME}}", equipmentName},
-        {"{{EQUIPMENT_CATEGORY}}", equipmentCategory},
-        {"{{QUANTITY}}", quantity},
-        {"{{START}}", startDt},
-        {"{{END}}", endDt},
-        {"{{TOTAL}}", totalPrice},
-        {"{{DEPOSIT}}", deposit},
-        {"{{NOTES}}", rental->getNotes()}
-    };
     QString filledDocxPath;
     bool docxOk = false;
     if (QFile::exists(templatePath)) {
-        docxOk = generateDocxFromTemplate(templatePath, placeholders, filledDocxPath);
+        docxOk = generateDocxFromTemplate(templatePath, contract.placeholders(), filledDocxPath);
     }
     if (docxOk) {
         QMessageBox::information(this, "Готово", QString("Заполненный договор сохранен: %1").arg(filledDocxPath));
@@ -1440,17 +1767,17 @@ void MainWindow::onPrintRental()
     } else {
         if (!templatePath.isEmpty()) {
             QMessageBox::warning(this, "Шаблон не заполнен",
-                                 "Не удалось заполнить шаблон .docx. Будет напечатана HTML-версия из приложения.");
+                                 "Не удалось заполнить шаблон .docx. Договор будет сохранен в PDF.");
         }
-        // Fallback: print HTML
-        QTextDocument doc;
-        doc.setHtml(html);
-        QPrinter printer(QPrinter::HighResolution);
-        printer.setPageSize(QPageSize(QPageSize::A4));
-        QPrintDialog dialog(&printer, this);
-        dialog.setWindowTitle("Печать договора аренды");
-        if (dialog.exec() == QDialog::Accepted) {
-            doc.print(&printer);
+        // Fallback: договор сразу в PDF, без диалога печати; печать — из просмотрщика
+        const QString pdfPath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) +
+            QString("/Договор_аренды_%1_%2.pdf").arg(contract.rentalId)
+                .arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmm"));
+        QString error;
+        if (PdfRenderer().renderContract(contract, pdfPath, &error)) {
+            QDesktopServices::openUrl(QUrl::fromLocalFile(pdfPath));
+        } else {
+            QMessageBox::warning(this, "Ошибка", "Не удалось сформировать PDF договора: " + error);
         }
     }
 
@@ -1459,75 +1786,119 @@ void MainWindow::onPrintRental()
     delete rental;
 }
 
-// Simple DOCX templating via unzip/zip (works on Linux and Windows with 7zip/zip installed)
+QString MainWindow::contractTemplatePath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/Договор Прокат Всего  2025.docx";
+}
+
+void MainWindow::onBatchDocuments()
+{
+    QList<int> ids;
+    for (const QModelIndex& index : m_rentalTable->selectionModel()->selectedRows(0)) {
+        ids.append(m_rentalTable->item(index.row(), 0)->text().toInt());
+    }
+    if (ids.isEmpty()) {
+        QMessageBox::information(this, "Информация", "Выберите аренды для пакетной печати");
+        return;
+    }
+    if (m_documentJob && m_documentJob->isRunning()) {
+        QMessageBox::information(this, "Информация", "Пакетная печать уже выполняется");
+        return;
+    }
+    
+    const QString templatePath = contractTemplatePath();
+    const bool hasTemplate = QFile::exists(templatePath);
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle(QString("Пакетная печать (%1 аренд)").arg(ids.size()));
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
+    QCheckBox* docxBox = new QCheckBox("Договоры DOCX по шаблону", &dialog);
+    docxBox->setChecked(hasTemplate);
+    docxBox->setEnabled(hasTemplate);
+    if (!hasTemplate) docxBox->setToolTip("Шаблон не найден: " + templatePath);
+    QCheckBox* pdfBox = new QCheckBox("Договоры PDF", &dialog);
+    pdfBox->setChecked(!hasTemplate);
+    QCheckBox* receiptBox = new QCheckBox("Квитанции PDF", &dialog);
+    QCheckBox* mergedBox = new QCheckBox("Один общий PDF", &dialog);
+    layout->addWidget(docxBox);
+    layout->addWidget(pdfBox);
+    layout->addWidget(receiptBox);
+    layout->addWidget(mergedBox);
+    QDialogButtonBox* buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    layout->addWidget(buttonBox);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+    
+    const QString outputDir = QFileDialog::getExistingDirectory(this, "Каталог для документов",
+        QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation));
+    if (outputDir.isEmpty()) {
+        return;
+    }
+    
+    DocumentBatchRequest request;
+    request.rentalIds = ids;
+    request.outputDir = outputDir;
+    request.templatePath = templatePath;
+    request.docx = docxBox->isChecked();
+    request.pdf = pdfBox->isChecked();
+    request.receipts = receiptBox->isChecked();
+    request.mergedPdf = mergedBox->isChecked();
+    
+    if (!m_documentJob) {
+        m_documentJob = new DocumentBatchJob(this);
+        connect(m_documentJob, &DocumentBatchJob::progress, this, [this](int done, int total) {
+            if (m_batchProgress) {
+                m_batchProgress->setMaximum(total);
+                m_batchProgress->setValue(done);
+            }
+        });
+        connect(m_documentJob, &DocumentBatchJob::itemFailed, this, [](int rentalId, const QString& error) {
+            qDebug() << "Документ не создан для аренды" << rentalId << ":" << error;
+        });
+        connect(m_documentJob, &DocumentBatchJob::finished, this,
+                [this](const QStringList& files, int failed, bool cancelled) {
+            if (m_batchProgress) m_batchProgress->close();
+            AuditLogger::instance().log("Batch documents", QString("files=%1 failed=%2").arg(files.size()).arg(failed));
+            QString message = QString("Создано файлов: %1").arg(files.size());
+            if (failed > 0) message += QString("\nС ошибками: %1").arg(failed);
+            if (cancelled) message += "\nЗадание отменено";
+            m_statusLabel->setText(message.section('\n', 0, 0));
+            QMessageBox::information(this, "Пакетная печать", message);
+        });
+    }
+    
+    QString error;
+    if (!m_documentJob->start(request, &error)) {
+        QMessageBox::warning(this, "Ошибка", error);
+        return;
+    }
+    
+    // Один немодальный индикатор на всё задание
+    m_batchProgress = new QProgressDialog("Подготовка документов...", "Отмена", 0, 0, this);
+    m_batchProgress->setAttribute(Qt::WA_DeleteOnClose);
+    m_batchProgress->setWindowModality(Qt::NonModal);
+    m_batchProgress->setMinimumDuration(0);
+    connect(m_batchProgress, &QProgressDialog::canceled, m_documentJob, &DocumentBatchJob::cancel);
+    m_batchProgress->show();
+}
+
+// Заполнение DOCX-шаблона в процессе, без распаковки во временный каталог
 bool MainWindow::generateDocxFromTemplate(const QString& templatePath, const QMap<QString, QString>& values, QString& outputDocxPath)
 {
     if (!QFile::exists(templatePath)) return false;
 
-    QTemporaryDir tempDir;
-    if (!tempDir.isValid()) return false;
-    QString tempPath = tempDir.path();
-
-    // Unzip DOCX (ZIP) into temp directory
-#if defined(Q_OS_WIN)
-    // Try PowerShell Expand-Archive if available
-    {
-        QProcess p;
-        QStringList args;
-        args << "-NoLogo" << "-NoProfile" << "-Command"
-             << QString("Expand-Archive -Path \"%1\" -DestinationPath \"%2\" -Force").arg(templatePath, tempPath);
-        p.start("powershell", args);
-        p.waitForFinished(-1);
-        if (p.exitCode() != 0) return false;
-    }
-#else
-    // Ensure unzip exists
-    if (QProcess::execute("which", QStringList() << "unzip") != 0) return false;
-    if (QProcess::execute("unzip", QStringList() << "-o" << templatePath << "-d" << tempPath) != 0) return false;
-#endif
-
-    // Replace placeholders in word/document.xml
-    QString docXmlPath = tempPath + "/word/document.xml";
-    QFile f(docXmlPath);
-    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
-    QString xml = QString::fromUtf8(f.readAll());
-    f.close();
-    for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
-        xml.replace(it.key(), it.value().toHtmlEscaped());
-    }
-    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) return false;
-    f.write(xml.toUtf8());
-    f.close();
-
-    // Zip back to DOCX
     QString outName = QString("Договор_аренды_%1.docx").arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmm"));
     outputDocxPath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/" + outName;
-#if defined(Q_OS_WIN)
-    {
-        QProcess p;
-        QString t = tempPath; t.replace("\\", "/");
-        QString o = outputDocxPath; o.replace("\\", "/");
-        QStringList args;
-        args << "-NoLogo" << "-NoProfile" << "-Command"
-             << QString("Compress-Archive -Path \"%1/*\" -DestinationPath \"%2\" -Force").arg(t, o);
-        p.start("powershell", args);
-        p.waitForFinished(-1);
-        if (p.exitCode() != 0) return false;
-    }
-#else
-    // Ensure zip exists
-    if (QProcess::execute("which", QStringList() << "zip") != 0) return false;
-    {
-        QProcess p;
-        p.setWorkingDirectory(tempPath);
-        QStringList args;
-        args << "-r" << outputDocxPath << ".";
-        p.start("zip", args);
-        p.waitForFinished(-1);
-        if (p.exitCode() != 0) return false;
-    }
-#endif
-    return QFile::exists(outputDocxPath);
+
+    QString error;
+    if (!DocxTemplate::fill(templatePath, values, outputDocxPath, &error)) {
+        qDebug() << "Ошибка заполнения шаблона договора:" << error;
+        return false;
+    }
+    return true;
 }
 
 void MainWindow::onCustomerSearch()
@@ -1588,11 +1959,13 @@ void MainWindow::onRentalSelectionChanged()
     if (selectedItems.isEmpty()) {
         m_selectedRentalId = -1;
         m_completeRentalBtn->setEnabled(false);
+        m_batchReturnBtn->setEnabled(false);
         m_viewRentalBtn->setEnabled(false);
     } else {
         int row = selectedItems.first()->row();
         m_selectedRentalId = m_rentalTable->item(row, 0)->text().toInt();
         m_completeRentalBtn->setEnabled(true);
+        m_batchReturnBtn->setEnabled(true);
         m_viewRentalBtn->setEnabled(true);
     }
 }
@@ -1687,6 +2060,44 @@ void MainWindow::displayRentals(const QList<Rental*>& rentals)
     }
 }
 
+void MainWindow::showNotificationDigest(const QList<Notification>& items)
+{
+    if (items.isEmpty()) {
+        return;
+    }
+    
+    int overdue = 0;
+    QStringList lines;
+    for (const Notification& n : items) {
+        if (n.kind == NotificationKind::Overdue) {
+            overdue++;
+        }
+        lines << n.message;
+    }
+    const QString summary = QString("Новых уведомлений: %1 (просрочено: %2, напоминаний о возврате: %3)")
+                                .arg(items.size()).arg(overdue).arg(items.size() - overdue);
+    statusBar()->showMessage(summary, 10000);
+    
+    // Переиспользуем открытое окно: новые алерты дописываются сверху, а не
+    // плодят диалоги. Окно могут не закрывать днями — храним только последние строки
+    const int maxLines = 500;
+    if (m_digestBox) {
+        lines += m_digestBox->detailedText().split('\n', Qt::SkipEmptyParts);
+        if (lines.size() > maxLines) lines.erase(lines.begin() + maxLines, lines.end());
+        m_digestBox->setText(summary);
+        m_digestBox->setDetailedText(lines.join("\n"));
+        return;
+    }
+    if (lines.size() > maxLines) lines.erase(lines.begin() + maxLines, lines.end());
+    
+    m_digestBox = new QMessageBox(QMessageBox::Warning, "Уведомления", summary, QMessageBox::Ok, this);
+    m_digestBox->setAttribute(Qt::WA_DeleteOnClose);
+    m_digestBox->setModal(false);
+    m_digestBox->setWindowModality(Qt::NonModal);
+    m_digestBox->setDetailedText(lines.join("\n"));
+    m_digestBox->show();
+}
+
 // Style methods
 void MainWindow::loadStyleSheet(const QString& theme)
 {
@@ -2,6 +2,7 @@
 #include "database.h"
 #include "customer.h"
 #include "equipment.h"
+#include "PricingEngine.h"
 #include <QDebug>
 
 Rental::Rental(QObject *parent)
@@ -73,11 +74,9 @@ double Rental::calculateTotalPrice() const
         return 0.0;
     }
     
-    int days = getRentalDays();
-    double equipmentPrice = m_equipment->calculateRentalPrice(days);
-    double totalPrice = equipmentPrice * m_quantity;
-    
-    return totalPrice;
+    // Сезоны, выходные, скидки за срок и количество — по скомпилированной таблице тарифа
+    PriceQuote quote = PricingEngine::instance().quote(m_equipment, m_quantity, m_startDate, m_endDate);
+    return quote.total;
 }
 
 double Rental::calculateDeposit() const
@@ -256,12 +255,8 @@ bool Rental::complete(double damageCost, double cleaningCost, double finalDeposi
         m_notes = notes;
         m_updatedAt = QDateTime::currentDateTime();
         
-        // Освобождаем оборудование
-        if (m_equipment) {
-            m_equipment->releaseQuantity(m_quantity);
-            m_equipment->save();
-        }
-        
+        // Склад освобождает RentalManager — в одном месте для одиночного
+        // и группового возврата
         return true;
     }
     
@@ -1,11 +1,39 @@
 #include "rentalmanager.h"
 #include "database.h"
+#include "PricingEngine.h"
 #include <QDebug>
-#include <QMessageBox>
+#include <QHash>
+#include <QMap>
+#include <QSettings>
+
+static QString overdueMessage(Rental* rental)
+{
+    return QString("Аренда #%1 просрочена! Клиент: %2, Оборудование: %3")
+            .arg(rental->getId())
+            .arg(rental->getCustomer() ? rental->getCustomer()->getName() : "Unknown")
+            .arg(rental->getEquipment() ? rental->getEquipment()->getName() : "Unknown");
+}
+
+static QString reminderMessage(Rental* rental)
+{
+    return QString("Аренда #%1: возврат до %2 (%3)")
+            .arg(rental->getId())
+            .arg(rental->getEndDate().toString("dd.MM.yyyy HH:mm"))
+            .arg(rental->getCustomer() ? rental->getCustomer()->getName() : "Unknown");
+}
 
 RentalManager::RentalManager(QObject *parent)
     : QObject(parent)
+    , m_overdueScheduler(new OverdueScheduler(this))
+    , m_reminderScheduler(new OverdueScheduler(this))
+    , m_notifications(new NotificationCenter(this))
 {
+    connect(m_overdueScheduler, &OverdueScheduler::deadlineReached, this, &RentalManager::onRentalDeadline);
+    connect(m_reminderScheduler, &OverdueScheduler::deadlineReached, this, &RentalManager::onReminderDeadline);
+    connect(&Database::getInstance(), &Database::databaseReplaced, this, &RentalManager::onDatabaseReplaced);
+    
+    // Каталог для внешнего рассыльщика задаётся в настройках (по умолчанию выключен)
+    m_notifications->setSpoolDirectory(QSettings().value("notifications/spool_dir").toString());
 }
 
 RentalManager::~RentalManager()
@@ -29,7 +57,7 @@ Rental* RentalManager::createRental(Customer* customer, Equipment* equipment, in
     }
     
     // Рассчитываем стоимость
-    double totalPrice = calculateRentalPrice(equipment, calculateRentalDays(startDate, endDate));
+    double totalPrice = PricingEngine::instance().quote(equipment, quantity, startDate, endDate).total;
     double deposit = calculateDeposit(equipment, quantity);
     
     // Создаем аренду
@@ -37,9 +65,9 @@ Rental* RentalManager::createRental(Customer* customer, Equipment* equipment, in
                                totalPrice, deposit, notes, this);
     
     if (rental->save()) {
-        // Резервируем оборудование
-        reserveEquipment(equipment, quantity);
-        
+        scheduleDeadlines(rental->getId(), rental->getEndDate());
+        // Склад зарезервировал Rental::save()
+        emit equipmentReserved(equipment, quantity);
         emit rentalCreated(rental);
         return rental;
     } else {
@@ -59,6 +87,7 @@ bool RentalManager::completeRental(Rental* rental, double damageCost, double cle
         // Освобождаем оборудование
         releaseEquipment(rental->getEquipment(), rental->getQuantity());
         
+        unscheduleDeadlines(rental->getId());
         emit rentalCompleted(rental);
         return true;
     }
@@ -66,6 +95,109 @@ bool RentalManager::completeRental(Rental* rental, double damageCost, double cle
     return false;
 }
 
+bool RentalManager::saveRental(Rental* rental)
+{
+    if (!rental || rental->getId() != 0) {
+        return false;
+    }
+    
+    if (!rental->save()) {
+        return false;
+    }
+    
+    scheduleDeadlines(rental->getId(), rental->getEndDate());
+    // Склад зарезервировал Rental::save()
+    emit equipmentReserved(rental->getEquipment(), rental->getQuantity());
+    emit rentalCreated(rental);
+    return true;
+}
+
+bool RentalManager::updateEquipment(Equipment* equipment)
+{
+    if (!equipment || equipment->getId() == 0 || !equipment->update()) {
+        return false;
+    }
+    
+    emit equipmentUpdated(equipment);
+    return true;
+}
+
+bool RentalManager::completeRentals(const QList<RentalReturnLine>& lines)
+{
+    if (lines.isEmpty()) {
+        return false;
+    }
+    
+    QList<int> ids;
+    ids.reserve(lines.size());
+    for (const RentalReturnLine& line : lines) {
+        if (ids.contains(line.rentalId)) {
+            qDebug() << "Аренда указана в возврате повторно:" << line.rentalId;
+            return false;
+        }
+        ids.append(line.rentalId);
+    }
+    
+    Database& db = Database::getInstance();
+    
+    if (!db.beginTransaction()) {
+        return false;
+    }
+    
+    // Статус читается внутри транзакции, а UPDATE завершает только активную
+    // аренду: параллельный возврат той же аренды не проведётся дважды.
+    // Одним запросом берём оборудование, количество и статус всех строк
+    QHash<int, int> equipmentByRental;
+    QHash<int, int> quantityByRental;
+    {
+        QSqlQuery query = db.getRentalsByIds(ids);
+        while (query.next()) {
+            const int id = query.value("id").toInt();
+            if (query.value("status").toString() != "active") {
+                qDebug() << "Аренда уже не активна:" << id;
+                query.finish();
+                db.rollbackTransaction();
+                return false;
+            }
+            equipmentByRental.insert(id, query.value("equipment_id").toInt());
+            quantityByRental.insert(id, query.value("quantity").toInt());
+        }
+    }
+    if (equipmentByRental.size() != ids.size()) {
+        qDebug() << "Не все аренды из возврата найдены";
+        db.rollbackTransaction();
+        return false;
+    }
+    
+    // Освобождаем склад одной операцией на единицу оборудования, а не на аренду
+    QMap<int, int> releasedByEquipment;
+    for (const RentalReturnLine& line : lines) {
+        if (!db.completeRental(line.rentalId, line.damageCost, line.cleaningCost,
+                               line.finalDeposit, line.notes)) {
+            db.rollbackTransaction();
+            return false;
+        }
+        releasedByEquipment[equipmentByRental.value(line.rentalId)] += quantityByRental.value(line.rentalId);
+    }
+    for (auto it = releasedByEquipment.constBegin(); it != releasedByEquipment.constEnd(); ++it) {
+        if (!db.releaseEquipmentQuantity(it.key(), it.value())) {
+            db.rollbackTransaction();
+            return false;
+        }
+    }
+    
+    if (!db.commitTransaction()) {
+        db.rollbackTransaction();
+        return false;
+    }
+    
+    for (int id : ids) {
+        unscheduleDeadlines(id);
+    }
+    emit rentalsCompleted(lines);
+    return true;
+}
+
 bool RentalManager::cancelRental(Rental* rental, const QString& reason)
 {
     if (!rental || !rental->isActive()) {
@@ -80,6 +212,7 @@ bool RentalManager::cancelRental(Rental* rental, const QString& reason)
     rental->setNotes(rental->getNotes() + "\nОтменено: " + reason);
     
     if (rental->update()) {
+        unscheduleDeadlines(rental->getId());
         emit rentalCancelled(rental);
         return true;
     }
@@ -243,61 +376,84 @@ QList<Rental*> RentalManager::getRentalsByDateRange(const QDateTime& start, cons
 
 double RentalManager::calculateTotalRevenue(const QDateTime& start, const QDateTime& end) const
 {
-    QList<Rental*> rentals = getRentalsByDateRange(start, end);
-    double totalRevenue = 0.0;
-    
-    for (Rental* rental : rentals) {
-        if (rental->isCompleted()) {
-            totalRevenue += rental->getFinalPrice();
-        } else {
-            totalRevenue += rental->getTotalPrice();
-        }
-    }
-    
-    return totalRevenue;
+    return computeAnalytics(start, end, MetricRevenue).totalRevenue;
 }
 
 double RentalManager::calculateTotalDeposits(const QDateTime& start, const QDateTime& end) const
 {
-    QList<Rental*> rentals = getRentalsByDateRange(start, end);
-    double totalDeposits = 0.0;
-    
-    for (Rental* rental : rentals) {
-        totalDeposits += rental->getDeposit();
-    }
-    
-    return totalDeposits;
+    return computeAnalytics(start, end, MetricDeposits).totalDeposits;
 }
 
 QMap<QString, int> RentalManager::getEquipmentUsageStats(const QDateTime& start, const QDateTime& end) const
 {
-    QList<Rental*> rentals = getRentalsByDateRange(start, end);
-    QMap<QString, int> stats;
-    
-    for (Rental* rental : rentals) {
-        if (rental->getEquipment()) {
-            QString category = rental->getEquipment()->getCategory();
-            stats[category] = stats.value(category, 0) + rental->getQuantity();
-        }
-    }
-    
-    return stats;
+    return computeAnalytics(start, end, MetricUsageByCategory).usageByCategory;
 }
 
 QMap<QString, double> RentalManager::getCustomerRevenueStats(const QDateTime& start, const QDateTime& end) const
 {
-    QList<Rental*> rentals = getRentalsByDateRange(start, end);
-    QMap<QString, double> stats;
+    return computeAnalytics(start, end, MetricRevenueByCustomer).revenueByCustomer;
+}
+
+RentalSnapshot* RentalManager::snapshot()
+{
+    if (!m_snapshot) {
+        m_snapshot = new RentalSnapshot(this);
+        m_snapshot->attach(this);
+        m_snapshot->load();
+    }
+    return m_snapshot;
+}
+
+RentalAnalytics RentalManager::computeAnalytics(const QDateTime& start, const QDateTime& end,
+                                                AnalyticsMetrics metrics) const
+{
+    RentalAnalytics result;
+    result.computed = metrics;
+    
+    // Одна выборка плоских строк, без загрузки Rental/Customer/Equipment на каждую аренду
+    Database& db = Database::getInstance();
+    QSqlQuery query = db.getRentalAnalyticsRows(start, end);
     
-    for (Rental* rental : rentals) {
-        if (rental->getCustomer()) {
-            QString customerName = rental->getCustomer()->getName();
-            double revenue = rental->isCompleted() ? rental->getFinalPrice() : rental->getTotalPrice();
-            stats[customerName] = stats.value(customerName, 0.0) + revenue;
+    const bool wantRevenue = metrics.testFlag(MetricRevenue);
+    const bool wantDeposits = metrics.testFlag(MetricDeposits);
+    const bool wantUsage = metrics.testFlag(MetricUsageByCategory);
+    const bool wantByCustomer = metrics.testFlag(MetricRevenueByCustomer);
+    const bool wantOverdue = metrics.testFlag(MetricOverdue);
+    const QDateTime now = QDateTime::currentDateTime();
+    
+    // Накопление в хэшах, в упорядоченные QMap переносим один раз в конце
+    QHash<QString, int> usage;
+    QHash<QString, double> byCustomer;
+    
+    while (query.next()) {
+        ++result.rentalCount;
+        const QString status = query.value(0).toString();
+        
+        if (wantRevenue || wantByCustomer) {
+            const double revenue = status == "completed" ? query.value(4).toDouble()
+                                                         : query.value(3).toDouble();
+            if (wantRevenue) result.totalRevenue += revenue;
+            if (wantByCustomer) byCustomer[query.value(6).toString()] += revenue;
+        }
+        if (wantDeposits) {
+            result.totalDeposits += query.value(5).toDouble();
+        }
+        if (wantUsage) {
+            usage[query.value(7).toString()] += query.value(1).toInt();
+        }
+        if (wantOverdue && status == "active" && query.value(2).toDateTime() < now) {
+            ++result.overdueCount;
         }
     }
     
-    return stats;
+    for (auto it = usage.constBegin(); it != usage.constEnd(); ++it) {
+        result.usageByCategory.insert(it.key(), it.value());
+    }
+    for (auto it = byCustomer.constBegin(); it != byCustomer.constEnd(); ++it) {
+        result.revenueByCustomer.insert(it.key(), it.value());
+    }
+    
+    return result;
 }
 
 bool RentalManager::validateRentalRequest(Customer* customer, Equipment* equipment, int quantity,
@@ -331,42 +487,79 @@ QStringList RentalManager::getRentalValidationErrors(Customer* customer, Equipme
     return errors;
 }
 
-void RentalManager::checkOverdueRentals()
+void RentalManager::startOverdueMonitoring()
 {
-    QList<Rental*> overdueRentals = getOverdueRentals();
-    
-    for (Rental* rental : overdueRentals) {
-        emit overdueRentalDetected(rental);
+    // Лёгкий запрос без загрузки клиентов и оборудования: только id и срок
+    m_overdueScheduler->clear();
+    m_reminderScheduler->clear();
+    QSqlQuery query = Database::getInstance().getActiveRentalDeadlines();
+    while (query.next()) {
+        scheduleDeadlines(query.value(0).toInt(), query.value(1).toDateTime());
+    }
+}
+
+void RentalManager::scheduleDeadlines(int rentalId, const QDateTime& endDate)
+{
+    m_overdueScheduler->schedule(rentalId, endDate);
+    // Напоминание, чей срок уже прошёл, сработает сразу; после срока
+    // аренды напоминать не о чем — там будет просрочка
+    if (endDate > QDateTime::currentDateTime()) {
+        m_reminderScheduler->schedule(rentalId, endDate.addSecs(-kReminderLeadHours * 3600));
+    } else {
+        m_reminderScheduler->unschedule(rentalId);
     }
 }
 
-void RentalManager::sendOverdueNotifications()
+void RentalManager::unscheduleDeadlines(int rentalId)
+{
+    m_overdueScheduler->unschedule(rentalId);
+    m_reminderScheduler->unschedule(rentalId);
+}
+
+void RentalManager::onDatabaseReplaced()
 {
-    QList<Rental*> overdueRentals = getOverdueRentals();
+    // Всё, что держится в памяти между событиями, относится к старому файлу
+    PricingEngine::instance().reloadRules();
+    startOverdueMonitoring();
+    if (m_snapshot) m_snapshot->load();
+    emit databaseReplaced();
+}
+
+void RentalManager::onRentalDeadline(int rentalId)
+{
+    Rental* rental = Rental::loadById(rentalId);
+    if (!rental) {
+        return;
+    }
     
-    for (Rental* rental : overdueRentals) {
-        if (rental->getCustomer()) {
-            QString message = QString("Аренда #%1 просрочена! Клиент: %2, Оборудование: %3")
-                            .arg(rental->getId())
-                            .arg(rental->getCustomer()->getName())
-                            .arg(rental->getEquipment() ? rental->getEquipment()->getName() : "Unknown");
-            
-            QMessageBox::warning(nullptr, "Просроченная аренда", message);
-        }
+    if (rental->isOverdue()) {
+        emit overdueRentalDetected(rental);
+        m_notifications->post(NotificationKind::Overdue, rental->getId(), overdueMessage(rental));
+    } else if (rental->isActive()) {
+        // Срок успели продлить в обход менеджера — ставим новый дедлайн
+        scheduleDeadlines(rental->getId(), rental->getEndDate());
     }
+    rental->deleteLater();
 }
 
-void RentalManager::sendReturnReminders()
+void RentalManager::onReminderDeadline(int rentalId)
 {
-    QList<Rental*> activeRentals = getActiveRentals();
-    QDateTime now = QDateTime::currentDateTime();
+    Rental* rental = Rental::loadById(rentalId);
+    if (!rental) {
+        return;
+    }
     
-    for (Rental* rental : activeRentals) {
-        // Напоминаем за день до окончания аренды
-        if (rental->getEndDate().addDays(-1) <= now && rental->getEndDate() > now) {
+    if (rental->isActive() && !rental->isOverdue()) {
+        const QDateTime remindAt = rental->getEndDate().addSecs(-kReminderLeadHours * 3600);
+        if (remindAt > QDateTime::currentDateTime()) {
+            // Срок продлили в обход менеджера — напомним ближе к новому
+            m_reminderScheduler->schedule(rental->getId(), remindAt);
+        } else {
             emit returnReminderNeeded(rental);
+            m_notifications->post(NotificationKind::ReturnReminder, rental->getId(), reminderMessage(rental));
         }
     }
+    rental->deleteLater();
 }
 
 bool RentalManager::reserveEquipment(Equipment* equipment, int quantity)
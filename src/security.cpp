@@ -6,10 +6,13 @@
 #include <QDateTime>
 #include <QTimer>
 #include <QCryptographicHash>
+#include <QMessageAuthenticationCode>
 #include <QDataStream>
 #include <QBuffer>
 #include <QIODevice>
-#include <QMessageAuthenticationCode>
+#include "Pbkdf2.h"
+#include "Aead.h"
+#include "AdminAuthDialog.h"
 
 Security* Security::m_instance = nullptr;
 
@@ -68,17 +71,15 @@ bool Security::authenticate()
         
         QMessageBox::information(nullptr, "Успех", "Мастер-пароль установлен!");
     } else {
-        // Запрашиваем мастер-пароль
-        bool ok;
-        QString password = QInputDialog::getText(nullptr, "Аутентификация",
-                                               "Введите мастер-пароль:",
-                                               QLineEdit::Password, "", &ok);
-        if (!ok || password.isEmpty()) {
-            return false;
-        }
-        
-        if (!verifyMasterPassword(password)) {
-            QMessageBox::critical(nullptr, "Ошибка", "Неверный пароль!");
+        // Запрашиваем мастер-пароль (проверка — в фоне, см. AdminAuthDialog)
+        AdminAuthDialog dlg;
+        dlg.setPrompt("Аутентификация", "Введите мастер-пароль:");
+        const MasterPasswordState state = masterPasswordState();
+        dlg.setVerifier([state](const QString& password) { return masterPasswordVerdict(password, state); });
+        if (dlg.exec() != QDialog::Accepted) {
+            if (dlg.failedAttempts() > 0) {
+                QMessageBox::critical(nullptr, "Ошибка", "Неверный пароль!");
+            }
             return false;
         }
     }
@@ -108,19 +109,22 @@ QString Security::authenticateAndGetPassword(int maxAttempts)
         startSession();
         return pw1;
     }
-    for (int attempt = 0; attempt < maxAttempts; ++attempt) {
-        bool ok;
-        QString password = QInputDialog::getText(nullptr, "Аутентификация",
-                                                 "Введите мастер-пароль:", QLineEdit::Password, "", &ok);
-        if (!ok) return QString();
-        if (verifyMasterPassword(password)) {
-            m_instance->m_isAuthenticated = true;
-            startSession();
-            return password;
+    // Проверка идёт в потоке окна: пока растягивается пароль, окно живо,
+    // а запущенная до запроса работа (открытие БД) продолжается
+    AdminAuthDialog dlg;
+    dlg.setPrompt("Аутентификация", "Введите мастер-пароль:");
+    const MasterPasswordState state = masterPasswordState();
+    dlg.setVerifier([state](const QString& password) { return masterPasswordVerdict(password, state); },
+                    maxAttempts);
+    if (dlg.exec() != QDialog::Accepted) {
+        if (dlg.failedAttempts() > 0) {
+            QMessageBox::critical(nullptr, "Ошибка", "Неверный пароль");
         }
-        QMessageBox::critical(nullptr, "Ошибка", "Неверный пароль");
+        return QString();
     }
-    return QString();
+    m_instance->m_isAuthenticated = true;
+    startSession();
+    return dlg.password();
 }
 
 bool Security::changePassword()
@@ -172,43 +176,81 @@ void Security::logout()
     if (m_instance) {
         m_instance->endSession();
         m_instance->m_isAuthenticated = false;
+        m_instance->m_encryptionKey.clear();
     }
 }
 
 QByteArray Security::encryptData(const QByteArray& data)
 {
-    if (!m_instance || !m_instance->m_isAuthenticated) {
+    if (!m_instance || !m_instance->m_isAuthenticated || !hasDataKey()) {
         return QByteArray();
     }
     
-    // Простое XOR шифрование (в реальном проекте используйте более надежные алгоритмы)
-    QByteArray encrypted = data;
-    QByteArray key = m_instance->m_encryptionKey;
-    
-    for (int i = 0; i < encrypted.size(); ++i) {
-        encrypted[i] = encrypted[i] ^ key[i % key.size()];
-    }
-    
-    return encrypted;
+    // ChaCha20-Poly1305 на ключе данных: nonce || шифртекст || тег
+    return Aead::seal(m_instance->m_encryptionKey, data);
 }
 
 QByteArray Security::decryptData(const QByteArray& encryptedData)
 {
-    if (!m_instance || !m_instance->m_isAuthenticated) {
+    if (!m_instance || !m_instance->m_isAuthenticated || !hasDataKey()) {
         return QByteArray();
     }
     
-    // XOR дешифрование
-    QByteArray decrypted = encryptedData;
-    QByteArray key = m_instance->m_encryptionKey;
-    
-    for (int i = 0; i < decrypted.size(); ++i) {
-        decrypted[i] = decrypted[i] ^ key[i % key.size()];
+    QByteArray decrypted;
+    if (!Aead::open(m_instance->m_encryptionKey, encryptedData, &decrypted)) {
+        qDebug() << "Данные повреждены или зашифрованы другим ключом";
+        return QByteArray();
     }
-    
     return decrypted;
 }
 
+bool Security::encryptField(const QString& value, const QString& context, QString* out)
+{
+    if (value.isEmpty()) {
+        *out = value;
+        return true;
+    }
+    if (!hasDataKey()) {
+        qDebug() << "Ключ данных не загружен, поле" << context << "не зашифровано";
+        return false;
+    }
+    const QByteArray sealed = Aead::seal(m_instance->m_encryptionKey, value.toUtf8(), context.toUtf8());
+    *out = QStringLiteral("enc1:") + QString::fromLatin1(sealed.toBase64());
+    return true;
+}
+
+QString Security::decryptField(const QString& stored, const QString& context)
+{
+    if (!isEncryptedField(stored)) {
+        return stored; // записано до включения шифрования
+    }
+    if (!hasDataKey()) {
+        return QString();
+    }
+    QByteArray plain;
+    const QByteArray sealed = QByteArray::fromBase64(stored.mid(5).toLatin1());
+    if (!Aead::open(m_instance->m_encryptionKey, sealed, &plain, context.toUtf8())) {
+        qDebug() << "Не удалось расшифровать поле" << context;
+        return QString();
+    }
+    return QString::fromUtf8(plain);
+}
+
+bool Security::isEncryptedField(const QString& stored)
+{
+    return stored.startsWith(QLatin1String("enc1:"));
+}
+
+bool Security::hasDataKey()
+{
+    return m_instance && m_instance->m_encryptionKey.size() == Aead::kKeySize;
+}
+
+QByteArray Security::dataKey()
+{
+    return hasDataKey() ? m_instance->m_encryptionKey : QByteArray();
+}
+
 QString Security::encryptString(const QString& text)
 {
     QByteArray data = text.toUtf8();
@@ -229,15 +271,26 @@ bool Security::setMasterPassword(const QString& password)
         return false;
     }
     
-    QString salt = generateSalt();
-    QString hash = hashPassword(password, salt);
+    // Число итераций подбирается под время разблокировки на этой машине;
+    // соль и итерации хранятся в самой записи
+    const MasterKeys keys = makeMasterKeys(password);
     
+    // Ключ данных при смене пароля не меняется — только перешифровывается
+    // новым паролем, иначе прежние поля и резервные копии не прочитать
     QSettings settings;
-    settings.setValue("security/master_password_hash", hash);
-    settings.setValue("security/salt", salt);
-    // Ключ шифрования больше не запрашиваем отдельно
-    m_instance->m_encryptionKey.clear();
-    
+    if (!hasDataKey()) {
+        if (settings.contains("security/data_key")) {
+            qDebug() << "Ключ данных создан заново: прежние зашифрованные данные недоступны";
+        }
+        m_instance->m_encryptionKey = Aead::randomBytes(Aead::kKeySize);
+    }
+    const QString wrapped = wrapDataKey(keys.kek, m_instance->m_encryptionKey);
+    if (keys.record.isEmpty() || wrapped.isEmpty()) {
+        return false;
+    }
+    settings.setValue("security/master_password_hash", keys.record);
+    settings.remove("security/salt");
+    settings.setValue("security/data_key", wrapped);
     return true;
 }
 
@@ -247,15 +300,103 @@ bool Security::verifyMasterPassword(const QString& password)
         return false;
     }
     
-    QString storedHash = getMasterPasswordHash();
-    QString salt = QSettings().value("security/salt").toString();
+    const MasterPasswordCheck check = checkMasterPassword(password, masterPasswordState());
+    applyMasterPasswordCheck(check);
+    return check.ok;
+}
+
+Security::MasterPasswordState Security::masterPasswordState()
+{
+    QSettings settings;
+    MasterPasswordState state;
+    state.record = settings.value("security/master_password_hash").toString();
+    state.legacySalt = settings.value("security/salt").toString();
+    state.wrappedKey = settings.value("security/data_key").toString();
+    return state;
+}
+
+Security::MasterPasswordCheck Security::checkMasterPassword(const QString& password,
+                                                            const MasterPasswordState& state)
+{
+    MasterPasswordCheck check;
+    if (state.record.isEmpty()) {
+        return check;
+    }
     
-    if (storedHash.isEmpty() || salt.isEmpty()) {
-        return false;
+    QByteArray kek;
+    if (masterRecordIterations(state.record) > 0) {
+        // Обычный вход: одно растяжение и на проверку, и на ключ данных
+        check.ok = openMasterRecord(password, state.record, &kek);
+        if (!check.ok) {
+            return check;
+        }
+        if (state.wrappedKey.isEmpty()) {
+            // Пароль задан до появления шифрования полей — создаём ключ сейчас
+            check.dataKey = Aead::randomBytes(Aead::kKeySize);
+            check.wrappedKey = wrapDataKey(kek, check.dataKey);
+        } else {
+            check.dataKey = unwrapDataKey(kek, state.wrappedKey);
+        }
+        return check;
     }
     
-    QString hash = hashPassword(password, salt);
-    return hash == storedHash;
+    // Прежние форматы переводятся один раз, при первом успешном входе:
+    // запись PBKDF2, хранившая сам результат растяжения, и одиночный SHA-256
+    int iterations = 0;
+    if (Pbkdf2::isRecord(state.record)) {
+        check.ok = Pbkdf2::verifyRecord(password, state.record);
+        iterations = Pbkdf2::recordIterations(state.record);
+    } else if (!state.legacySalt.isEmpty()) {
+        const QString hash = hashPassword(password, state.legacySalt);
+        check.ok = Pbkdf2::constantTimeEquals(hash.toLatin1(), state.record.toLatin1());
+    }
+    if (!check.ok) {
+        return check;
+    }
+    if (!state.wrappedKey.isEmpty()) {
+        check.dataKey = unwrapLegacyDataKey(password, state.wrappedKey);
+    }
+    if (check.dataKey.isEmpty()) {
+        if (!state.wrappedKey.isEmpty()) {
+            qDebug() << "Ключ данных создан заново: прежние зашифрованные данные недоступны";
+        }
+        check.dataKey = Aead::randomBytes(Aead::kKeySize);
+    }
+    const MasterKeys keys = makeMasterKeys(password, iterations);
+    check.record = keys.record;
+    check.wrappedKey = wrapDataKey(keys.kek, check.dataKey);
+    return check;
+}
+
+void Security::applyMasterPasswordCheck(const MasterPasswordCheck& check)
+{
+    if (!m_instance || !check.ok) {
+        return;
+    }
+    QSettings settings;
+    if (!check.record.isEmpty() && !check.wrappedKey.isEmpty()) {
+        settings.setValue("security/master_password_hash", check.record);
+        settings.remove("security/salt");
+    }
+    if (!check.wrappedKey.isEmpty()) {
+        settings.setValue("security/data_key", check.wrappedKey);
+    }
+    if (check.dataKey.size() == Aead::kKeySize) {
+        m_instance->m_encryptionKey = check.dataKey;
+    } else {
+        qDebug() << "Ключ данных не расшифрован: зашифрованные поля недоступны";
+    }
+}
+
+AdminAuthDialog::Verdict Security::masterPasswordVerdict(const QString& password,
+                                                         const MasterPasswordState& state)
+{
+    // Рабочий поток окна пароля: только расчёт, состояние меняет apply
+    const MasterPasswordCheck check = checkMasterPassword(password, state);
+    AdminAuthDialog::Verdict verdict;
+    verdict.ok = check.ok;
+    verdict.apply = [check]() { applyMasterPasswordCheck(check); };
+    return verdict;
 }
 
 bool Security::hasMasterPassword()
@@ -337,16 +478,7 @@ void Security::setMasterPasswordHash(const QString& hash)
     QSettings().setValue("security/master_password_hash", hash);
 }
 
-QString Security::generateSalt()
-{
-    const QString chars = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
-    QString salt;
-    for (int i = 0; i < 32; ++i) {
-        salt += chars[QRandomGenerator::global()->bounded(chars.length())];
-    }
-    return salt;
-}
-
+// Хеш старого формата — только для проверки и перевода прежних записей
 QString Security::hashPassword(const QString& password, const QString& salt)
 {
     QByteArray data = (password + salt).toUtf8();
@@ -361,27 +493,129 @@ QByteArray Security::generateEncryptionKey()
 
 QByteArray Security::deriveKeyFromPassword(const QString& password, const QByteArray& salt, int iterations)
 {
-    // PBKDF2-HMAC-SHA256
-    QByteArray key(32, 0);
-    int blocks = (key.size() + 31) / 32;
-    for (int block = 1; block <= blocks; ++block) {
-        QByteArray u;
-        QByteArray t(32, 0);
-        // U1 = HMAC(password, salt || INT(block))
-        QByteArray data = salt;
-        data.append(char((block >> 24) & 0xFF));
-        data.append(char((block >> 16) & 0xFF));
-        data.append(char((block >> 8) & 0xFF));
-        data.append(char(block & 0xFF));
-        u = QMessageAuthenticationCode::hash(data, password.toUtf8(), QCryptographicHash::Sha256);
-        t = u;
-        for (int i = 1; i < iterations; ++i) {
-            u = QMessageAuthenticationCode::hash(u, password.toUtf8(), QCryptographicHash::Sha256);
-            for (int j = 0; j < 32; ++j) t[j] = t[j] ^ u[j];
-        }
-        for (int k = 0; k < 32 && (k + (block - 1) * 32) < key.size(); ++k) {
-            key[k + (block - 1) * 32] = t[k];
-        }
+    // PBKDF2-HMAC-SHA256: пары ipad/opad считаются один раз, итерации — без выделений
+    return Pbkdf2::derive(password.toUtf8(), salt, iterations);
+}
+
+// Запись мастер-пароля: "pbkdf2-sha256-kek$<итерации>$<соль>$<проверка>".
+// master = PBKDF2(пароль, соль, итерации); в записи — только
+// HMAC(master, "master-verify-v1"), ключ обёртки ключа данных —
+// HMAC(master, "data-key-kek-v1"). Оба значения получаются из одного
+// растяжения, поэтому вход стоит ровно одну калиброванную задержку
+namespace {
+const QLatin1String kMasterScheme("pbkdf2-sha256-kek");
+const QByteArray kVerifyLabel("master-verify-v1");
+const QByteArray kKekLabel("data-key-kek-v1");
+
+QByteArray masterSubkey(const QByteArray& master, const QByteArray& label)
+{
+    return QMessageAuthenticationCode::hash(label, master, QCryptographicHash::Sha256);
+}
+
+bool parseMasterRecord(const QString& record, int* iterations, QByteArray* salt, QByteArray* verifier)
+{
+    const QStringList parts = record.split('$');
+    if (parts.size() != 4 || parts[0] != kMasterScheme) {
+        return false;
+    }
+    bool ok = false;
+    const int it = parts[1].toInt(&ok);
+    if (!ok || it <= 0 || it > Pbkdf2::kMaxIterations) {
+        return false;
+    }
+    const QByteArray s = QByteArray::fromBase64(parts[2].toLatin1());
+    const QByteArray v = QByteArray::fromBase64(parts[3].toLatin1());
+    if (s.isEmpty() || v.size() != Pbkdf2::kKeySize) {
+        return false;
+    }
+    if (iterations) *iterations = it;
+    if (salt) *salt = s;
+    if (verifier) *verifier = v;
+    return true;
+}
+} // namespace
+
+Security::MasterKeys Security::makeMasterKeys(const QString& password, int iterations)
+{
+    if (iterations <= 0) {
+        iterations = Pbkdf2::calibrate();
+    }
+    const QByteArray salt = Pbkdf2::randomSalt();
+    const QByteArray master = Pbkdf2::derive(password.toUtf8(), salt, iterations);
+    MasterKeys keys;
+    keys.record = QStringLiteral("%1$%2$%3$%4")
+            .arg(kMasterScheme)
+            .arg(iterations)
+            .arg(QString::fromLatin1(salt.toBase64()))
+            .arg(QString::fromLatin1(masterSubkey(master, kVerifyLabel).toBase64()));
+    keys.kek = masterSubkey(master, kKekLabel);
+    return keys;
+}
+
+bool Security::openMasterRecord(const QString& password, const QString& record, QByteArray* kek)
+{
+    int iterations = 0;
+    QByteArray salt, verifier;
+    if (!parseMasterRecord(record, &iterations, &salt, &verifier)) {
+        return false;
+    }
+    const QByteArray master = Pbkdf2::derive(password.toUtf8(), salt, iterations);
+    if (!Pbkdf2::constantTimeEquals(masterSubkey(master, kVerifyLabel), verifier)) {
+        return false;
+    }
+    if (kek) {
+        *kek = masterSubkey(master, kKekLabel);
+    }
+    return true;
+}
+
+int Security::masterRecordIterations(const QString& record)
+{
+    int iterations = 0;
+    return parseMasterRecord(record, &iterations, nullptr, nullptr) ? iterations : 0;
+}
+
+// Ключ данных (случайный, 32 байта) хранится зашифрованным ключом обёртки
+// из записи мастер-пароля: "chacha20poly1305-kek$<ключ в AEAD>"
+QString Security::wrapDataKey(const QByteArray& kek, const QByteArray& dataKey)
+{
+    const QByteArray wrapped = Aead::seal(kek, dataKey, QByteArrayLiteral("data-key"));
+    if (wrapped.isEmpty()) {
+        return QString();
+    }
+    return QStringLiteral("chacha20poly1305-kek$%1").arg(QString::fromLatin1(wrapped.toBase64()));
+}
+
+QByteArray Security::unwrapDataKey(const QByteArray& kek, const QString& stored)
+{
+    const QStringList parts = stored.split('$');
+    if (parts.size() != 2 || parts[0] != QLatin1String("chacha20poly1305-kek")) {
+        return QByteArray();
+    }
+    const QByteArray wrapped = QByteArray::fromBase64(parts[1].toLatin1());
+    QByteArray key;
+    if (!Aead::open(kek, wrapped, &key, QByteArrayLiteral("data-key")) || key.size() != Aead::kKeySize) {
+        return QByteArray();
+    }
+    return key;
+}
+
+// Прежний формат со своим растяжением: "chacha20poly1305$<итерации>$<соль>$<ключ>".
+// Читается только при переводе записи, после чего перезаписывается
+QByteArray Security::unwrapLegacyDataKey(const QString& password, const QString& stored)
+{
+    const QStringList parts = stored.split('$');
+    bool ok = false;
+    const int iterations = parts.size() == 4 ? parts[1].toInt(&ok) : 0;
+    if (!ok || iterations <= 0 || parts[0] != QLatin1String("chacha20poly1305")) {
+        return QByteArray();
+    }
+    const QByteArray salt = QByteArray::fromBase64(parts[2].toLatin1());
+    const QByteArray wrapped = QByteArray::fromBase64(parts[3].toLatin1());
+    const QByteArray kek = Pbkdf2::derive(password.toUtf8(), salt, iterations);
+    QByteArray key;
+    if (!Aead::open(kek, wrapped, &key, QByteArrayLiteral("data-key")) || key.size() != Aead::kKeySize) {
+        return QByteArray();
     }
     return key;
 }